@@ -0,0 +1,374 @@
+#include "BatchConverter.h"
+
+#include <chrono>
+#include <cctype>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <iostream>
+#include <algorithm>
+#include <filesystem>
+#include <unordered_map>
+#include <unordered_set>
+#include <unistd.h>
+
+#include "ObjLoader.h"
+#include "ModelCache.h"
+#include "MeshOptimizer.h"
+#include "JobScheduler.h"
+#include "ThreadPool.h"
+#include "Profiler.h"
+
+static double get_elapsed_ms(std::chrono::steady_clock::time_point start_time) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start_time).count();
+}
+
+// --------------------------------------------------------------------------
+
+static bool is_obj_file(const std::filesystem::path& path) {
+    std::string extension = path.extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return std::tolower(c); });
+    return extension == ".obj";
+}
+
+// --------------------------------------------------------------------------
+
+static bool add_input(const std::filesystem::path& path, std::vector<ConversionInput>& inputs) {
+    std::error_code error;
+    if (std::filesystem::is_directory(path, error)) {
+        // Keep the layout under the directory, so same-named files in different
+        // folders don't overwrite each other.
+        for (std::filesystem::recursive_directory_iterator it(path, error), end; !error && it != end; it.increment(error)) {
+            if (!it->is_regular_file(error) || !is_obj_file(it->path())) {
+                continue;
+            }
+
+            std::filesystem::path output_name = std::filesystem::relative(it->path(), path, error).replace_extension();
+            inputs.push_back({it->path().string(), output_name.string(), (uint64_t)it->file_size(error)});
+        }
+
+        if (error) {
+            std::cerr << "[ERROR] Could not read directory \"" << path.string() << "\": " << error.message() << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    uint64_t size = std::filesystem::file_size(path, error);
+    if (error) {
+        std::cerr << "[ERROR] Could not open file \"" << path.string() << "\"" << std::endl;
+        return false;
+    }
+
+    inputs.push_back({path.string(), path.stem().string(), size});
+    return true;
+}
+
+// --------------------------------------------------------------------------
+
+BatchConverter::BatchConverter(const ConversionSettings& settings)
+:
+settings(settings),
+finished_file_count(0),
+wall_time_ms(0.0),
+steal_count(0) {
+    // A thread count of 0 or less means one thread per hardware thread.
+    if (this->settings.thread_count <= 0) {
+        this->settings.thread_count = ThreadPool::get_hardware_thread_count();
+    }
+}
+
+// --------------------------------------------------------------------------
+
+BatchConverter::~BatchConverter() {
+    // do nothing for now
+}
+
+// --------------------------------------------------------------------------
+
+std::optional<std::vector<ConversionInput>> BatchConverter::find_inputs(const std::vector<std::string>& input_paths) {
+    // Each input is an OBJ file, a directory searched recursively for OBJ files, or
+    // @LIST_FILE naming one file or directory per line. Relative paths in a list are
+    // relative to the list file.
+    std::vector<ConversionInput> inputs;
+    for (const std::string& input_path : input_paths) {
+        if (input_path.size() < 2 || input_path[0] != '@') {
+            if (!add_input(input_path, inputs)) {
+                return std::nullopt;
+            }
+            continue;
+        }
+
+        std::string list_file_path = input_path.substr(1);
+        std::ifstream list_file(list_file_path);
+        if (!list_file) {
+            std::cerr << "[ERROR] Could not open file list \"" << list_file_path << "\"" << std::endl;
+            return std::nullopt;
+        }
+
+        std::filesystem::path base_directory = std::filesystem::path(list_file_path).parent_path();
+        std::string line;
+        while (std::getline(list_file, line)) {
+            size_t first = line.find_first_not_of(" \t\r");
+            if (first == std::string::npos || line[first] == '#') {
+                continue;
+            }
+            size_t last = line.find_last_not_of(" \t\r");
+
+            std::filesystem::path listed_path = line.substr(first, last - first + 1);
+            if (!add_input(listed_path.is_absolute() ? listed_path : base_directory / listed_path, inputs)) {
+                return std::nullopt;
+            }
+        }
+    }
+
+    // The same file reached twice is only converted once, but two different files
+    // can't share an output.
+    std::vector<ConversionInput> unique_inputs;
+    std::unordered_set<std::string> canonical_paths;
+    std::unordered_map<std::string, std::string> output_name_owners;
+    for (ConversionInput& input : inputs) {
+        std::error_code error;
+        std::string canonical_path = std::filesystem::weakly_canonical(input.file_path, error).string();
+        if (!canonical_paths.insert(error ? input.file_path : canonical_path).second) {
+            continue;
+        }
+
+        auto [owner, is_new_output_name] = output_name_owners.emplace(input.output_name, input.file_path);
+        if (!is_new_output_name) {
+            std::cerr << "[ERROR] \"" << owner->second << "\" and \"" << input.file_path << "\" would both be converted to \"" << input.output_name << "\"" << std::endl;
+            return std::nullopt;
+        }
+
+        unique_inputs.push_back(std::move(input));
+    }
+
+    return unique_inputs;
+}
+
+// --------------------------------------------------------------------------
+
+bool BatchConverter::convert(std::vector<ConversionInput> inputs) {
+    std::error_code error;
+    std::filesystem::create_directories(settings.output_directory, error);
+    if (error) {
+        std::cerr << "[ERROR] Could not create output directory \"" << settings.output_directory << "\": " << error.message() << std::endl;
+        return false;
+    }
+
+    // Start the biggest files first. A big file that starts last keeps the batch
+    // running long after every other worker has gone idle.
+    std::stable_sort(inputs.begin(), inputs.end(), [](const ConversionInput& a, const ConversionInput& b) {
+        return a.size > b.size;
+    });
+
+    results.assign(inputs.size(), ConversionResult());
+    finished_file_count = 0;
+
+    std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+
+    JobScheduler job_scheduler(settings.thread_count);
+    for (size_t i = 0; i < inputs.size(); i++) {
+        job_scheduler.submit([this, &inputs, &job_scheduler, i]() {
+            results[i] = convert_file(inputs[i], job_scheduler);
+            finish_file(results[i], inputs.size());
+        });
+    }
+    job_scheduler.wait_for_all();
+
+    wall_time_ms = get_elapsed_ms(start_time);
+    steal_count = job_scheduler.get_steal_count();
+
+    return std::all_of(results.begin(), results.end(), [](const ConversionResult& result) { return result.succeeded; });
+}
+
+// --------------------------------------------------------------------------
+
+void BatchConverter::print_summary() const {
+    int succeeded_count = 0;
+    uint64_t input_size = 0;
+    long long face_count = 0;
+    double busy_time_ms = 0.0;
+    for (const ConversionResult& result : results) {
+        if (result.succeeded) {
+            succeeded_count++;
+            input_size += result.input_size;
+            face_count += result.face_count;
+        }
+        busy_time_ms += result.total_ms;
+    }
+
+    double wall_time_seconds = wall_time_ms / 1000.0;
+    double input_size_mb = input_size / (1024.0 * 1024.0);
+
+    std::ostringstream summary;
+    summary << std::fixed << std::setprecision(1);
+    summary << std::endl;
+    summary << "Converted " << succeeded_count << " of " << results.size() << " files";
+    if (succeeded_count < (int)results.size()) {
+        summary << " (" << (results.size() - succeeded_count) << " failed)";
+    }
+    summary << " in " << std::setprecision(2) << wall_time_seconds << " s on " << settings.thread_count << " threads" << std::endl;
+
+    summary << std::setprecision(1);
+    summary << "Input: " << input_size_mb << " MB, " << face_count << " faces" << std::endl;
+    if (wall_time_seconds > 0.0) {
+        summary << "Throughput: " << (input_size_mb / wall_time_seconds) << " MB/s, " << (long long)(face_count / wall_time_seconds) << " faces/s" << std::endl;
+        summary << "Time spent on files: " << (busy_time_ms / 1000.0) << " s (" << (busy_time_ms / wall_time_ms) << "x the wall time), "
+                << steal_count << " stolen jobs" << std::endl;
+    }
+
+    std::cout << summary.str();
+}
+
+// --------------------------------------------------------------------------
+
+const std::vector<ConversionResult>& BatchConverter::get_results() const {
+    return results;
+}
+
+// --------------------------------------------------------------------------
+
+ConversionResult BatchConverter::convert_file(const ConversionInput& input, JobScheduler& job_scheduler) {
+    PROFILE_SCOPE("BatchConverter::convert_file");
+
+    std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+
+    ConversionResult result = {input.file_path, "", false, input.size, 0, 0.0, 0.0, 0.0, 0.0};
+
+    // Parsing is split into sub-tasks on the shared scheduler so that one huge file
+    // spreads across workers. The steps after it run on this worker alone.
+    ObjLoader obj_loader;
+    obj_loader.set_job_scheduler(&job_scheduler);
+    std::optional<Model> model = obj_loader.load_from_file(input.file_path);
+    result.load_ms = get_elapsed_ms(start_time);
+    if (!model.has_value()) {
+        std::cerr << "[ERROR] Could not convert \"" << input.file_path << "\"" << std::endl;
+        result.total_ms = get_elapsed_ms(start_time);
+        return result;
+    }
+    result.face_count = model->get_faces().size();
+
+    std::chrono::steady_clock::time_point process_start_time = std::chrono::steady_clock::now();
+    if (settings.generate_normals || model->has_missing_normals()) {
+        NormalGenerator normal_generator;
+        normal_generator.set_thread_count(1);
+        normal_generator.set_weighting(settings.normal_weighting);
+        normal_generator.set_crease_angle(settings.crease_angle_degrees);
+        normal_generator.generate(model.value(), settings.normal_type);
+    }
+
+    IndexedBufferData indexed_buffer_data = model->get_indexed_buffer_data();
+
+    if (settings.optimize_mesh) {
+        MeshOptimizer mesh_optimizer;
+        mesh_optimizer.set_thread_count(1);
+        mesh_optimizer.optimize_vertex_cache(indexed_buffer_data);
+        if (settings.optimize_overdraw) {
+            mesh_optimizer.optimize_overdraw(indexed_buffer_data);
+        }
+        mesh_optimizer.optimize_vertex_fetch(indexed_buffer_data);
+    }
+    result.process_ms = get_elapsed_ms(process_start_time);
+
+    std::chrono::steady_clock::time_point write_start_time = std::chrono::steady_clock::now();
+    bool is_written;
+    if (settings.format == ConversionFormat::CACHE) {
+        // The same cache the viewer reads with --cache-dir and --cache-buffer.
+        ModelCache model_cache;
+        model_cache.set_cache_directory(settings.output_directory);
+        model_cache.set_processing_settings({settings.generate_normals, settings.normal_type, settings.normal_weighting, settings.crease_angle_degrees,
+                                             settings.optimize_mesh, settings.optimize_overdraw});
+        result.output_file_path = settings.output_directory;
+        is_written = model_cache.store(input.file_path, model.value(), &indexed_buffer_data);
+    } else {
+        VertexEncoder vertex_encoder;
+        EncodedVertexBuffer encoded_vertex_buffer = vertex_encoder.encode(indexed_buffer_data, settings.vertex_format, model->get_extents());
+        result.output_file_path = (std::filesystem::path(settings.output_directory) / (input.output_name + ".mesh")).string();
+        is_written = write_mesh_file(result.output_file_path, encoded_vertex_buffer, indexed_buffer_data);
+    }
+    result.write_ms = get_elapsed_ms(write_start_time);
+
+    if (!is_written) {
+        std::cerr << "[ERROR] Could not write the conversion of \"" << input.file_path << "\" to \"" << result.output_file_path << "\"" << std::endl;
+    }
+
+    result.succeeded = is_written;
+    result.total_ms = get_elapsed_ms(start_time);
+    return result;
+}
+
+// --------------------------------------------------------------------------
+
+void BatchConverter::finish_file(const ConversionResult& result, int total_file_count) {
+    std::lock_guard<std::mutex> lock(results_mutex);
+    finished_file_count++;
+
+    std::ostringstream line;
+    line << std::fixed << std::setprecision(1);
+    line << "[" << finished_file_count << "/" << total_file_count << "] " << result.input_file_path << ": ";
+    if (!result.succeeded) {
+        line << "failed after " << result.total_ms << " ms";
+    } else {
+        line << (result.input_size / (1024.0 * 1024.0)) << " MB, " << result.face_count << " faces in " << result.total_ms << " ms"
+             << " (load " << result.load_ms << ", process " << result.process_ms << ", write " << result.write_ms << ")";
+    }
+    std::cout << line.str() << std::endl;
+}
+
+// --------------------------------------------------------------------------
+
+bool BatchConverter::write_mesh_file(const std::string& mesh_file_path, const EncodedVertexBuffer& encoded_vertex_buffer, const IndexedBufferData& indexed_buffer_data) {
+    // A header followed by the encoded vertex buffer and the index buffer, both
+    // exactly as they're uploaded to the GPU.
+    MeshFileHeader header = {};
+    std::memcpy(header.magic, "OBJVMESH", sizeof(header.magic));
+    header.version = MESH_FORMAT_VERSION;
+    header.vertex_format = (uint32_t)encoded_vertex_buffer.format;
+    header.vertex_count = encoded_vertex_buffer.vertex_count;
+    header.bytes_per_vertex = encoded_vertex_buffer.bytes_per_vertex;
+    header.normal_offset = encoded_vertex_buffer.normal_offset;
+    header.index_count = indexed_buffer_data.indices.size();
+    header.index_size_in_bytes = indexed_buffer_data.index_size_in_bytes;
+    for (int axis = 0; axis < 3; axis++) {
+        header.position_offset[axis] = encoded_vertex_buffer.position_offset[axis];
+        header.position_scale[axis] = encoded_vertex_buffer.position_scale[axis];
+    }
+
+    std::error_code error;
+    std::filesystem::create_directories(std::filesystem::path(mesh_file_path).parent_path(), error);
+    if (error) {
+        return false;
+    }
+
+    // Write next to the target and rename it into place, so a crash never leaves a
+    // half-written mesh behind.
+    std::string temporary_file_path = mesh_file_path + ".tmp" + std::to_string(getpid());
+    {
+        std::ofstream file(temporary_file_path, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char*>(&header), sizeof(MeshFileHeader));
+        file.write(reinterpret_cast<const char*>(encoded_vertex_buffer.data.data()), encoded_vertex_buffer.data.size());
+
+        if (indexed_buffer_data.index_size_in_bytes == sizeof(uint16_t)) {
+            std::vector<uint16_t> short_indices(indexed_buffer_data.indices.begin(), indexed_buffer_data.indices.end());
+            file.write(reinterpret_cast<const char*>(short_indices.data()), short_indices.size() * sizeof(uint16_t));
+        } else {
+            file.write(reinterpret_cast<const char*>(indexed_buffer_data.indices.data()), indexed_buffer_data.indices.size() * sizeof(uint32_t));
+        }
+
+        if (!file) {
+            file.close();
+            std::filesystem::remove(temporary_file_path, error);
+            return false;
+        }
+    }
+
+    std::filesystem::rename(temporary_file_path, mesh_file_path, error);
+    if (error) {
+        std::filesystem::remove(temporary_file_path, error);
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,98 @@
+#ifndef BATCH_CONVERTER_H
+#define BATCH_CONVERTER_H
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <optional>
+#include <cstdint>
+
+#include "Model.h"
+#include "NormalGenerator.h"
+#include "VertexEncoder.h"
+
+class JobScheduler;
+
+enum class ConversionFormat {
+    CACHE,
+    MESH
+};
+
+struct ConversionSettings {
+    std::string output_directory;
+    ConversionFormat format;
+    int thread_count;
+    bool generate_normals;
+    NormalType normal_type;
+    NormalWeighting normal_weighting;
+    float crease_angle_degrees;
+    bool optimize_mesh;
+    bool optimize_overdraw;
+    VertexFormat vertex_format;
+};
+
+struct ConversionInput {
+    std::string file_path;
+    std::string output_name;
+    uint64_t size;
+};
+
+struct ConversionResult {
+    std::string input_file_path;
+    std::string output_file_path;
+    bool succeeded;
+    uint64_t input_size;
+    long long face_count;
+    double load_ms;
+    double process_ms;
+    double write_ms;
+    double total_ms;
+};
+
+class BatchConverter {
+
+public:
+
+    BatchConverter(const ConversionSettings& settings);
+    ~BatchConverter();
+
+    static std::optional<std::vector<ConversionInput>> find_inputs(const std::vector<std::string>& input_paths);
+
+    bool convert(std::vector<ConversionInput> inputs);
+    void print_summary() const;
+
+    const std::vector<ConversionResult>& get_results() const;
+
+private:
+
+    static const uint64_t MESH_FORMAT_VERSION = 1;
+
+    struct MeshFileHeader {
+        char magic[8];
+        uint64_t version;
+        uint32_t vertex_format;
+        uint32_t vertex_count;
+        uint32_t bytes_per_vertex;
+        uint32_t normal_offset;
+        uint32_t index_count;
+        uint32_t index_size_in_bytes;
+        float position_offset[3];
+        float position_scale[3];
+    };
+
+    ConversionSettings settings;
+
+    std::vector<ConversionResult> results;
+    int finished_file_count;
+    std::mutex results_mutex;
+
+    double wall_time_ms;
+    long long steal_count;
+
+    ConversionResult convert_file(const ConversionInput& input, JobScheduler& job_scheduler);
+    void finish_file(const ConversionResult& result, int total_file_count);
+
+    bool write_mesh_file(const std::string& mesh_file_path, const EncodedVertexBuffer& encoded_vertex_buffer, const IndexedBufferData& indexed_buffer_data);
+};
+
+#endif
@@ -0,0 +1,150 @@
+#include "Benchmark.h"
+
+#include <cmath>
+#include <algorithm>
+#include <numeric>
+
+static std::string escape_json_string(const std::string& str) {
+    std::string escaped;
+    for (char c : str) {
+        if (c == '"' || c == '\\') {
+            escaped += '\\';
+            escaped += c;
+        } else if ((unsigned char)c < 0x20) {
+            const char* hex_digits = "0123456789abcdef";
+            escaped += "\\u00";
+            escaped += hex_digits[(c >> 4) & 0xf];
+            escaped += hex_digits[c & 0xf];
+        } else {
+            escaped += c;
+        }
+    }
+
+    return escaped;
+}
+
+// --------------------------------------------------------------------------
+
+Benchmark::Benchmark()
+:
+phase_start_time(std::chrono::steady_clock::now()),
+triangles_per_frame(0) {
+    // do nothing for now
+}
+
+// --------------------------------------------------------------------------
+
+Benchmark::~Benchmark() {
+    // do nothing for now
+}
+
+// --------------------------------------------------------------------------
+
+void Benchmark::end_phase(const std::string& phase_name) {
+    // Each phase runs from the end of the previous one, or from the last restart.
+    std::chrono::steady_clock::time_point current_time = std::chrono::steady_clock::now();
+    std::chrono::duration<double, std::milli> elapsed_time = current_time - phase_start_time;
+    phase_timings.push_back({phase_name, elapsed_time.count()});
+    phase_start_time = current_time;
+}
+
+// --------------------------------------------------------------------------
+
+void Benchmark::restart_phase_timer() {
+    phase_start_time = std::chrono::steady_clock::now();
+}
+
+// --------------------------------------------------------------------------
+
+void Benchmark::add_frame_time(double frame_time_ms) {
+    frame_times_ms.push_back(frame_time_ms);
+}
+
+// --------------------------------------------------------------------------
+
+void Benchmark::set_renderer(const std::string& renderer_name, long long triangles_per_frame) {
+    // Lets runs on different renderers, like llvmpipe and the CPU rasterizer, be compared by throughput.
+    this->renderer_name = renderer_name;
+    this->triangles_per_frame = triangles_per_frame;
+}
+
+// --------------------------------------------------------------------------
+
+CameraPose Benchmark::get_camera_pose(int frame_index, int frame_count) {
+    // One full turn around the model while tilting up and down twice and zooming in and out once,
+    // so every run of the same length renders exactly the same frames.
+    const float TWO_PI = 6.28318530718f;
+    const float MAX_TILT_DEGREES = 30.0f;
+    const float ZOOM_AMPLITUDE = 0.25f;
+
+    float progress = frame_count > 1 ? (float)frame_index / (frame_count - 1) : 0.0f;
+
+    CameraPose camera_pose;
+    camera_pose.rotation_degrees_y = 360.0f * progress;
+    camera_pose.rotation_degrees_x = MAX_TILT_DEGREES * std::sin(2.0f * TWO_PI * progress);
+    camera_pose.camera_distance_scale = 1.0f - ZOOM_AMPLITUDE * 0.5f * (1.0f - std::cos(TWO_PI * progress));
+
+    return camera_pose;
+}
+
+// --------------------------------------------------------------------------
+
+FrameTimeStatistics Benchmark::get_frame_time_statistics() const {
+    FrameTimeStatistics statistics = {0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+    if (frame_times_ms.empty()) {
+        return statistics;
+    }
+
+    std::vector<double> sorted_frame_times_ms = frame_times_ms;
+    std::sort(sorted_frame_times_ms.begin(), sorted_frame_times_ms.end());
+
+    // Nearest-rank percentiles.
+    int frame_count = sorted_frame_times_ms.size();
+    auto get_percentile = [&](double percentile) {
+        int rank = (int)std::ceil(percentile / 100.0 * frame_count);
+        return sorted_frame_times_ms[std::max(rank, 1) - 1];
+    };
+
+    statistics.frame_count = frame_count;
+    statistics.mean_ms = std::accumulate(sorted_frame_times_ms.begin(), sorted_frame_times_ms.end(), 0.0) / frame_count;
+    statistics.min_ms = sorted_frame_times_ms.front();
+    statistics.max_ms = sorted_frame_times_ms.back();
+    statistics.p50_ms = get_percentile(50.0);
+    statistics.p95_ms = get_percentile(95.0);
+    statistics.p99_ms = get_percentile(99.0);
+
+    return statistics;
+}
+
+// --------------------------------------------------------------------------
+
+void Benchmark::write_json(std::ostream& output, const std::string& file_path, int window_width, int window_height) const {
+    // Written on a single line so it can be picked out of the rest of the program's output.
+    FrameTimeStatistics statistics = get_frame_time_statistics();
+
+    output << "{\"file\":\"" << escape_json_string(file_path) << "\"";
+    output << ",\"width\":" << window_width << ",\"height\":" << window_height;
+    output << ",\"renderer\":\"" << escape_json_string(renderer_name) << "\"";
+
+    output << ",\"load_phases_ms\":{";
+    double total_load_ms = 0.0;
+    for (size_t i = 0; i < phase_timings.size(); i++) {
+        output << (i > 0 ? "," : "") << "\"" << escape_json_string(phase_timings[i].name) << "\":" << phase_timings[i].elapsed_ms;
+        total_load_ms += phase_timings[i].elapsed_ms;
+    }
+    output << "},\"load_total_ms\":" << total_load_ms;
+
+    output << ",\"frames\":" << statistics.frame_count;
+    output << ",\"frame_time_ms\":{";
+    output << "\"mean\":" << statistics.mean_ms;
+    output << ",\"min\":" << statistics.min_ms;
+    output << ",\"max\":" << statistics.max_ms;
+    output << ",\"p50\":" << statistics.p50_ms;
+    output << ",\"p95\":" << statistics.p95_ms;
+    output << ",\"p99\":" << statistics.p99_ms;
+    output << "}";
+
+    output << ",\"triangles_per_frame\":" << triangles_per_frame;
+    output << ",\"triangles_per_second\":" << (statistics.mean_ms > 0.0 ? triangles_per_frame * 1000.0 / statistics.mean_ms : 0.0);
+    output << "}" << std::endl;
+}
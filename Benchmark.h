@@ -0,0 +1,58 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <ostream>
+
+struct CameraPose {
+    float rotation_degrees_x;
+    float rotation_degrees_y;
+    float camera_distance_scale;
+};
+
+struct FrameTimeStatistics {
+    int frame_count;
+    double mean_ms;
+    double min_ms;
+    double max_ms;
+    double p50_ms;
+    double p95_ms;
+    double p99_ms;
+};
+
+class Benchmark {
+
+public:
+
+    Benchmark();
+    ~Benchmark();
+
+    void end_phase(const std::string& phase_name);
+    void restart_phase_timer();
+
+    void add_frame_time(double frame_time_ms);
+    void set_renderer(const std::string& renderer_name, long long triangles_per_frame);
+
+    static CameraPose get_camera_pose(int frame_index, int frame_count);
+
+    FrameTimeStatistics get_frame_time_statistics() const;
+    void write_json(std::ostream& output, const std::string& file_path, int window_width, int window_height) const;
+
+private:
+
+    struct PhaseTiming {
+        std::string name;
+        double elapsed_ms;
+    };
+
+    std::chrono::steady_clock::time_point phase_start_time;
+    std::vector<PhaseTiming> phase_timings;
+    std::vector<double> frame_times_ms;
+
+    std::string renderer_name;
+    long long triangles_per_frame;
+};
+
+#endif
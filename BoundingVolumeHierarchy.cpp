@@ -0,0 +1,491 @@
+#include "BoundingVolumeHierarchy.h"
+
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <algorithm>
+
+#include "ThreadPool.h"
+
+static float compute_half_surface_area(glm::vec3 bounds_min, glm::vec3 bounds_max) {
+    glm::vec3 extent = bounds_max - bounds_min;
+    return extent.x * extent.y + extent.y * extent.z + extent.z * extent.x;
+}
+
+// Distance along the ray to where it enters the node's box, or infinity if it misses it.
+static float intersect_node_bounds(const BvhNode& node, const Ray& ray, glm::vec3 inverse_direction, float max_distance) {
+    glm::vec3 near_distances = (node.bounds_min - ray.origin) * inverse_direction;
+    glm::vec3 far_distances = (node.bounds_max - ray.origin) * inverse_direction;
+    glm::vec3 entry_distances = glm::min(near_distances, far_distances);
+    glm::vec3 exit_distances = glm::max(near_distances, far_distances);
+
+    float entry_distance = std::max(std::max(entry_distances.x, entry_distances.y), std::max(entry_distances.z, 0.0f));
+    float exit_distance = std::min(std::min(exit_distances.x, exit_distances.y), std::min(exit_distances.z, max_distance));
+
+    return entry_distance <= exit_distance ? entry_distance : std::numeric_limits<float>::infinity();
+}
+
+// --------------------------------------------------------------------------
+
+BoundingVolumeHierarchy::BoundingVolumeHierarchy()
+:
+thread_count(1),
+depth(0) {
+    // do nothing for now
+}
+
+// --------------------------------------------------------------------------
+
+BoundingVolumeHierarchy::~BoundingVolumeHierarchy() {
+    // do nothing for now
+}
+
+// --------------------------------------------------------------------------
+
+void BoundingVolumeHierarchy::set_thread_count(int thread_count) {
+    this->thread_count = thread_count > 0 ? thread_count : ThreadPool::get_hardware_thread_count();
+}
+
+// --------------------------------------------------------------------------
+
+void BoundingVolumeHierarchy::build(const Model& model) {
+    // The top of the tree is split on the calling thread, with binning spread over the pool,
+    // until the ranges are small enough to hand out as independent subtrees. The subtrees are
+    // then built in parallel into their own node lists and appended to the top of the tree.
+    const ModelArray<glm::vec3>& vertices = model.get_vertices();
+    const ModelArray<Face>& faces = model.get_faces();
+    int face_count = faces.size();
+
+    nodes.clear();
+    triangle_vertices.clear();
+    face_indices.clear();
+    vertex_indices.clear();
+    depth = 0;
+    if (face_count == 0) {
+        return;
+    }
+
+    ThreadPool thread_pool(thread_count);
+    int task_count = thread_pool.get_thread_count() * SUBTREES_PER_THREAD;
+
+    primitive_bounds.resize(face_count);
+    primitive_indices.resize(face_count);
+    std::iota(primitive_indices.begin(), primitive_indices.end(), 0);
+    thread_pool.parallel_for(task_count, [&](int task_index) {
+        int task_end = (long long)face_count * (task_index + 1) / task_count;
+        for (int face_index = (long long)face_count * task_index / task_count; face_index < task_end; face_index++) {
+            const Face& face = faces[face_index];
+            PrimitiveBounds& bounds = primitive_bounds[face_index];
+            bounds.bounds_min = glm::min(glm::min(vertices[face.vertex_indices[0]], vertices[face.vertex_indices[1]]), vertices[face.vertex_indices[2]]);
+            bounds.bounds_max = glm::max(glm::max(vertices[face.vertex_indices[0]], vertices[face.vertex_indices[1]]), vertices[face.vertex_indices[2]]);
+            bounds.centroid = 0.5f * (bounds.bounds_min + bounds.bounds_max);
+        }
+    });
+
+    std::vector<Subtree> subtrees;
+    int max_subtree_size = std::max(MIN_PARALLEL_RANGE_SIZE, face_count / task_count);
+    bool is_parallel = thread_pool.get_thread_count() > 1;
+
+    nodes.push_back(BvhNode());
+    build_node(nodes, 0, 0, face_count, 0, max_subtree_size, is_parallel ? &subtrees : nullptr, is_parallel ? &thread_pool : nullptr);
+
+    std::vector<std::vector<BvhNode>> subtree_nodes(subtrees.size());
+    thread_pool.parallel_for(subtrees.size(), [&](int subtree_index) {
+        const Subtree& subtree = subtrees[subtree_index];
+        subtree_nodes[subtree_index].push_back(BvhNode());
+        build_node(subtree_nodes[subtree_index], 0, subtree.begin, subtree.end, subtree.depth, 0, nullptr, nullptr);
+    });
+
+    // Each subtree root replaces its placeholder, and the rest of its nodes are appended with
+    // their child indices moved past the nodes already in place.
+    for (size_t subtree_index = 0; subtree_index < subtrees.size(); subtree_index++) {
+        std::vector<BvhNode>& local_nodes = subtree_nodes[subtree_index];
+        int index_offset = (int)nodes.size() - 1;
+        for (BvhNode& node : local_nodes) {
+            if (node.primitive_count == 0) {
+                node.first += index_offset;
+            }
+        }
+
+        nodes[subtrees[subtree_index].node_index] = local_nodes[0];
+        nodes.insert(nodes.end(), local_nodes.begin() + 1, local_nodes.end());
+        local_nodes = std::vector<BvhNode>();
+    }
+
+    // Triangles are copied in leaf order so that a leaf's triangles sit next to each other.
+    triangle_vertices.resize(face_count * 3);
+    face_indices.resize(face_count);
+    vertex_indices.resize(face_count * 3);
+    thread_pool.parallel_for(task_count, [&](int task_index) {
+        int task_end = (long long)face_count * (task_index + 1) / task_count;
+        for (int primitive = (long long)face_count * task_index / task_count; primitive < task_end; primitive++) {
+            int face_index = primitive_indices[primitive];
+            face_indices[primitive] = face_index;
+            for (int corner = 0; corner < 3; corner++) {
+                vertex_indices[primitive * 3 + corner] = faces[face_index].vertex_indices[corner];
+                triangle_vertices[primitive * 3 + corner] = vertices[faces[face_index].vertex_indices[corner]];
+            }
+        }
+    });
+
+    primitive_bounds = std::vector<PrimitiveBounds>();
+    primitive_indices = std::vector<int>();
+
+    std::vector<std::pair<int, int>> stack;
+    stack.push_back({0, 1});
+    while (!stack.empty()) {
+        std::pair<int, int> entry = stack.back();
+        stack.pop_back();
+
+        const BvhNode& node = nodes[entry.first];
+        depth = std::max(depth, entry.second);
+        if (node.primitive_count == 0) {
+            stack.push_back({node.first, entry.second + 1});
+            stack.push_back({node.first + 1, entry.second + 1});
+        }
+    }
+}
+
+// --------------------------------------------------------------------------
+
+std::optional<RayHit> BoundingVolumeHierarchy::intersect(const Ray& ray) const {
+    // Visits the nearer child first, skipping any node that starts beyond the closest hit so far.
+    // Triangles are hit from either side, matching the renderer, which doesn't cull back faces.
+    if (nodes.empty()) {
+        return std::nullopt;
+    }
+
+    glm::vec3 inverse_direction = 1.0f / ray.direction;
+
+    float closest_distance = std::numeric_limits<float>::infinity();
+    int closest_primitive = -1;
+    float closest_u = 0.0f;
+    float closest_v = 0.0f;
+
+    int stack[2 * MAX_DEPTH + 2];
+    int stack_size = 0;
+    stack[stack_size++] = 0;
+    while (stack_size > 0) {
+        const BvhNode& node = nodes[stack[--stack_size]];
+        if (intersect_node_bounds(node, ray, inverse_direction, closest_distance) >= closest_distance) {
+            continue;
+        }
+
+        if (node.primitive_count > 0) {
+            for (int primitive = node.first; primitive < node.first + node.primitive_count; primitive++) {
+                // Möller-Trumbore ray/triangle intersection.
+                const glm::vec3* triangle = &triangle_vertices[primitive * 3];
+                glm::vec3 first_edge = triangle[1] - triangle[0];
+                glm::vec3 second_edge = triangle[2] - triangle[0];
+                glm::vec3 p = glm::cross(ray.direction, second_edge);
+                float determinant = glm::dot(first_edge, p);
+                if (std::abs(determinant) < std::numeric_limits<float>::min()) {
+                    continue;
+                }
+
+                float inverse_determinant = 1.0f / determinant;
+                glm::vec3 s = ray.origin - triangle[0];
+                float u = glm::dot(s, p) * inverse_determinant;
+                if (u < 0.0f || u > 1.0f) {
+                    continue;
+                }
+
+                glm::vec3 q = glm::cross(s, first_edge);
+                float v = glm::dot(ray.direction, q) * inverse_determinant;
+                if (v < 0.0f || u + v > 1.0f) {
+                    continue;
+                }
+
+                float distance = glm::dot(second_edge, q) * inverse_determinant;
+                if (distance >= 0.0f && distance < closest_distance) {
+                    closest_distance = distance;
+                    closest_primitive = primitive;
+                    closest_u = u;
+                    closest_v = v;
+                }
+            }
+            continue;
+        }
+
+        float left_distance = intersect_node_bounds(nodes[node.first], ray, inverse_direction, closest_distance);
+        float right_distance = intersect_node_bounds(nodes[node.first + 1], ray, inverse_direction, closest_distance);
+        int near_child = left_distance <= right_distance ? node.first : node.first + 1;
+        int far_child = left_distance <= right_distance ? node.first + 1 : node.first;
+        if (std::max(left_distance, right_distance) < closest_distance) {
+            stack[stack_size++] = far_child;
+        }
+        if (std::min(left_distance, right_distance) < closest_distance) {
+            stack[stack_size++] = near_child;
+        }
+    }
+
+    if (closest_primitive < 0) {
+        return std::nullopt;
+    }
+
+    // The hit vertex is the corner with the largest barycentric weight.
+    float corner_weights[3] = { 1.0f - closest_u - closest_v, closest_u, closest_v };
+    int closest_corner = std::max_element(corner_weights, corner_weights + 3) - corner_weights;
+
+    RayHit hit;
+    hit.face_index = face_indices[closest_primitive];
+    hit.vertex_index = vertex_indices[closest_primitive * 3 + closest_corner];
+    hit.position = ray.origin + closest_distance * ray.direction;
+    hit.distance = closest_distance;
+
+    return hit;
+}
+
+// --------------------------------------------------------------------------
+
+void BoundingVolumeHierarchy::traverse(const std::function<bool(const BvhNode& node)>& should_visit_node, const std::function<void(int face_index)>& visit_face) const {
+    // Generic depth-first walk for other spatial queries: should_visit_node prunes subtrees by
+    // their bounds and visit_face receives the faces of every leaf that is reached.
+    if (nodes.empty()) {
+        return;
+    }
+
+    int stack[2 * MAX_DEPTH + 2];
+    int stack_size = 0;
+    stack[stack_size++] = 0;
+    while (stack_size > 0) {
+        const BvhNode& node = nodes[stack[--stack_size]];
+        if (!should_visit_node(node)) {
+            continue;
+        }
+
+        if (node.primitive_count > 0) {
+            for (int primitive = node.first; primitive < node.first + node.primitive_count; primitive++) {
+                visit_face(face_indices[primitive]);
+            }
+        } else {
+            stack[stack_size++] = node.first + 1;
+            stack[stack_size++] = node.first;
+        }
+    }
+}
+
+// --------------------------------------------------------------------------
+
+const std::vector<BvhNode>& BoundingVolumeHierarchy::get_nodes() const {
+    return nodes;
+}
+
+// --------------------------------------------------------------------------
+
+int BoundingVolumeHierarchy::get_depth() const {
+    return depth;
+}
+
+// --------------------------------------------------------------------------
+
+BoundingVolumeHierarchy::RangeBounds BoundingVolumeHierarchy::compute_range_bounds(int begin, int end, ThreadPool* thread_pool) {
+    const float MAX_FLOAT_VALUE = std::numeric_limits<float>::max();
+
+    RangeBounds empty_bounds;
+    empty_bounds.bounds_min = glm::vec3(MAX_FLOAT_VALUE, MAX_FLOAT_VALUE, MAX_FLOAT_VALUE);
+    empty_bounds.bounds_max = glm::vec3(-MAX_FLOAT_VALUE, -MAX_FLOAT_VALUE, -MAX_FLOAT_VALUE);
+    empty_bounds.centroid_min = empty_bounds.bounds_min;
+    empty_bounds.centroid_max = empty_bounds.bounds_max;
+
+    int chunk_count = thread_pool != nullptr && end - begin >= MIN_PARALLEL_RANGE_SIZE ? thread_pool->get_thread_count() : 1;
+    auto compute_chunk_bounds = [&](RangeBounds& bounds, int chunk_index) {
+        int chunk_end = begin + (long long)(end - begin) * (chunk_index + 1) / chunk_count;
+        for (int i = begin + (long long)(end - begin) * chunk_index / chunk_count; i < chunk_end; i++) {
+            const PrimitiveBounds& primitive = primitive_bounds[primitive_indices[i]];
+            bounds.bounds_min = glm::min(bounds.bounds_min, primitive.bounds_min);
+            bounds.bounds_max = glm::max(bounds.bounds_max, primitive.bounds_max);
+            bounds.centroid_min = glm::min(bounds.centroid_min, primitive.centroid);
+            bounds.centroid_max = glm::max(bounds.centroid_max, primitive.centroid);
+        }
+    };
+
+    RangeBounds range_bounds = empty_bounds;
+    if (chunk_count == 1) {
+        compute_chunk_bounds(range_bounds, 0);
+        return range_bounds;
+    }
+
+    std::vector<RangeBounds> chunk_bounds(chunk_count, empty_bounds);
+    thread_pool->parallel_for(chunk_count, [&](int chunk_index) {
+        compute_chunk_bounds(chunk_bounds[chunk_index], chunk_index);
+    });
+
+    for (const RangeBounds& bounds : chunk_bounds) {
+        range_bounds.bounds_min = glm::min(range_bounds.bounds_min, bounds.bounds_min);
+        range_bounds.bounds_max = glm::max(range_bounds.bounds_max, bounds.bounds_max);
+        range_bounds.centroid_min = glm::min(range_bounds.centroid_min, bounds.centroid_min);
+        range_bounds.centroid_max = glm::max(range_bounds.centroid_max, bounds.centroid_max);
+    }
+
+    return range_bounds;
+}
+
+// --------------------------------------------------------------------------
+
+int BoundingVolumeHierarchy::split_range(int begin, int end, const RangeBounds& range_bounds, ThreadPool* thread_pool) {
+    // Bins the primitive centroids along each axis and picks the bin boundary with the lowest
+    // surface area heuristic cost. Returns the partition point, or -1 to make a leaf.
+    const float MAX_FLOAT_VALUE = std::numeric_limits<float>::max();
+    const float TRAVERSAL_COST = 1.0f;
+
+    struct Bin {
+        glm::vec3 bounds_min;
+        glm::vec3 bounds_max;
+        int count;
+    };
+
+    struct AxisBins {
+        Bin bins[3][BIN_COUNT];
+    };
+
+    int primitive_count = end - begin;
+    glm::vec3 centroid_extent = range_bounds.centroid_max - range_bounds.centroid_min;
+    glm::vec3 bin_scale = glm::vec3(0.0f, 0.0f, 0.0f);
+    for (int axis = 0; axis < 3; axis++) {
+        if (centroid_extent[axis] > 0.0f) {
+            bin_scale[axis] = BIN_COUNT / centroid_extent[axis];
+        }
+    }
+
+    auto find_bin = [&](const glm::vec3& centroid, int axis) {
+        return std::min((int)((centroid[axis] - range_bounds.centroid_min[axis]) * bin_scale[axis]), BIN_COUNT - 1);
+    };
+
+    AxisBins empty_bins;
+    for (int axis = 0; axis < 3; axis++) {
+        for (Bin& bin : empty_bins.bins[axis]) {
+            bin.bounds_min = glm::vec3(MAX_FLOAT_VALUE, MAX_FLOAT_VALUE, MAX_FLOAT_VALUE);
+            bin.bounds_max = glm::vec3(-MAX_FLOAT_VALUE, -MAX_FLOAT_VALUE, -MAX_FLOAT_VALUE);
+            bin.count = 0;
+        }
+    }
+
+    int chunk_count = thread_pool != nullptr && primitive_count >= MIN_PARALLEL_RANGE_SIZE ? thread_pool->get_thread_count() : 1;
+    auto fill_chunk_bins = [&](AxisBins& bins, int chunk_index) {
+        int chunk_end = begin + (long long)primitive_count * (chunk_index + 1) / chunk_count;
+        for (int i = begin + (long long)primitive_count * chunk_index / chunk_count; i < chunk_end; i++) {
+            const PrimitiveBounds& primitive = primitive_bounds[primitive_indices[i]];
+            for (int axis = 0; axis < 3; axis++) {
+                Bin& bin = bins.bins[axis][find_bin(primitive.centroid, axis)];
+                bin.bounds_min = glm::min(bin.bounds_min, primitive.bounds_min);
+                bin.bounds_max = glm::max(bin.bounds_max, primitive.bounds_max);
+                bin.count++;
+            }
+        }
+    };
+
+    AxisBins bins = empty_bins;
+    if (chunk_count == 1) {
+        fill_chunk_bins(bins, 0);
+    } else {
+        std::vector<AxisBins> chunk_bins(chunk_count, empty_bins);
+        thread_pool->parallel_for(chunk_count, [&](int chunk_index) {
+            fill_chunk_bins(chunk_bins[chunk_index], chunk_index);
+        });
+
+        for (const AxisBins& chunk : chunk_bins) {
+            for (int axis = 0; axis < 3; axis++) {
+                for (int i = 0; i < BIN_COUNT; i++) {
+                    bins.bins[axis][i].bounds_min = glm::min(bins.bins[axis][i].bounds_min, chunk.bins[axis][i].bounds_min);
+                    bins.bins[axis][i].bounds_max = glm::max(bins.bins[axis][i].bounds_max, chunk.bins[axis][i].bounds_max);
+                    bins.bins[axis][i].count += chunk.bins[axis][i].count;
+                }
+            }
+        }
+    }
+
+    float best_cost = MAX_FLOAT_VALUE;
+    int best_axis = -1;
+    int best_bin = 0;
+    for (int axis = 0; axis < 3; axis++) {
+        if (centroid_extent[axis] <= 0.0f) {
+            continue;
+        }
+
+        // Sweep from the right to get the cost of everything after each boundary, then from the left.
+        float right_costs[BIN_COUNT];
+        int right_counts[BIN_COUNT];
+        glm::vec3 bounds_min = glm::vec3(MAX_FLOAT_VALUE, MAX_FLOAT_VALUE, MAX_FLOAT_VALUE);
+        glm::vec3 bounds_max = glm::vec3(-MAX_FLOAT_VALUE, -MAX_FLOAT_VALUE, -MAX_FLOAT_VALUE);
+        int count = 0;
+        for (int i = BIN_COUNT - 1; i > 0; i--) {
+            const Bin& bin = bins.bins[axis][i];
+            bounds_min = glm::min(bounds_min, bin.bounds_min);
+            bounds_max = glm::max(bounds_max, bin.bounds_max);
+            count += bin.count;
+            right_counts[i] = count;
+            right_costs[i] = count > 0 ? count * compute_half_surface_area(bounds_min, bounds_max) : 0.0f;
+        }
+
+        bounds_min = glm::vec3(MAX_FLOAT_VALUE, MAX_FLOAT_VALUE, MAX_FLOAT_VALUE);
+        bounds_max = glm::vec3(-MAX_FLOAT_VALUE, -MAX_FLOAT_VALUE, -MAX_FLOAT_VALUE);
+        count = 0;
+        for (int i = 0; i < BIN_COUNT - 1; i++) {
+            const Bin& bin = bins.bins[axis][i];
+            bounds_min = glm::min(bounds_min, bin.bounds_min);
+            bounds_max = glm::max(bounds_max, bin.bounds_max);
+            count += bin.count;
+            if (count == 0 || right_counts[i + 1] == 0) {
+                continue;
+            }
+
+            float cost = count * compute_half_surface_area(bounds_min, bounds_max) + right_costs[i + 1];
+            if (cost < best_cost) {
+                best_cost = cost;
+                best_axis = axis;
+                best_bin = i;
+            }
+        }
+    }
+
+    int* range_begin = primitive_indices.data() + begin;
+    int* range_end = primitive_indices.data() + end;
+
+    // All centroids coincide: no plane separates them, so split the range in half if it's too big for a leaf.
+    if (best_axis < 0) {
+        return primitive_count > MAX_LEAF_SIZE ? begin + primitive_count / 2 : -1;
+    }
+
+    float parent_area = compute_half_surface_area(range_bounds.bounds_min, range_bounds.bounds_max);
+    float split_cost = TRAVERSAL_COST + (parent_area > 0.0f ? best_cost / parent_area : 0.0f);
+    if (primitive_count <= MAX_LEAF_SIZE && split_cost >= primitive_count) {
+        return -1;
+    }
+
+    int* middle = std::partition(range_begin, range_end, [&](int primitive) {
+        return find_bin(primitive_bounds[primitive].centroid, best_axis) <= best_bin;
+    });
+
+    return begin + (middle - range_begin);
+}
+
+// --------------------------------------------------------------------------
+
+void BoundingVolumeHierarchy::build_node(std::vector<BvhNode>& build_nodes, int node_index, int begin, int end, int node_depth, int max_subtree_size, std::vector<Subtree>* subtrees, ThreadPool* thread_pool) {
+    // Ranges no bigger than max_subtree_size are left as placeholders in subtrees, if given.
+    if (subtrees != nullptr && end - begin <= max_subtree_size) {
+        subtrees->push_back({node_index, begin, end, node_depth});
+        return;
+    }
+
+    RangeBounds range_bounds = compute_range_bounds(begin, end, thread_pool);
+    build_nodes[node_index].bounds_min = range_bounds.bounds_min;
+    build_nodes[node_index].bounds_max = range_bounds.bounds_max;
+
+    int middle = end - begin > MIN_SPLIT_SIZE && node_depth < MAX_DEPTH ? split_range(begin, end, range_bounds, thread_pool) : -1;
+    if (middle < 0) {
+        build_nodes[node_index].first = begin;
+        build_nodes[node_index].primitive_count = end - begin;
+        return;
+    }
+
+    int left_child = build_nodes.size();
+    build_nodes.push_back(BvhNode());
+    build_nodes.push_back(BvhNode());
+    build_nodes[node_index].first = left_child;
+    build_nodes[node_index].primitive_count = 0;
+
+    build_node(build_nodes, left_child, begin, middle, node_depth + 1, max_subtree_size, subtrees, thread_pool);
+    build_node(build_nodes, left_child + 1, middle, end, node_depth + 1, max_subtree_size, subtrees, thread_pool);
+}
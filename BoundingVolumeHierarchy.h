@@ -0,0 +1,99 @@
+#ifndef BOUNDING_VOLUME_HIERARCHY_H
+#define BOUNDING_VOLUME_HIERARCHY_H
+
+#include <vector>
+#include <optional>
+#include <functional>
+#include <glm/glm.hpp>
+
+#include "Model.h"
+
+class ThreadPool;
+
+struct Ray {
+    glm::vec3 origin;
+    glm::vec3 direction;
+};
+
+struct RayHit {
+    int face_index;
+    int vertex_index;
+    glm::vec3 position;
+    float distance;
+};
+
+// 32 bytes, two per cache line. Inner nodes have a primitive_count of 0 and store the index
+// of their left child in first; the right child always follows it. Leaves store their
+// first primitive in BVH order.
+struct BvhNode {
+    glm::vec3 bounds_min;
+    int first;
+    glm::vec3 bounds_max;
+    int primitive_count;
+};
+
+class BoundingVolumeHierarchy {
+
+public:
+
+    BoundingVolumeHierarchy();
+    ~BoundingVolumeHierarchy();
+
+    void set_thread_count(int thread_count);
+
+    void build(const Model& model);
+
+    std::optional<RayHit> intersect(const Ray& ray) const;
+    void traverse(const std::function<bool(const BvhNode& node)>& should_visit_node, const std::function<void(int face_index)>& visit_face) const;
+
+    const std::vector<BvhNode>& get_nodes() const;
+    int get_depth() const;
+
+private:
+
+    struct PrimitiveBounds {
+        glm::vec3 bounds_min;
+        glm::vec3 bounds_max;
+        glm::vec3 centroid;
+    };
+
+    struct RangeBounds {
+        glm::vec3 bounds_min;
+        glm::vec3 bounds_max;
+        glm::vec3 centroid_min;
+        glm::vec3 centroid_max;
+    };
+
+    struct Subtree {
+        int node_index;
+        int begin;
+        int end;
+        int depth;
+    };
+
+    static const int BIN_COUNT = 16;
+    static const int MIN_SPLIT_SIZE = 2;
+    static const int MAX_LEAF_SIZE = 8;
+    static const int MAX_DEPTH = 64;
+    static const int SUBTREES_PER_THREAD = 8;
+    static constexpr int MIN_PARALLEL_RANGE_SIZE = 1 << 16;
+
+    int thread_count;
+
+    std::vector<BvhNode> nodes;
+    std::vector<glm::vec3> triangle_vertices;
+    std::vector<int> face_indices;
+    std::vector<int> vertex_indices;
+    int depth;
+
+    // Only used while building.
+    std::vector<PrimitiveBounds> primitive_bounds;
+    std::vector<int> primitive_indices;
+
+    RangeBounds compute_range_bounds(int begin, int end, ThreadPool* thread_pool);
+    int split_range(int begin, int end, const RangeBounds& range_bounds, ThreadPool* thread_pool);
+
+    void build_node(std::vector<BvhNode>& build_nodes, int node_index, int begin, int end, int node_depth, int max_subtree_size, std::vector<Subtree>* subtrees, ThreadPool* thread_pool);
+};
+
+#endif
@@ -0,0 +1,167 @@
+#include "BufferUploader.h"
+
+#include <vector>
+#include <iostream>
+
+BufferUploader::BufferUploader()
+:
+method(BufferUploadMethod::COPY),
+upload_fence(nullptr),
+fallback_count(0) {
+    // do nothing for now
+}
+
+// --------------------------------------------------------------------------
+
+BufferUploader::~BufferUploader() {
+    // do nothing for now
+}
+
+// --------------------------------------------------------------------------
+
+void BufferUploader::initialize(bool allow_mapping) {
+    // Needs a current OpenGL context. Immutable storage lets the driver place the buffer
+    // where it's going to be drawn from, so the mapping is written there directly rather
+    // than through a driver-side staging copy.
+    if (!allow_mapping) {
+        method = BufferUploadMethod::COPY;
+    } else if (GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage) {
+        method = BufferUploadMethod::STORAGE;
+    } else {
+        method = BufferUploadMethod::MAPPED;
+    }
+}
+
+// --------------------------------------------------------------------------
+
+void BufferUploader::destroy() {
+    if (upload_fence != nullptr) {
+        glDeleteSync(upload_fence);
+        upload_fence = nullptr;
+    }
+}
+
+// --------------------------------------------------------------------------
+
+bool BufferUploader::upload(GLenum target, GLuint& buffer, size_t size_in_bytes, const std::function<void(unsigned char*)>& write_data) {
+    // write_data fills all size_in_bytes in one pass and must never read back what it
+    // wrote, since mapped memory is usually write-combined and uncached. Returns false
+    // if mapping didn't work out and the data went through a copy instead.
+    glBindBuffer(target, buffer);
+
+    if (method == BufferUploadMethod::COPY || size_in_bytes == 0) {
+        copy_upload(target, size_in_bytes, write_data);
+        return method == BufferUploadMethod::COPY;
+    }
+
+    if (method == BufferUploadMethod::STORAGE) {
+        glBufferStorage(target, size_in_bytes, nullptr, GL_MAP_WRITE_BIT);
+    } else {
+        glBufferData(target, size_in_bytes, nullptr, GL_STATIC_DRAW);
+    }
+
+    unsigned char* destination = static_cast<unsigned char*>(glMapBufferRange(target, 0, size_in_bytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT));
+    bool is_uploaded = false;
+    if (destination != nullptr) {
+        write_data(destination);
+
+        // The contents can be lost while mapped, for example on a display mode change.
+        is_uploaded = glUnmapBuffer(target) == GL_TRUE;
+    }
+
+    if (!is_uploaded) {
+        // Immutable storage can't be given new data, so start over with a fresh buffer.
+        std::cerr << "[WARN] Couldn't map a buffer of " << size_in_bytes << " bytes, copying it instead" << std::endl;
+        glDeleteBuffers(1, &buffer);
+        glGenBuffers(1, &buffer);
+        glBindBuffer(target, buffer);
+        copy_upload(target, size_in_bytes, write_data);
+        fallback_count++;
+        return false;
+    }
+
+    // Lets wait_for_uploads() tell when the driver is done with every upload so far.
+    if (upload_fence != nullptr) {
+        glDeleteSync(upload_fence);
+    }
+    upload_fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+    return true;
+}
+
+// --------------------------------------------------------------------------
+
+unsigned char* BufferUploader::map_persistent(GLenum target, GLuint buffer, size_t size_in_bytes) {
+    // Maps the whole buffer for as long as it lives, so another thread can fill it while
+    // it's being drawn. The mapping is coherent, so anything written before a draw call is
+    // issued is visible to it without flushing. Returns null without immutable storage.
+    if (method != BufferUploadMethod::STORAGE || size_in_bytes == 0) {
+        return nullptr;
+    }
+
+    const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glBindBuffer(target, buffer);
+    glBufferStorage(target, size_in_bytes, nullptr, flags | GL_DYNAMIC_STORAGE_BIT);
+
+    unsigned char* destination = static_cast<unsigned char*>(glMapBufferRange(target, 0, size_in_bytes, flags));
+    if (destination == nullptr) {
+        std::cerr << "[WARN] Couldn't persistently map a buffer of " << size_in_bytes << " bytes" << std::endl;
+        fallback_count++;
+    }
+
+    return destination;
+}
+
+// --------------------------------------------------------------------------
+
+void BufferUploader::wait_for_uploads() {
+    // Blocks only until the uploads issued so far have landed, rather than for the whole
+    // pipeline to drain as glFinish() would.
+    if (upload_fence == nullptr) {
+        return;
+    }
+
+    const GLuint64 TIMEOUT_NS = 1000000000;
+    GLenum wait_result = glClientWaitSync(upload_fence, GL_SYNC_FLUSH_COMMANDS_BIT, TIMEOUT_NS);
+    if (wait_result == GL_TIMEOUT_EXPIRED || wait_result == GL_WAIT_FAILED) {
+        std::cerr << "[WARN] Gave up waiting for buffer uploads to finish" << std::endl;
+    }
+
+    glDeleteSync(upload_fence);
+    upload_fence = nullptr;
+}
+
+// --------------------------------------------------------------------------
+
+BufferUploadMethod BufferUploader::get_method() const {
+    return method;
+}
+
+// --------------------------------------------------------------------------
+
+const char* BufferUploader::get_method_name() const {
+    switch (method) {
+        case BufferUploadMethod::STORAGE:
+            return "mapped immutable storage";
+        case BufferUploadMethod::MAPPED:
+            return "mapped buffer";
+        default:
+            return "copy";
+    }
+}
+
+// --------------------------------------------------------------------------
+
+int BufferUploader::get_fallback_count() const {
+    return fallback_count;
+}
+
+// --------------------------------------------------------------------------
+
+void BufferUploader::copy_upload(GLenum target, size_t size_in_bytes, const std::function<void(unsigned char*)>& write_data) {
+    std::vector<unsigned char> staging_data(size_in_bytes);
+    if (size_in_bytes > 0) {
+        write_data(staging_data.data());
+    }
+    glBufferData(target, size_in_bytes, staging_data.data(), GL_STATIC_DRAW);
+}
@@ -0,0 +1,41 @@
+#ifndef BUFFER_UPLOADER_H
+#define BUFFER_UPLOADER_H
+
+#include <GL/glew.h>
+#include <cstddef>
+#include <functional>
+
+enum class BufferUploadMethod {
+    COPY,
+    MAPPED,
+    STORAGE
+};
+
+class BufferUploader {
+
+public:
+
+    BufferUploader();
+    ~BufferUploader();
+
+    void initialize(bool allow_mapping);
+    void destroy();
+
+    bool upload(GLenum target, GLuint& buffer, size_t size_in_bytes, const std::function<void(unsigned char*)>& write_data);
+    unsigned char* map_persistent(GLenum target, GLuint buffer, size_t size_in_bytes);
+    void wait_for_uploads();
+
+    BufferUploadMethod get_method() const;
+    const char* get_method_name() const;
+    int get_fallback_count() const;
+
+private:
+
+    BufferUploadMethod method;
+    GLsync upload_fence;
+    int fallback_count;
+
+    void copy_upload(GLenum target, size_t size_in_bytes, const std::function<void(unsigned char*)>& write_data);
+};
+
+#endif
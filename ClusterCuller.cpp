@@ -0,0 +1,242 @@
+#include "ClusterCuller.h"
+
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+#include "Simd.h"
+#include "Profiler.h"
+
+ClusterCuller::ClusterCuller() {
+    // do nothing for now
+}
+
+// --------------------------------------------------------------------------
+
+ClusterCuller::~ClusterCuller() {
+    // do nothing for now
+}
+
+// --------------------------------------------------------------------------
+
+void ClusterCuller::build_clusters(const IndexedBufferData& indexed_buffer_data, int first_index, int index_count) {
+    // Cuts the given range of triangles, in their current order, into runs of at most MAX_CLUSTER_TRIANGLES.
+    // Once a cluster has MIN_CLUSTER_TRIANGLES, it also ends at the first triangle that shares
+    // no vertex with it, which keeps clusters connected when the order jumps across the mesh.
+    // Callers should order triangles spatially (or for the vertex cache) beforehand.
+    clusters.clear();
+
+    int first_triangle = first_index / 3;
+    int last_triangle = first_triangle + index_count / 3;
+    std::vector<int> vertex_cluster_indices(indexed_buffer_data.vertex_count, -1);
+
+    MeshCluster cluster;
+    cluster.first_index = first_index;
+    int cluster_triangle_count = 0;
+    for (int triangle = first_triangle; triangle < last_triangle; triangle++) {
+        const uint32_t* triangle_indices = &indexed_buffer_data.indices[triangle * 3];
+        int cluster_index = clusters.size();
+
+        bool shares_vertex = false;
+        for (int corner = 0; corner < 3; corner++) {
+            shares_vertex = shares_vertex || vertex_cluster_indices[triangle_indices[corner]] == cluster_index;
+        }
+
+        if (cluster_triangle_count == MAX_CLUSTER_TRIANGLES || (cluster_triangle_count >= MIN_CLUSTER_TRIANGLES && !shares_vertex)) {
+            cluster.index_count = cluster_triangle_count * 3;
+            compute_cluster_bounds(indexed_buffer_data, cluster);
+            clusters.push_back(cluster);
+
+            cluster_index++;
+            cluster.first_index = triangle * 3;
+            cluster_triangle_count = 0;
+        }
+
+        for (int corner = 0; corner < 3; corner++) {
+            vertex_cluster_indices[triangle_indices[corner]] = cluster_index;
+        }
+        cluster_triangle_count++;
+    }
+
+    if (cluster_triangle_count > 0) {
+        cluster.index_count = cluster_triangle_count * 3;
+        compute_cluster_bounds(indexed_buffer_data, cluster);
+        clusters.push_back(cluster);
+    }
+
+    size_t padded_cluster_count = (clusters.size() + 3) / 4 * 4;
+    center_xs.assign(padded_cluster_count, 0.0f);
+    center_ys.assign(padded_cluster_count, 0.0f);
+    center_zs.assign(padded_cluster_count, 0.0f);
+    radii.assign(padded_cluster_count, 0.0f);
+    cone_axis_xs.assign(padded_cluster_count, 0.0f);
+    cone_axis_ys.assign(padded_cluster_count, 0.0f);
+    cone_axis_zs.assign(padded_cluster_count, 0.0f);
+    cone_cutoffs.assign(padded_cluster_count, 2.0f);
+
+    for (size_t i = 0; i < clusters.size(); i++) {
+        center_xs[i] = clusters[i].center.x;
+        center_ys[i] = clusters[i].center.y;
+        center_zs[i] = clusters[i].center.z;
+        radii[i] = clusters[i].radius;
+        cone_axis_xs[i] = clusters[i].cone_axis.x;
+        cone_axis_ys[i] = clusters[i].cone_axis.y;
+        cone_axis_zs[i] = clusters[i].cone_axis.z;
+        cone_cutoffs[i] = clusters[i].cone_cutoff;
+    }
+}
+
+// --------------------------------------------------------------------------
+
+const std::vector<MeshCluster>& ClusterCuller::get_clusters() const {
+    return clusters;
+}
+
+// --------------------------------------------------------------------------
+
+CullingStatistics ClusterCuller::cull(const glm::mat4& model_view_projection, glm::vec3 object_camera_position, VisibleRanges& visible_ranges) {
+    PROFILE_SCOPE("ClusterCuller::cull");
+
+    // Both tests run in object space, four clusters at a time. The frustum planes come
+    // straight from the rows of the model-view-projection matrix (Gribb and Hartmann), and
+    // a cluster is back-facing when
+    //     dot(center - camera, cone_axis) >= cone_cutoff * length(center - camera) + radius
+    const int PLANE_COUNT = 6;
+
+    glm::vec4 planes[PLANE_COUNT];
+    for (int axis = 0; axis < 3; axis++) {
+        glm::vec4 row = glm::vec4(model_view_projection[0][axis], model_view_projection[1][axis], model_view_projection[2][axis], model_view_projection[3][axis]);
+        glm::vec4 w_row = glm::vec4(model_view_projection[0][3], model_view_projection[1][3], model_view_projection[2][3], model_view_projection[3][3]);
+        planes[axis * 2] = w_row + row;
+        planes[axis * 2 + 1] = w_row - row;
+    }
+
+    for (int i = 0; i < PLANE_COUNT; i++) {
+        float length = glm::length(glm::vec3(planes[i]));
+        planes[i] = length > 0.0f ? planes[i] / length : glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+    }
+
+    visible_ranges.first_indices.clear();
+    visible_ranges.index_counts.clear();
+
+    CullingStatistics statistics = {0, 0, 0, 0};
+
+    Float4 zero = float4_splat(0.0f);
+    Float4 camera_x = float4_splat(object_camera_position.x);
+    Float4 camera_y = float4_splat(object_camera_position.y);
+    Float4 camera_z = float4_splat(object_camera_position.z);
+
+    int cluster_count = clusters.size();
+    for (int first_cluster = 0; first_cluster < cluster_count; first_cluster += 4) {
+        Float4 center_x = float4_load(&center_xs[first_cluster]);
+        Float4 center_y = float4_load(&center_ys[first_cluster]);
+        Float4 center_z = float4_load(&center_zs[first_cluster]);
+        Float4 radius = float4_load(&radii[first_cluster]);
+        Float4 negative_radius = zero - radius;
+
+        Mask4 is_culled = float4_less(zero, zero);
+        for (int i = 0; i < PLANE_COUNT; i++) {
+            Float4 distance = float4_dot3(
+                float4_splat(planes[i].x), float4_splat(planes[i].y), float4_splat(planes[i].z),
+                center_x, center_y, center_z
+            ) + float4_splat(planes[i].w);
+            is_culled = is_culled | float4_less(distance, negative_radius);
+        }
+
+        Float4 offset_x = center_x - camera_x;
+        Float4 offset_y = center_y - camera_y;
+        Float4 offset_z = center_z - camera_z;
+        Float4 offset_length = float4_sqrt(float4_dot3(offset_x, offset_y, offset_z, offset_x, offset_y, offset_z));
+        Float4 axis_distance = float4_dot3(
+            offset_x, offset_y, offset_z,
+            float4_load(&cone_axis_xs[first_cluster]), float4_load(&cone_axis_ys[first_cluster]), float4_load(&cone_axis_zs[first_cluster])
+        );
+        is_culled = is_culled | float4_greater_equal(axis_distance, float4_load(&cone_cutoffs[first_cluster]) * offset_length + radius);
+
+        int culled_bits = mask4_bits(is_culled);
+        int lane_count = std::min(4, cluster_count - first_cluster);
+        for (int lane = 0; lane < lane_count; lane++) {
+            const MeshCluster& cluster = clusters[first_cluster + lane];
+            if (culled_bits & (1 << lane)) {
+                statistics.culled_cluster_count++;
+                statistics.culled_triangle_count += cluster.index_count / 3;
+                continue;
+            }
+
+            statistics.visible_cluster_count++;
+            statistics.visible_triangle_count += cluster.index_count / 3;
+
+            // Neighboring visible clusters are contiguous in the index buffer and merge into one draw.
+            if (!visible_ranges.first_indices.empty() && visible_ranges.first_indices.back() + visible_ranges.index_counts.back() == cluster.first_index) {
+                visible_ranges.index_counts.back() += cluster.index_count;
+            } else {
+                visible_ranges.first_indices.push_back(cluster.first_index);
+                visible_ranges.index_counts.push_back(cluster.index_count);
+            }
+        }
+    }
+
+    return statistics;
+}
+
+// --------------------------------------------------------------------------
+
+void ClusterCuller::compute_cluster_bounds(const IndexedBufferData& indexed_buffer_data, MeshCluster& cluster) {
+    const int STRIDE = Model::FLOATS_PER_BUFFER_VERTEX;
+    const float MAX_FLOAT_VALUE = std::numeric_limits<float>::max();
+
+    const uint32_t* indices = &indexed_buffer_data.indices[cluster.first_index];
+    const float* vertex_data = indexed_buffer_data.vertex_data.data();
+
+    glm::vec3 bounds_min = glm::vec3(MAX_FLOAT_VALUE, MAX_FLOAT_VALUE, MAX_FLOAT_VALUE);
+    glm::vec3 bounds_max = glm::vec3(-MAX_FLOAT_VALUE, -MAX_FLOAT_VALUE, -MAX_FLOAT_VALUE);
+    for (int i = 0; i < cluster.index_count; i++) {
+        const float* position = &vertex_data[indices[i] * STRIDE];
+        bounds_min = glm::min(bounds_min, glm::vec3(position[0], position[1], position[2]));
+        bounds_max = glm::max(bounds_max, glm::vec3(position[0], position[1], position[2]));
+    }
+
+    cluster.center = 0.5f * (bounds_min + bounds_max);
+    cluster.radius = 0.0f;
+    for (int i = 0; i < cluster.index_count; i++) {
+        const float* position = &vertex_data[indices[i] * STRIDE];
+        cluster.radius = std::max(cluster.radius, glm::length(glm::vec3(position[0], position[1], position[2]) - cluster.center));
+    }
+
+    // The cone axis is the area-weighted average face normal, and the cutoff is the sine of
+    // the widest angle between it and any face normal, so cones over 90 degrees never cull.
+    std::vector<glm::vec3> face_normals(cluster.index_count / 3);
+    glm::vec3 normal_sum = glm::vec3(0.0f, 0.0f, 0.0f);
+    for (size_t triangle = 0; triangle < face_normals.size(); triangle++) {
+        const float* p0 = &vertex_data[indices[triangle * 3] * STRIDE];
+        const float* p1 = &vertex_data[indices[triangle * 3 + 1] * STRIDE];
+        const float* p2 = &vertex_data[indices[triangle * 3 + 2] * STRIDE];
+        glm::vec3 first_edge = glm::vec3(p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]);
+        glm::vec3 second_edge = glm::vec3(p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2]);
+
+        face_normals[triangle] = glm::cross(first_edge, second_edge);
+        normal_sum += face_normals[triangle];
+    }
+
+    cluster.cone_axis = glm::vec3(0.0f, 0.0f, 0.0f);
+    cluster.cone_cutoff = 2.0f;
+
+    float normal_sum_length = glm::length(normal_sum);
+    if (normal_sum_length <= 0.0f) {
+        return;
+    }
+
+    glm::vec3 cone_axis = normal_sum / normal_sum_length;
+    float min_dot = 1.0f;
+    for (const glm::vec3& face_normal : face_normals) {
+        float face_normal_length = glm::length(face_normal);
+        if (face_normal_length > 0.0f) {
+            min_dot = std::min(min_dot, glm::dot(cone_axis, face_normal) / face_normal_length);
+        }
+    }
+
+    if (min_dot > 0.0f) {
+        cluster.cone_axis = cone_axis;
+        cluster.cone_cutoff = std::sqrt(1.0f - min_dot * min_dot);
+    }
+}
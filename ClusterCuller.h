@@ -0,0 +1,67 @@
+#ifndef CLUSTER_CULLER_H
+#define CLUSTER_CULLER_H
+
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "Model.h"
+
+struct MeshCluster {
+    int first_index;
+    int index_count;
+
+    glm::vec3 center;
+    float radius;
+
+    // The cluster faces away from every camera position in the cone behind it,
+    // see ClusterCuller::cull(). A cutoff above 1 disables the test. Culling by cone is only
+    // correct when back faces are culled too, so the viewer enables GL_CULL_FACE with it.
+    glm::vec3 cone_axis;
+    float cone_cutoff;
+};
+
+struct CullingStatistics {
+    int visible_cluster_count;
+    int culled_cluster_count;
+    long long visible_triangle_count;
+    long long culled_triangle_count;
+};
+
+struct VisibleRanges {
+    std::vector<int> first_indices;
+    std::vector<int> index_counts;
+};
+
+class ClusterCuller {
+
+public:
+
+    ClusterCuller();
+    ~ClusterCuller();
+
+    void build_clusters(const IndexedBufferData& indexed_buffer_data, int first_index, int index_count);
+    const std::vector<MeshCluster>& get_clusters() const;
+
+    CullingStatistics cull(const glm::mat4& model_view_projection, glm::vec3 object_camera_position, VisibleRanges& visible_ranges);
+
+private:
+
+    static const int MIN_CLUSTER_TRIANGLES = 64;
+    static const int MAX_CLUSTER_TRIANGLES = 256;
+
+    std::vector<MeshCluster> clusters;
+
+    // Cluster bounds in structure-of-arrays form, padded to a multiple of four for the SIMD pass.
+    std::vector<float> center_xs;
+    std::vector<float> center_ys;
+    std::vector<float> center_zs;
+    std::vector<float> radii;
+    std::vector<float> cone_axis_xs;
+    std::vector<float> cone_axis_ys;
+    std::vector<float> cone_axis_zs;
+    std::vector<float> cone_cutoffs;
+
+    void compute_cluster_bounds(const IndexedBufferData& indexed_buffer_data, MeshCluster& cluster);
+};
+
+#endif
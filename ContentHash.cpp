@@ -0,0 +1,91 @@
+#include "ContentHash.h"
+
+#include <cstring>
+
+static const uint64_t PRIME_1 = 0x9E3779B185EBCA87ULL;
+static const uint64_t PRIME_2 = 0xC2B2AE3D27D4EB4FULL;
+static const uint64_t PRIME_3 = 0x165667B19E3779F9ULL;
+static const uint64_t PRIME_4 = 0x85EBCA77C2B2AE63ULL;
+static const uint64_t PRIME_5 = 0x27D4EB2F165667C5ULL;
+
+static uint64_t rotate_left(uint64_t value, int bits) {
+    return (value << bits) | (value >> (64 - bits));
+}
+
+static uint64_t read_uint64(const unsigned char* bytes) {
+    uint64_t value;
+    std::memcpy(&value, bytes, sizeof(value));
+    return value;
+}
+
+static uint32_t read_uint32(const unsigned char* bytes) {
+    uint32_t value;
+    std::memcpy(&value, bytes, sizeof(value));
+    return value;
+}
+
+static uint64_t accumulate(uint64_t accumulator, uint64_t input) {
+    accumulator += input * PRIME_2;
+    accumulator = rotate_left(accumulator, 31);
+    return accumulator * PRIME_1;
+}
+
+static uint64_t merge_accumulator(uint64_t hash, uint64_t accumulator) {
+    hash ^= accumulate(0, accumulator);
+    return hash * PRIME_1 + PRIME_4;
+}
+
+// --------------------------------------------------------------------------
+
+uint64_t compute_content_hash(const void* data, size_t size, uint64_t seed) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    const unsigned char* end = bytes + size;
+
+    uint64_t hash;
+    if (size >= 32) {
+        uint64_t accumulators[4] = {seed + PRIME_1 + PRIME_2, seed + PRIME_2, seed, seed - PRIME_1};
+
+        const unsigned char* stripes_end = end - 32;
+        do {
+            for (int i = 0; i < 4; i++) {
+                accumulators[i] = accumulate(accumulators[i], read_uint64(bytes + i * 8));
+            }
+            bytes += 32;
+        } while (bytes <= stripes_end);
+
+        hash = rotate_left(accumulators[0], 1) + rotate_left(accumulators[1], 7) + rotate_left(accumulators[2], 12) + rotate_left(accumulators[3], 18);
+        for (int i = 0; i < 4; i++) {
+            hash = merge_accumulator(hash, accumulators[i]);
+        }
+    } else {
+        hash = seed + PRIME_5;
+    }
+
+    hash += size;
+
+    while (bytes + 8 <= end) {
+        hash ^= accumulate(0, read_uint64(bytes));
+        hash = rotate_left(hash, 27) * PRIME_1 + PRIME_4;
+        bytes += 8;
+    }
+
+    if (bytes + 4 <= end) {
+        hash ^= read_uint32(bytes) * PRIME_1;
+        hash = rotate_left(hash, 23) * PRIME_2 + PRIME_3;
+        bytes += 4;
+    }
+
+    while (bytes < end) {
+        hash ^= (*bytes) * PRIME_5;
+        hash = rotate_left(hash, 11) * PRIME_1;
+        bytes++;
+    }
+
+    hash ^= hash >> 33;
+    hash *= PRIME_2;
+    hash ^= hash >> 29;
+    hash *= PRIME_3;
+    hash ^= hash >> 32;
+
+    return hash;
+}
@@ -0,0 +1,10 @@
+#ifndef CONTENT_HASH_H
+#define CONTENT_HASH_H
+
+#include <cstdint>
+#include <cstddef>
+
+// 64-bit XXH64 hash, used to key caches by the contents of files and buffers.
+uint64_t compute_content_hash(const void* data, size_t size, uint64_t seed = 0);
+
+#endif
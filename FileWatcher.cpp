@@ -0,0 +1,86 @@
+#include "FileWatcher.h"
+
+#include <thread>
+#include <chrono>
+#include <iostream>
+#include <unistd.h>
+
+#if defined(__linux__)
+#include <poll.h>
+#include <sys/inotify.h>
+#endif
+
+FileWatcher::FileWatcher()
+:
+inotify_descriptor(-1),
+watch_descriptor(-1) {
+    // do nothing for now
+}
+
+// --------------------------------------------------------------------------
+
+FileWatcher::~FileWatcher() {
+    close();
+}
+
+// --------------------------------------------------------------------------
+
+bool FileWatcher::open(const std::string& file_path) {
+    close();
+
+#if defined(__linux__)
+    inotify_descriptor = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotify_descriptor < 0) {
+        std::cerr << "[WARN] Could not start inotify, so \"" << file_path << "\" will be checked on a timer" << std::endl;
+        return true;
+    }
+
+    // Writers that replace the file instead of appending to it are caught by the delete and
+    // move events, so the reader can notice and stop instead of waiting forever.
+    watch_descriptor = inotify_add_watch(inotify_descriptor, file_path.c_str(), IN_MODIFY | IN_CLOSE_WRITE | IN_ATTRIB | IN_DELETE_SELF | IN_MOVE_SELF);
+    if (watch_descriptor < 0) {
+        close();
+        return false;
+    }
+#else
+    (void)file_path;
+#endif
+
+    return true;
+}
+
+// --------------------------------------------------------------------------
+
+void FileWatcher::close() {
+    if (inotify_descriptor >= 0) {
+        ::close(inotify_descriptor);
+    }
+
+    inotify_descriptor = -1;
+    watch_descriptor = -1;
+}
+
+// --------------------------------------------------------------------------
+
+bool FileWatcher::wait_for_change(int timeout_ms) {
+    // Returns whether the file may have changed. Waking up without a change is allowed, and
+    // the timeout lets the caller check whether it should stop.
+#if defined(__linux__)
+    if (inotify_descriptor >= 0) {
+        pollfd poll_descriptor = {inotify_descriptor, POLLIN, 0};
+        if (poll(&poll_descriptor, 1, timeout_ms) <= 0) {
+            return false;
+        }
+
+        // Only the fact that something happened matters, so the events are just drained.
+        alignas(inotify_event) char events[4096];
+        while (read(inotify_descriptor, events, sizeof(events)) > 0) {
+            // do nothing
+        }
+        return true;
+    }
+#endif
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(timeout_ms));
+    return true;
+}
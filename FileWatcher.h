@@ -0,0 +1,29 @@
+#ifndef FILE_WATCHER_H
+#define FILE_WATCHER_H
+
+#include <string>
+
+// Sleeps until a file changes. Linux is told about writes by inotify; other platforms just
+// wait out the timeout, so callers always look at the file again themselves.
+class FileWatcher {
+
+public:
+
+    FileWatcher();
+    ~FileWatcher();
+
+    FileWatcher(const FileWatcher&) = delete;
+    FileWatcher& operator=(const FileWatcher&) = delete;
+
+    bool open(const std::string& file_path);
+    void close();
+
+    bool wait_for_change(int timeout_ms);
+
+private:
+
+    int inotify_descriptor;
+    int watch_descriptor;
+};
+
+#endif
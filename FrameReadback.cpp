@@ -0,0 +1,197 @@
+#include "FrameReadback.h"
+
+#include <iostream>
+#include <cstring>
+
+#include "ImageSequenceWriter.h"
+#include "Profiler.h"
+
+FrameReadback::FrameReadback()
+:
+width(0),
+height(0),
+framebuffer(0),
+color_renderbuffer(0),
+depth_renderbuffer(0),
+next_slot(0),
+stall_count(0),
+is_initialized(false) {
+    // do nothing for now
+}
+
+// --------------------------------------------------------------------------
+
+FrameReadback::~FrameReadback() {
+    // do nothing for now
+}
+
+// --------------------------------------------------------------------------
+
+bool FrameReadback::initialize(int width, int height) {
+    // Needs a current OpenGL context. A hidden window's own framebuffer may not keep what's
+    // drawn into it, so frames go to renderbuffers of exactly the requested size instead.
+    this->width = width;
+    this->height = height;
+
+    glGenRenderbuffers(1, &color_renderbuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, color_renderbuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+
+    glGenRenderbuffers(1, &depth_renderbuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, depth_renderbuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glGenFramebuffers(1, &framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color_renderbuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth_renderbuffer);
+    GLenum framebuffer_status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    size_t frame_size_in_bytes = (size_t)width * height * 4;
+    for (PendingFrame& pending_frame : ring) {
+        glGenBuffers(1, &pending_frame.pixel_buffer);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, pending_frame.pixel_buffer);
+        glBufferData(GL_PIXEL_PACK_BUFFER, frame_size_in_bytes, nullptr, GL_STREAM_READ);
+        pending_frame.fence = nullptr;
+        pending_frame.frame_index = -1;
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    is_initialized = true;
+    next_slot = 0;
+
+    if (framebuffer_status != GL_FRAMEBUFFER_COMPLETE) {
+        std::cerr << "[ERROR] Could not create a " << width << "x" << height << " offscreen framebuffer" << std::endl;
+        destroy();
+        return false;
+    }
+
+    return true;
+}
+
+// --------------------------------------------------------------------------
+
+void FrameReadback::destroy() {
+    if (!is_initialized) {
+        return;
+    }
+
+    for (PendingFrame& pending_frame : ring) {
+        if (pending_frame.fence != nullptr) {
+            glDeleteSync(pending_frame.fence);
+        }
+        glDeleteBuffers(1, &pending_frame.pixel_buffer);
+    }
+
+    glDeleteFramebuffers(1, &framebuffer);
+    glDeleteRenderbuffers(1, &color_renderbuffer);
+    glDeleteRenderbuffers(1, &depth_renderbuffer);
+    is_initialized = false;
+}
+
+// --------------------------------------------------------------------------
+
+void FrameReadback::bind_framebuffer() {
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glViewport(0, 0, width, height);
+}
+
+// --------------------------------------------------------------------------
+
+void FrameReadback::read_frame(int frame_index, ImageSequenceWriter& image_sequence_writer) {
+    // Collects the frame that was read into this slot RING_SIZE frames ago, then queues the
+    // copy of the current one.
+    PROFILE_SCOPE("FrameReadback::read_frame");
+
+    PendingFrame& pending_frame = ring[next_slot];
+    if (pending_frame.frame_index >= 0) {
+        collect_frame(pending_frame, image_sequence_writer);
+    }
+
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, pending_frame.pixel_buffer);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    pending_frame.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    pending_frame.frame_index = frame_index;
+    next_slot = (next_slot + 1) % RING_SIZE;
+}
+
+// --------------------------------------------------------------------------
+
+void FrameReadback::finish(ImageSequenceWriter& image_sequence_writer) {
+    // Collects every frame still in flight, oldest first.
+    for (int i = 0; i < RING_SIZE; i++) {
+        PendingFrame& pending_frame = ring[(next_slot + i) % RING_SIZE];
+        if (pending_frame.frame_index >= 0) {
+            collect_frame(pending_frame, image_sequence_writer);
+        }
+    }
+}
+
+// --------------------------------------------------------------------------
+
+int FrameReadback::get_stall_count() const {
+    // How many frames weren't copied yet when they were collected, which means the ring is
+    // too short for the GPU's latency.
+    return stall_count;
+}
+
+// --------------------------------------------------------------------------
+
+void FrameReadback::collect_frame(PendingFrame& pending_frame, ImageSequenceWriter& image_sequence_writer) {
+    PROFILE_SCOPE("FrameReadback::collect_frame");
+
+    if (glClientWaitSync(pending_frame.fence, 0, 0) == GL_TIMEOUT_EXPIRED) {
+        stall_count++;
+
+        const GLuint64 TIMEOUT_NS = 1000000000;
+        GLenum wait_result = glClientWaitSync(pending_frame.fence, GL_SYNC_FLUSH_COMMANDS_BIT, TIMEOUT_NS);
+        if (wait_result == GL_TIMEOUT_EXPIRED || wait_result == GL_WAIT_FAILED) {
+            std::cerr << "[WARN] Gave up waiting for frame " << pending_frame.frame_index << " to be read back" << std::endl;
+        }
+    }
+    glDeleteSync(pending_frame.fence);
+    pending_frame.fence = nullptr;
+
+    Image image;
+    image.width = width;
+    image.height = height;
+    image.pixels.resize((size_t)width * height * 4);
+
+    // OpenGL rows go from the bottom up, and images from the top down.
+    size_t row_size = (size_t)width * 4;
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, pending_frame.pixel_buffer);
+    const unsigned char* pixels = static_cast<const unsigned char*>(glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, row_size * height, GL_MAP_READ_BIT));
+    if (pixels != nullptr) {
+        for (int y = 0; y < height; y++) {
+            std::memcpy(&image.pixels[(size_t)(height - 1 - y) * row_size], &pixels[(size_t)y * row_size], row_size);
+        }
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    } else {
+        std::cerr << "[WARN] Could not map the pixels of frame " << pending_frame.frame_index << std::endl;
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    if (pixels != nullptr) {
+        image_sequence_writer.write(pending_frame.frame_index, std::move(image));
+    }
+    pending_frame.frame_index = -1;
+}
+
+// --------------------------------------------------------------------------
+
+size_t FrameReadback::get_size_in_bytes() const {
+    // The renderbuffers and the ring of pixel buffers, taking depth as four bytes a pixel
+    // the way drivers usually store it.
+    if (!is_initialized) {
+        return 0;
+    }
+
+    size_t frame_size_in_bytes = (size_t)width * height * 4;
+    return (2 + RING_SIZE) * frame_size_in_bytes;
+}
@@ -0,0 +1,54 @@
+#ifndef FRAME_READBACK_H
+#define FRAME_READBACK_H
+
+#include <GL/glew.h>
+#include <cstddef>
+
+class ImageSequenceWriter;
+
+// Renders frames into an offscreen framebuffer of a fixed size and reads them back through
+// a ring of pixel buffers. Each read only queues a copy on the GPU, and a frame is collected
+// when its buffer comes round again, by which time the copy has long finished, so reading
+// back never stalls the frame being drawn.
+class FrameReadback {
+
+public:
+
+    FrameReadback();
+    ~FrameReadback();
+
+    bool initialize(int width, int height);
+    void destroy();
+
+    void bind_framebuffer();
+    void read_frame(int frame_index, ImageSequenceWriter& image_sequence_writer);
+    void finish(ImageSequenceWriter& image_sequence_writer);
+
+    int get_stall_count() const;
+    size_t get_size_in_bytes() const;
+
+private:
+
+    static const int RING_SIZE = 4;
+
+    struct PendingFrame {
+        GLuint pixel_buffer;
+        GLsync fence;
+        int frame_index;
+    };
+
+    void collect_frame(PendingFrame& pending_frame, ImageSequenceWriter& image_sequence_writer);
+
+    int width;
+    int height;
+    GLuint framebuffer;
+    GLuint color_renderbuffer;
+    GLuint depth_renderbuffer;
+
+    PendingFrame ring[RING_SIZE];
+    int next_slot;
+    int stall_count;
+    bool is_initialized;
+};
+
+#endif
@@ -0,0 +1,97 @@
+#include "GpuTimer.h"
+
+#ifdef ENABLE_PROFILING
+
+GpuTimer::GpuTimer()
+:
+next_query(0),
+oldest_pending_query(0),
+is_running(false),
+is_initialized(false),
+dropped_count(0) {
+    // do nothing for now
+}
+
+// --------------------------------------------------------------------------
+
+GpuTimer::~GpuTimer() {
+    // do nothing for now
+}
+
+// --------------------------------------------------------------------------
+
+void GpuTimer::initialize() {
+    // Needs a current OpenGL context.
+    glGenQueries(QUERY_COUNT, queries);
+    for (int i = 0; i < QUERY_COUNT; i++) {
+        is_query_pending[i] = false;
+    }
+    is_initialized = true;
+}
+
+// --------------------------------------------------------------------------
+
+void GpuTimer::destroy() {
+    if (is_initialized) {
+        glDeleteQueries(QUERY_COUNT, queries);
+        is_initialized = false;
+    }
+}
+
+// --------------------------------------------------------------------------
+
+void GpuTimer::begin(const char* name) {
+    if (!is_initialized || is_query_pending[next_query]) {
+        dropped_count += is_initialized ? 1 : 0;
+        return;
+    }
+
+    query_names[next_query] = name;
+    query_start_times_us[next_query] = Profiler::get_instance().get_time_us();
+    glBeginQuery(GL_TIME_ELAPSED, queries[next_query]);
+    is_running = true;
+}
+
+// --------------------------------------------------------------------------
+
+void GpuTimer::end() {
+    if (!is_running) {
+        return;
+    }
+
+    glEndQuery(GL_TIME_ELAPSED);
+    is_query_pending[next_query] = true;
+    next_query = (next_query + 1) % QUERY_COUNT;
+    is_running = false;
+}
+
+// --------------------------------------------------------------------------
+
+std::vector<GpuTiming> GpuTimer::collect_results() {
+    // Queries complete in submission order, so stop at the first one that isn't ready.
+    std::vector<GpuTiming> results;
+    while (is_initialized && is_query_pending[oldest_pending_query]) {
+        GLint is_available = GL_FALSE;
+        glGetQueryObjectiv(queries[oldest_pending_query], GL_QUERY_RESULT_AVAILABLE, &is_available);
+        if (!is_available) {
+            break;
+        }
+
+        GLuint64 elapsed_ns = 0;
+        glGetQueryObjectui64v(queries[oldest_pending_query], GL_QUERY_RESULT, &elapsed_ns);
+        results.push_back({query_names[oldest_pending_query], query_start_times_us[oldest_pending_query], elapsed_ns / 1.0e6});
+
+        is_query_pending[oldest_pending_query] = false;
+        oldest_pending_query = (oldest_pending_query + 1) % QUERY_COUNT;
+    }
+
+    return results;
+}
+
+// --------------------------------------------------------------------------
+
+int GpuTimer::get_dropped_count() const {
+    return dropped_count;
+}
+
+#endif
@@ -0,0 +1,55 @@
+#ifndef GPU_TIMER_H
+#define GPU_TIMER_H
+
+#include "Profiler.h"
+
+#ifdef ENABLE_PROFILING
+
+#include <GL/glew.h>
+#include <vector>
+#include <cstdint>
+
+struct GpuTiming {
+    const char* name;
+    int64_t cpu_start_us;
+    double elapsed_ms;
+};
+
+class GpuTimer {
+
+public:
+
+    GpuTimer();
+    ~GpuTimer();
+
+    void initialize();
+    void destroy();
+
+    void begin(const char* name);
+    void end();
+
+    std::vector<GpuTiming> collect_results();
+
+    int get_dropped_count() const;
+
+private:
+
+    // Results usually arrive a frame or two late, so a small ring covers the latency without
+    // ever waiting on the GPU. If every query is still in flight, the interval isn't timed.
+    static const int QUERY_COUNT = 8;
+
+    GLuint queries[QUERY_COUNT];
+    const char* query_names[QUERY_COUNT];
+    int64_t query_start_times_us[QUERY_COUNT];
+    bool is_query_pending[QUERY_COUNT];
+
+    int next_query;
+    int oldest_pending_query;
+    bool is_running;
+    bool is_initialized;
+    int dropped_count;
+};
+
+#endif
+
+#endif
@@ -0,0 +1,98 @@
+#include "GrowableBuffer.h"
+
+#include <algorithm>
+
+#include "Profiler.h"
+
+GrowableBuffer::GrowableBuffer()
+:
+size(0),
+capacity(0) {
+    // do nothing for now
+}
+
+// --------------------------------------------------------------------------
+
+GrowableBuffer::~GrowableBuffer() {
+    // do nothing for now
+}
+
+// --------------------------------------------------------------------------
+
+void GrowableBuffer::initialize(size_t capacity_in_bytes) {
+    // Needs a current OpenGL context. The copy write target is used throughout, so whatever
+    // is bound to the array and element targets stays put.
+    chunks.clear();
+    size = 0;
+    capacity = 0;
+
+    add_chunk(std::max<size_t>(capacity_in_bytes, 1));
+}
+
+// --------------------------------------------------------------------------
+
+void GrowableBuffer::append(const void* data, size_t size_in_bytes) {
+    // Appended data is never split across chunks, so a vertex always lies in one buffer.
+    // Whatever is left at the end of a full chunk goes unused.
+    if (chunks.back().size + size_in_bytes > chunks.back().capacity) {
+        PROFILE_SCOPE("GrowableBuffer::grow");
+
+        size_t new_capacity = chunks.back().capacity * 2;
+        while (size_in_bytes > new_capacity) {
+            new_capacity *= 2;
+        }
+
+        add_chunk(new_capacity);
+    }
+
+    Chunk& chunk = chunks.back();
+    glBindBuffer(GL_COPY_WRITE_BUFFER, chunk.buffer);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, chunk.size, size_in_bytes, data);
+    chunk.size += size_in_bytes;
+    size += size_in_bytes;
+}
+
+// --------------------------------------------------------------------------
+
+int GrowableBuffer::get_chunk_count() const {
+    return (int)chunks.size();
+}
+
+// --------------------------------------------------------------------------
+
+GLuint GrowableBuffer::get_chunk_buffer(int chunk) const {
+    return chunks[chunk].buffer;
+}
+
+// --------------------------------------------------------------------------
+
+size_t GrowableBuffer::get_chunk_size(int chunk) const {
+    return chunks[chunk].size;
+}
+
+// --------------------------------------------------------------------------
+
+size_t GrowableBuffer::get_size() const {
+    return size;
+}
+
+// --------------------------------------------------------------------------
+
+size_t GrowableBuffer::get_capacity() const {
+    return capacity;
+}
+
+// --------------------------------------------------------------------------
+
+void GrowableBuffer::add_chunk(size_t capacity_in_bytes) {
+    Chunk chunk;
+    chunk.size = 0;
+    chunk.capacity = capacity_in_bytes;
+
+    glGenBuffers(1, &chunk.buffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, chunk.buffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, capacity_in_bytes, nullptr, GL_DYNAMIC_DRAW);
+
+    chunks.push_back(chunk);
+    capacity += capacity_in_bytes;
+}
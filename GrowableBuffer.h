@@ -0,0 +1,45 @@
+#ifndef GROWABLE_BUFFER_H
+#define GROWABLE_BUFFER_H
+
+#include <GL/glew.h>
+#include <cstddef>
+#include <vector>
+
+// GPU memory that data is only ever appended to, kept as a chain of buffers. Each append
+// uploads just the new bytes. When the newest buffer is full, another one twice its size is
+// added to the chain, so nothing already uploaded is ever copied and an append never costs
+// more than its own upload plus, at most, allocating one empty buffer. Each buffer is drawn
+// on its own, and there are only as many as the number of times the size has doubled.
+class GrowableBuffer {
+
+public:
+
+    GrowableBuffer();
+    ~GrowableBuffer();
+
+    void initialize(size_t capacity_in_bytes);
+    void append(const void* data, size_t size_in_bytes);
+
+    int get_chunk_count() const;
+    GLuint get_chunk_buffer(int chunk) const;
+    size_t get_chunk_size(int chunk) const;
+
+    size_t get_size() const;
+    size_t get_capacity() const;
+
+private:
+
+    struct Chunk {
+        GLuint buffer;
+        size_t size;
+        size_t capacity;
+    };
+
+    void add_chunk(size_t capacity_in_bytes);
+
+    std::vector<Chunk> chunks;
+    size_t size;
+    size_t capacity;
+};
+
+#endif
@@ -0,0 +1,289 @@
+#include "ImageDecoder.h"
+
+#include <cstring>
+#include <cstdint>
+#include <cctype>
+#include <iostream>
+#include <algorithm>
+
+static uint16_t read_uint16(const unsigned char* data) {
+    return data[0] | (data[1] << 8);
+}
+
+// --------------------------------------------------------------------------
+
+static uint32_t read_uint32(const unsigned char* data) {
+    return data[0] | (data[1] << 8) | (data[2] << 16) | ((uint32_t)data[3] << 24);
+}
+
+// --------------------------------------------------------------------------
+
+ImageDecoder::ImageDecoder() {
+    // do nothing for now
+}
+
+// --------------------------------------------------------------------------
+
+ImageDecoder::~ImageDecoder() {
+    // do nothing for now
+}
+
+// --------------------------------------------------------------------------
+
+std::optional<Image> ImageDecoder::decode(const unsigned char* data, size_t size, const std::string& file_path) {
+    // The format is told by the file's contents rather than its extension. TGA has no magic
+    // number, so it's whatever is left once the others have been ruled out.
+    const unsigned char PNG_MAGIC[4] = {0x89, 'P', 'N', 'G'};
+    const unsigned char JPEG_MAGIC[3] = {0xFF, 0xD8, 0xFF};
+
+    if (size >= 4 && std::memcmp(data, PNG_MAGIC, sizeof(PNG_MAGIC)) == 0) {
+        std::cerr << "[WARN] PNG textures aren't supported, convert \"" << file_path << "\" to TGA, BMP or PPM" << std::endl;
+        return std::nullopt;
+    } else if (size >= 3 && std::memcmp(data, JPEG_MAGIC, sizeof(JPEG_MAGIC)) == 0) {
+        std::cerr << "[WARN] JPEG textures aren't supported, convert \"" << file_path << "\" to TGA, BMP or PPM" << std::endl;
+        return std::nullopt;
+    } else if (size >= 2 && data[0] == 'B' && data[1] == 'M') {
+        return decode_bmp(data, size, file_path);
+    } else if (size >= 2 && data[0] == 'P' && (data[1] == '5' || data[1] == '6')) {
+        return decode_pnm(data, size, file_path);
+    }
+
+    return decode_tga(data, size, file_path);
+}
+
+// --------------------------------------------------------------------------
+
+std::optional<Image> ImageDecoder::decode_tga(const unsigned char* data, size_t size, const std::string& file_path) {
+    // Uncompressed and run-length encoded true color (24 or 32 bits) and grayscale (8 bits).
+    const size_t HEADER_SIZE = 18;
+    if (size < HEADER_SIZE) {
+        std::cerr << "[WARN] Unknown image format in \"" << file_path << "\"" << std::endl;
+        return std::nullopt;
+    }
+
+    int id_length = data[0];
+    int color_map_type = data[1];
+    int image_type = data[2];
+    int color_map_length = read_uint16(data + 5);
+    int color_map_entry_bits = data[7];
+    int width = read_uint16(data + 12);
+    int height = read_uint16(data + 14);
+    int bits_per_pixel = data[16];
+    bool is_top_down = (data[17] & 0x20) != 0;
+
+    bool is_true_color = (image_type == 2 || image_type == 10) && (bits_per_pixel == 24 || bits_per_pixel == 32);
+    bool is_grayscale = (image_type == 3 || image_type == 11) && bits_per_pixel == 8;
+    if (color_map_type > 1 || (!is_true_color && !is_grayscale)) {
+        std::cerr << "[WARN] Unknown or unsupported image format in \"" << file_path << "\"" << std::endl;
+        return std::nullopt;
+    }
+
+    Image image;
+    if (!create_image(width, height, image, file_path)) {
+        return std::nullopt;
+    }
+
+    bool is_run_length_encoded = image_type >= 9;
+    int bytes_per_pixel = bits_per_pixel / 8;
+    size_t position = HEADER_SIZE + id_length + (color_map_type == 1 ? color_map_length * ((color_map_entry_bits + 7) / 8) : 0);
+
+    auto write_pixel = [&](int pixel_index, const unsigned char* source) {
+        int x = pixel_index % width;
+        int y = pixel_index / width;
+        unsigned char* destination = &image.pixels[((size_t)(is_top_down ? y : height - 1 - y) * width + x) * 4];
+        if (bytes_per_pixel == 1) {
+            destination[0] = destination[1] = destination[2] = source[0];
+            destination[3] = 255;
+        } else {
+            destination[0] = source[2];
+            destination[1] = source[1];
+            destination[2] = source[0];
+            destination[3] = bytes_per_pixel == 4 ? source[3] : 255;
+        }
+    };
+
+    int pixel_count = width * height;
+    int pixel_index = 0;
+    while (pixel_index < pixel_count) {
+        int run_length = 1;
+        bool is_repeated = false;
+        if (is_run_length_encoded) {
+            if (position >= size) {
+                break;
+            }
+            is_repeated = (data[position] & 0x80) != 0;
+            run_length = std::min((data[position] & 0x7F) + 1, pixel_count - pixel_index);
+            position++;
+        }
+
+        size_t run_size = (size_t)(is_repeated ? 1 : run_length) * bytes_per_pixel;
+        if (position + run_size > size) {
+            break;
+        }
+
+        for (int i = 0; i < run_length; i++) {
+            write_pixel(pixel_index++, data + position + (is_repeated ? 0 : i * bytes_per_pixel));
+        }
+        position += run_size;
+    }
+
+    if (pixel_index < pixel_count) {
+        std::cerr << "[WARN] Image \"" << file_path << "\" is truncated" << std::endl;
+        return std::nullopt;
+    }
+
+    return image;
+}
+
+// --------------------------------------------------------------------------
+
+std::optional<Image> ImageDecoder::decode_bmp(const unsigned char* data, size_t size, const std::string& file_path) {
+    // Uncompressed 24 and 32-bit bitmaps, stored bottom-up unless the height is negative.
+    const size_t HEADER_SIZE = 54;
+    const uint32_t BI_RGB = 0;
+    const uint32_t BI_BITFIELDS = 3;
+    if (size < HEADER_SIZE) {
+        std::cerr << "[WARN] Image \"" << file_path << "\" is truncated" << std::endl;
+        return std::nullopt;
+    }
+
+    uint32_t pixel_offset = read_uint32(data + 10);
+    int32_t width = (int32_t)read_uint32(data + 18);
+    int32_t height = (int32_t)read_uint32(data + 22);
+    int bits_per_pixel = read_uint16(data + 28);
+    uint32_t compression = read_uint32(data + 30);
+
+    bool is_supported = (bits_per_pixel == 24 && compression == BI_RGB) || (bits_per_pixel == 32 && (compression == BI_RGB || compression == BI_BITFIELDS));
+    if (!is_supported) {
+        std::cerr << "[WARN] Only uncompressed 24 and 32-bit bitmaps are supported, \"" << file_path << "\" isn't one" << std::endl;
+        return std::nullopt;
+    }
+
+    bool is_top_down = height < 0;
+    height = (int32_t)std::min<int64_t>(is_top_down ? -(int64_t)height : height, MAX_IMAGE_SIZE + 1);
+
+    Image image;
+    if (!create_image(width, height, image, file_path)) {
+        return std::nullopt;
+    }
+
+    int bytes_per_pixel = bits_per_pixel / 8;
+    size_t row_stride = ((size_t)width * bytes_per_pixel + 3) & ~(size_t)3;
+    if (pixel_offset > size || (size - pixel_offset) / row_stride < (size_t)height) {
+        std::cerr << "[WARN] Image \"" << file_path << "\" is truncated" << std::endl;
+        return std::nullopt;
+    }
+
+    // Many writers leave the fourth byte of 32-bit pixels at zero, so it only counts as
+    // alpha if some pixel sets it.
+    unsigned char max_alpha = 0;
+    for (int y = 0; y < height; y++) {
+        const unsigned char* source = data + pixel_offset + (size_t)(is_top_down ? y : height - 1 - y) * row_stride;
+        unsigned char* destination = &image.pixels[(size_t)y * width * 4];
+        for (int x = 0; x < width; x++) {
+            destination[0] = source[2];
+            destination[1] = source[1];
+            destination[2] = source[0];
+            destination[3] = bytes_per_pixel == 4 ? source[3] : 255;
+            max_alpha = std::max(max_alpha, destination[3]);
+            source += bytes_per_pixel;
+            destination += 4;
+        }
+    }
+
+    if (max_alpha == 0) {
+        for (size_t i = 3; i < image.pixels.size(); i += 4) {
+            image.pixels[i] = 255;
+        }
+    }
+
+    return image;
+}
+
+// --------------------------------------------------------------------------
+
+std::optional<Image> ImageDecoder::decode_pnm(const unsigned char* data, size_t size, const std::string& file_path) {
+    // Binary PGM (P5) and PPM (P6) with at most 8 bits per sample.
+    bool is_grayscale = data[1] == '5';
+    size_t position = 2;
+
+    auto read_header_value = [&](int& value) {
+        while (position < size) {
+            if (data[position] == '#') {
+                while (position < size && data[position] != '\n') {
+                    position++;
+                }
+            } else if (std::isspace(data[position])) {
+                position++;
+            } else {
+                break;
+            }
+        }
+
+        if (position >= size || !std::isdigit(data[position])) {
+            return false;
+        }
+
+        value = 0;
+        while (position < size && std::isdigit(data[position]) && value <= MAX_IMAGE_SIZE) {
+            value = value * 10 + (data[position++] - '0');
+        }
+        return true;
+    };
+
+    int width;
+    int height;
+    int max_value;
+    if (!read_header_value(width) || !read_header_value(height) || !read_header_value(max_value) || position >= size) {
+        std::cerr << "[WARN] Image \"" << file_path << "\" has an invalid header" << std::endl;
+        return std::nullopt;
+    }
+
+    if (max_value < 1 || max_value > 255) {
+        std::cerr << "[WARN] Only 8-bit PGM and PPM images are supported, \"" << file_path << "\" isn't one" << std::endl;
+        return std::nullopt;
+    }
+
+    // Exactly one whitespace character separates the header from the samples.
+    position++;
+
+    Image image;
+    if (!create_image(width, height, image, file_path)) {
+        return std::nullopt;
+    }
+
+    int samples_per_pixel = is_grayscale ? 1 : 3;
+    size_t pixel_count = (size_t)width * height;
+    if ((size - position) / samples_per_pixel < pixel_count) {
+        std::cerr << "[WARN] Image \"" << file_path << "\" is truncated" << std::endl;
+        return std::nullopt;
+    }
+
+    const unsigned char* source = data + position;
+    unsigned char* destination = image.pixels.data();
+    for (size_t i = 0; i < pixel_count; i++) {
+        for (int channel = 0; channel < 3; channel++) {
+            int sample = source[is_grayscale ? 0 : channel];
+            destination[channel] = max_value == 255 ? sample : (std::min(sample, max_value) * 255 + max_value / 2) / max_value;
+        }
+        destination[3] = 255;
+        source += samples_per_pixel;
+        destination += 4;
+    }
+
+    return image;
+}
+
+// --------------------------------------------------------------------------
+
+bool ImageDecoder::create_image(int width, int height, Image& image, const std::string& file_path) {
+    if (width <= 0 || height <= 0 || width > MAX_IMAGE_SIZE || height > MAX_IMAGE_SIZE) {
+        std::cerr << "[WARN] Image \"" << file_path << "\" has an unsupported size of " << width << "x" << height << std::endl;
+        return false;
+    }
+
+    image.width = width;
+    image.height = height;
+    image.pixels.resize((size_t)width * height * 4);
+    return true;
+}
@@ -0,0 +1,36 @@
+#ifndef IMAGE_DECODER_H
+#define IMAGE_DECODER_H
+
+#include <string>
+#include <vector>
+#include <optional>
+#include <cstddef>
+
+// 8-bit RGBA pixels, rows from top to bottom.
+struct Image {
+    int width;
+    int height;
+    std::vector<unsigned char> pixels;
+};
+
+class ImageDecoder {
+
+public:
+
+    ImageDecoder();
+    ~ImageDecoder();
+
+    std::optional<Image> decode(const unsigned char* data, size_t size, const std::string& file_path);
+
+private:
+
+    static const int MAX_IMAGE_SIZE = 16384;
+
+    std::optional<Image> decode_tga(const unsigned char* data, size_t size, const std::string& file_path);
+    std::optional<Image> decode_bmp(const unsigned char* data, size_t size, const std::string& file_path);
+    std::optional<Image> decode_pnm(const unsigned char* data, size_t size, const std::string& file_path);
+
+    bool create_image(int width, int height, Image& image, const std::string& file_path);
+};
+
+#endif
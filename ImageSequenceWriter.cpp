@@ -0,0 +1,178 @@
+#include "ImageSequenceWriter.h"
+
+#include <iostream>
+#include <filesystem>
+
+#include "ImageWriter.h"
+#include "ThreadPool.h"
+#include "JobScheduler.h"
+#include "Profiler.h"
+
+static double get_elapsed_ms(std::chrono::steady_clock::time_point start_time, std::chrono::steady_clock::time_point end_time) {
+    return std::chrono::duration<double, std::milli>(end_time - start_time).count();
+}
+
+// --------------------------------------------------------------------------
+
+ImageSequenceWriter::ImageSequenceWriter(int thread_count)
+:
+thread_count(thread_count > 0 ? thread_count : ThreadPool::get_hardware_thread_count()),
+frame_number_start(0),
+frame_number_length(0),
+queued_frame_count(0),
+max_queued_frame_count(2 * this->thread_count),
+written_count(0),
+failed_count(0),
+size_in_bytes(0),
+encode_ms(0.0),
+is_started(false) {
+    // do nothing for now
+}
+
+// --------------------------------------------------------------------------
+
+ImageSequenceWriter::~ImageSequenceWriter() {
+    // Jobs read the frames and update this writer, so they have to finish before it goes away.
+    if (job_scheduler != nullptr) {
+        job_scheduler->wait_for_all();
+    }
+}
+
+// --------------------------------------------------------------------------
+
+bool ImageSequenceWriter::open(const std::string& file_pattern) {
+    if (!ImageWriter::is_supported_format(file_pattern)) {
+        std::cerr << "[ERROR] Unsupported image format for \"" << file_pattern << "\", use .png or .ppm" << std::endl;
+        return false;
+    }
+
+    size_t frame_number_start = file_pattern.find('#');
+    if (frame_number_start == std::string::npos) {
+        std::cerr << "[ERROR] The output pattern \"" << file_pattern << "\" needs a run of # for the frame number" << std::endl;
+        return false;
+    }
+
+    size_t frame_number_end = file_pattern.find_first_not_of('#', frame_number_start);
+    if (frame_number_end == std::string::npos) {
+        frame_number_end = file_pattern.size();
+    }
+
+    this->file_pattern = file_pattern;
+    this->frame_number_start = frame_number_start;
+    this->frame_number_length = frame_number_end - frame_number_start;
+
+    std::filesystem::path directory = std::filesystem::path(get_file_path(0)).parent_path();
+    if (!directory.empty()) {
+        std::error_code error;
+        std::filesystem::create_directories(directory, error);
+        if (error) {
+            std::cerr << "[ERROR] Could not create output directory \"" << directory.string() << "\": " << error.message() << std::endl;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// --------------------------------------------------------------------------
+
+std::string ImageSequenceWriter::get_file_path(int frame_index) const {
+    std::string frame_number = std::to_string(frame_index);
+    if (frame_number.size() < frame_number_length) {
+        frame_number.insert(0, frame_number_length - frame_number.size(), '0');
+    }
+
+    std::string file_path = file_pattern;
+    file_path.replace(frame_number_start, frame_number_length, frame_number);
+    return file_path;
+}
+
+// --------------------------------------------------------------------------
+
+void ImageSequenceWriter::write(int frame_index, Image image) {
+    // Returns as soon as the frame is queued, unless the workers have fallen behind.
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        frame_finished.wait(lock, [this] { return queued_frame_count < max_queued_frame_count; });
+        queued_frame_count++;
+
+        if (!is_started) {
+            is_started = true;
+            start_time = std::chrono::steady_clock::now();
+        }
+    }
+
+    // The producer keeps a thread of its own, so the workers get one each on top of it.
+    if (job_scheduler == nullptr) {
+        job_scheduler = std::make_unique<JobScheduler>(thread_count + 1);
+    }
+
+    auto frame = std::make_shared<Image>(std::move(image));
+    job_scheduler->submit([this, frame_index, frame] {
+        encode_frame(frame_index, *frame);
+    });
+}
+
+// --------------------------------------------------------------------------
+
+bool ImageSequenceWriter::finish() {
+    // Waits for every queued frame, and succeeds if they were all written.
+    if (job_scheduler != nullptr) {
+        job_scheduler->wait_for_all();
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    finish_time = std::chrono::steady_clock::now();
+    return failed_count == 0;
+}
+
+// --------------------------------------------------------------------------
+
+int ImageSequenceWriter::get_thread_count() const {
+    return thread_count;
+}
+
+// --------------------------------------------------------------------------
+
+ImageSequenceStatistics ImageSequenceWriter::get_statistics() const {
+    // The elapsed time runs from the first frame queued until finish().
+    std::lock_guard<std::mutex> lock(mutex);
+
+    ImageSequenceStatistics statistics;
+    statistics.written_count = written_count;
+    statistics.failed_count = failed_count;
+    statistics.size_in_bytes = size_in_bytes;
+    statistics.encode_ms = encode_ms;
+    statistics.elapsed_ms = is_started ? get_elapsed_ms(start_time, finish_time) : 0.0;
+    return statistics;
+}
+
+// --------------------------------------------------------------------------
+
+void ImageSequenceWriter::encode_frame(int frame_index, const Image& image) {
+    PROFILE_SCOPE("ImageSequenceWriter::encode_frame");
+
+    std::chrono::steady_clock::time_point encode_start_time = std::chrono::steady_clock::now();
+
+    std::string file_path = get_file_path(frame_index);
+    ImageWriter image_writer;
+    bool is_written = image_writer.write(image, file_path);
+
+    std::error_code error;
+    uintmax_t file_size = is_written ? std::filesystem::file_size(file_path, error) : 0;
+
+    double elapsed_ms = get_elapsed_ms(encode_start_time, std::chrono::steady_clock::now());
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (is_written) {
+            written_count++;
+            size_in_bytes += error ? 0 : file_size;
+        } else {
+            failed_count++;
+        }
+        encode_ms += elapsed_ms;
+        queued_frame_count--;
+    }
+    frame_finished.notify_one();
+}
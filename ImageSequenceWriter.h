@@ -0,0 +1,71 @@
+#ifndef IMAGE_SEQUENCE_WRITER_H
+#define IMAGE_SEQUENCE_WRITER_H
+
+#include <string>
+#include <memory>
+#include <mutex>
+#include <chrono>
+#include <condition_variable>
+
+#include "ImageDecoder.h"
+
+class JobScheduler;
+
+struct ImageSequenceStatistics {
+    int written_count;
+    int failed_count;
+    size_t size_in_bytes;
+    double encode_ms;
+    double elapsed_ms;
+};
+
+// Encodes and writes numbered frames on worker threads, so the thread producing them only
+// hands each one over. The frame number replaces the run of '#' in the file pattern, padded
+// to its length, and the extension picks the format.
+class ImageSequenceWriter {
+
+public:
+
+    ImageSequenceWriter(int thread_count = 0);
+    ~ImageSequenceWriter();
+
+    ImageSequenceWriter(const ImageSequenceWriter&) = delete;
+    ImageSequenceWriter& operator=(const ImageSequenceWriter&) = delete;
+
+    bool open(const std::string& file_pattern);
+    std::string get_file_path(int frame_index) const;
+
+    void write(int frame_index, Image image);
+    bool finish();
+
+    int get_thread_count() const;
+    ImageSequenceStatistics get_statistics() const;
+
+private:
+
+    void encode_frame(int frame_index, const Image& image);
+
+    int thread_count;
+    std::unique_ptr<JobScheduler> job_scheduler;
+
+    std::string file_pattern;
+    size_t frame_number_start;
+    size_t frame_number_length;
+
+    // Frames waiting to be encoded hold their pixels, so the producer waits once there are
+    // enough of them to keep every worker busy.
+    mutable std::mutex mutex;
+    std::condition_variable frame_finished;
+    int queued_frame_count;
+    int max_queued_frame_count;
+
+    int written_count;
+    int failed_count;
+    size_t size_in_bytes;
+    double encode_ms;
+    bool is_started;
+    std::chrono::steady_clock::time_point start_time;
+    std::chrono::steady_clock::time_point finish_time;
+};
+
+#endif
@@ -0,0 +1,394 @@
+#include "ImageWriter.h"
+
+#include <fstream>
+#include <iostream>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <cctype>
+
+// Deflate streams are read from the least significant bit of each byte up.
+struct BitWriter {
+    std::vector<unsigned char>& output;
+    uint32_t bit_buffer;
+    int bit_count;
+
+    void write_bits(uint32_t bits, int count) {
+        bit_buffer |= bits << bit_count;
+        bit_count += count;
+        while (bit_count >= 8) {
+            output.push_back(bit_buffer & 0xFF);
+            bit_buffer >>= 8;
+            bit_count -= 8;
+        }
+    }
+
+    // Huffman codes are the one thing written from their most significant bit down.
+    void write_code(uint32_t code, int length) {
+        uint32_t reversed_code = 0;
+        for (int i = 0; i < length; i++) {
+            reversed_code = (reversed_code << 1) | ((code >> i) & 1);
+        }
+        write_bits(reversed_code, length);
+    }
+
+    void flush() {
+        if (bit_count > 0) {
+            output.push_back(bit_buffer & 0xFF);
+        }
+        bit_buffer = 0;
+        bit_count = 0;
+    }
+};
+
+// --------------------------------------------------------------------------
+
+static void write_fixed_literal(BitWriter& bit_writer, int symbol) {
+    // The fixed Huffman code from RFC 1951 section 3.2.6.
+    if (symbol < 144) {
+        bit_writer.write_code(0x30 + symbol, 8);
+    } else if (symbol < 256) {
+        bit_writer.write_code(0x190 + symbol - 144, 9);
+    } else if (symbol < 280) {
+        bit_writer.write_code(symbol - 256, 7);
+    } else {
+        bit_writer.write_code(0xC0 + symbol - 280, 8);
+    }
+}
+
+// --------------------------------------------------------------------------
+
+static void write_fixed_match(BitWriter& bit_writer, int length, int distance) {
+    static const int LENGTH_BASES[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+    static const int LENGTH_EXTRA_BITS[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+    static const int DISTANCE_BASES[30] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+    static const int DISTANCE_EXTRA_BITS[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+    int length_code = 28;
+    while (LENGTH_BASES[length_code] > length) {
+        length_code--;
+    }
+    write_fixed_literal(bit_writer, 257 + length_code);
+    bit_writer.write_bits(length - LENGTH_BASES[length_code], LENGTH_EXTRA_BITS[length_code]);
+
+    int distance_code = 29;
+    while (DISTANCE_BASES[distance_code] > distance) {
+        distance_code--;
+    }
+    bit_writer.write_code(distance_code, 5);
+    bit_writer.write_bits(distance - DISTANCE_BASES[distance_code], DISTANCE_EXTRA_BITS[distance_code]);
+}
+
+// --------------------------------------------------------------------------
+
+static std::vector<unsigned char> compress_zlib(const std::vector<unsigned char>& data) {
+    // A single deflate block with the fixed Huffman code, fed by greedy LZ77 matching over
+    // hash chains. It compresses rendered frames, which are mostly flat background, nearly
+    // as well as zlib's defaults, without adding a dependency.
+    const int WINDOW_SIZE = 32768;
+    const int MIN_MATCH_LENGTH = 3;
+    const int MAX_MATCH_LENGTH = 258;
+    const int MAX_CHAIN_LENGTH = 32;
+    const int HASH_BITS = 15;
+
+    std::vector<unsigned char> output;
+    output.reserve(data.size() / 4 + 64);
+    output.push_back(0x78);
+    output.push_back(0x01);
+
+    BitWriter bit_writer = {output, 0, 0};
+    bit_writer.write_bits(1, 1);
+    bit_writer.write_bits(1, 2);
+
+    // The most recent position with each hash, and for each position the previous one with
+    // the same hash, both stored plus one so that zero means none.
+    std::vector<int> hash_heads(1 << HASH_BITS, 0);
+    std::vector<int> previous_positions(WINDOW_SIZE, 0);
+    auto get_hash = [&](size_t position) {
+        uint32_t value = data[position] | (data[position + 1] << 8) | (data[position + 2] << 16);
+        return (value * 2654435761u) >> (32 - HASH_BITS);
+    };
+    auto insert_position = [&](size_t position) {
+        if (position + MIN_MATCH_LENGTH <= data.size()) {
+            uint32_t hash = get_hash(position);
+            previous_positions[position % WINDOW_SIZE] = hash_heads[hash];
+            hash_heads[hash] = position + 1;
+        }
+    };
+
+    size_t position = 0;
+    while (position < data.size()) {
+        int best_length = 0;
+        int best_distance = 0;
+        if (position + MIN_MATCH_LENGTH <= data.size()) {
+            int max_length = std::min<size_t>(MAX_MATCH_LENGTH, data.size() - position);
+            int candidate = hash_heads[get_hash(position)] - 1;
+            for (int chain = 0; chain < MAX_CHAIN_LENGTH && candidate >= 0 && position - candidate <= (size_t)WINDOW_SIZE; chain++) {
+                int length = 0;
+                while (length < max_length && data[candidate + length] == data[position + length]) {
+                    length++;
+                }
+                if (length > best_length) {
+                    best_length = length;
+                    best_distance = position - candidate;
+                    if (length == max_length) {
+                        break;
+                    }
+                }
+
+                int previous = previous_positions[candidate % WINDOW_SIZE] - 1;
+                if (previous >= candidate) {
+                    break;
+                }
+                candidate = previous;
+            }
+        }
+
+        if (best_length >= MIN_MATCH_LENGTH) {
+            write_fixed_match(bit_writer, best_length, best_distance);
+            for (int i = 0; i < best_length; i++) {
+                insert_position(position + i);
+            }
+            position += best_length;
+        } else {
+            write_fixed_literal(bit_writer, data[position]);
+            insert_position(position);
+            position++;
+        }
+    }
+
+    write_fixed_literal(bit_writer, 256);
+    bit_writer.flush();
+
+    uint32_t sum_a = 1;
+    uint32_t sum_b = 0;
+    for (unsigned char byte : data) {
+        sum_a = (sum_a + byte) % 65521;
+        sum_b = (sum_b + sum_a) % 65521;
+    }
+    uint32_t adler = (sum_b << 16) | sum_a;
+    for (int shift = 24; shift >= 0; shift -= 8) {
+        output.push_back((adler >> shift) & 0xFF);
+    }
+
+    return output;
+}
+
+// --------------------------------------------------------------------------
+
+static uint32_t compute_crc32(const unsigned char* data, size_t size, uint32_t crc) {
+    static const std::vector<uint32_t> crc_table = [] {
+        std::vector<uint32_t> table(256);
+        for (uint32_t n = 0; n < 256; n++) {
+            uint32_t c = n;
+            for (int k = 0; k < 8; k++) {
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            table[n] = c;
+        }
+        return table;
+    }();
+
+    crc = ~crc;
+    for (size_t i = 0; i < size; i++) {
+        crc = crc_table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+// --------------------------------------------------------------------------
+
+static void write_png_chunk(std::ofstream& file, const char* type, const std::vector<unsigned char>& data) {
+    unsigned char length[4] = {(unsigned char)(data.size() >> 24), (unsigned char)(data.size() >> 16), (unsigned char)(data.size() >> 8), (unsigned char)data.size()};
+    uint32_t crc = compute_crc32(reinterpret_cast<const unsigned char*>(type), 4, 0);
+    crc = compute_crc32(data.data(), data.size(), crc);
+    unsigned char crc_bytes[4] = {(unsigned char)(crc >> 24), (unsigned char)(crc >> 16), (unsigned char)(crc >> 8), (unsigned char)crc};
+
+    file.write(reinterpret_cast<const char*>(length), 4);
+    file.write(type, 4);
+    file.write(reinterpret_cast<const char*>(data.data()), data.size());
+    file.write(reinterpret_cast<const char*>(crc_bytes), 4);
+}
+
+// --------------------------------------------------------------------------
+
+ImageWriter::ImageWriter() {
+    // do nothing for now
+}
+
+// --------------------------------------------------------------------------
+
+ImageWriter::~ImageWriter() {
+    // do nothing for now
+}
+
+// --------------------------------------------------------------------------
+
+bool ImageWriter::write(const Image& image, const std::string& file_path) {
+    // The format comes from the file extension.
+    std::string extension = get_extension(file_path);
+    if (extension == ".png") {
+        return write_png(image, file_path);
+    }
+    if (extension == ".ppm") {
+        return write_ppm(image, file_path);
+    }
+
+    std::cerr << "[ERROR] Unsupported image format for \"" << file_path << "\", use .png or .ppm" << std::endl;
+    return false;
+}
+
+// --------------------------------------------------------------------------
+
+bool ImageWriter::is_supported_format(const std::string& file_path) {
+    std::string extension = get_extension(file_path);
+    return extension == ".png" || extension == ".ppm";
+}
+
+// --------------------------------------------------------------------------
+
+std::string ImageWriter::get_extension(const std::string& file_path) {
+    size_t extension_start = file_path.find_last_of('.');
+    if (extension_start == std::string::npos || file_path.find('/', extension_start) != std::string::npos) {
+        return "";
+    }
+
+    std::string extension = file_path.substr(extension_start);
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return std::tolower(c); });
+    return extension;
+}
+
+// --------------------------------------------------------------------------
+
+bool ImageWriter::write_png(const Image& image, const std::string& file_path) {
+    // Opaque images are written without their alpha channel. Each row gets whichever of the
+    // five PNG filters leaves the smallest residuals, the usual heuristic for photos and renders.
+    bool has_alpha = false;
+    for (size_t i = 3; i < image.pixels.size(); i += 4) {
+        if (image.pixels[i] != 255) {
+            has_alpha = true;
+            break;
+        }
+    }
+
+    int channel_count = has_alpha ? 4 : 3;
+    size_t row_size = (size_t)image.width * channel_count;
+
+    std::vector<unsigned char> previous_row(row_size, 0);
+    std::vector<unsigned char> row(row_size);
+    std::vector<unsigned char> filtered_rows[5];
+    for (std::vector<unsigned char>& filtered_row : filtered_rows) {
+        filtered_row.resize(row_size);
+    }
+
+    std::vector<unsigned char> filtered_data;
+    filtered_data.reserve((row_size + 1) * image.height);
+    for (int y = 0; y < image.height; y++) {
+        const unsigned char* source = &image.pixels[(size_t)y * image.width * 4];
+        for (int x = 0; x < image.width; x++) {
+            std::memcpy(&row[(size_t)x * channel_count], &source[(size_t)x * 4], channel_count);
+        }
+
+        int best_filter = 0;
+        long long best_cost = -1;
+        for (int filter = 0; filter < 5; filter++) {
+            std::vector<unsigned char>& filtered_row = filtered_rows[filter];
+            long long cost = 0;
+            for (size_t i = 0; i < row_size; i++) {
+                int left = i >= (size_t)channel_count ? row[i - channel_count] : 0;
+                int up = previous_row[i];
+                int up_left = i >= (size_t)channel_count ? previous_row[i - channel_count] : 0;
+
+                int prediction = 0;
+                if (filter == 1) {
+                    prediction = left;
+                } else if (filter == 2) {
+                    prediction = up;
+                } else if (filter == 3) {
+                    prediction = (left + up) / 2;
+                } else if (filter == 4) {
+                    int estimate = left + up - up_left;
+                    int left_distance = std::abs(estimate - left);
+                    int up_distance = std::abs(estimate - up);
+                    int up_left_distance = std::abs(estimate - up_left);
+                    if (left_distance <= up_distance && left_distance <= up_left_distance) {
+                        prediction = left;
+                    } else if (up_distance <= up_left_distance) {
+                        prediction = up;
+                    } else {
+                        prediction = up_left;
+                    }
+                }
+
+                filtered_row[i] = row[i] - prediction;
+                cost += std::abs((signed char)filtered_row[i]);
+            }
+
+            if (best_cost < 0 || cost < best_cost) {
+                best_cost = cost;
+                best_filter = filter;
+            }
+        }
+
+        filtered_data.push_back(best_filter);
+        filtered_data.insert(filtered_data.end(), filtered_rows[best_filter].begin(), filtered_rows[best_filter].end());
+        row.swap(previous_row);
+    }
+
+    std::ofstream file(file_path, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        std::cerr << "[ERROR] Could not open image file \"" << file_path << "\"" << std::endl;
+        return false;
+    }
+
+    const unsigned char SIGNATURE[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    file.write(reinterpret_cast<const char*>(SIGNATURE), 8);
+
+    std::vector<unsigned char> header = {
+        (unsigned char)(image.width >> 24), (unsigned char)(image.width >> 16), (unsigned char)(image.width >> 8), (unsigned char)image.width,
+        (unsigned char)(image.height >> 24), (unsigned char)(image.height >> 16), (unsigned char)(image.height >> 8), (unsigned char)image.height,
+        8, (unsigned char)(has_alpha ? 6 : 2), 0, 0, 0
+    };
+    write_png_chunk(file, "IHDR", header);
+    write_png_chunk(file, "IDAT", compress_zlib(filtered_data));
+    write_png_chunk(file, "IEND", {});
+
+    if (!file) {
+        std::cerr << "[ERROR] Could not write image file \"" << file_path << "\"" << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+// --------------------------------------------------------------------------
+
+bool ImageWriter::write_ppm(const Image& image, const std::string& file_path) {
+    // Binary PPM, which has no alpha channel.
+    std::ofstream file(file_path, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        std::cerr << "[ERROR] Could not open image file \"" << file_path << "\"" << std::endl;
+        return false;
+    }
+
+    file << "P6\n" << image.width << " " << image.height << "\n255\n";
+
+    std::vector<unsigned char> row((size_t)image.width * 3);
+    for (int y = 0; y < image.height; y++) {
+        const unsigned char* source = &image.pixels[(size_t)y * image.width * 4];
+        for (int x = 0; x < image.width; x++) {
+            row[x * 3] = source[x * 4];
+            row[x * 3 + 1] = source[x * 4 + 1];
+            row[x * 3 + 2] = source[x * 4 + 2];
+        }
+        file.write(reinterpret_cast<const char*>(row.data()), row.size());
+    }
+
+    if (!file) {
+        std::cerr << "[ERROR] Could not write image file \"" << file_path << "\"" << std::endl;
+        return false;
+    }
+
+    return true;
+}
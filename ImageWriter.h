@@ -0,0 +1,27 @@
+#ifndef IMAGE_WRITER_H
+#define IMAGE_WRITER_H
+
+#include <string>
+
+#include "ImageDecoder.h"
+
+class ImageWriter {
+
+public:
+
+    ImageWriter();
+    ~ImageWriter();
+
+    bool write(const Image& image, const std::string& file_path);
+
+    static bool is_supported_format(const std::string& file_path);
+
+private:
+
+    static std::string get_extension(const std::string& file_path);
+
+    bool write_png(const Image& image, const std::string& file_path);
+    bool write_ppm(const Image& image, const std::string& file_path);
+};
+
+#endif
@@ -0,0 +1,244 @@
+#include "JobScheduler.h"
+
+#include <algorithm>
+
+#include "ThreadPool.h"
+
+// Which scheduler and queue the current thread works for, so that jobs can submit
+// sub-tasks to their own queue. Threads outside any scheduler have index -1.
+static thread_local const JobScheduler* current_scheduler = nullptr;
+static thread_local int current_worker_index = -1;
+
+JobScheduler::JobScheduler(int thread_count)
+:
+queued_job_count(0),
+unfinished_job_count(0),
+next_submit_queue(0),
+steal_count(0),
+is_stopping(false) {
+    if (thread_count <= 0) {
+        thread_count = ThreadPool::get_hardware_thread_count();
+    }
+
+    // Queue 0 belongs to the thread that calls wait_for_all(), which works
+    // through jobs like any other worker while it waits.
+    for (int i = 0; i < thread_count; i++) {
+        queues.push_back(std::make_unique<WorkerQueue>());
+    }
+
+    for (int i = 1; i < thread_count; i++) {
+        workers.emplace_back(&JobScheduler::run_worker, this, i);
+    }
+}
+
+// --------------------------------------------------------------------------
+
+JobScheduler::~JobScheduler() {
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex);
+        is_stopping = true;
+    }
+    work_changed.notify_all();
+
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+}
+
+// --------------------------------------------------------------------------
+
+int JobScheduler::get_thread_count() const {
+    return queues.size();
+}
+
+// --------------------------------------------------------------------------
+
+long long JobScheduler::get_steal_count() const {
+    return steal_count.load();
+}
+
+// --------------------------------------------------------------------------
+
+void JobScheduler::submit(std::function<void()> job) {
+    // Jobs submitted from inside a job go to that worker's own queue, where it
+    // finds them first. Jobs from outside are dealt out across all queues.
+    int worker_index = get_current_worker_index();
+    if (worker_index < 0) {
+        worker_index = next_submit_queue.fetch_add(1) % queues.size();
+    }
+
+    unfinished_job_count++;
+    push_job(worker_index, std::move(job));
+}
+
+// --------------------------------------------------------------------------
+
+void JobScheduler::wait_for_all() {
+    const JobScheduler* previous_scheduler = current_scheduler;
+    int previous_worker_index = current_worker_index;
+    current_scheduler = this;
+    current_worker_index = 0;
+
+    while (unfinished_job_count.load() > 0) {
+        if (run_next_job(0)) {
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleep_mutex);
+        work_changed.wait(lock, [this]() { return queued_job_count.load() > 0 || unfinished_job_count.load() == 0; });
+    }
+
+    current_scheduler = previous_scheduler;
+    current_worker_index = previous_worker_index;
+}
+
+// --------------------------------------------------------------------------
+
+void JobScheduler::parallel_for(int task_count, const std::function<void(int)>& task) {
+    if (task_count <= 0) {
+        return;
+    }
+
+    // Outside a job there's no queue to put helpers on, so run the tasks here.
+    int worker_index = get_current_worker_index();
+    if (worker_index < 0) {
+        for (int task_index = 0; task_index < task_count; task_index++) {
+            task(task_index);
+        }
+        return;
+    }
+
+    // Helpers sit on this worker's queue until idle workers steal them. Any left
+    // over once every task has been claimed find nothing to do, which is why they
+    // hold the shared progress rather than pointing into this stack frame.
+    struct Progress {
+        std::atomic<int> next_task_index;
+        std::atomic<int> finished_task_count;
+    };
+    std::shared_ptr<Progress> progress = std::make_shared<Progress>();
+    progress->next_task_index = 0;
+    progress->finished_task_count = 0;
+
+    // A task is only claimed while this call is still waiting for it, so the task
+    // itself is safe to reference.
+    const std::function<void(int)>* task_pointer = &task;
+    auto run_tasks = [progress, task_pointer, task_count]() {
+        int task_index;
+        while ((task_index = progress->next_task_index.fetch_add(1)) < task_count) {
+            (*task_pointer)(task_index);
+            progress->finished_task_count++;
+        }
+    };
+
+    int helper_count = std::min<int>(queues.size() - 1, task_count - 1);
+    for (int i = 0; i < helper_count; i++) {
+        unfinished_job_count++;
+        push_job(worker_index, run_tasks);
+    }
+
+    run_tasks();
+
+    // Only tasks already running on other workers are left. Picking up other jobs
+    // here would hold this one up for as long as they take, so just wait.
+    while (progress->finished_task_count.load() < task_count) {
+        std::this_thread::yield();
+    }
+}
+
+// --------------------------------------------------------------------------
+
+void JobScheduler::run_worker(int worker_index) {
+    current_scheduler = this;
+    current_worker_index = worker_index;
+
+    while (true) {
+        if (run_next_job(worker_index)) {
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleep_mutex);
+        work_changed.wait(lock, [this]() { return is_stopping || queued_job_count.load() > 0; });
+        if (is_stopping) {
+            return;
+        }
+    }
+}
+
+// --------------------------------------------------------------------------
+
+bool JobScheduler::run_next_job(int worker_index) {
+    std::function<void()> job;
+    if (!pop_job(worker_index, job) && !steal_job(worker_index, job)) {
+        return false;
+    }
+
+    job();
+
+    if (--unfinished_job_count == 0) {
+        std::lock_guard<std::mutex> lock(sleep_mutex);
+        work_changed.notify_all();
+    }
+
+    return true;
+}
+
+// --------------------------------------------------------------------------
+
+bool JobScheduler::pop_job(int worker_index, std::function<void()>& job) {
+    // A worker takes its newest job first, which is the one whose data is most
+    // likely still in its cache.
+    WorkerQueue& queue = *queues[worker_index];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.jobs.empty()) {
+        return false;
+    }
+
+    job = std::move(queue.jobs.back());
+    queue.jobs.pop_back();
+    queued_job_count--;
+    return true;
+}
+
+// --------------------------------------------------------------------------
+
+bool JobScheduler::steal_job(int thief_index, std::function<void()>& job) {
+    // Thieves take the oldest job, which for nested work is usually the biggest.
+    int queue_count = queues.size();
+    for (int i = 1; i < queue_count; i++) {
+        WorkerQueue& queue = *queues[(thief_index + i) % queue_count];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.jobs.empty()) {
+            continue;
+        }
+
+        job = std::move(queue.jobs.front());
+        queue.jobs.pop_front();
+        queued_job_count--;
+        steal_count++;
+        return true;
+    }
+
+    return false;
+}
+
+// --------------------------------------------------------------------------
+
+void JobScheduler::push_job(int worker_index, std::function<void()> job) {
+    {
+        WorkerQueue& queue = *queues[worker_index];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.jobs.push_back(std::move(job));
+    }
+    queued_job_count++;
+
+    // Taking the lock before notifying means a worker can't check for work and
+    // then miss this wake-up before it starts waiting.
+    std::lock_guard<std::mutex> lock(sleep_mutex);
+    work_changed.notify_one();
+}
+
+// --------------------------------------------------------------------------
+
+int JobScheduler::get_current_worker_index() const {
+    return current_scheduler == this ? current_worker_index : -1;
+}
@@ -0,0 +1,58 @@
+#ifndef JOB_SCHEDULER_H
+#define JOB_SCHEDULER_H
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+
+class JobScheduler {
+
+public:
+
+    JobScheduler(int thread_count);
+    ~JobScheduler();
+
+    JobScheduler(const JobScheduler&) = delete;
+    JobScheduler& operator=(const JobScheduler&) = delete;
+
+    int get_thread_count() const;
+    long long get_steal_count() const;
+
+    void submit(std::function<void()> job);
+    void wait_for_all();
+
+    void parallel_for(int task_count, const std::function<void(int)>& task);
+
+private:
+
+    struct WorkerQueue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> jobs;
+    };
+
+    void run_worker(int worker_index);
+    bool run_next_job(int worker_index);
+    bool pop_job(int worker_index, std::function<void()>& job);
+    bool steal_job(int thief_index, std::function<void()>& job);
+    void push_job(int worker_index, std::function<void()> job);
+
+    int get_current_worker_index() const;
+
+    std::vector<std::unique_ptr<WorkerQueue>> queues;
+    std::vector<std::thread> workers;
+
+    std::mutex sleep_mutex;
+    std::condition_variable work_changed;
+    std::atomic<int> queued_job_count;
+    std::atomic<int> unfinished_job_count;
+    std::atomic<int> next_submit_queue;
+    std::atomic<long long> steal_count;
+    bool is_stopping;
+};
+
+#endif
@@ -0,0 +1,87 @@
+#include "MappedFile.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "Profiler.h"
+#include "MemoryTracker.h"
+
+MappedFile::MappedFile()
+:
+mapping(nullptr),
+size(0) {
+    // do nothing for now
+}
+
+// --------------------------------------------------------------------------
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+// --------------------------------------------------------------------------
+
+bool MappedFile::open(const std::string& file_path) {
+    PROFILE_SCOPE("MappedFile::open");
+
+    close();
+
+    int file_descriptor = ::open(file_path.c_str(), O_RDONLY);
+    if (file_descriptor < 0) {
+        return false;
+    }
+
+    struct stat file_status;
+    if (fstat(file_descriptor, &file_status) != 0 || !S_ISREG(file_status.st_mode)) {
+        ::close(file_descriptor);
+        return false;
+    }
+
+    // mmap() rejects zero-length mappings, so an empty file is simply an empty view.
+    size = file_status.st_size;
+    if (size > 0) {
+        mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file_descriptor, 0);
+        if (mapping == MAP_FAILED) {
+            mapping = nullptr;
+            size = 0;
+            ::close(file_descriptor);
+            return false;
+        }
+
+        madvise(mapping, size, MADV_SEQUENTIAL);
+
+        // Pages are only read in as they're touched, but the whole file is counted, since a
+        // full parse touches all of it.
+        MemoryTracker::get_instance().add_allocation(MemorySubsystem::LOADER, size);
+    }
+
+    // The mapping keeps its own reference to the file.
+    ::close(file_descriptor);
+    return true;
+}
+
+// --------------------------------------------------------------------------
+
+void MappedFile::close() {
+    if (mapping != nullptr) {
+        munmap(mapping, size);
+        MemoryTracker::get_instance().remove_allocation(MemorySubsystem::LOADER, size);
+    }
+
+    mapping = nullptr;
+    size = 0;
+}
+
+// --------------------------------------------------------------------------
+
+const char* MappedFile::get_data() const {
+    return static_cast<const char*>(mapping);
+}
+
+// --------------------------------------------------------------------------
+
+size_t MappedFile::get_size() const {
+    return size;
+}
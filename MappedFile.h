@@ -0,0 +1,29 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <string>
+#include <cstddef>
+
+class MappedFile {
+
+public:
+
+    MappedFile();
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool open(const std::string& file_path);
+    void close();
+
+    const char* get_data() const;
+    size_t get_size() const;
+
+private:
+
+    void* mapping;
+    size_t size;
+};
+
+#endif
@@ -0,0 +1,217 @@
+#include "MaterialLibrary.h"
+
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <algorithm>
+#include <filesystem>
+
+#include "TextureCache.h"
+#include "Profiler.h"
+
+MaterialLibrary::MaterialLibrary()
+:
+texture_cache(nullptr) {
+    // do nothing for now
+}
+
+// --------------------------------------------------------------------------
+
+MaterialLibrary::~MaterialLibrary() {
+    // do nothing for now
+}
+
+// --------------------------------------------------------------------------
+
+void MaterialLibrary::set_texture_cache(TextureCache* texture_cache) {
+    this->texture_cache = texture_cache;
+}
+
+// --------------------------------------------------------------------------
+
+bool MaterialLibrary::load(const std::string& file_path) {
+    // Safe to call from the loader's worker threads, and each file is only read once however
+    // many times it's named. Textures are requested from the cache as their materials are
+    // read, so they decode in the background while the OBJ file is still being parsed.
+    PROFILE_SCOPE("MaterialLibrary::load");
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!loaded_file_paths.insert(file_path).second) {
+            return true;
+        }
+    }
+
+    std::ifstream file(file_path);
+    if (!file) {
+        std::cerr << "[WARN] Could not open material library \"" << file_path << "\"" << std::endl;
+        return false;
+    }
+
+    std::filesystem::path base_directory = std::filesystem::path(file_path).parent_path();
+
+    std::vector<Material> loaded_materials;
+    std::string line;
+    int line_number = 0;
+    while (std::getline(file, line)) {
+        line_number++;
+
+        size_t comment_start = line.find('#');
+        if (comment_start != std::string::npos) {
+            line.erase(comment_start);
+        }
+
+        std::istringstream line_stream(line);
+        std::string keyword;
+        if (!(line_stream >> keyword)) {
+            continue;
+        }
+
+        if (keyword == "newmtl") {
+            std::string material_name;
+            if (!(line_stream >> material_name)) {
+                std::cerr << "[WARN] Unnamed material on line " << line_number << " of \"" << file_path << "\"" << std::endl;
+            }
+            loaded_materials.push_back(create_default_material(material_name));
+            continue;
+        }
+
+        // Anything else only means something inside a material, and most of it, like
+        // ambient colors and bump maps, isn't drawn.
+        if (loaded_materials.empty()) {
+            continue;
+        }
+
+        Material& material = loaded_materials.back();
+        bool is_valid = true;
+        if (keyword == "Kd") {
+            is_valid = static_cast<bool>(line_stream >> material.diffuse_color.x >> material.diffuse_color.y >> material.diffuse_color.z);
+        } else if (keyword == "Ks") {
+            is_valid = static_cast<bool>(line_stream >> material.specular_color.x >> material.specular_color.y >> material.specular_color.z);
+        } else if (keyword == "Ns") {
+            is_valid = static_cast<bool>(line_stream >> material.shininess);
+        } else if (keyword == "d") {
+            is_valid = static_cast<bool>(line_stream >> material.opacity);
+        } else if (keyword == "Tr") {
+            float transparency;
+            is_valid = static_cast<bool>(line_stream >> transparency);
+            material.opacity = 1.0f - transparency;
+        } else if (keyword == "map_Kd") {
+            std::string arguments;
+            std::getline(line_stream, arguments);
+
+            std::string texture_path;
+            is_valid = parse_texture_path(arguments, texture_path);
+            if (is_valid) {
+                std::filesystem::path path(texture_path);
+                if (path.is_relative()) {
+                    path = base_directory / path;
+                }
+                material.diffuse_texture_path = path.string();
+            }
+        }
+
+        if (!is_valid) {
+            std::cerr << "[WARN] Ignoring invalid " << keyword << " on line " << line_number << " of \"" << file_path << "\"" << std::endl;
+        }
+    }
+
+    for (Material& material : loaded_materials) {
+        if (texture_cache != nullptr && !material.diffuse_texture_path.empty()) {
+            material.diffuse_texture = texture_cache->request(material.diffuse_texture_path);
+        }
+    }
+
+    // When libraries define the same name, the first one loaded wins.
+    std::lock_guard<std::mutex> lock(mutex);
+    for (Material& material : loaded_materials) {
+        auto has_same_name = [&](const Material& other) { return other.name == material.name; };
+        if (std::none_of(materials.begin(), materials.end(), has_same_name)) {
+            materials.push_back(std::move(material));
+        }
+    }
+
+    return true;
+}
+
+// --------------------------------------------------------------------------
+
+const Material* MaterialLibrary::find(const std::string& material_name) const {
+    // The result stays valid until the next load().
+    std::lock_guard<std::mutex> lock(mutex);
+    for (const Material& material : materials) {
+        if (material.name == material_name) {
+            return &material;
+        }
+    }
+
+    return nullptr;
+}
+
+// --------------------------------------------------------------------------
+
+int MaterialLibrary::get_material_count() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return materials.size();
+}
+
+// --------------------------------------------------------------------------
+
+Material MaterialLibrary::create_default_material(const std::string& material_name) {
+    // The defaults the MTL format gives a material that leaves things out.
+    Material material;
+    material.name = material_name;
+    material.diffuse_color = glm::vec3(0.8f, 0.8f, 0.8f);
+    material.specular_color = glm::vec3(0.0f, 0.0f, 0.0f);
+    material.shininess = 32.0f;
+    material.opacity = 1.0f;
+    material.diffuse_texture = -1;
+    return material;
+}
+
+// --------------------------------------------------------------------------
+
+bool MaterialLibrary::parse_texture_path(const std::string& arguments, std::string& texture_path) {
+    // Texture lines are [OPTIONS] FILE, where each option takes a fixed number of values
+    // except -o, -s and -t, which take one to three numbers. The file name is everything
+    // after the options, so it may contain spaces.
+    std::istringstream argument_stream(arguments);
+    std::vector<std::string> tokens;
+    std::string token;
+    while (argument_stream >> token) {
+        tokens.push_back(token);
+    }
+
+    auto is_number = [](const std::string& text) {
+        std::istringstream number_stream(text);
+        float number;
+        return static_cast<bool>(number_stream >> number) && number_stream.eof();
+    };
+
+    size_t token_index = 0;
+    while (token_index < tokens.size() && tokens[token_index].size() > 1 && tokens[token_index][0] == '-' && !is_number(tokens[token_index])) {
+        const std::string& option = tokens[token_index++];
+        if (option == "-o" || option == "-s" || option == "-t") {
+            for (int value_count = 0; value_count < 3 && token_index < tokens.size() - 1 && is_number(tokens[token_index]); value_count++) {
+                token_index++;
+            }
+        } else if (option == "-mm") {
+            token_index += 2;
+        } else {
+            token_index += 1;
+        }
+    }
+
+    if (token_index >= tokens.size()) {
+        return false;
+    }
+
+    texture_path = tokens[token_index];
+    for (token_index++; token_index < tokens.size(); token_index++) {
+        texture_path += " " + tokens[token_index];
+    }
+
+    // Exporters on Windows write backslashes, which no other platform reads as separators.
+    std::replace(texture_path.begin(), texture_path.end(), '\\', '/');
+    return true;
+}
@@ -0,0 +1,51 @@
+#ifndef MATERIAL_LIBRARY_H
+#define MATERIAL_LIBRARY_H
+
+#include <string>
+#include <vector>
+#include <set>
+#include <mutex>
+#include <glm/glm.hpp>
+
+class TextureCache;
+
+struct Material {
+    std::string name;
+    glm::vec3 diffuse_color;
+    glm::vec3 specular_color;
+    float shininess;
+    float opacity;
+
+    // diffuse_texture is the TextureCache handle for diffuse_texture_path, or -1 without one.
+    std::string diffuse_texture_path;
+    int diffuse_texture;
+};
+
+class MaterialLibrary {
+
+public:
+
+    MaterialLibrary();
+    ~MaterialLibrary();
+
+    void set_texture_cache(TextureCache* texture_cache);
+
+    bool load(const std::string& file_path);
+
+    const Material* find(const std::string& material_name) const;
+    int get_material_count() const;
+
+private:
+
+    static Material create_default_material(const std::string& material_name);
+
+    static bool parse_texture_path(const std::string& arguments, std::string& texture_path);
+
+    TextureCache* texture_cache;
+
+    mutable std::mutex mutex;
+    std::set<std::string> loaded_file_paths;
+    std::vector<Material> materials;
+};
+
+#endif
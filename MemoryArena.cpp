@@ -0,0 +1,129 @@
+#include "MemoryArena.h"
+
+#include <new>
+#include <cstdint>
+#include <algorithm>
+
+MemoryArena::MemoryArena(size_t block_size)
+:
+block_size(block_size),
+current_block_used_bytes(0),
+used_bytes(0),
+last_allocation(nullptr),
+last_allocation_size(0) {
+    // do nothing for now
+}
+
+// --------------------------------------------------------------------------
+
+MemoryArena::~MemoryArena() {
+    MemoryTracker::get_instance().remove_allocation(MemorySubsystem::MODEL, get_reserved_bytes());
+}
+
+// --------------------------------------------------------------------------
+
+void MemoryArena::reserve(size_t size_in_bytes) {
+    // Makes sure the next size_in_bytes of allocations fit in the current block, so
+    // a loader that knows its totals up front gets one block for all of them.
+    if (blocks.empty() || blocks.back().size - current_block_used_bytes < size_in_bytes) {
+        add_block(size_in_bytes);
+    }
+}
+
+// --------------------------------------------------------------------------
+
+void* MemoryArena::allocate(size_t size_in_bytes, size_t alignment) {
+    if (size_in_bytes == 0) {
+        size_in_bytes = 1;
+    }
+
+    if (!blocks.empty()) {
+        Block& block = blocks.back();
+        uintptr_t block_start = reinterpret_cast<uintptr_t>(block.data.get());
+        uintptr_t aligned_start = (block_start + current_block_used_bytes + alignment - 1) & ~(uintptr_t)(alignment - 1);
+        size_t aligned_offset = aligned_start - block_start;
+        if (aligned_offset + size_in_bytes <= block.size) {
+            current_block_used_bytes = aligned_offset + size_in_bytes;
+            used_bytes += size_in_bytes;
+            last_allocation = block.data.get() + aligned_offset;
+            last_allocation_size = size_in_bytes;
+            return last_allocation;
+        }
+    }
+
+    // Blocks come from operator new[], which aligns for any fundamental type.
+    add_block(size_in_bytes);
+    current_block_used_bytes = size_in_bytes;
+    used_bytes += size_in_bytes;
+    last_allocation = blocks.back().data.get();
+    last_allocation_size = size_in_bytes;
+    return last_allocation;
+}
+
+// --------------------------------------------------------------------------
+
+void MemoryArena::deallocate(void* pointer, size_t size_in_bytes) {
+    // Memory is only given back by reset(), except for the most recent allocation,
+    // which a growing vector often frees right after moving out of it.
+    if (pointer != last_allocation || size_in_bytes != last_allocation_size) {
+        return;
+    }
+
+    current_block_used_bytes -= size_in_bytes;
+    used_bytes -= size_in_bytes;
+    last_allocation = nullptr;
+    last_allocation_size = 0;
+}
+
+// --------------------------------------------------------------------------
+
+void MemoryArena::reset() {
+    // Keeps the largest block for reuse and frees the rest.
+    if (blocks.size() > 1) {
+        std::vector<Block>::iterator largest_block = std::max_element(blocks.begin(), blocks.end(), [](const Block& a, const Block& b) {
+            return a.size < b.size;
+        });
+        Block kept_block = std::move(*largest_block);
+        MemoryTracker::get_instance().remove_allocation(MemorySubsystem::MODEL, get_reserved_bytes() - kept_block.size);
+        blocks.clear();
+        blocks.push_back(std::move(kept_block));
+    }
+
+    current_block_used_bytes = 0;
+    used_bytes = 0;
+    last_allocation = nullptr;
+    last_allocation_size = 0;
+}
+
+// --------------------------------------------------------------------------
+
+size_t MemoryArena::get_used_bytes() const {
+    return used_bytes;
+}
+
+// --------------------------------------------------------------------------
+
+size_t MemoryArena::get_reserved_bytes() const {
+    size_t reserved_bytes = 0;
+    for (const Block& block : blocks) {
+        reserved_bytes += block.size;
+    }
+    return reserved_bytes;
+}
+
+// --------------------------------------------------------------------------
+
+int MemoryArena::get_block_count() const {
+    return blocks.size();
+}
+
+// --------------------------------------------------------------------------
+
+void MemoryArena::add_block(size_t minimum_size) {
+    Block block;
+    block.size = std::max(block_size, minimum_size);
+    block.data.reset(new unsigned char[block.size]);
+    MemoryTracker::get_instance().add_allocation(MemorySubsystem::MODEL, block.size);
+    blocks.push_back(std::move(block));
+    current_block_used_bytes = 0;
+}
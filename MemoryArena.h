@@ -0,0 +1,115 @@
+#ifndef MEMORY_ARENA_H
+#define MEMORY_ARENA_H
+
+#include <vector>
+#include <memory>
+#include <cstddef>
+#include <type_traits>
+
+#include "MemoryTracker.h"
+
+class MemoryArena {
+
+public:
+
+    static const size_t DEFAULT_BLOCK_SIZE = 1024 * 1024;
+
+    MemoryArena(size_t block_size = DEFAULT_BLOCK_SIZE);
+    ~MemoryArena();
+
+    MemoryArena(const MemoryArena&) = delete;
+    MemoryArena& operator=(const MemoryArena&) = delete;
+
+    void reserve(size_t size_in_bytes);
+    void* allocate(size_t size_in_bytes, size_t alignment);
+    void deallocate(void* pointer, size_t size_in_bytes);
+    void reset();
+
+    size_t get_used_bytes() const;
+    size_t get_reserved_bytes() const;
+    int get_block_count() const;
+
+private:
+
+    struct Block {
+        std::unique_ptr<unsigned char[]> data;
+        size_t size;
+    };
+
+    size_t block_size;
+    std::vector<Block> blocks;
+    size_t current_block_used_bytes;
+    size_t used_bytes;
+
+    void* last_allocation;
+    size_t last_allocation_size;
+
+    void add_block(size_t minimum_size);
+};
+
+// --------------------------------------------------------------------------
+
+// Lets standard containers take their storage from a MemoryArena. Without an arena it
+// falls back to the global heap, so containers behave exactly as with std::allocator.
+// The arena must outlive every container that uses it. Heap storage is charged to the
+// model's memory, as are an arena's blocks.
+template <typename T>
+class ArenaAllocator {
+
+public:
+
+    using value_type = T;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+
+    ArenaAllocator(MemoryArena* arena = nullptr) noexcept
+    :
+    arena(arena) {
+        // do nothing for now
+    }
+
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other) noexcept
+    :
+    arena(other.get_arena()) {
+        // do nothing for now
+    }
+
+    T* allocate(size_t count) {
+        if (arena == nullptr) {
+            T* pointer = static_cast<T*>(::operator new(count * sizeof(T)));
+            MemoryTracker::get_instance().add_allocation(MemorySubsystem::MODEL, count * sizeof(T));
+            return pointer;
+        }
+        return static_cast<T*>(arena->allocate(count * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T* pointer, size_t count) noexcept {
+        if (arena == nullptr) {
+            MemoryTracker::get_instance().remove_allocation(MemorySubsystem::MODEL, count * sizeof(T));
+            ::operator delete(pointer);
+            return;
+        }
+        arena->deallocate(pointer, count * sizeof(T));
+    }
+
+    MemoryArena* get_arena() const noexcept {
+        return arena;
+    }
+
+private:
+
+    MemoryArena* arena;
+};
+
+template <typename T, typename U>
+bool operator==(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) noexcept {
+    return a.get_arena() == b.get_arena();
+}
+
+template <typename T, typename U>
+bool operator!=(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) noexcept {
+    return a.get_arena() != b.get_arena();
+}
+
+#endif
@@ -0,0 +1,148 @@
+#include "MemoryTracker.h"
+
+#include <sys/resource.h>
+
+static const char* SUBSYSTEM_NAMES[MemoryTracker::SUBSYSTEM_COUNT] = {"loader", "model", "buffer_data"};
+
+static std::string escape_json_string(const std::string& str) {
+    std::string escaped;
+    for (char c : str) {
+        if (c == '"' || c == '\\') {
+            escaped += '\\';
+            escaped += c;
+        } else if ((unsigned char)c < 0x20) {
+            const char* hex_digits = "0123456789abcdef";
+            escaped += "\\u00";
+            escaped += hex_digits[(c >> 4) & 0xf];
+            escaped += hex_digits[c & 0xf];
+        } else {
+            escaped += c;
+        }
+    }
+
+    return escaped;
+}
+
+// --------------------------------------------------------------------------
+
+static long long get_peak_resident_bytes() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return usage.ru_maxrss;
+#else
+    return (long long)usage.ru_maxrss * 1024;
+#endif
+}
+
+// --------------------------------------------------------------------------
+
+static void write_usage_json(std::ostream& output, const char* name, const MemoryUsage& usage) {
+    output << "\"" << name << "\":{\"current_bytes\":" << usage.current_bytes << ",\"peak_bytes\":" << usage.peak_bytes << ",\"allocations\":" << usage.allocation_count << "}";
+}
+
+// --------------------------------------------------------------------------
+
+MemoryTracker& MemoryTracker::get_instance() {
+    static MemoryTracker memory_tracker;
+    return memory_tracker;
+}
+
+// --------------------------------------------------------------------------
+
+MemoryTracker::MemoryTracker() {
+    for (Counter& counter : counters) {
+        counter.current_bytes.store(0, std::memory_order_relaxed);
+        counter.peak_bytes.store(0, std::memory_order_relaxed);
+        counter.allocation_count.store(0, std::memory_order_relaxed);
+    }
+
+    total_counter.current_bytes.store(0, std::memory_order_relaxed);
+    total_counter.peak_bytes.store(0, std::memory_order_relaxed);
+    total_counter.allocation_count.store(0, std::memory_order_relaxed);
+}
+
+// --------------------------------------------------------------------------
+
+MemoryTracker::~MemoryTracker() {
+    // do nothing for now
+}
+
+// --------------------------------------------------------------------------
+
+void MemoryTracker::add_allocation(MemorySubsystem subsystem, size_t size_in_bytes) {
+    add_to_counter(counters[(int)subsystem], size_in_bytes);
+    add_to_counter(total_counter, size_in_bytes);
+}
+
+// --------------------------------------------------------------------------
+
+void MemoryTracker::remove_allocation(MemorySubsystem subsystem, size_t size_in_bytes) {
+    counters[(int)subsystem].current_bytes.fetch_sub(size_in_bytes, std::memory_order_relaxed);
+    total_counter.current_bytes.fetch_sub(size_in_bytes, std::memory_order_relaxed);
+}
+
+// --------------------------------------------------------------------------
+
+MemoryStatistics MemoryTracker::get_statistics() const {
+    MemoryStatistics statistics;
+    statistics.loader = get_usage(counters[(int)MemorySubsystem::LOADER]);
+    statistics.model = get_usage(counters[(int)MemorySubsystem::MODEL]);
+    statistics.buffer_data = get_usage(counters[(int)MemorySubsystem::BUFFER_DATA]);
+    statistics.total = get_usage(total_counter);
+    return statistics;
+}
+
+// --------------------------------------------------------------------------
+
+void MemoryTracker::write_json(std::ostream& output, const std::string& file_path, const std::optional<GpuMemoryStatistics>& gpu_statistics) const {
+    // One line, so a regression check can compare runs with a JSON tool or a plain diff.
+    output << "{\"file\":\"" << escape_json_string(file_path) << "\"";
+
+    output << ",\"cpu\":{";
+    for (int subsystem = 0; subsystem < SUBSYSTEM_COUNT; subsystem++) {
+        write_usage_json(output, SUBSYSTEM_NAMES[subsystem], get_usage(counters[subsystem]));
+        output << ",";
+    }
+    write_usage_json(output, "total", get_usage(total_counter));
+    output << "}";
+
+    if (gpu_statistics.has_value()) {
+        const GpuMemoryStatistics& gpu = gpu_statistics.value();
+        output << ",\"gpu\":{";
+        output << "\"vertex_buffer_bytes\":" << gpu.vertex_buffer_bytes;
+        output << ",\"index_buffer_bytes\":" << gpu.index_buffer_bytes;
+        output << ",\"texture_coordinate_buffer_bytes\":" << gpu.texture_coordinate_buffer_bytes;
+        output << ",\"instance_buffer_bytes\":" << gpu.instance_buffer_bytes;
+        output << ",\"texture_bytes\":" << gpu.texture_bytes;
+        output << ",\"readback_bytes\":" << gpu.readback_bytes;
+        output << ",\"total_bytes\":" << gpu.total_bytes;
+        output << "}";
+    }
+
+    output << ",\"peak_resident_bytes\":" << get_peak_resident_bytes();
+    output << "}" << std::endl;
+}
+
+// --------------------------------------------------------------------------
+
+void MemoryTracker::add_to_counter(Counter& counter, size_t size_in_bytes) {
+    long long current_bytes = counter.current_bytes.fetch_add(size_in_bytes, std::memory_order_relaxed) + size_in_bytes;
+    counter.allocation_count.fetch_add(1, std::memory_order_relaxed);
+
+    // Another thread may be raising the peak at the same time, so only ever move it up.
+    long long peak_bytes = counter.peak_bytes.load(std::memory_order_relaxed);
+    while (current_bytes > peak_bytes && !counter.peak_bytes.compare_exchange_weak(peak_bytes, current_bytes, std::memory_order_relaxed)) {
+        // do nothing
+    }
+}
+
+// --------------------------------------------------------------------------
+
+MemoryUsage MemoryTracker::get_usage(const Counter& counter) {
+    MemoryUsage usage;
+    usage.current_bytes = counter.current_bytes.load(std::memory_order_relaxed);
+    usage.peak_bytes = counter.peak_bytes.load(std::memory_order_relaxed);
+    usage.allocation_count = counter.allocation_count.load(std::memory_order_relaxed);
+    return usage;
+}
@@ -0,0 +1,129 @@
+#ifndef MEMORY_TRACKER_H
+#define MEMORY_TRACKER_H
+
+#include <new>
+#include <atomic>
+#include <string>
+#include <ostream>
+#include <cstddef>
+#include <optional>
+#include <type_traits>
+
+// Where tracked memory is charged. The loader is file text and batches on their way to
+// the GPU, the model is every Model's vertex, normal, texture coordinate and face arrays,
+// and buffer data is the interleaved vertices and indices built for the GPU.
+enum class MemorySubsystem {
+    LOADER,
+    MODEL,
+    BUFFER_DATA
+};
+
+struct MemoryUsage {
+    long long current_bytes;
+    long long peak_bytes;
+    long long allocation_count;
+};
+
+struct MemoryStatistics {
+    MemoryUsage loader;
+    MemoryUsage model;
+    MemoryUsage buffer_data;
+
+    // The peak of the sum, which is usually less than the sum of the peaks.
+    MemoryUsage total;
+};
+
+// Sizes of what the driver holds for us. Buffer sizes come from the driver, while textures
+// and the readback framebuffer are worked out from their formats.
+struct GpuMemoryStatistics {
+    long long vertex_buffer_bytes;
+    long long index_buffer_bytes;
+    long long texture_coordinate_buffer_bytes;
+    long long instance_buffer_bytes;
+    long long texture_bytes;
+    long long readback_bytes;
+    long long total_bytes;
+};
+
+// Counts the bytes each subsystem has allocated, from any thread. Only what the subsystems
+// report is counted, so it's a budget for our own data rather than the process's footprint.
+class MemoryTracker {
+
+public:
+
+    static const int SUBSYSTEM_COUNT = 3;
+
+    static MemoryTracker& get_instance();
+
+    void add_allocation(MemorySubsystem subsystem, size_t size_in_bytes);
+    void remove_allocation(MemorySubsystem subsystem, size_t size_in_bytes);
+
+    MemoryStatistics get_statistics() const;
+    void write_json(std::ostream& output, const std::string& file_path, const std::optional<GpuMemoryStatistics>& gpu_statistics) const;
+
+private:
+
+    struct Counter {
+        std::atomic<long long> current_bytes;
+        std::atomic<long long> peak_bytes;
+        std::atomic<long long> allocation_count;
+    };
+
+    MemoryTracker();
+    ~MemoryTracker();
+
+    static void add_to_counter(Counter& counter, size_t size_in_bytes);
+    static MemoryUsage get_usage(const Counter& counter);
+
+    Counter counters[SUBSYSTEM_COUNT];
+    Counter total_counter;
+};
+
+// --------------------------------------------------------------------------
+
+// A std::allocator that charges everything it allocates to one subsystem.
+template <typename T, MemorySubsystem subsystem>
+class TrackedAllocator {
+
+public:
+
+    using value_type = T;
+    using is_always_equal = std::true_type;
+
+    template <typename U>
+    struct rebind {
+        using other = TrackedAllocator<U, subsystem>;
+    };
+
+    TrackedAllocator() noexcept {
+        // do nothing for now
+    }
+
+    template <typename U>
+    TrackedAllocator(const TrackedAllocator<U, subsystem>&) noexcept {
+        // do nothing for now
+    }
+
+    T* allocate(size_t count) {
+        T* pointer = static_cast<T*>(::operator new(count * sizeof(T)));
+        MemoryTracker::get_instance().add_allocation(subsystem, count * sizeof(T));
+        return pointer;
+    }
+
+    void deallocate(T* pointer, size_t count) noexcept {
+        MemoryTracker::get_instance().remove_allocation(subsystem, count * sizeof(T));
+        ::operator delete(pointer);
+    }
+};
+
+template <typename T, typename U, MemorySubsystem subsystem>
+bool operator==(const TrackedAllocator<T, subsystem>&, const TrackedAllocator<U, subsystem>&) noexcept {
+    return true;
+}
+
+template <typename T, typename U, MemorySubsystem subsystem>
+bool operator!=(const TrackedAllocator<T, subsystem>&, const TrackedAllocator<U, subsystem>&) noexcept {
+    return false;
+}
+
+#endif
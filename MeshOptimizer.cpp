@@ -0,0 +1,467 @@
+#include "MeshOptimizer.h"
+
+#include <cmath>
+#include <algorithm>
+#include <numeric>
+#include <utility>
+#include <limits>
+
+#include "ThreadPool.h"
+
+// Vertex scoring constants from Tom Forsyth's "Linear-Speed Vertex Cache Optimisation".
+static const float CACHE_DECAY_POWER = 1.5f;
+static const float LAST_TRIANGLE_SCORE = 0.75f;
+static const float VALENCE_BOOST_SCALE = 2.0f;
+static const float VALENCE_BOOST_POWER = 0.5f;
+
+MeshOptimizer::MeshOptimizer()
+:
+thread_count(1) {
+    for (int cache_position = 0; cache_position < CACHE_SIZE; cache_position++) {
+        if (cache_position < 3) {
+            cache_position_scores[cache_position] = LAST_TRIANGLE_SCORE;
+        } else {
+            float scale = 1.0f / (CACHE_SIZE - 3);
+            cache_position_scores[cache_position] = std::pow(1.0f - (cache_position - 3) * scale, CACHE_DECAY_POWER);
+        }
+    }
+
+    valence_scores[0] = 0.0f;
+    for (int valence = 1; valence <= MAX_SCORED_VALENCE; valence++) {
+        valence_scores[valence] = VALENCE_BOOST_SCALE * std::pow((float)valence, -VALENCE_BOOST_POWER);
+    }
+}
+
+// --------------------------------------------------------------------------
+
+MeshOptimizer::~MeshOptimizer() {
+    // do nothing for now
+}
+
+// --------------------------------------------------------------------------
+
+void MeshOptimizer::set_thread_count(int thread_count) {
+    this->thread_count = thread_count > 0 ? thread_count : ThreadPool::get_hardware_thread_count();
+}
+
+// --------------------------------------------------------------------------
+
+void MeshOptimizer::sort_triangles_spatially(IndexedBufferData& indexed_buffer_data) {
+    // Orders triangles along a Z-order curve through their centroids, so that any
+    // contiguous run of triangles covers a compact part of the mesh.
+    const int STRIDE = Model::FLOATS_PER_BUFFER_VERTEX;
+
+    glm::vec3 extents_min = glm::vec3(std::numeric_limits<float>::max());
+    glm::vec3 extents_max = glm::vec3(-std::numeric_limits<float>::max());
+    for (int i = 0; i < indexed_buffer_data.vertex_count; i++) {
+        const float* position = &indexed_buffer_data.vertex_data[i * STRIDE];
+        extents_min = glm::min(extents_min, glm::vec3(position[0], position[1], position[2]));
+        extents_max = glm::max(extents_max, glm::vec3(position[0], position[1], position[2]));
+    }
+    glm::vec3 extents_scale = 1.0f / glm::max(extents_max - extents_min, glm::vec3(std::numeric_limits<float>::min()));
+
+    // The triangle number in the low bits makes every key unique, which keeps the order deterministic.
+    int triangle_count = indexed_buffer_data.indices.size() / 3;
+    std::vector<uint64_t> sort_keys(triangle_count);
+
+    std::vector<TriangleRange> ranges = split_into_ranges(indexed_buffer_data);
+
+    ThreadPool thread_pool(thread_count);
+    thread_pool.parallel_for(ranges.size(), [&](int range_index) {
+        int first_triangle = ranges[range_index].first_triangle;
+        int last_triangle = first_triangle + ranges[range_index].triangle_count;
+        for (int triangle = first_triangle; triangle < last_triangle; triangle++) {
+            glm::vec3 centroid = glm::vec3(0.0f, 0.0f, 0.0f);
+            for (int corner = 0; corner < 3; corner++) {
+                const float* position = &indexed_buffer_data.vertex_data[indexed_buffer_data.indices[triangle * 3 + corner] * STRIDE];
+                centroid += glm::vec3(position[0], position[1], position[2]);
+            }
+
+            glm::vec3 normalized_centroid = (centroid / 3.0f - extents_min) * extents_scale;
+            sort_keys[triangle] = ((uint64_t)compute_morton_code(normalized_centroid) << 32) | (uint32_t)triangle;
+        }
+    });
+
+    // Each submesh is sorted on its own, so its triangles stay together.
+    if (indexed_buffer_data.submeshes.empty()) {
+        std::sort(sort_keys.begin(), sort_keys.end());
+    } else {
+        for (const Submesh& submesh : indexed_buffer_data.submeshes) {
+            auto first_key = sort_keys.begin() + submesh.first_index / 3;
+            std::sort(first_key, first_key + submesh.index_count / 3);
+        }
+    }
+
+    BufferArray<uint32_t> sorted_indices(indexed_buffer_data.indices.size());
+    for (int i = 0; i < triangle_count; i++) {
+        uint32_t triangle = (uint32_t)sort_keys[i];
+        std::copy_n(&indexed_buffer_data.indices[triangle * 3], 3, &sorted_indices[i * 3]);
+    }
+
+    indexed_buffer_data.indices = std::move(sorted_indices);
+}
+
+// --------------------------------------------------------------------------
+
+void MeshOptimizer::optimize_vertex_cache(IndexedBufferData& indexed_buffer_data) {
+    // Ranges of triangles are optimized independently, which costs a few cache misses
+    // at range boundaries but lets large meshes use every core. The result doesn't
+    // depend on the thread count. Triangles are first sorted spatially so that a range
+    // from a badly ordered mesh still forms a connected patch.
+    std::vector<TriangleRange> ranges = split_into_ranges(indexed_buffer_data);
+    if (ranges.size() > std::max<size_t>(indexed_buffer_data.submeshes.size(), 1)) {
+        sort_triangles_spatially(indexed_buffer_data);
+    }
+
+    ThreadPool thread_pool(thread_count);
+    thread_pool.parallel_for(ranges.size(), [&](int range_index) {
+        const TriangleRange& range = ranges[range_index];
+        optimize_range_for_vertex_cache(indexed_buffer_data.indices.data() + range.first_triangle * 3, range.triangle_count);
+    });
+}
+
+// --------------------------------------------------------------------------
+
+void MeshOptimizer::optimize_overdraw(IndexedBufferData& indexed_buffer_data) {
+    const int STRIDE = Model::FLOATS_PER_BUFFER_VERTEX;
+
+    glm::vec3 mesh_center = glm::vec3(0.0f, 0.0f, 0.0f);
+    for (int i = 0; i < indexed_buffer_data.vertex_count; i++) {
+        const float* position = &indexed_buffer_data.vertex_data[i * STRIDE];
+        mesh_center += glm::vec3(position[0], position[1], position[2]);
+    }
+    if (indexed_buffer_data.vertex_count > 0) {
+        mesh_center /= (float)indexed_buffer_data.vertex_count;
+    }
+
+    std::vector<TriangleRange> ranges = split_into_ranges(indexed_buffer_data);
+
+    ThreadPool thread_pool(thread_count);
+    thread_pool.parallel_for(ranges.size(), [&](int range_index) {
+        const TriangleRange& range = ranges[range_index];
+        optimize_range_for_overdraw(indexed_buffer_data.indices.data() + range.first_triangle * 3, range.triangle_count, indexed_buffer_data.vertex_data.data(), mesh_center);
+    });
+}
+
+// --------------------------------------------------------------------------
+
+void MeshOptimizer::optimize_vertex_fetch(IndexedBufferData& indexed_buffer_data) {
+    // Lay vertices out in the order the index buffer first references them.
+    // Unreferenced vertices are dropped.
+    const int STRIDE = Model::FLOATS_PER_BUFFER_VERTEX;
+    const uint32_t UNASSIGNED = UINT32_MAX;
+
+    std::vector<uint32_t> new_vertex_indices(indexed_buffer_data.vertex_count, UNASSIGNED);
+    BufferArray<float> new_vertex_data(indexed_buffer_data.vertex_data.size());
+    BufferArray<float> new_texture_coordinate_data(indexed_buffer_data.texture_coordinate_data.size());
+    bool has_texture_coordinates = !new_texture_coordinate_data.empty();
+
+    uint32_t next_vertex_index = 0;
+    for (uint32_t& index : indexed_buffer_data.indices) {
+        if (new_vertex_indices[index] == UNASSIGNED) {
+            new_vertex_indices[index] = next_vertex_index;
+            std::copy_n(&indexed_buffer_data.vertex_data[index * STRIDE], STRIDE, &new_vertex_data[next_vertex_index * STRIDE]);
+            if (has_texture_coordinates) {
+                std::copy_n(&indexed_buffer_data.texture_coordinate_data[index * 2], 2, &new_texture_coordinate_data[next_vertex_index * 2]);
+            }
+            next_vertex_index++;
+        }
+
+        index = new_vertex_indices[index];
+    }
+
+    new_vertex_data.resize(next_vertex_index * STRIDE);
+    indexed_buffer_data.vertex_data = std::move(new_vertex_data);
+    if (has_texture_coordinates) {
+        new_texture_coordinate_data.resize(next_vertex_index * 2);
+        indexed_buffer_data.texture_coordinate_data = std::move(new_texture_coordinate_data);
+    }
+    indexed_buffer_data.vertex_count = next_vertex_index;
+    indexed_buffer_data.index_size_in_bytes = next_vertex_index <= 65536 ? sizeof(uint16_t) : sizeof(uint32_t);
+}
+
+// --------------------------------------------------------------------------
+
+VertexCacheStatistics MeshOptimizer::analyze_vertex_cache(const IndexedBufferData& indexed_buffer_data) {
+    // Simulates a FIFO post-transform cache. ACMR is misses per triangle (0.5 is ideal
+    // for large closed meshes), ATVR is misses per vertex (1.0 is ideal).
+    std::vector<uint32_t> cache_timestamps(indexed_buffer_data.vertex_count, 0);
+    uint32_t timestamp = ANALYSIS_CACHE_SIZE + 1;
+
+    long long miss_count = 0;
+    for (uint32_t index : indexed_buffer_data.indices) {
+        if (timestamp - cache_timestamps[index] > ANALYSIS_CACHE_SIZE) {
+            cache_timestamps[index] = timestamp++;
+            miss_count++;
+        }
+    }
+
+    VertexCacheStatistics statistics;
+    statistics.acmr = 0.0f;
+    statistics.atvr = 0.0f;
+    if (indexed_buffer_data.indices.size() > 0) {
+        statistics.acmr = (float)miss_count / (indexed_buffer_data.indices.size() / 3);
+    }
+    if (indexed_buffer_data.vertex_count > 0) {
+        statistics.atvr = (float)miss_count / indexed_buffer_data.vertex_count;
+    }
+
+    return statistics;
+}
+
+// --------------------------------------------------------------------------
+
+float MeshOptimizer::compute_vertex_score(int cache_position, int remaining_valence) {
+    if (remaining_valence == 0) {
+        return -1.0f;
+    }
+
+    float score = 0.0f;
+    if (cache_position >= 0) {
+        score = cache_position_scores[cache_position];
+    }
+
+    return score + valence_scores[std::min(remaining_valence, MAX_SCORED_VALENCE)];
+}
+
+// --------------------------------------------------------------------------
+
+uint32_t MeshOptimizer::compute_morton_code(glm::vec3 normalized_position) {
+    // Interleaves 10 bits per axis.
+    uint32_t code = 0;
+    for (int axis = 0; axis < 3; axis++) {
+        uint32_t value = (uint32_t)glm::clamp(normalized_position[axis] * 1023.0f, 0.0f, 1023.0f);
+        value = (value | (value << 16)) & 0x030000FF;
+        value = (value | (value << 8)) & 0x0300F00F;
+        value = (value | (value << 4)) & 0x030C30C3;
+        value = (value | (value << 2)) & 0x09249249;
+        code |= value << (2 - axis);
+    }
+
+    return code;
+}
+
+// --------------------------------------------------------------------------
+
+std::vector<MeshOptimizer::TriangleRange> MeshOptimizer::split_into_ranges(const IndexedBufferData& indexed_buffer_data) {
+    // Ranges never cross from one submesh into the next, so reordering triangles within a
+    // range keeps every submesh's triangles contiguous.
+    std::vector<TriangleRange> ranges;
+    auto add_ranges = [&](int first_triangle, int triangle_count) {
+        for (int offset = 0; offset < triangle_count; offset += TRIANGLES_PER_RANGE) {
+            ranges.push_back({first_triangle + offset, std::min(TRIANGLES_PER_RANGE, triangle_count - offset)});
+        }
+    };
+
+    if (indexed_buffer_data.submeshes.empty()) {
+        add_ranges(0, indexed_buffer_data.indices.size() / 3);
+    } else {
+        for (const Submesh& submesh : indexed_buffer_data.submeshes) {
+            add_ranges(submesh.first_index / 3, submesh.index_count / 3);
+        }
+    }
+
+    return ranges;
+}
+
+// --------------------------------------------------------------------------
+
+void MeshOptimizer::optimize_range_for_vertex_cache(uint32_t* indices, int triangle_count) {
+    int corner_count = triangle_count * 3;
+
+    // Renumber the range's vertices densely so per-vertex state scales with the range, not the mesh.
+    std::vector<std::pair<uint32_t, int>> sorted_corners(corner_count);
+    for (int i = 0; i < corner_count; i++) {
+        sorted_corners[i] = std::make_pair(indices[i], i);
+    }
+    std::sort(sorted_corners.begin(), sorted_corners.end());
+
+    std::vector<int> local_indices(corner_count);
+    int vertex_count = 0;
+    for (int i = 0; i < corner_count; i++) {
+        if (i == 0 || sorted_corners[i].first != sorted_corners[i - 1].first) {
+            vertex_count++;
+        }
+        local_indices[sorted_corners[i].second] = vertex_count - 1;
+    }
+    sorted_corners = std::vector<std::pair<uint32_t, int>>();
+
+    // Triangles adjacent to each vertex, stored contiguously. The first remaining_valences[v]
+    // entries of a vertex's list are the triangles that haven't been emitted yet.
+    std::vector<int> adjacency_offsets(vertex_count + 1, 0);
+    for (int local_index : local_indices) {
+        adjacency_offsets[local_index + 1]++;
+    }
+    std::partial_sum(adjacency_offsets.begin(), adjacency_offsets.end(), adjacency_offsets.begin());
+
+    std::vector<int> remaining_valences(vertex_count, 0);
+    std::vector<int> adjacent_triangles(corner_count);
+    for (int i = 0; i < corner_count; i++) {
+        int vertex = local_indices[i];
+        adjacent_triangles[adjacency_offsets[vertex] + remaining_valences[vertex]++] = i / 3;
+    }
+
+    std::vector<int> cache_positions(vertex_count, -1);
+    std::vector<float> vertex_scores(vertex_count);
+    for (int vertex = 0; vertex < vertex_count; vertex++) {
+        vertex_scores[vertex] = compute_vertex_score(-1, remaining_valences[vertex]);
+    }
+
+    std::vector<float> triangle_scores(triangle_count);
+    std::vector<bool> is_triangle_emitted(triangle_count, false);
+    int best_triangle = 0;
+    for (int triangle = 0; triangle < triangle_count; triangle++) {
+        const int* triangle_vertices = &local_indices[triangle * 3];
+        triangle_scores[triangle] = vertex_scores[triangle_vertices[0]] + vertex_scores[triangle_vertices[1]] + vertex_scores[triangle_vertices[2]];
+        if (triangle_scores[triangle] > triangle_scores[best_triangle]) {
+            best_triangle = triangle;
+        }
+    }
+
+    std::vector<uint32_t> optimized_indices(corner_count);
+    int cache[CACHE_SIZE + 3];
+    int cache_count = 0;
+    int next_unemitted_triangle = 0;
+
+    for (int emitted_triangle_count = 0; emitted_triangle_count < triangle_count; emitted_triangle_count++) {
+        // When nothing in the cache scores, restart from the next triangle in the original order.
+        if (best_triangle < 0) {
+            while (is_triangle_emitted[next_unemitted_triangle]) {
+                next_unemitted_triangle++;
+            }
+            best_triangle = next_unemitted_triangle;
+        }
+
+        int triangle = best_triangle;
+        is_triangle_emitted[triangle] = true;
+        std::copy_n(&indices[triangle * 3], 3, &optimized_indices[emitted_triangle_count * 3]);
+
+        const int* triangle_vertices = &local_indices[triangle * 3];
+        for (int corner = 0; corner < 3; corner++) {
+            int vertex = triangle_vertices[corner];
+            int* vertex_triangles = &adjacent_triangles[adjacency_offsets[vertex]];
+            int* emitted_entry = std::find(vertex_triangles, vertex_triangles + remaining_valences[vertex], triangle);
+            std::swap(*emitted_entry, vertex_triangles[remaining_valences[vertex] - 1]);
+            remaining_valences[vertex]--;
+        }
+
+        // The emitted triangle's vertices move to the front of the LRU cache.
+        int new_cache[CACHE_SIZE + 3];
+        int new_cache_count = 0;
+        for (int corner = 0; corner < 3; corner++) {
+            int vertex = triangle_vertices[corner];
+            if (std::find(new_cache, new_cache + new_cache_count, vertex) == new_cache + new_cache_count) {
+                new_cache[new_cache_count++] = vertex;
+            }
+        }
+        for (int i = 0; i < cache_count; i++) {
+            if (std::find(new_cache, new_cache + new_cache_count, cache[i]) == new_cache + new_cache_count) {
+                new_cache[new_cache_count++] = cache[i];
+            }
+        }
+
+        for (int i = 0; i < new_cache_count; i++) {
+            int vertex = new_cache[i];
+            cache_positions[vertex] = i < CACHE_SIZE ? i : -1;
+            vertex_scores[vertex] = compute_vertex_score(cache_positions[vertex], remaining_valences[vertex]);
+        }
+
+        // Only triangles touching the cache changed score, so the next pick comes from them.
+        best_triangle = -1;
+        float best_triangle_score = -1.0f;
+        for (int i = 0; i < new_cache_count; i++) {
+            int vertex = new_cache[i];
+            const int* vertex_triangles = &adjacent_triangles[adjacency_offsets[vertex]];
+            for (int j = 0; j < remaining_valences[vertex]; j++) {
+                int adjacent_triangle = vertex_triangles[j];
+                const int* adjacent_vertices = &local_indices[adjacent_triangle * 3];
+                float score = vertex_scores[adjacent_vertices[0]] + vertex_scores[adjacent_vertices[1]] + vertex_scores[adjacent_vertices[2]];
+                triangle_scores[adjacent_triangle] = score;
+                if (score > best_triangle_score) {
+                    best_triangle_score = score;
+                    best_triangle = adjacent_triangle;
+                }
+            }
+        }
+
+        cache_count = std::min(new_cache_count, (int)CACHE_SIZE);
+        std::copy_n(new_cache, cache_count, cache);
+    }
+
+    std::copy(optimized_indices.begin(), optimized_indices.end(), indices);
+}
+
+// --------------------------------------------------------------------------
+
+void MeshOptimizer::optimize_range_for_overdraw(uint32_t* indices, int triangle_count, const float* vertex_data, glm::vec3 mesh_center) {
+    // Following Sander et al., "Fast Triangle Reordering for Vertex Locality and Reduced
+    // Overdraw": cut the cache-optimized order into clusters wherever a triangle misses
+    // the cache on all three vertices (so moving clusters around costs almost no cache
+    // efficiency), then draw outward-facing clusters on the outside of the mesh first.
+    const int STRIDE = Model::FLOATS_PER_BUFFER_VERTEX;
+
+    std::vector<int> cluster_starts;
+    std::vector<std::pair<uint32_t, uint32_t>> cache_entries;
+    uint32_t timestamp = CACHE_SIZE + 1;
+    for (int triangle = 0; triangle < triangle_count; triangle++) {
+        int miss_count = 0;
+        for (int corner = 0; corner < 3; corner++) {
+            uint32_t vertex = indices[triangle * 3 + corner];
+            auto cache_entry = std::find_if(cache_entries.begin(), cache_entries.end(), [&](const std::pair<uint32_t, uint32_t>& entry) {
+                return entry.first == vertex;
+            });
+
+            if (cache_entry == cache_entries.end()) {
+                cache_entries.push_back(std::make_pair(vertex, timestamp++));
+                miss_count++;
+            } else if (timestamp - cache_entry->second > CACHE_SIZE) {
+                cache_entry->second = timestamp++;
+                miss_count++;
+            }
+        }
+
+        cache_entries.erase(std::remove_if(cache_entries.begin(), cache_entries.end(), [&](const std::pair<uint32_t, uint32_t>& entry) {
+            return timestamp - entry.second > CACHE_SIZE;
+        }), cache_entries.end());
+
+        if (triangle == 0 || miss_count == 3) {
+            cluster_starts.push_back(triangle);
+        }
+    }
+    cluster_starts.push_back(triangle_count);
+
+    int cluster_count = cluster_starts.size() - 1;
+    std::vector<float> cluster_sort_keys(cluster_count);
+    for (int cluster = 0; cluster < cluster_count; cluster++) {
+        glm::vec3 area_weighted_normal = glm::vec3(0.0f, 0.0f, 0.0f);
+        glm::vec3 centroid_sum = glm::vec3(0.0f, 0.0f, 0.0f);
+        for (int triangle = cluster_starts[cluster]; triangle < cluster_starts[cluster + 1]; triangle++) {
+            glm::vec3 positions[3];
+            for (int corner = 0; corner < 3; corner++) {
+                const float* position = &vertex_data[indices[triangle * 3 + corner] * STRIDE];
+                positions[corner] = glm::vec3(position[0], position[1], position[2]);
+            }
+
+            area_weighted_normal += glm::cross(positions[1] - positions[0], positions[2] - positions[0]);
+            centroid_sum += positions[0] + positions[1] + positions[2];
+        }
+
+        glm::vec3 centroid = centroid_sum / (3.0f * (cluster_starts[cluster + 1] - cluster_starts[cluster]));
+        float normal_length = glm::length(area_weighted_normal);
+        cluster_sort_keys[cluster] = normal_length > 0.0f ? glm::dot(centroid - mesh_center, area_weighted_normal / normal_length) : 0.0f;
+    }
+
+    std::vector<int> cluster_order(cluster_count);
+    std::iota(cluster_order.begin(), cluster_order.end(), 0);
+    std::stable_sort(cluster_order.begin(), cluster_order.end(), [&](int a, int b) {
+        return cluster_sort_keys[a] > cluster_sort_keys[b];
+    });
+
+    std::vector<uint32_t> sorted_indices;
+    sorted_indices.reserve(triangle_count * 3);
+    for (int cluster : cluster_order) {
+        sorted_indices.insert(sorted_indices.end(), indices + cluster_starts[cluster] * 3, indices + cluster_starts[cluster + 1] * 3);
+    }
+
+    std::copy(sorted_indices.begin(), sorted_indices.end(), indices);
+}
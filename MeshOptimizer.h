@@ -0,0 +1,59 @@
+#ifndef MESH_OPTIMIZER_H
+#define MESH_OPTIMIZER_H
+
+#include <vector>
+#include <cstdint>
+#include <glm/glm.hpp>
+
+#include "Model.h"
+
+struct VertexCacheStatistics {
+    float acmr;
+    float atvr;
+};
+
+class MeshOptimizer {
+
+public:
+
+    MeshOptimizer();
+    ~MeshOptimizer();
+
+    void set_thread_count(int thread_count);
+
+    void sort_triangles_spatially(IndexedBufferData& indexed_buffer_data);
+
+    void optimize_vertex_cache(IndexedBufferData& indexed_buffer_data);
+    void optimize_overdraw(IndexedBufferData& indexed_buffer_data);
+    void optimize_vertex_fetch(IndexedBufferData& indexed_buffer_data);
+
+    VertexCacheStatistics analyze_vertex_cache(const IndexedBufferData& indexed_buffer_data);
+
+private:
+
+    static const int CACHE_SIZE = 32;
+    static constexpr int MAX_SCORED_VALENCE = 32;
+    static const int ANALYSIS_CACHE_SIZE = 16;
+    static constexpr int TRIANGLES_PER_RANGE = 1 << 16;
+
+    // A run of triangles that's optimized on its own.
+    struct TriangleRange {
+        int first_triangle;
+        int triangle_count;
+    };
+
+    int thread_count;
+
+    float cache_position_scores[CACHE_SIZE];
+    float valence_scores[MAX_SCORED_VALENCE + 1];
+
+    float compute_vertex_score(int cache_position, int remaining_valence);
+    uint32_t compute_morton_code(glm::vec3 normalized_position);
+
+    std::vector<TriangleRange> split_into_ranges(const IndexedBufferData& indexed_buffer_data);
+
+    void optimize_range_for_vertex_cache(uint32_t* indices, int triangle_count);
+    void optimize_range_for_overdraw(uint32_t* indices, int triangle_count, const float* vertex_data, glm::vec3 mesh_center);
+};
+
+#endif
@@ -0,0 +1,577 @@
+#include "MeshSimplifier.h"
+
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <algorithm>
+#include <unordered_map>
+
+#include "ThreadPool.h"
+
+MeshSimplifier::MeshSimplifier()
+:
+thread_count(1) {
+    // do nothing for now
+}
+
+// --------------------------------------------------------------------------
+
+MeshSimplifier::~MeshSimplifier() {
+    // do nothing for now
+}
+
+// --------------------------------------------------------------------------
+
+void MeshSimplifier::set_thread_count(int thread_count) {
+    this->thread_count = thread_count > 0 ? thread_count : ThreadPool::get_hardware_thread_count();
+}
+
+// --------------------------------------------------------------------------
+
+std::vector<LevelOfDetail> MeshSimplifier::build_levels_of_detail(IndexedBufferData& indexed_buffer_data, int max_level_count) {
+    // Every level roughly halves the previous one with half-edge collapses, which only ever
+    // move a vertex onto a neighbor. All levels therefore share the original vertex buffer,
+    // and their index lists are appended after the full-detail indices.
+    const int REGION_GRID_SIZES[] = { MAX_REGION_GRID_SIZE, 3, 2, 1 };
+    const int MIN_REGION_TRIANGLE_COUNT = 4096;
+
+    std::vector<LevelOfDetail> levels_of_detail;
+    levels_of_detail.push_back({0, (int)indexed_buffer_data.indices.size(), 0.0f});
+
+    weld_positions(indexed_buffer_data);
+
+    std::vector<uint32_t> source_indices(indexed_buffer_data.indices.begin(), indexed_buffer_data.indices.end());
+    float error = 0.0f;
+    for (int level = 1; level < max_level_count; level++) {
+        int source_triangle_count = source_indices.size() / 3;
+        if (source_triangle_count < 2 * MIN_LEVEL_TRIANGLE_COUNT) {
+            break;
+        }
+
+        // Regions are locked along their borders, so each level uses a different grid
+        // to let the next level simplify the previous level's borders.
+        int region_grid_size = REGION_GRID_SIZES[std::min(level - 1, 3)];
+        while (region_grid_size > 1 && source_triangle_count / (region_grid_size * region_grid_size * region_grid_size) < MIN_REGION_TRIANGLE_COUNT) {
+            region_grid_size--;
+        }
+
+        std::vector<uint32_t> simplified_indices;
+        double max_error = simplify_level(indexed_buffer_data, source_indices, region_grid_size, simplified_indices);
+        if (simplified_indices.size() > source_indices.size() * MIN_REDUCTION) {
+            break;
+        }
+
+        // Each level is measured against the previous one, so the errors add up.
+        error += max_error;
+
+        LevelOfDetail level_of_detail;
+        level_of_detail.first_index = indexed_buffer_data.indices.size();
+        level_of_detail.index_count = simplified_indices.size();
+        level_of_detail.error = error;
+        levels_of_detail.push_back(level_of_detail);
+
+        indexed_buffer_data.indices.insert(indexed_buffer_data.indices.end(), simplified_indices.begin(), simplified_indices.end());
+        source_indices = std::move(simplified_indices);
+    }
+
+    position_ids = std::vector<int>();
+    first_position_vertices = std::vector<int>();
+    position_vertices = std::vector<int>();
+
+    return levels_of_detail;
+}
+
+// --------------------------------------------------------------------------
+
+void MeshSimplifier::weld_positions(const IndexedBufferData& indexed_buffer_data) {
+    // Buffer vertices with bit-identical positions share the id of the first of them, and
+    // first_position_vertices/position_vertices list the buffer vertices for each such id.
+    const int STRIDE = Model::FLOATS_PER_BUFFER_VERTEX;
+    int vertex_count = indexed_buffer_data.vertex_count;
+    const float* vertex_data = indexed_buffer_data.vertex_data.data();
+
+    std::vector<int> sorted_vertices(vertex_count);
+    std::iota(sorted_vertices.begin(), sorted_vertices.end(), 0);
+    std::sort(sorted_vertices.begin(), sorted_vertices.end(), [&](int a, int b) {
+        const float* position_a = &vertex_data[a * STRIDE];
+        const float* position_b = &vertex_data[b * STRIDE];
+        return std::lexicographical_compare(position_a, position_a + 3, position_b, position_b + 3) || (std::equal(position_a, position_a + 3, position_b) && a < b);
+    });
+
+    position_ids.assign(vertex_count, 0);
+    first_position_vertices.assign(vertex_count + 1, 0);
+    for (int i = 0; i < vertex_count; i++) {
+        int vertex = sorted_vertices[i];
+        bool is_new_position = i == 0 || !std::equal(&vertex_data[vertex * STRIDE], &vertex_data[vertex * STRIDE] + 3, &vertex_data[sorted_vertices[i - 1] * STRIDE]);
+        position_ids[vertex] = is_new_position ? vertex : position_ids[sorted_vertices[i - 1]];
+        first_position_vertices[position_ids[vertex] + 1]++;
+    }
+
+    for (int i = 0; i < vertex_count; i++) {
+        first_position_vertices[i + 1] += first_position_vertices[i];
+    }
+
+    position_vertices.resize(vertex_count);
+    std::vector<int> next_position_vertices(first_position_vertices.begin(), first_position_vertices.end() - 1);
+    for (int vertex = 0; vertex < vertex_count; vertex++) {
+        position_vertices[next_position_vertices[position_ids[vertex]]++] = vertex;
+    }
+}
+
+// --------------------------------------------------------------------------
+
+double MeshSimplifier::simplify_level(const IndexedBufferData& indexed_buffer_data, const std::vector<uint32_t>& source_indices, int region_grid_size, std::vector<uint32_t>& simplified_indices) {
+    // Splits the triangles into a grid of regions by centroid and simplifies the regions in
+    // parallel. Positions used by more than one region are locked, so the regions stay
+    // stitched together without any coordination between threads.
+    const int STRIDE = Model::FLOATS_PER_BUFFER_VERTEX;
+    const float MAX_FLOAT_VALUE = std::numeric_limits<float>::max();
+    const float* vertex_data = indexed_buffer_data.vertex_data.data();
+
+    int triangle_count = source_indices.size() / 3;
+
+    glm::vec3 extents_min = glm::vec3(MAX_FLOAT_VALUE, MAX_FLOAT_VALUE, MAX_FLOAT_VALUE);
+    glm::vec3 extents_max = glm::vec3(-MAX_FLOAT_VALUE, -MAX_FLOAT_VALUE, -MAX_FLOAT_VALUE);
+    for (uint32_t vertex : source_indices) {
+        glm::vec3 position = glm::vec3(vertex_data[vertex * STRIDE], vertex_data[vertex * STRIDE + 1], vertex_data[vertex * STRIDE + 2]);
+        extents_min = glm::min(extents_min, position);
+        extents_max = glm::max(extents_max, position);
+    }
+    glm::vec3 region_scale = (float)region_grid_size / glm::max(extents_max - extents_min, glm::vec3(std::numeric_limits<float>::min()));
+
+    int region_count = region_grid_size * region_grid_size * region_grid_size;
+    std::vector<int> triangle_regions(triangle_count);
+    std::vector<int> region_triangle_counts(region_count, 0);
+    std::vector<int> position_regions(indexed_buffer_data.vertex_count, -1);
+    std::vector<bool> is_position_locked(indexed_buffer_data.vertex_count, false);
+    for (int triangle = 0; triangle < triangle_count; triangle++) {
+        glm::vec3 centroid = glm::vec3(0.0f, 0.0f, 0.0f);
+        for (int corner = 0; corner < 3; corner++) {
+            const float* position = &vertex_data[source_indices[triangle * 3 + corner] * STRIDE];
+            centroid += glm::vec3(position[0], position[1], position[2]) / 3.0f;
+        }
+
+        glm::vec3 cell = glm::clamp((centroid - extents_min) * region_scale, 0.0f, region_grid_size - 1.0f);
+        int region = ((int)cell.x * region_grid_size + (int)cell.y) * region_grid_size + (int)cell.z;
+        triangle_regions[triangle] = region;
+        region_triangle_counts[region]++;
+
+        for (int corner = 0; corner < 3; corner++) {
+            int position_id = position_ids[source_indices[triangle * 3 + corner]];
+            if (position_regions[position_id] == -1) {
+                position_regions[position_id] = region;
+            } else if (position_regions[position_id] != region) {
+                is_position_locked[position_id] = true;
+            }
+        }
+    }
+
+    std::vector<std::vector<uint32_t>> region_indices(region_count);
+    for (int region = 0; region < region_count; region++) {
+        region_indices[region].reserve(region_triangle_counts[region] * 3);
+    }
+    for (int triangle = 0; triangle < triangle_count; triangle++) {
+        std::vector<uint32_t>& indices = region_indices[triangle_regions[triangle]];
+        indices.insert(indices.end(), &source_indices[triangle * 3], &source_indices[triangle * 3] + 3);
+    }
+
+    std::vector<double> region_errors(region_count, 0.0);
+    ThreadPool thread_pool(thread_count);
+    thread_pool.parallel_for(region_count, [&](int region) {
+        region_errors[region] = simplify_region(indexed_buffer_data, region_indices[region], is_position_locked);
+    });
+
+    simplified_indices.clear();
+    for (const std::vector<uint32_t>& indices : region_indices) {
+        simplified_indices.insert(simplified_indices.end(), indices.begin(), indices.end());
+    }
+
+    return *std::max_element(region_errors.begin(), region_errors.end());
+}
+
+// --------------------------------------------------------------------------
+
+double MeshSimplifier::simplify_region(const IndexedBufferData& indexed_buffer_data, std::vector<uint32_t>& region_indices, const std::vector<bool>& is_position_locked) {
+    // Collapses edges in passes: each pass ranks every edge by quadric error and performs the
+    // cheapest collapses whose neighborhoods don't overlap, until half of the triangles are
+    // gone. Returns the largest error among the performed collapses, as the root mean square
+    // distance from the merged vertex to the planes its quadric was built from.
+    const int STRIDE = Model::FLOATS_PER_BUFFER_VERTEX;
+    const float* vertex_data = indexed_buffer_data.vertex_data.data();
+
+    int triangle_count = region_indices.size() / 3;
+    int target_triangle_count = triangle_count / 2;
+
+    // Local numbering of the welded positions in this region.
+    std::unordered_map<int, int> local_vertices;
+    std::vector<int> vertex_position_ids;
+    std::vector<int> corner_vertices(region_indices.size());
+    for (size_t corner = 0; corner < region_indices.size(); corner++) {
+        int position_id = position_ids[region_indices[corner]];
+        auto inserted = local_vertices.emplace(position_id, (int)vertex_position_ids.size());
+        if (inserted.second) {
+            vertex_position_ids.push_back(position_id);
+        }
+        corner_vertices[corner] = inserted.first->second;
+    }
+    local_vertices = std::unordered_map<int, int>();
+
+    int vertex_count = vertex_position_ids.size();
+    // A position is on a texture seam when its buffer vertices have different texture
+    // coordinates, as along texture borders.
+    const float* texture_coordinate_data = indexed_buffer_data.texture_coordinate_data.data();
+    bool has_texture_coordinates = !indexed_buffer_data.texture_coordinate_data.empty();
+    std::vector<glm::vec3> positions(vertex_count);
+    std::vector<bool> is_vertex_locked(vertex_count);
+    std::vector<bool> is_vertex_on_texture_seam(vertex_count);
+    for (int vertex = 0; vertex < vertex_count; vertex++) {
+        int position_id = vertex_position_ids[vertex];
+        positions[vertex] = glm::vec3(vertex_data[position_id * STRIDE], vertex_data[position_id * STRIDE + 1], vertex_data[position_id * STRIDE + 2]);
+        is_vertex_locked[vertex] = is_position_locked[position_id];
+
+        int first = first_position_vertices[position_id];
+        int last = first_position_vertices[position_id + 1];
+        for (int i = first + 1; i < last && has_texture_coordinates; i++) {
+            const float* texture_coordinate = &texture_coordinate_data[position_vertices[i] * 2];
+            const float* first_texture_coordinate = &texture_coordinate_data[position_vertices[first] * 2];
+            if (texture_coordinate[0] != first_texture_coordinate[0] || texture_coordinate[1] != first_texture_coordinate[1]) {
+                is_vertex_on_texture_seam[vertex] = true;
+            }
+        }
+    }
+
+    std::vector<Quadric> quadrics(vertex_count, Quadric{0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0});
+    std::unordered_map<uint64_t, int> edge_triangle_counts;
+    for (int triangle = 0; triangle < triangle_count; triangle++) {
+        const int* vertices = &corner_vertices[triangle * 3];
+        glm::vec3 normal = glm::cross(positions[vertices[1]] - positions[vertices[0]], positions[vertices[2]] - positions[vertices[0]]);
+        float length = glm::length(normal);
+        if (length > 0.0f) {
+            normal /= length;
+            for (int corner = 0; corner < 3; corner++) {
+                add_plane_to_quadric(quadrics[vertices[corner]], normal, -glm::dot(normal, positions[vertices[0]]), 1.0);
+            }
+        }
+
+        for (int corner = 0; corner < 3; corner++) {
+            uint32_t a = vertices[corner];
+            uint32_t b = vertices[(corner + 1) % 3];
+            edge_triangle_counts[((uint64_t)std::min(a, b) << 32) | std::max(a, b)]++;
+        }
+    }
+
+    // Open edges get a plane through them, perpendicular to their face, so that the
+    // boundary keeps its shape.
+    for (int triangle = 0; triangle < triangle_count; triangle++) {
+        const int* vertices = &corner_vertices[triangle * 3];
+        glm::vec3 normal = glm::cross(positions[vertices[1]] - positions[vertices[0]], positions[vertices[2]] - positions[vertices[0]]);
+        for (int corner = 0; corner < 3; corner++) {
+            uint32_t a = vertices[corner];
+            uint32_t b = vertices[(corner + 1) % 3];
+            if (edge_triangle_counts[((uint64_t)std::min(a, b) << 32) | std::max(a, b)] != 1) {
+                continue;
+            }
+
+            glm::vec3 boundary_normal = glm::cross(positions[b] - positions[a], normal);
+            float length = glm::length(boundary_normal);
+            if (length > 0.0f) {
+                boundary_normal /= length;
+                double distance = -glm::dot(boundary_normal, positions[a]);
+                add_plane_to_quadric(quadrics[a], boundary_normal, distance, BOUNDARY_WEIGHT);
+                add_plane_to_quadric(quadrics[b], boundary_normal, distance, BOUNDARY_WEIGHT);
+            }
+        }
+    }
+    edge_triangle_counts = std::unordered_map<uint64_t, int>();
+
+    std::vector<bool> is_triangle_alive(triangle_count, true);
+    int alive_triangle_count = triangle_count;
+    double max_error = 0.0;
+
+    std::vector<int> first_vertex_triangles(vertex_count + 1);
+    std::vector<int> vertex_triangles;
+    std::vector<Collapse> collapses;
+    std::vector<bool> is_vertex_touched(vertex_count);
+    std::vector<std::pair<uint32_t, uint32_t>> wedge_targets;
+    while (alive_triangle_count > target_triangle_count) {
+        std::fill(first_vertex_triangles.begin(), first_vertex_triangles.end(), 0);
+        for (int triangle = 0; triangle < triangle_count; triangle++) {
+            if (is_triangle_alive[triangle]) {
+                for (int corner = 0; corner < 3; corner++) {
+                    first_vertex_triangles[corner_vertices[triangle * 3 + corner] + 1]++;
+                }
+            }
+        }
+        for (int vertex = 0; vertex < vertex_count; vertex++) {
+            first_vertex_triangles[vertex + 1] += first_vertex_triangles[vertex];
+        }
+
+        vertex_triangles.resize(first_vertex_triangles[vertex_count]);
+        std::vector<int> next_vertex_triangles(first_vertex_triangles.begin(), first_vertex_triangles.end() - 1);
+        collapses.clear();
+        for (int triangle = 0; triangle < triangle_count; triangle++) {
+            if (!is_triangle_alive[triangle]) {
+                continue;
+            }
+
+            for (int corner = 0; corner < 3; corner++) {
+                int a = corner_vertices[triangle * 3 + corner];
+                int b = corner_vertices[triangle * 3 + (corner + 1) % 3];
+                vertex_triangles[next_vertex_triangles[a]++] = triangle;
+
+                Quadric quadric = quadrics[a];
+                add_quadric(quadric, quadrics[b]);
+                double inverse_weight = quadric.weight > 0.0 ? 1.0 / quadric.weight : 0.0;
+                if (!is_vertex_locked[a]) {
+                    double cost = evaluate_quadric(quadric, positions[b]);
+                    collapses.push_back({cost, std::sqrt(cost * inverse_weight), a, b});
+                }
+                if (!is_vertex_locked[b]) {
+                    double cost = evaluate_quadric(quadric, positions[a]);
+                    collapses.push_back({cost, std::sqrt(cost * inverse_weight), b, a});
+                }
+            }
+        }
+
+        std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) {
+            return a.cost < b.cost;
+        });
+
+        // A collapse removes about two triangles; leave some for the next pass to rank again.
+        int max_collapse_count = (alive_triangle_count - target_triangle_count) / 2 + 1;
+        int collapse_count = 0;
+        std::fill(is_vertex_touched.begin(), is_vertex_touched.end(), false);
+        for (const Collapse& collapse : collapses) {
+            if (collapse_count == max_collapse_count) {
+                break;
+            }
+
+            int from_vertex = collapse.from_vertex;
+            int to_vertex = collapse.to_vertex;
+            if (is_vertex_touched[from_vertex] || is_vertex_touched[to_vertex]) {
+                continue;
+            }
+
+            // Reject collapses that would flip any surviving triangle around from_vertex.
+            bool is_valid = true;
+            for (int i = first_vertex_triangles[from_vertex]; i < first_vertex_triangles[from_vertex + 1] && is_valid; i++) {
+                const int* vertices = &corner_vertices[vertex_triangles[i] * 3];
+                if (vertices[0] == to_vertex || vertices[1] == to_vertex || vertices[2] == to_vertex) {
+                    continue;
+                }
+
+                glm::vec3 old_positions[3];
+                glm::vec3 new_positions[3];
+                for (int corner = 0; corner < 3; corner++) {
+                    old_positions[corner] = positions[vertices[corner]];
+                    new_positions[corner] = vertices[corner] == from_vertex ? positions[to_vertex] : old_positions[corner];
+                }
+
+                glm::vec3 old_normal = glm::cross(old_positions[1] - old_positions[0], old_positions[2] - old_positions[0]);
+                glm::vec3 new_normal = glm::cross(new_positions[1] - new_positions[0], new_positions[2] - new_positions[0]);
+                is_valid = glm::dot(old_normal, new_normal) > 0.0f;
+            }
+
+            // Every wedge of from_vertex moves with it, to a wedge of to_vertex.
+            if (is_valid) {
+                is_valid = find_wedge_targets(indexed_buffer_data, collapse, vertex_position_ids[to_vertex], is_vertex_on_texture_seam[from_vertex], corner_vertices, region_indices,
+                                              vertex_triangles.data() + first_vertex_triangles[from_vertex], vertex_triangles.data() + first_vertex_triangles[from_vertex + 1], wedge_targets);
+            }
+
+            if (!is_valid) {
+                continue;
+            }
+
+            for (int i = first_vertex_triangles[from_vertex]; i < first_vertex_triangles[from_vertex + 1]; i++) {
+                int triangle = vertex_triangles[i];
+                int* vertices = &corner_vertices[triangle * 3];
+                for (int corner = 0; corner < 3; corner++) {
+                    is_vertex_touched[vertices[corner]] = true;
+                }
+
+                if (vertices[0] == to_vertex || vertices[1] == to_vertex || vertices[2] == to_vertex) {
+                    is_triangle_alive[triangle] = false;
+                    alive_triangle_count--;
+                    continue;
+                }
+
+                for (int corner = 0; corner < 3; corner++) {
+                    if (vertices[corner] != from_vertex) {
+                        continue;
+                    }
+
+                    vertices[corner] = to_vertex;
+                    uint32_t& wedge = region_indices[triangle * 3 + corner];
+                    wedge = std::find_if(wedge_targets.begin(), wedge_targets.end(), [wedge](const std::pair<uint32_t, uint32_t>& wedge_target) {
+                        return wedge_target.first == wedge;
+                    })->second;
+                }
+            }
+
+            add_quadric(quadrics[to_vertex], quadrics[from_vertex]);
+            max_error = std::max(max_error, collapse.error);
+            collapse_count++;
+        }
+
+        if (collapse_count == 0) {
+            break;
+        }
+    }
+
+    int kept_triangle_count = 0;
+    for (int triangle = 0; triangle < triangle_count; triangle++) {
+        if (is_triangle_alive[triangle]) {
+            std::copy(&region_indices[triangle * 3], &region_indices[triangle * 3] + 3, &region_indices[kept_triangle_count * 3]);
+            kept_triangle_count++;
+        }
+    }
+    region_indices.resize(kept_triangle_count * 3);
+
+    return max_error;
+}
+
+// --------------------------------------------------------------------------
+
+bool MeshSimplifier::find_wedge_targets(const IndexedBufferData& indexed_buffer_data, const Collapse& collapse, int to_position_id, bool is_texture_seam,
+                                        const std::vector<int>& corner_vertices, const std::vector<uint32_t>& region_indices, const int* first_triangle, const int* last_triangle,
+                                        std::vector<std::pair<uint32_t, uint32_t>>& wedge_targets) {
+    // Positions on a seam have several buffer vertices (wedges). A wedge in a triangle on the
+    // collapsing edge moves to the wedge of to_vertex in that triangle, so a collapse along a
+    // seam moves the seam along itself. Any other wedge moves to the wedge of to_vertex with
+    // the closest normal, which is only allowed when the normals are close and the texture
+    // isn't split there, so seams are never smeared.
+    wedge_targets.clear();
+
+    const int STRIDE = Model::FLOATS_PER_BUFFER_VERTEX;
+    const float* vertex_data = indexed_buffer_data.vertex_data.data();
+
+    auto find_target = [&](uint32_t from_wedge) {
+        return std::find_if(wedge_targets.begin(), wedge_targets.end(), [from_wedge](const std::pair<uint32_t, uint32_t>& wedge_target) {
+            return wedge_target.first == from_wedge;
+        });
+    };
+
+    for (const int* triangle = first_triangle; triangle < last_triangle; triangle++) {
+        const int* vertices = &corner_vertices[*triangle * 3];
+        int to_corner = std::find(vertices, vertices + 3, collapse.to_vertex) - vertices;
+        if (to_corner == 3) {
+            continue;
+        }
+
+        int from_corner = std::find(vertices, vertices + 3, collapse.from_vertex) - vertices;
+        uint32_t from_wedge = region_indices[*triangle * 3 + from_corner];
+        uint32_t to_wedge = region_indices[*triangle * 3 + to_corner];
+        auto target = find_target(from_wedge);
+        if (target == wedge_targets.end()) {
+            wedge_targets.push_back({from_wedge, to_wedge});
+        } else if (target->second != to_wedge) {
+            return false;
+        }
+    }
+
+    for (const int* triangle = first_triangle; triangle < last_triangle; triangle++) {
+        const int* vertices = &corner_vertices[*triangle * 3];
+        int from_corner = std::find(vertices, vertices + 3, collapse.from_vertex) - vertices;
+        uint32_t from_wedge = region_indices[*triangle * 3 + from_corner];
+        if (find_target(from_wedge) != wedge_targets.end()) {
+            continue;
+        }
+
+        if (is_texture_seam) {
+            return false;
+        }
+
+        uint32_t to_wedge = find_vertex_at_position(indexed_buffer_data, to_position_id, from_wedge);
+        glm::vec3 from_normal = glm::vec3(vertex_data[from_wedge * STRIDE + 3], vertex_data[from_wedge * STRIDE + 4], vertex_data[from_wedge * STRIDE + 5]);
+        glm::vec3 to_normal = glm::vec3(vertex_data[to_wedge * STRIDE + 3], vertex_data[to_wedge * STRIDE + 4], vertex_data[to_wedge * STRIDE + 5]);
+        if (glm::dot(from_normal, to_normal) < MIN_WEDGE_NORMAL_DOT) {
+            return false;
+        }
+
+        wedge_targets.push_back({from_wedge, to_wedge});
+    }
+
+    return true;
+}
+
+// --------------------------------------------------------------------------
+
+uint32_t MeshSimplifier::find_vertex_at_position(const IndexedBufferData& indexed_buffer_data, int position_id, uint32_t original_vertex) {
+    // When several buffer vertices share the target position, keep the normal closest to the original one.
+    const int STRIDE = Model::FLOATS_PER_BUFFER_VERTEX;
+    const float* vertex_data = indexed_buffer_data.vertex_data.data();
+
+    int first = first_position_vertices[position_id];
+    int last = first_position_vertices[position_id + 1];
+    if (last - first == 1) {
+        return position_vertices[first];
+    }
+
+    glm::vec3 original_normal = glm::vec3(vertex_data[original_vertex * STRIDE + 3], vertex_data[original_vertex * STRIDE + 4], vertex_data[original_vertex * STRIDE + 5]);
+
+    uint32_t best_vertex = position_vertices[first];
+    float best_dot = -std::numeric_limits<float>::max();
+    for (int i = first; i < last; i++) {
+        int vertex = position_vertices[i];
+        glm::vec3 normal = glm::vec3(vertex_data[vertex * STRIDE + 3], vertex_data[vertex * STRIDE + 4], vertex_data[vertex * STRIDE + 5]);
+        float dot = glm::dot(original_normal, normal);
+        if (dot > best_dot) {
+            best_dot = dot;
+            best_vertex = vertex;
+        }
+    }
+
+    return best_vertex;
+}
+
+// --------------------------------------------------------------------------
+
+void MeshSimplifier::add_plane_to_quadric(Quadric& quadric, glm::vec3 normal, double distance, double weight) {
+    double a = normal.x;
+    double b = normal.y;
+    double c = normal.z;
+    double d = distance;
+
+    quadric.a2 += weight * a * a;
+    quadric.ab += weight * a * b;
+    quadric.ac += weight * a * c;
+    quadric.ad += weight * a * d;
+    quadric.b2 += weight * b * b;
+    quadric.bc += weight * b * c;
+    quadric.bd += weight * b * d;
+    quadric.c2 += weight * c * c;
+    quadric.cd += weight * c * d;
+    quadric.d2 += weight * d * d;
+    quadric.weight += weight;
+}
+
+// --------------------------------------------------------------------------
+
+void MeshSimplifier::add_quadric(Quadric& quadric, const Quadric& other) {
+    quadric.a2 += other.a2;
+    quadric.ab += other.ab;
+    quadric.ac += other.ac;
+    quadric.ad += other.ad;
+    quadric.b2 += other.b2;
+    quadric.bc += other.bc;
+    quadric.bd += other.bd;
+    quadric.c2 += other.c2;
+    quadric.cd += other.cd;
+    quadric.d2 += other.d2;
+    quadric.weight += other.weight;
+}
+
+// --------------------------------------------------------------------------
+
+double MeshSimplifier::evaluate_quadric(const Quadric& quadric, glm::vec3 position) {
+    double x = position.x;
+    double y = position.y;
+    double z = position.z;
+
+    double error = quadric.a2 * x * x + 2.0 * quadric.ab * x * y + 2.0 * quadric.ac * x * z + 2.0 * quadric.ad * x
+        + quadric.b2 * y * y + 2.0 * quadric.bc * y * z + 2.0 * quadric.bd * y
+        + quadric.c2 * z * z + 2.0 * quadric.cd * z
+        + quadric.d2;
+
+    return std::max(error, 0.0);
+}
@@ -0,0 +1,80 @@
+#ifndef MESH_SIMPLIFIER_H
+#define MESH_SIMPLIFIER_H
+
+#include <vector>
+#include <cstdint>
+#include <utility>
+#include <glm/glm.hpp>
+
+#include "Model.h"
+
+struct LevelOfDetail {
+    int first_index;
+    int index_count;
+
+    // Estimated distance, in model units, between this level's surface and the original:
+    // the root mean square quadric error of the worst collapse, summed over the levels so far.
+    float error;
+};
+
+class MeshSimplifier {
+
+public:
+
+    MeshSimplifier();
+    ~MeshSimplifier();
+
+    void set_thread_count(int thread_count);
+
+    std::vector<LevelOfDetail> build_levels_of_detail(IndexedBufferData& indexed_buffer_data, int max_level_count);
+
+private:
+
+    struct Quadric {
+        double a2, ab, ac, ad;
+        double b2, bc, bd;
+        double c2, cd;
+        double d2;
+        double weight;
+    };
+
+    struct Collapse {
+        double cost;
+        double error;
+        int from_vertex;
+        int to_vertex;
+    };
+
+    static const int MIN_LEVEL_TRIANGLE_COUNT = 256;
+    static const int MAX_REGION_GRID_SIZE = 5;
+
+    static constexpr double BOUNDARY_WEIGHT = 10.0;
+    static constexpr float MIN_REDUCTION = 0.9f;
+
+    // Off the seam, a wedge may only take over a wedge whose normal is within about 35 degrees.
+    static constexpr float MIN_WEDGE_NORMAL_DOT = 0.8f;
+
+    int thread_count;
+
+    // Face corners refer to buffer vertices, but collapses work on positions: vertices at
+    // the same position (seams) are welded and move together.
+    std::vector<int> position_ids;
+    std::vector<int> first_position_vertices;
+    std::vector<int> position_vertices;
+
+    void weld_positions(const IndexedBufferData& indexed_buffer_data);
+
+    double simplify_level(const IndexedBufferData& indexed_buffer_data, const std::vector<uint32_t>& source_indices, int region_grid_size, std::vector<uint32_t>& simplified_indices);
+    double simplify_region(const IndexedBufferData& indexed_buffer_data, std::vector<uint32_t>& region_indices, const std::vector<bool>& is_position_locked);
+    uint32_t find_vertex_at_position(const IndexedBufferData& indexed_buffer_data, int position_id, uint32_t original_vertex);
+
+    bool find_wedge_targets(const IndexedBufferData& indexed_buffer_data, const Collapse& collapse, int to_position_id, bool is_texture_seam,
+                            const std::vector<int>& corner_vertices, const std::vector<uint32_t>& region_indices, const int* first_triangle, const int* last_triangle,
+                            std::vector<std::pair<uint32_t, uint32_t>>& wedge_targets);
+
+    static void add_plane_to_quadric(Quadric& quadric, glm::vec3 normal, double distance, double weight);
+    static void add_quadric(Quadric& quadric, const Quadric& other);
+    static double evaluate_quadric(const Quadric& quadric, glm::vec3 position);
+};
+
+#endif
@@ -0,0 +1,251 @@
+#include "MipmapGenerator.h"
+
+#include <cmath>
+#include <algorithm>
+
+#include "Simd.h"
+#include "Profiler.h"
+
+// Filtering happens on linear light, so textures don't darken as they get smaller. Decoding
+// sRGB is a table lookup per byte, and encoding looks up the nearest of a few thousand steps.
+struct ColorTables {
+    static const int LINEAR_STEP_COUNT = 4096;
+
+    float srgb_to_linear[256];
+    unsigned char linear_to_srgb[LINEAR_STEP_COUNT];
+
+    ColorTables() {
+        for (int value = 0; value < 256; value++) {
+            float srgb = value / 255.0f;
+            srgb_to_linear[value] = srgb <= 0.04045f ? srgb / 12.92f : std::pow((srgb + 0.055f) / 1.055f, 2.4f);
+        }
+
+        for (int step = 0; step < LINEAR_STEP_COUNT; step++) {
+            float linear = step / (float)(LINEAR_STEP_COUNT - 1);
+            float srgb = linear <= 0.0031308f ? linear * 12.92f : 1.055f * std::pow(linear, 1.0f / 2.4f) - 0.055f;
+            linear_to_srgb[step] = (unsigned char)std::lround(std::clamp(srgb, 0.0f, 1.0f) * 255.0f);
+        }
+    }
+};
+
+static const ColorTables& get_color_tables() {
+    static const ColorTables color_tables;
+    return color_tables;
+}
+
+// --------------------------------------------------------------------------
+
+static Float4 load_linear_pixel(const ColorTables& color_tables, const unsigned char* pixel) {
+    return float4_set(color_tables.srgb_to_linear[pixel[0]], color_tables.srgb_to_linear[pixel[1]], color_tables.srgb_to_linear[pixel[2]], pixel[3] / 255.0f);
+}
+
+// --------------------------------------------------------------------------
+
+static void store_srgb_pixel(const ColorTables& color_tables, Float4 color, unsigned char* pixel) {
+    // Color channels become table steps and alpha becomes bytes, in one multiply.
+    const float STEP_SCALE = ColorTables::LINEAR_STEP_COUNT - 1;
+    Float4 scale = float4_set(STEP_SCALE, STEP_SCALE, STEP_SCALE, 255.0f);
+    int32_t values[4];
+    int4_store(values, float4_round_to_int(float4_clamp(color, float4_splat(0.0f), float4_splat(1.0f)) * scale));
+
+    pixel[0] = color_tables.linear_to_srgb[values[0]];
+    pixel[1] = color_tables.linear_to_srgb[values[1]];
+    pixel[2] = color_tables.linear_to_srgb[values[2]];
+    pixel[3] = (unsigned char)values[3];
+}
+
+// --------------------------------------------------------------------------
+
+MipmapGenerator::MipmapGenerator()
+:
+filter(MipmapFilter::KAISER) {
+    // do nothing for now
+}
+
+// --------------------------------------------------------------------------
+
+MipmapGenerator::~MipmapGenerator() {
+    // do nothing for now
+}
+
+// --------------------------------------------------------------------------
+
+void MipmapGenerator::set_filter(MipmapFilter filter) {
+    this->filter = filter;
+}
+
+// --------------------------------------------------------------------------
+
+void MipmapGenerator::generate(std::vector<Image>& levels) {
+    // levels holds the full size image, and every level down to 1x1 is appended to it. Each
+    // level halves the previous one, rounding down, as OpenGL expects.
+    PROFILE_SCOPE("MipmapGenerator::generate");
+
+    while (!levels.empty() && (levels.back().width > 1 || levels.back().height > 1)) {
+        Image level = filter == MipmapFilter::BOX ? downsample_with_box(levels.back()) : downsample_with_kaiser(levels.back());
+        levels.push_back(std::move(level));
+    }
+}
+
+// --------------------------------------------------------------------------
+
+Image MipmapGenerator::downsample_with_box(const Image& source) {
+    // Averages each 2x2 block. Odd sizes repeat the last row or column.
+    const ColorTables& color_tables = get_color_tables();
+
+    Image destination;
+    destination.width = std::max(source.width / 2, 1);
+    destination.height = std::max(source.height / 2, 1);
+    destination.pixels.resize((size_t)destination.width * destination.height * 4);
+
+    Float4 quarter = float4_splat(0.25f);
+    for (int y = 0; y < destination.height; y++) {
+        const unsigned char* first_row = &source.pixels[(size_t)std::min(2 * y, source.height - 1) * source.width * 4];
+        const unsigned char* second_row = &source.pixels[(size_t)std::min(2 * y + 1, source.height - 1) * source.width * 4];
+        unsigned char* destination_row = &destination.pixels[(size_t)y * destination.width * 4];
+
+        for (int x = 0; x < destination.width; x++) {
+            int first_column = std::min(2 * x, source.width - 1) * 4;
+            int second_column = std::min(2 * x + 1, source.width - 1) * 4;
+
+            Float4 sum = load_linear_pixel(color_tables, first_row + first_column) + load_linear_pixel(color_tables, first_row + second_column)
+                + load_linear_pixel(color_tables, second_row + first_column) + load_linear_pixel(color_tables, second_row + second_column);
+            store_srgb_pixel(color_tables, sum * quarter, destination_row + x * 4);
+        }
+    }
+
+    return destination;
+}
+
+// --------------------------------------------------------------------------
+
+Image MipmapGenerator::downsample_with_kaiser(const Image& source) {
+    // A separable windowed sinc, which keeps fine detail sharper than the box filter without
+    // aliasing. Rows are filtered horizontally into a small ring as the vertical pass needs
+    // them, so each source row is filtered once and no full size float copy is made.
+    const ColorTables& color_tables = get_color_tables();
+
+    Image destination;
+    destination.width = std::max(source.width / 2, 1);
+    destination.height = std::max(source.height / 2, 1);
+    destination.pixels.resize((size_t)destination.width * destination.height * 4);
+
+    std::vector<FilterTaps> column_taps = compute_kaiser_taps(source.width, destination.width);
+    std::vector<FilterTaps> row_taps = compute_kaiser_taps(source.height, destination.height);
+
+    size_t ring_size = 0;
+    for (const FilterTaps& taps : row_taps) {
+        ring_size = std::max(ring_size, taps.size());
+    }
+
+    std::vector<Float4> linear_row(source.width);
+    std::vector<Float4> filtered_rows(ring_size * destination.width);
+    std::vector<int> filtered_row_indices(ring_size, -1);
+
+    auto get_filtered_row = [&](int source_row) {
+        Float4* filtered_row = &filtered_rows[(source_row % ring_size) * destination.width];
+        if (filtered_row_indices[source_row % ring_size] == source_row) {
+            return filtered_row;
+        }
+
+        const unsigned char* source_pixels = &source.pixels[(size_t)source_row * source.width * 4];
+        for (int x = 0; x < source.width; x++) {
+            linear_row[x] = load_linear_pixel(color_tables, source_pixels + x * 4);
+        }
+
+        for (int x = 0; x < destination.width; x++) {
+            Float4 sum = float4_splat(0.0f);
+            for (const std::pair<int, float>& tap : column_taps[x]) {
+                sum = sum + linear_row[tap.first] * float4_splat(tap.second);
+            }
+            filtered_row[x] = sum;
+        }
+
+        filtered_row_indices[source_row % ring_size] = source_row;
+        return filtered_row;
+    };
+
+    std::vector<Float4> sums(destination.width);
+    for (int y = 0; y < destination.height; y++) {
+        std::fill(sums.begin(), sums.end(), float4_splat(0.0f));
+        for (const std::pair<int, float>& tap : row_taps[y]) {
+            const Float4* filtered_row = get_filtered_row(tap.first);
+            Float4 weight = float4_splat(tap.second);
+            for (int x = 0; x < destination.width; x++) {
+                sums[x] = sums[x] + filtered_row[x] * weight;
+            }
+        }
+
+        unsigned char* destination_row = &destination.pixels[(size_t)y * destination.width * 4];
+        for (int x = 0; x < destination.width; x++) {
+            store_srgb_pixel(color_tables, sums[x], destination_row + x * 4);
+        }
+    }
+
+    return destination;
+}
+
+// --------------------------------------------------------------------------
+
+std::vector<MipmapGenerator::FilterTaps> MipmapGenerator::compute_kaiser_taps(int source_size, int destination_size) {
+    // Taps past the edges are clamped to the edge pixel, and each destination pixel's weights
+    // are normalized to sum to one, so flat areas stay flat.
+    std::vector<FilterTaps> all_taps(destination_size);
+
+    float scale = (float)source_size / destination_size;
+    for (int destination_index = 0; destination_index < destination_size; destination_index++) {
+        float center = (destination_index + 0.5f) * scale;
+        int first_source_index = (int)std::floor(center - KAISER_RADIUS * scale);
+        int last_source_index = (int)std::ceil(center + KAISER_RADIUS * scale);
+
+        FilterTaps& taps = all_taps[destination_index];
+        float weight_sum = 0.0f;
+        for (int source_index = first_source_index; source_index < last_source_index; source_index++) {
+            float weight = compute_kaiser_weight((source_index + 0.5f - center) / scale);
+            if (weight == 0.0f) {
+                continue;
+            }
+
+            int clamped_index = std::clamp(source_index, 0, source_size - 1);
+            if (!taps.empty() && taps.back().first == clamped_index) {
+                taps.back().second += weight;
+            } else {
+                taps.push_back({clamped_index, weight});
+            }
+            weight_sum += weight;
+        }
+
+        for (std::pair<int, float>& tap : taps) {
+            tap.second /= weight_sum;
+        }
+    }
+
+    return all_taps;
+}
+
+// --------------------------------------------------------------------------
+
+float MipmapGenerator::compute_kaiser_weight(float distance) {
+    // sinc(distance) under a Kaiser window, with distance in destination pixels.
+    const float PI = 3.14159265358979f;
+
+    float window_position = distance / KAISER_RADIUS;
+    if (std::fabs(window_position) >= 1.0f) {
+        return 0.0f;
+    }
+
+    // Zeroth order modified Bessel function of the first kind, from its power series.
+    auto bessel_i0 = [](float x) {
+        float sum = 1.0f;
+        float term = 1.0f;
+        for (int k = 1; k < 16; k++) {
+            term *= (x / (2.0f * k)) * (x / (2.0f * k));
+            sum += term;
+        }
+        return sum;
+    };
+
+    float sinc = distance == 0.0f ? 1.0f : std::sin(PI * distance) / (PI * distance);
+    float window = bessel_i0(KAISER_ALPHA * std::sqrt(1.0f - window_position * window_position)) / bessel_i0(KAISER_ALPHA);
+    return sinc * window;
+}
@@ -0,0 +1,43 @@
+#ifndef MIPMAP_GENERATOR_H
+#define MIPMAP_GENERATOR_H
+
+#include <vector>
+#include <utility>
+
+#include "ImageDecoder.h"
+
+enum class MipmapFilter {
+    BOX,
+    KAISER
+};
+
+class MipmapGenerator {
+
+public:
+
+    MipmapGenerator();
+    ~MipmapGenerator();
+
+    void set_filter(MipmapFilter filter);
+
+    void generate(std::vector<Image>& levels);
+
+private:
+
+    // The Kaiser window spans this many destination pixels on either side, with this shape.
+    static constexpr float KAISER_RADIUS = 2.0f;
+    static constexpr float KAISER_ALPHA = 4.0f;
+
+    // Source pixels and their weights for one destination row or column.
+    using FilterTaps = std::vector<std::pair<int, float>>;
+
+    MipmapFilter filter;
+
+    Image downsample_with_box(const Image& source);
+    Image downsample_with_kaiser(const Image& source);
+
+    static std::vector<FilterTaps> compute_kaiser_taps(int source_size, int destination_size);
+    static float compute_kaiser_weight(float distance);
+};
+
+#endif
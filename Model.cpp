@@ -1,9 +1,29 @@
 #include "Model.h"
 
 #include <limits>
+#include <utility>
+#include <algorithm>
 #include <glm/glm.hpp>
 
-Model::Model() {
+#include "Profiler.h"
+
+Model::Model(MemoryArena* arena)
+:
+vertices(ArenaAllocator<glm::vec3>(arena)),
+normals(ArenaAllocator<glm::vec3>(arena)),
+texture_coordinates(ArenaAllocator<glm::vec2>(arena)),
+faces(ArenaAllocator<Face>(arena)) {
+    // do nothing for now
+}
+
+// --------------------------------------------------------------------------
+
+Model::Model(ModelArray<glm::vec3> vertices, ModelArray<glm::vec3> normals, ModelArray<glm::vec2> texture_coordinates, ModelArray<Face> faces)
+:
+vertices(std::move(vertices)),
+normals(std::move(normals)),
+texture_coordinates(std::move(texture_coordinates)),
+faces(std::move(faces)) {
     // do nothing for now
 }
 
@@ -39,14 +59,213 @@ void Model::add_face(Face& face) {
 
 // --------------------------------------------------------------------------
 
-float* Model::get_buffer_data(int& size_in_bytes, int& vertex_count) {
-    // For now, we'll only provide vertices and normals in the buffer data data for triangle faces.
+void Model::add_material_library(const std::string& file_path) {
+    for (const std::string& material_library_path : material_library_paths) {
+        if (material_library_path == file_path) {
+            return;
+        }
+    }
+    material_library_paths.push_back(file_path);
+}
+
+// --------------------------------------------------------------------------
+
+void Model::use_material(const std::string& material_name) {
+    // Files usually switch between a handful of materials, so a linear search is fine.
+    int material_index = std::find(material_names.begin(), material_names.end(), material_name) - material_names.begin();
+    if (material_index == (int)material_names.size()) {
+        material_names.push_back(material_name);
+    }
+
+    // Faces before the first usemtl line get a range of their own.
+    if (material_ranges.empty() && !faces.empty()) {
+        material_ranges.push_back({-1, 0});
+    }
+
+    if (!material_ranges.empty() && material_ranges.back().first_face == (int)faces.size()) {
+        material_ranges.back().material_index = material_index;
+    } else if (material_ranges.empty() || material_ranges.back().material_index != material_index) {
+        material_ranges.push_back({material_index, (int)faces.size()});
+    }
+}
+
+// --------------------------------------------------------------------------
+
+void Model::set_materials(std::vector<std::string> material_library_paths, std::vector<std::string> material_names, std::vector<MaterialRange> material_ranges) {
+    this->material_library_paths = std::move(material_library_paths);
+    this->material_names = std::move(material_names);
+    this->material_ranges = std::move(material_ranges);
+}
+
+// --------------------------------------------------------------------------
+
+void Model::clear_faces() {
+    // The current material carries over to the faces that come next.
+    faces.clear();
+    if (!material_ranges.empty()) {
+        material_ranges.assign(1, {material_ranges.back().material_index, 0});
+    }
+}
+
+// --------------------------------------------------------------------------
+
+void Model::replace_normals(ModelArray<glm::vec3> normals, const std::vector<int>& corner_normal_indices) {
+    // corner_normal_indices holds one normal index per face corner, in face order.
+    this->normals = std::move(normals);
+    for (size_t face_index = 0; face_index < faces.size(); face_index++) {
+        for (int corner = 0; corner < 3; corner++) {
+            faces[face_index].normal_indices[corner] = corner_normal_indices[face_index * 3 + corner];
+        }
+    }
+}
+
+// --------------------------------------------------------------------------
+
+void Model::reserve(const ModelStatistics& expected_counts) {
+    // With an arena, ask for all four arrays at once so they share one block.
+    MemoryArena* arena = vertices.get_allocator().get_arena();
+    if (arena != nullptr) {
+        size_t alignment_padding = 4 * alignof(glm::vec3);
+        arena->reserve((size_t)expected_counts.vertex_count * sizeof(glm::vec3) + (size_t)expected_counts.normal_count * sizeof(glm::vec3)
+            + (size_t)expected_counts.texture_coordinate_count * sizeof(glm::vec2) + (size_t)expected_counts.face_count * sizeof(Face) + alignment_padding);
+    }
+
+    vertices.reserve(expected_counts.vertex_count);
+    normals.reserve(expected_counts.normal_count);
+    texture_coordinates.reserve(expected_counts.texture_coordinate_count);
+    faces.reserve(expected_counts.face_count);
+}
+
+// --------------------------------------------------------------------------
+
+template <typename T>
+void Model::move_array(ModelArray<T>& destination, ModelArray<T>& source) {
+    // An empty array takes over the source's storage when both come from the same place and
+    // the source holds at least as much, so the first model appended is never copied.
+    if (destination.empty() && destination.get_allocator() == source.get_allocator() && source.capacity() >= destination.capacity()) {
+        destination = std::move(source);
+        return;
+    }
+
+    destination.insert(destination.end(), source.begin(), source.end());
+    source.clear();
+    source.shrink_to_fit();
+}
+
+// --------------------------------------------------------------------------
+
+void Model::append(Model&& other) {
+    // Face indices are kept as they are: OBJ indices are absolute within the file,
+    // so appending models parsed from consecutive parts of one file needs no fix-up.
+    move_array(vertices, other.vertices);
+    move_array(normals, other.normals);
+    move_array(texture_coordinates, other.texture_coordinates);
+
+    // Faces of the other model before its first usemtl line continue this model's current
+    // material, and its material indices are remapped by name.
+    for (const std::string& material_library_path : other.material_library_paths) {
+        add_material_library(material_library_path);
+    }
+
+    int face_offset = faces.size();
+    for (size_t i = 0; i < other.material_ranges.size(); i++) {
+        const MaterialRange& range = other.material_ranges[i];
+        if (range.material_index < 0) {
+            continue;
+        }
+
+        faces.insert(faces.end(), other.faces.begin() + (faces.size() - face_offset), other.faces.begin() + range.first_face);
+        use_material(other.material_names[range.material_index]);
+    }
+
+    if ((int)faces.size() == face_offset) {
+        move_array(faces, other.faces);
+    } else {
+        faces.insert(faces.end(), other.faces.begin() + (faces.size() - face_offset), other.faces.end());
+    }
+
+    other = Model();
+}
+
+// --------------------------------------------------------------------------
+
+const ModelArray<glm::vec3>& Model::get_vertices() const {
+    return vertices;
+}
+
+// --------------------------------------------------------------------------
+
+const ModelArray<glm::vec3>& Model::get_normals() const {
+    return normals;
+}
+
+// --------------------------------------------------------------------------
+
+const ModelArray<glm::vec2>& Model::get_texture_coordinates() const {
+    return texture_coordinates;
+}
+
+// --------------------------------------------------------------------------
+
+const ModelArray<Face>& Model::get_faces() const {
+    return faces;
+}
+
+// --------------------------------------------------------------------------
+
+const std::vector<std::string>& Model::get_material_library_paths() const {
+    return material_library_paths;
+}
+
+// --------------------------------------------------------------------------
 
-    int buffer_data_size = faces.size() * 3 * 6; // 3 vertices per face, 6 floats per vertex
-    float* buffer_data = new float[buffer_data_size];
+const std::vector<std::string>& Model::get_material_names() const {
+    return material_names;
+}
+
+// --------------------------------------------------------------------------
+
+const std::vector<MaterialRange>& Model::get_material_ranges() const {
+    return material_ranges;
+}
+
+// --------------------------------------------------------------------------
+
+bool Model::has_missing_normals() const {
+    for (const Face& face : faces) {
+        for (int corner = 0; corner < 3; corner++) {
+            if (face.normal_indices[corner] < 0) {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+// --------------------------------------------------------------------------
+
+BufferData Model::get_buffer_data() const {
+    // Sizes are size_t throughout, since the float count passes INT_MAX at about 119M faces.
+    size_t buffer_data_size = faces.size() * 3 * FLOATS_PER_BUFFER_VERTEX;
+
+    // Every element is written, so the array is left uninitialized.
+    BufferData result;
+    result.data.reset(new float[buffer_data_size]);
+    result.size_in_bytes = buffer_data_size * sizeof(float);
+    result.vertex_count = faces.size() * 3;
+    write_buffer_data(result.data.get());
+    return result;
+}
+
+// --------------------------------------------------------------------------
+
+void Model::write_buffer_data(float* buffer_data) const {
+    // For now, we'll only provide vertices and normals in the buffer data data for triangle faces.
+    // Every float is written in order and none is read back, so buffer_data can be mapped GPU memory.
 
-    int buffer_data_index = 0;
-    for (Face face : faces) {
+    size_t buffer_data_index = 0;
+    for (const Face& face : faces) {
         for (int i = 0; i < 3; i++) {
             int vertex_index = face.vertex_indices[i];
             buffer_data[buffer_data_index++] = vertices[vertex_index].x;
@@ -54,15 +273,145 @@ float* Model::get_buffer_data(int& size_in_bytes, int& vertex_count) {
             buffer_data[buffer_data_index++] = vertices[vertex_index].z;
 
             int normal_index = face.normal_indices[i];
-            buffer_data[buffer_data_index++] = normals[normal_index].x;
-            buffer_data[buffer_data_index++] = normals[normal_index].y;
-            buffer_data[buffer_data_index++] = normals[normal_index].z;
+            glm::vec3 normal = normal_index >= 0 ? normals[normal_index] : compute_face_normal(face);
+            buffer_data[buffer_data_index++] = normal.x;
+            buffer_data[buffer_data_index++] = normal.y;
+            buffer_data[buffer_data_index++] = normal.z;
         }
     }
 
-    size_in_bytes = buffer_data_size * sizeof(float);
-    vertex_count = faces.size() * 3;
-    return buffer_data;
+}
+
+// --------------------------------------------------------------------------
+
+IndexedBufferData Model::get_indexed_buffer_data() {
+    PROFILE_SCOPE("Model::get_indexed_buffer_data");
+
+    // Face corners that share the same (vertex, texture coordinate, normal) indices become one
+    // buffer vertex. The open addressing table stores, per unique buffer vertex, the first
+    // face corner that produced it, so keys are never copied out of the faces.
+    const uint32_t EMPTY_SLOT = UINT32_MAX;
+
+    IndexedBufferData indexed_buffer_data;
+    indexed_buffer_data.indices.resize(faces.size() * 3);
+
+    std::vector<uint32_t> first_corners;
+    first_corners.reserve(vertices.size());
+
+    size_t slot_count = 1024;
+    while (slot_count < vertices.size() * 2) {
+        slot_count *= 2;
+    }
+    std::vector<uint32_t> slots(slot_count, EMPTY_SLOT);
+
+    auto add_corner = [&](size_t corner_index, size_t output_index) {
+        const Face& face = faces[corner_index / 3];
+        int corner = corner_index % 3;
+
+        size_t slot = hash_face_corner(face, corner) & (slot_count - 1);
+        while (slots[slot] != EMPTY_SLOT) {
+            uint32_t first_corner = first_corners[slots[slot]];
+            if (are_face_corners_equal(face, corner, faces[first_corner / 3], first_corner % 3)) {
+                break;
+            }
+            slot = (slot + 1) & (slot_count - 1);
+        }
+
+        if (slots[slot] != EMPTY_SLOT) {
+            indexed_buffer_data.indices[output_index] = slots[slot];
+            return;
+        }
+
+        slots[slot] = first_corners.size();
+        indexed_buffer_data.indices[output_index] = first_corners.size();
+        first_corners.push_back(corner_index);
+
+        // Keep the table at most half full.
+        if (first_corners.size() * 2 > slot_count) {
+            slot_count *= 2;
+            slots.assign(slot_count, EMPTY_SLOT);
+            for (size_t i = 0; i < first_corners.size(); i++) {
+                size_t rehashed_slot = hash_face_corner(faces[first_corners[i] / 3], first_corners[i] % 3) & (slot_count - 1);
+                while (slots[rehashed_slot] != EMPTY_SLOT) {
+                    rehashed_slot = (rehashed_slot + 1) & (slot_count - 1);
+                }
+                slots[rehashed_slot] = i;
+            }
+        }
+    };
+
+    if (material_ranges.empty()) {
+        for (size_t corner_index = 0; corner_index < faces.size() * 3; corner_index++) {
+            add_corner(corner_index, corner_index);
+        }
+    } else {
+        // Gather each material's faces into one submesh, in order of first use, so that a
+        // material is bound once per frame however often the file switches back to it.
+        std::vector<int> submesh_material_indices;
+        for (const MaterialRange& range : material_ranges) {
+            if (std::find(submesh_material_indices.begin(), submesh_material_indices.end(), range.material_index) == submesh_material_indices.end()) {
+                submesh_material_indices.push_back(range.material_index);
+            }
+        }
+
+        size_t output_index = 0;
+        for (int material_index : submesh_material_indices) {
+            Submesh submesh = {material_index, (int)output_index, 0};
+            for (size_t range_index = 0; range_index < material_ranges.size(); range_index++) {
+                if (material_ranges[range_index].material_index != material_index) {
+                    continue;
+                }
+
+                size_t first_face = material_ranges[range_index].first_face;
+                size_t end_face = range_index + 1 < material_ranges.size() ? material_ranges[range_index + 1].first_face : faces.size();
+                for (size_t corner_index = first_face * 3; corner_index < end_face * 3; corner_index++) {
+                    add_corner(corner_index, output_index++);
+                }
+            }
+
+            submesh.index_count = output_index - submesh.first_index;
+            if (submesh.index_count > 0) {
+                indexed_buffer_data.submeshes.push_back(submesh);
+            }
+        }
+    }
+
+    indexed_buffer_data.vertex_count = first_corners.size();
+    indexed_buffer_data.index_size_in_bytes = first_corners.size() <= 65536 ? sizeof(uint16_t) : sizeof(uint32_t);
+
+    indexed_buffer_data.vertex_data.resize(first_corners.size() * FLOATS_PER_BUFFER_VERTEX);
+    float* vertex_data = indexed_buffer_data.vertex_data.data();
+    for (uint32_t first_corner : first_corners) {
+        const Face& face = faces[first_corner / 3];
+        int corner = first_corner % 3;
+
+        glm::vec3 vertex = vertices[face.vertex_indices[corner]];
+        *vertex_data++ = vertex.x;
+        *vertex_data++ = vertex.y;
+        *vertex_data++ = vertex.z;
+
+        glm::vec3 normal = glm::vec3(0.0f, 0.0f, 0.0f);
+        if (face.normal_indices[corner] >= 0) {
+            normal = normals[face.normal_indices[corner]];
+        }
+        *vertex_data++ = normal.x;
+        *vertex_data++ = normal.y;
+        *vertex_data++ = normal.z;
+    }
+
+    // Texture coordinates are only worth their memory when a material can use them.
+    if (!material_ranges.empty() && !texture_coordinates.empty()) {
+        indexed_buffer_data.texture_coordinate_data.resize(first_corners.size() * 2);
+        float* texture_coordinate_data = indexed_buffer_data.texture_coordinate_data.data();
+        for (uint32_t first_corner : first_corners) {
+            int texture_coordinate_index = faces[first_corner / 3].texture_coordinate_indices[first_corner % 3];
+            glm::vec2 texture_coordinate = texture_coordinate_index >= 0 ? texture_coordinates[texture_coordinate_index] : glm::vec2(0.0f, 0.0f);
+            *texture_coordinate_data++ = texture_coordinate.x;
+            *texture_coordinate_data++ = texture_coordinate.y;
+        }
+    }
+
+    return indexed_buffer_data;
 }
 
 // --------------------------------------------------------------------------
@@ -74,11 +423,71 @@ ModelStatistics Model::get_statistics() {
     statistics.texture_coordinate_count = texture_coordinates.size();
     statistics.face_count = faces.size();
 
+    statistics.indexed_vertex_count = 0;
+    statistics.index_size_in_bytes = 0;
+    statistics.deduplication_ratio = 1.0f;
+    statistics.indexing_bytes_saved = 0;
+
+    statistics.model_size_in_bytes = vertices.capacity() * sizeof(glm::vec3) + normals.capacity() * sizeof(glm::vec3)
+        + texture_coordinates.capacity() * sizeof(glm::vec2) + faces.capacity() * sizeof(Face);
+    statistics.buffer_data_size_in_bytes = 0;
+
+    return statistics;
+}
+
+// --------------------------------------------------------------------------
+
+ModelStatistics Model::get_statistics(const IndexedBufferData& indexed_buffer_data) {
+    ModelStatistics statistics = get_statistics();
+
+    long long corner_count = faces.size() * 3;
+    long long unindexed_size_in_bytes = corner_count * FLOATS_PER_BUFFER_VERTEX * sizeof(float);
+    long long indexed_size_in_bytes = (long long)indexed_buffer_data.vertex_count * FLOATS_PER_BUFFER_VERTEX * sizeof(float)
+        + corner_count * indexed_buffer_data.index_size_in_bytes;
+
+    statistics.indexed_vertex_count = indexed_buffer_data.vertex_count;
+    statistics.index_size_in_bytes = indexed_buffer_data.index_size_in_bytes;
+    if (indexed_buffer_data.vertex_count > 0) {
+        statistics.deduplication_ratio = (float)corner_count / indexed_buffer_data.vertex_count;
+    }
+    statistics.indexing_bytes_saved = unindexed_size_in_bytes - indexed_size_in_bytes;
+
+    statistics.buffer_data_size_in_bytes = indexed_buffer_data.vertex_data.capacity() * sizeof(float) + indexed_buffer_data.indices.capacity() * sizeof(uint32_t)
+        + indexed_buffer_data.texture_coordinate_data.capacity() * sizeof(float);
+
     return statistics;
 }
 
 // --------------------------------------------------------------------------
 
+uint32_t Model::hash_face_corner(const Face& face, int corner) {
+    uint32_t hash = face.vertex_indices[corner] * 0x9E3779B1u;
+    hash ^= (face.texture_coordinate_indices[corner] + 0x7F4A7C15u) * 0x85EBCA77u;
+    hash ^= (face.normal_indices[corner] + 0x165667B1u) * 0xC2B2AE3Du;
+    return hash ^ (hash >> 15);
+}
+
+// --------------------------------------------------------------------------
+
+bool Model::are_face_corners_equal(const Face& face, int corner, const Face& other_face, int other_corner) {
+    return face.vertex_indices[corner] == other_face.vertex_indices[other_corner]
+        && face.texture_coordinate_indices[corner] == other_face.texture_coordinate_indices[other_corner]
+        && face.normal_indices[corner] == other_face.normal_indices[other_corner];
+}
+
+// --------------------------------------------------------------------------
+
+glm::vec3 Model::compute_face_normal(const Face& face) const {
+    glm::vec3 first_edge = vertices[face.vertex_indices[1]] - vertices[face.vertex_indices[0]];
+    glm::vec3 second_edge = vertices[face.vertex_indices[2]] - vertices[face.vertex_indices[0]];
+    glm::vec3 normal = glm::cross(first_edge, second_edge);
+
+    float length = glm::length(normal);
+    return length > 0.0f ? normal / length : glm::vec3(0.0f, 0.0f, 0.0f);
+}
+
+// --------------------------------------------------------------------------
+
 ModelExtents Model::get_extents() {
     const float MIN_FLOAT_VALUE = std::numeric_limits<float>::min();
     const float MAX_FLOAT_VALUE = std::numeric_limits<float>::max();
@@ -2,15 +2,82 @@
 #define MODEL_H
 
 #include <vector>
+#include <string>
+#include <memory>
+#include <cstdint>
 #include <glm/glm.hpp>
 
 #include "Face.h"
+#include "MemoryArena.h"
+
+// Model storage, which comes from a MemoryArena when the model is given one.
+template <typename T>
+using ModelArray = std::vector<T, ArenaAllocator<T>>;
+
+// Buffer data storage, counted as the buffer data's memory.
+template <typename T>
+using BufferArray = std::vector<T, TrackedAllocator<T, MemorySubsystem::BUFFER_DATA>>;
 
 struct ModelStatistics {
     int vertex_count;
     int normal_count;
     int texture_coordinate_count;
     int face_count;
+
+    int indexed_vertex_count;
+    int index_size_in_bytes;
+    float deduplication_ratio;
+    long long indexing_bytes_saved;
+
+    // Bytes held by the model's arrays and by the buffer data, including spare capacity.
+    long long model_size_in_bytes;
+    long long buffer_data_size_in_bytes;
+};
+
+struct BufferData {
+    std::unique_ptr<float[]> data;
+    size_t size_in_bytes;
+    size_t vertex_count;
+};
+
+// Faces from first_face up to the next range's first face use one material. Faces given
+// before any usemtl line have material index -1.
+struct MaterialRange {
+    int material_index;
+    int first_face;
+};
+
+// A run of indices drawn with one material.
+struct Submesh {
+    int material_index;
+    int first_index;
+    int index_count;
+};
+
+struct IndexedBufferData {
+    BufferArray<float> vertex_data;
+    BufferArray<uint32_t> indices;
+    int vertex_count;
+    int index_size_in_bytes;
+
+    // Only models with materials get these. Texture coordinates are two floats per vertex,
+    // and each submesh's triangles are contiguous in the indices.
+    BufferArray<float> texture_coordinate_data;
+    std::vector<Submesh> submeshes;
+};
+
+// Buffer data that's only read, laid out like IndexedBufferData. It points either into an
+// IndexedBufferData or straight into a mapped model cache, and doesn't own what it points at.
+struct BufferDataView {
+    const float* vertex_data;
+    const uint32_t* indices;
+    const float* texture_coordinate_data;
+    const Submesh* submeshes;
+    int vertex_count;
+    size_t index_count;
+    size_t texture_coordinate_float_count;
+    size_t submesh_count;
+    int index_size_in_bytes;
 };
 
 struct ModelExtents {
@@ -22,24 +89,65 @@ class Model {
 
 public:
 
-    Model();
+    static const int FLOATS_PER_BUFFER_VERTEX = 6;
+
+    Model(MemoryArena* arena = nullptr);
+    Model(ModelArray<glm::vec3> vertices, ModelArray<glm::vec3> normals, ModelArray<glm::vec2> texture_coordinates, ModelArray<Face> faces);
     ~Model();
 
+    // Models hold our largest data, so they can only be moved.
+    Model(const Model&) = delete;
+    Model& operator=(const Model&) = delete;
+    Model(Model&&) = default;
+    Model& operator=(Model&&) = default;
+
     void add_vertex(glm::vec3& vertex);
     void add_normal(glm::vec3& normal);
     void add_texture_coordinate(glm::vec2& texture_coordinate);
     void add_face(Face& face);
+    void add_material_library(const std::string& file_path);
+    void use_material(const std::string& material_name);
+    void set_materials(std::vector<std::string> material_library_paths, std::vector<std::string> material_names, std::vector<MaterialRange> material_ranges);
 
-    float* get_buffer_data(int& size_in_bytes, int& vertex_count);
+    void clear_faces();
+    void replace_normals(ModelArray<glm::vec3> normals, const std::vector<int>& corner_normal_indices);
+    void reserve(const ModelStatistics& expected_counts);
+    void append(Model&& other);
+
+    const ModelArray<glm::vec3>& get_vertices() const;
+    const ModelArray<glm::vec3>& get_normals() const;
+    const ModelArray<glm::vec2>& get_texture_coordinates() const;
+    const ModelArray<Face>& get_faces() const;
+    const std::vector<std::string>& get_material_library_paths() const;
+    const std::vector<std::string>& get_material_names() const;
+    const std::vector<MaterialRange>& get_material_ranges() const;
+    bool has_missing_normals() const;
+
+    BufferData get_buffer_data() const;
+    void write_buffer_data(float* buffer_data) const;
+    IndexedBufferData get_indexed_buffer_data();
     ModelStatistics get_statistics();
+    ModelStatistics get_statistics(const IndexedBufferData& indexed_buffer_data);
     ModelExtents get_extents();
 
 private:
 
-    std::vector<glm::vec3> vertices;
-    std::vector<glm::vec3> normals;
-    std::vector<glm::vec2> texture_coordinates;
-    std::vector<Face> faces;
+    glm::vec3 compute_face_normal(const Face& face) const;
+
+    static uint32_t hash_face_corner(const Face& face, int corner);
+    static bool are_face_corners_equal(const Face& face, int corner, const Face& other_face, int other_corner);
+
+    template <typename T>
+    static void move_array(ModelArray<T>& destination, ModelArray<T>& source);
+
+    ModelArray<glm::vec3> vertices;
+    ModelArray<glm::vec3> normals;
+    ModelArray<glm::vec2> texture_coordinates;
+    ModelArray<Face> faces;
+
+    std::vector<std::string> material_library_paths;
+    std::vector<std::string> material_names;
+    std::vector<MaterialRange> material_ranges;
 };
 
 #endif
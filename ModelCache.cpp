@@ -0,0 +1,522 @@
+#include "ModelCache.h"
+
+#include <cstring>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <climits>
+#include <cerrno>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <vector>
+#include <string_view>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "ContentHash.h"
+#include "Profiler.h"
+
+static const char CACHE_MAGIC[8] = {'O', 'B', 'J', 'V', 'C', 'A', 'C', 'H'};
+static const char* CACHE_FILE_EXTENSION = ".objcache";
+
+static uint64_t align_offset(uint64_t offset, uint64_t alignment) {
+    return (offset + alignment - 1) / alignment * alignment;
+}
+
+// --------------------------------------------------------------------------
+
+ModelCache::ModelCache()
+:
+indexed_vertex_data(nullptr),
+indices(nullptr),
+indexed_texture_coordinate_data(nullptr),
+submeshes(nullptr) {
+    // The viewer's defaults.
+    processing_settings.generate_normals = false;
+    processing_settings.normal_type = NormalType::SMOOTH;
+    processing_settings.normal_weighting = NormalWeighting::ANGLE;
+    processing_settings.crease_angle_degrees = 180.0f;
+    processing_settings.optimize_mesh = false;
+    processing_settings.optimize_overdraw = false;
+}
+
+// --------------------------------------------------------------------------
+
+ModelCache::~ModelCache() {
+    // do nothing for now
+}
+
+// --------------------------------------------------------------------------
+
+void ModelCache::set_cache_directory(const std::string& cache_directory) {
+    // An empty directory keeps cache files next to their OBJ files.
+    this->cache_directory = cache_directory;
+}
+
+// --------------------------------------------------------------------------
+
+void ModelCache::set_processing_settings(const CacheProcessingSettings& processing_settings) {
+    this->processing_settings = processing_settings;
+}
+
+// --------------------------------------------------------------------------
+
+std::optional<Model> ModelCache::load(const std::string& source_file_path) {
+    PROFILE_SCOPE("ModelCache::load");
+
+    close();
+
+    SourceFileInfo source_file_info;
+    if (!get_source_file_info(source_file_path, source_file_info)) {
+        return std::nullopt;
+    }
+
+    std::string cache_file_path = get_cache_file_path(source_file_info);
+    if (!cache_file.open(cache_file_path)) {
+        return std::nullopt;
+    }
+
+    Header header;
+    if (cache_file.get_size() < sizeof(Header)) {
+        std::cerr << "[WARN] Model cache \"" << cache_file_path << "\" is corrupt and will be rebuilt" << std::endl;
+        cache_file.close();
+        return std::nullopt;
+    }
+    std::memcpy(&header, cache_file.get_data(), sizeof(Header));
+
+    if (!is_header_valid(header, cache_file.get_size())) {
+        std::cerr << "[WARN] Model cache \"" << cache_file_path << "\" is corrupt and will be rebuilt" << std::endl;
+        cache_file.close();
+        return std::nullopt;
+    }
+
+    SectionOffsets offsets = compute_section_offsets(header);
+    const char* cache_data = cache_file.get_data();
+
+    std::string_view cached_source_path(cache_data + offsets.source_path, header.source_path_length);
+    if (cached_source_path != source_file_info.absolute_path || header.source_size != source_file_info.size) {
+        std::cerr << "[WARN] Model cache \"" << cache_file_path << "\" is stale and will be rebuilt" << std::endl;
+        cache_file.close();
+        return std::nullopt;
+    }
+
+    // A changed modification time alone (a touch, a fresh checkout) doesn't make the
+    // cache stale: fall back to comparing content hashes before throwing it away.
+    if (header.source_modification_time != source_file_info.modification_time) {
+        uint64_t source_content_hash;
+        if (!compute_source_content_hash(source_file_path, source_content_hash) || source_content_hash != header.source_content_hash) {
+            std::cerr << "[WARN] Model cache \"" << cache_file_path << "\" is stale and will be rebuilt" << std::endl;
+            cache_file.close();
+            return std::nullopt;
+        }
+
+        refresh_source_modification_time(cache_file_path, header, source_file_info.modification_time);
+    }
+
+    if (header.processing_hash != compute_processing_hash()) {
+        std::cerr << "[WARN] Model cache \"" << cache_file_path << "\" was made with other normal or optimization settings and will be rebuilt" << std::endl;
+        cache_file.close();
+        return std::nullopt;
+    }
+
+    Section sections[SECTION_COUNT] = {
+        {cache_data + offsets.source_path, offsets.source_path, header.source_path_length},
+        {cache_data + offsets.vertices, offsets.vertices, header.vertex_count * sizeof(glm::vec3)},
+        {cache_data + offsets.normals, offsets.normals, header.normal_count * sizeof(glm::vec3)},
+        {cache_data + offsets.texture_coordinates, offsets.texture_coordinates, header.texture_coordinate_count * sizeof(glm::vec2)},
+        {cache_data + offsets.faces, offsets.faces, header.face_count * sizeof(Face)},
+        {cache_data + offsets.indexed_vertex_data, offsets.indexed_vertex_data, header.indexed_vertex_count * Model::FLOATS_PER_BUFFER_VERTEX * sizeof(float)},
+        {cache_data + offsets.indices, offsets.indices, header.index_count * sizeof(uint32_t)},
+        {cache_data + offsets.material_strings, offsets.material_strings, header.material_string_size},
+        {cache_data + offsets.material_ranges, offsets.material_ranges, header.material_range_count * sizeof(MaterialRange)},
+        {cache_data + offsets.indexed_texture_coordinate_data, offsets.indexed_texture_coordinate_data, header.indexed_texture_coordinate_count * 2 * sizeof(float)},
+        {cache_data + offsets.submeshes, offsets.submeshes, header.submesh_count * sizeof(Submesh)}
+    };
+
+    if (compute_payload_hash(sections) != header.payload_hash) {
+        std::cerr << "[WARN] Model cache \"" << cache_file_path << "\" is corrupt and will be rebuilt" << std::endl;
+        cache_file.close();
+        return std::nullopt;
+    }
+
+    const glm::vec3* vertices = reinterpret_cast<const glm::vec3*>(cache_data + offsets.vertices);
+    const glm::vec3* normals = reinterpret_cast<const glm::vec3*>(cache_data + offsets.normals);
+    const glm::vec2* texture_coordinates = reinterpret_cast<const glm::vec2*>(cache_data + offsets.texture_coordinates);
+    const Face* faces = reinterpret_cast<const Face*>(cache_data + offsets.faces);
+    const MaterialRange* material_ranges = reinterpret_cast<const MaterialRange*>(cache_data + offsets.material_ranges);
+
+    std::vector<std::string> material_library_paths;
+    std::vector<std::string> material_names;
+    if (!unpack_material_strings(cache_data + offsets.material_strings, header, material_library_paths, material_names)) {
+        std::cerr << "[WARN] Model cache \"" << cache_file_path << "\" is corrupt and will be rebuilt" << std::endl;
+        cache_file.close();
+        return std::nullopt;
+    }
+
+    if (header.index_count > 0) {
+        indexed_vertex_data = reinterpret_cast<const float*>(cache_data + offsets.indexed_vertex_data);
+        indices = reinterpret_cast<const uint32_t*>(cache_data + offsets.indices);
+        indexed_texture_coordinate_data = reinterpret_cast<const float*>(cache_data + offsets.indexed_texture_coordinate_data);
+        submeshes = reinterpret_cast<const Submesh*>(cache_data + offsets.submeshes);
+        cached_header = header;
+    }
+
+    // The model's arrays are copied out of the mapping, since models are changed after loading.
+    Model model(
+        ModelArray<glm::vec3>(vertices, vertices + header.vertex_count),
+        ModelArray<glm::vec3>(normals, normals + header.normal_count),
+        ModelArray<glm::vec2>(texture_coordinates, texture_coordinates + header.texture_coordinate_count),
+        ModelArray<Face>(faces, faces + header.face_count)
+    );
+    model.set_materials(std::move(material_library_paths), std::move(material_names), std::vector<MaterialRange>(material_ranges, material_ranges + header.material_range_count));
+
+    return model;
+}
+
+// --------------------------------------------------------------------------
+
+bool ModelCache::store(const std::string& source_file_path, const Model& model, const IndexedBufferData* indexed_buffer_data) {
+    PROFILE_SCOPE("ModelCache::store");
+
+    SourceFileInfo source_file_info;
+    if (!get_source_file_info(source_file_path, source_file_info)) {
+        return false;
+    }
+
+    uint64_t source_content_hash;
+    if (!compute_source_content_hash(source_file_path, source_content_hash)) {
+        return false;
+    }
+
+    if (!cache_directory.empty() && mkdir(cache_directory.c_str(), 0755) != 0 && errno != EEXIST) {
+        std::cerr << "[WARN] Could not create model cache directory \"" << cache_directory << "\"" << std::endl;
+        return false;
+    }
+
+    Header header;
+    std::memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    header.version = FORMAT_VERSION;
+    header.byte_order_mark = BYTE_ORDER_MARK;
+    header.source_size = source_file_info.size;
+    header.source_modification_time = source_file_info.modification_time;
+    header.source_content_hash = source_content_hash;
+    header.processing_hash = compute_processing_hash();
+    header.source_path_length = source_file_info.absolute_path.size();
+    header.vertex_count = model.get_vertices().size();
+    header.normal_count = model.get_normals().size();
+    header.texture_coordinate_count = model.get_texture_coordinates().size();
+    header.face_count = model.get_faces().size();
+    header.indexed_vertex_count = 0;
+    header.index_count = 0;
+    header.index_size_in_bytes = 0;
+    header.indexed_texture_coordinate_count = 0;
+    header.submesh_count = 0;
+    if (indexed_buffer_data != nullptr) {
+        header.indexed_vertex_count = indexed_buffer_data->vertex_count;
+        header.index_count = indexed_buffer_data->indices.size();
+        header.index_size_in_bytes = indexed_buffer_data->index_size_in_bytes;
+        header.indexed_texture_coordinate_count = indexed_buffer_data->texture_coordinate_data.size() / 2;
+        header.submesh_count = indexed_buffer_data->submeshes.size();
+    }
+
+    std::string material_strings = pack_material_strings(model);
+    header.material_library_count = model.get_material_library_paths().size();
+    header.material_name_count = model.get_material_names().size();
+    header.material_string_size = material_strings.size();
+    header.material_range_count = model.get_material_ranges().size();
+
+    SectionOffsets offsets = compute_section_offsets(header);
+    header.payload_size = offsets.end - sizeof(Header);
+
+    Section sections[SECTION_COUNT] = {
+        {source_file_info.absolute_path.data(), offsets.source_path, header.source_path_length},
+        {model.get_vertices().data(), offsets.vertices, header.vertex_count * sizeof(glm::vec3)},
+        {model.get_normals().data(), offsets.normals, header.normal_count * sizeof(glm::vec3)},
+        {model.get_texture_coordinates().data(), offsets.texture_coordinates, header.texture_coordinate_count * sizeof(glm::vec2)},
+        {model.get_faces().data(), offsets.faces, header.face_count * sizeof(Face)},
+        {indexed_buffer_data != nullptr ? indexed_buffer_data->vertex_data.data() : nullptr, offsets.indexed_vertex_data, header.indexed_vertex_count * Model::FLOATS_PER_BUFFER_VERTEX * sizeof(float)},
+        {indexed_buffer_data != nullptr ? indexed_buffer_data->indices.data() : nullptr, offsets.indices, header.index_count * sizeof(uint32_t)},
+        {material_strings.data(), offsets.material_strings, header.material_string_size},
+        {model.get_material_ranges().data(), offsets.material_ranges, header.material_range_count * sizeof(MaterialRange)},
+        {indexed_buffer_data != nullptr ? indexed_buffer_data->texture_coordinate_data.data() : nullptr, offsets.indexed_texture_coordinate_data, header.indexed_texture_coordinate_count * 2 * sizeof(float)},
+        {indexed_buffer_data != nullptr ? indexed_buffer_data->submeshes.data() : nullptr, offsets.submeshes, header.submesh_count * sizeof(Submesh)}
+    };
+
+    header.payload_hash = compute_payload_hash(sections);
+    header.header_hash = compute_header_hash(header);
+
+    // Write to a temporary file and rename it into place, so concurrent viewers
+    // never observe a half-written cache.
+    std::string cache_file_path = get_cache_file_path(source_file_info);
+    std::string temporary_file_path = cache_file_path + ".tmp" + std::to_string(getpid());
+    {
+        std::ofstream file(temporary_file_path, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+
+        const char padding[SECTION_ALIGNMENT] = {};
+        uint64_t file_offset = sizeof(Header);
+        for (const Section& section : sections) {
+            file.write(padding, section.offset - file_offset);
+            file.write(static_cast<const char*>(section.data), section.size);
+            file_offset = section.offset + section.size;
+        }
+
+        if (!file) {
+            std::cerr << "[WARN] Could not write model cache \"" << temporary_file_path << "\"" << std::endl;
+            file.close();
+            std::remove(temporary_file_path.c_str());
+            return false;
+        }
+    }
+
+    if (std::rename(temporary_file_path.c_str(), cache_file_path.c_str()) != 0) {
+        std::cerr << "[WARN] Could not write model cache \"" << cache_file_path << "\"" << std::endl;
+        std::remove(temporary_file_path.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+// --------------------------------------------------------------------------
+
+bool ModelCache::has_indexed_buffer_data() const {
+    return indices != nullptr;
+}
+
+// --------------------------------------------------------------------------
+
+IndexedBufferData ModelCache::get_indexed_buffer_data() const {
+    // A copy out of the mapping, for levels of detail and cluster sorting, which rewrite or
+    // extend the buffer data. Buffers that are uploaded as they are use get_buffer_data_view().
+    IndexedBufferData indexed_buffer_data;
+    indexed_buffer_data.vertex_data.assign(indexed_vertex_data, indexed_vertex_data + cached_header.indexed_vertex_count * Model::FLOATS_PER_BUFFER_VERTEX);
+    indexed_buffer_data.indices.assign(indices, indices + cached_header.index_count);
+    indexed_buffer_data.vertex_count = cached_header.indexed_vertex_count;
+    indexed_buffer_data.index_size_in_bytes = cached_header.index_size_in_bytes;
+    indexed_buffer_data.texture_coordinate_data.assign(indexed_texture_coordinate_data, indexed_texture_coordinate_data + cached_header.indexed_texture_coordinate_count * 2);
+    indexed_buffer_data.submeshes.assign(submeshes, submeshes + cached_header.submesh_count);
+
+    return indexed_buffer_data;
+}
+
+// --------------------------------------------------------------------------
+
+BufferDataView ModelCache::get_buffer_data_view() const {
+    // Points straight into the mapped cache file, so nothing is copied before the upload. The
+    // view is valid until close() or the next load().
+    BufferDataView buffer_data_view;
+    buffer_data_view.vertex_data = indexed_vertex_data;
+    buffer_data_view.indices = indices;
+    buffer_data_view.texture_coordinate_data = indexed_texture_coordinate_data;
+    buffer_data_view.submeshes = submeshes;
+    buffer_data_view.vertex_count = cached_header.indexed_vertex_count;
+    buffer_data_view.index_count = cached_header.index_count;
+    buffer_data_view.texture_coordinate_float_count = cached_header.indexed_texture_coordinate_count * 2;
+    buffer_data_view.submesh_count = cached_header.submesh_count;
+    buffer_data_view.index_size_in_bytes = cached_header.index_size_in_bytes;
+    return buffer_data_view;
+}
+
+// --------------------------------------------------------------------------
+
+void ModelCache::close() {
+    // Unmaps the cache file once its buffers have been uploaded.
+    cache_file.close();
+    indexed_vertex_data = nullptr;
+    indices = nullptr;
+    indexed_texture_coordinate_data = nullptr;
+    submeshes = nullptr;
+}
+
+// --------------------------------------------------------------------------
+
+std::string ModelCache::get_cache_file_path(const SourceFileInfo& source_file_info) {
+    if (cache_directory.empty()) {
+        return source_file_info.absolute_path + CACHE_FILE_EXTENSION;
+    }
+
+    // Files from different directories can share a name, so the shared cache
+    // directory also keys on a hash of the full path.
+    std::string file_name = source_file_info.absolute_path;
+    size_t last_slash_index = file_name.find_last_of('/');
+    if (last_slash_index != std::string::npos) {
+        file_name = file_name.substr(last_slash_index + 1);
+    }
+
+    uint64_t path_hash = compute_content_hash(source_file_info.absolute_path.data(), source_file_info.absolute_path.size());
+
+    std::ostringstream cache_file_path;
+    cache_file_path << cache_directory << "/" << file_name << "-" << std::hex << std::setw(16) << std::setfill('0') << path_hash << CACHE_FILE_EXTENSION;
+    return cache_file_path.str();
+}
+
+// --------------------------------------------------------------------------
+
+bool ModelCache::get_source_file_info(const std::string& source_file_path, SourceFileInfo& source_file_info) {
+    struct stat file_status;
+    if (stat(source_file_path.c_str(), &file_status) != 0) {
+        return false;
+    }
+
+    char absolute_path[PATH_MAX];
+    if (realpath(source_file_path.c_str(), absolute_path) != nullptr) {
+        source_file_info.absolute_path = absolute_path;
+    } else {
+        source_file_info.absolute_path = source_file_path;
+    }
+
+    source_file_info.size = file_status.st_size;
+#if defined(__APPLE__)
+    source_file_info.modification_time = file_status.st_mtimespec.tv_sec * 1000000000LL + file_status.st_mtimespec.tv_nsec;
+#else
+    source_file_info.modification_time = file_status.st_mtim.tv_sec * 1000000000LL + file_status.st_mtim.tv_nsec;
+#endif
+
+    return true;
+}
+
+// --------------------------------------------------------------------------
+
+bool ModelCache::compute_source_content_hash(const std::string& source_file_path, uint64_t& content_hash) {
+    MappedFile source_file;
+    if (!source_file.open(source_file_path)) {
+        return false;
+    }
+
+    content_hash = compute_content_hash(source_file.get_data(), source_file.get_size());
+    return true;
+}
+
+// --------------------------------------------------------------------------
+
+uint64_t ModelCache::compute_processing_hash() const {
+    // Hashed field by field, since the struct's padding bytes aren't guaranteed to be zero.
+    std::string settings_text = std::to_string(processing_settings.generate_normals) + " " + std::to_string((int)processing_settings.normal_type)
+        + " " + std::to_string((int)processing_settings.normal_weighting) + " " + std::to_string(processing_settings.crease_angle_degrees)
+        + " " + std::to_string(processing_settings.optimize_mesh) + " " + std::to_string(processing_settings.optimize_overdraw);
+    return compute_content_hash(settings_text.data(), settings_text.size());
+}
+
+// --------------------------------------------------------------------------
+
+std::string ModelCache::pack_material_strings(const Model& model) {
+    // Library paths and then material names, each ending in a NUL.
+    std::string material_strings;
+    for (const std::string& material_library_path : model.get_material_library_paths()) {
+        material_strings.append(material_library_path.c_str(), material_library_path.size() + 1);
+    }
+    for (const std::string& material_name : model.get_material_names()) {
+        material_strings.append(material_name.c_str(), material_name.size() + 1);
+    }
+
+    return material_strings;
+}
+
+// --------------------------------------------------------------------------
+
+bool ModelCache::unpack_material_strings(const char* data, const Header& header, std::vector<std::string>& material_library_paths, std::vector<std::string>& material_names) {
+    const char* end = data + header.material_string_size;
+    uint64_t string_count = header.material_library_count + header.material_name_count;
+    for (uint64_t i = 0; i < string_count; i++) {
+        const char* string_end = static_cast<const char*>(std::memchr(data, '\0', end - data));
+        if (string_end == nullptr) {
+            return false;
+        }
+
+        (i < header.material_library_count ? material_library_paths : material_names).emplace_back(data, string_end);
+        data = string_end + 1;
+    }
+
+    return data == end;
+}
+
+// --------------------------------------------------------------------------
+
+ModelCache::SectionOffsets ModelCache::compute_section_offsets(const Header& header) {
+    SectionOffsets offsets;
+    offsets.source_path = sizeof(Header);
+    offsets.vertices = align_offset(offsets.source_path + header.source_path_length, SECTION_ALIGNMENT);
+    offsets.normals = align_offset(offsets.vertices + header.vertex_count * sizeof(glm::vec3), SECTION_ALIGNMENT);
+    offsets.texture_coordinates = align_offset(offsets.normals + header.normal_count * sizeof(glm::vec3), SECTION_ALIGNMENT);
+    offsets.faces = align_offset(offsets.texture_coordinates + header.texture_coordinate_count * sizeof(glm::vec2), SECTION_ALIGNMENT);
+    offsets.indexed_vertex_data = align_offset(offsets.faces + header.face_count * sizeof(Face), SECTION_ALIGNMENT);
+    offsets.indices = align_offset(offsets.indexed_vertex_data + header.indexed_vertex_count * Model::FLOATS_PER_BUFFER_VERTEX * sizeof(float), SECTION_ALIGNMENT);
+    offsets.material_strings = align_offset(offsets.indices + header.index_count * sizeof(uint32_t), SECTION_ALIGNMENT);
+    offsets.material_ranges = align_offset(offsets.material_strings + header.material_string_size, SECTION_ALIGNMENT);
+    offsets.indexed_texture_coordinate_data = align_offset(offsets.material_ranges + header.material_range_count * sizeof(MaterialRange), SECTION_ALIGNMENT);
+    offsets.submeshes = align_offset(offsets.indexed_texture_coordinate_data + header.indexed_texture_coordinate_count * 2 * sizeof(float), SECTION_ALIGNMENT);
+    offsets.end = offsets.submeshes + header.submesh_count * sizeof(Submesh);
+
+    return offsets;
+}
+
+// --------------------------------------------------------------------------
+
+uint64_t ModelCache::compute_payload_hash(const Section* sections) {
+    // Sections are hashed separately, so storing doesn't need one contiguous copy of the payload.
+    uint64_t section_hashes[SECTION_COUNT];
+    for (int i = 0; i < SECTION_COUNT; i++) {
+        section_hashes[i] = compute_content_hash(sections[i].data, sections[i].size);
+    }
+
+    return compute_content_hash(section_hashes, sizeof(section_hashes));
+}
+
+// --------------------------------------------------------------------------
+
+uint64_t ModelCache::compute_header_hash(const Header& header) {
+    return compute_content_hash(&header, offsetof(Header, header_hash));
+}
+
+// --------------------------------------------------------------------------
+
+bool ModelCache::is_header_valid(const Header& header, uint64_t cache_file_size) {
+    if (std::memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0
+            || header.version != FORMAT_VERSION
+            || header.byte_order_mark != BYTE_ORDER_MARK
+            || header.header_hash != compute_header_hash(header)) {
+        return false;
+    }
+
+    // Counts come from the file, so bound them before computing offsets from them.
+    const uint64_t MAX_ELEMENT_COUNT = cache_file_size / sizeof(glm::vec2);
+    if (header.source_path_length > cache_file_size
+            || header.vertex_count > MAX_ELEMENT_COUNT
+            || header.normal_count > MAX_ELEMENT_COUNT
+            || header.texture_coordinate_count > MAX_ELEMENT_COUNT
+            || header.face_count > MAX_ELEMENT_COUNT
+            || header.indexed_vertex_count > MAX_ELEMENT_COUNT
+            || header.index_count > MAX_ELEMENT_COUNT
+            || header.material_library_count > cache_file_size
+            || header.material_name_count > cache_file_size
+            || header.material_string_size > cache_file_size
+            || header.material_range_count > MAX_ELEMENT_COUNT
+            || header.indexed_texture_coordinate_count > MAX_ELEMENT_COUNT
+            || header.submesh_count > MAX_ELEMENT_COUNT) {
+        return false;
+    }
+
+    SectionOffsets offsets = compute_section_offsets(header);
+    return offsets.end == cache_file_size && header.payload_size == cache_file_size - sizeof(Header);
+}
+
+// --------------------------------------------------------------------------
+
+void ModelCache::refresh_source_modification_time(const std::string& cache_file_path, Header header, int64_t source_modification_time) {
+    header.source_modification_time = source_modification_time;
+    header.header_hash = compute_header_hash(header);
+
+    // Best effort: if this fails, the next launch just hashes the source again.
+    int file_descriptor = open(cache_file_path.c_str(), O_WRONLY);
+    if (file_descriptor < 0) {
+        return;
+    }
+
+    ssize_t written_size = pwrite(file_descriptor, &header, sizeof(Header), 0);
+    (void)written_size;
+    ::close(file_descriptor);
+}
@@ -0,0 +1,133 @@
+#ifndef MODEL_CACHE_H
+#define MODEL_CACHE_H
+
+#include <optional>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "Model.h"
+#include "MappedFile.h"
+#include "NormalGenerator.h"
+
+// How a model was processed after parsing. The cache holds the processed model and buffer
+// data, so a cache made with other settings is rebuilt instead of being shown as if these
+// had been applied.
+struct CacheProcessingSettings {
+    bool generate_normals;
+    NormalType normal_type;
+    NormalWeighting normal_weighting;
+    float crease_angle_degrees;
+    bool optimize_mesh;
+    bool optimize_overdraw;
+};
+
+class ModelCache {
+
+public:
+
+    ModelCache();
+    ~ModelCache();
+
+    void set_cache_directory(const std::string& cache_directory);
+    void set_processing_settings(const CacheProcessingSettings& processing_settings);
+
+    std::optional<Model> load(const std::string& source_file_path);
+    bool store(const std::string& source_file_path, const Model& model, const IndexedBufferData* indexed_buffer_data);
+
+    bool has_indexed_buffer_data() const;
+    IndexedBufferData get_indexed_buffer_data() const;
+    BufferDataView get_buffer_data_view() const;
+
+    void close();
+
+private:
+
+    static const uint64_t FORMAT_VERSION = 4;
+    static const uint64_t BYTE_ORDER_MARK = 0x0102030405060708ULL;
+    static const uint64_t SECTION_ALIGNMENT = 16;
+
+    struct Header {
+        char magic[8];
+        uint64_t version;
+        uint64_t byte_order_mark;
+        uint64_t source_size;
+        int64_t source_modification_time;
+        uint64_t source_content_hash;
+        uint64_t processing_hash;
+        uint64_t source_path_length;
+        uint64_t vertex_count;
+        uint64_t normal_count;
+        uint64_t texture_coordinate_count;
+        uint64_t face_count;
+        uint64_t indexed_vertex_count;
+        uint64_t index_count;
+        uint64_t index_size_in_bytes;
+        uint64_t material_library_count;
+        uint64_t material_name_count;
+        uint64_t material_string_size;
+        uint64_t material_range_count;
+        uint64_t indexed_texture_coordinate_count;
+        uint64_t submesh_count;
+        uint64_t payload_size;
+        uint64_t payload_hash;
+        uint64_t header_hash;
+    };
+
+    struct SectionOffsets {
+        uint64_t source_path;
+        uint64_t vertices;
+        uint64_t normals;
+        uint64_t texture_coordinates;
+        uint64_t faces;
+        uint64_t indexed_vertex_data;
+        uint64_t indices;
+        uint64_t material_strings;
+        uint64_t material_ranges;
+        uint64_t indexed_texture_coordinate_data;
+        uint64_t submeshes;
+        uint64_t end;
+    };
+
+    struct Section {
+        const void* data;
+        uint64_t offset;
+        uint64_t size;
+    };
+
+    static const int SECTION_COUNT = 11;
+
+    struct SourceFileInfo {
+        std::string absolute_path;
+        uint64_t size;
+        int64_t modification_time;
+    };
+
+    std::string cache_directory;
+    CacheProcessingSettings processing_settings;
+
+    MappedFile cache_file;
+    const float* indexed_vertex_data;
+    const uint32_t* indices;
+    const float* indexed_texture_coordinate_data;
+    const Submesh* submeshes;
+    Header cached_header;
+
+    std::string get_cache_file_path(const SourceFileInfo& source_file_info);
+    bool get_source_file_info(const std::string& source_file_path, SourceFileInfo& source_file_info);
+    bool compute_source_content_hash(const std::string& source_file_path, uint64_t& content_hash);
+
+    uint64_t compute_processing_hash() const;
+
+    static std::string pack_material_strings(const Model& model);
+    static bool unpack_material_strings(const char* data, const Header& header, std::vector<std::string>& material_library_paths, std::vector<std::string>& material_names);
+
+    SectionOffsets compute_section_offsets(const Header& header);
+    uint64_t compute_payload_hash(const Section* sections);
+    uint64_t compute_header_hash(const Header& header);
+    bool is_header_valid(const Header& header, uint64_t cache_file_size);
+
+    void refresh_source_modification_time(const std::string& cache_file_path, Header header, int64_t source_modification_time);
+};
+
+#endif
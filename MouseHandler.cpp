@@ -35,3 +35,24 @@ glm::vec2 MouseHandler::handle_mouse_motion(float relative_x, float relative_y)
 
     return mouse_drag_motion;
 };
+
+// --------------------------------------------------------------------------
+
+Ray MouseHandler::create_picking_ray(float window_x, float window_y, const glm::mat4& model_view_projection) const {
+    // Unprojects the cursor onto the near and far planes, giving a ray in the model's own space.
+    int window_width, window_height;
+    SDL_GetWindowSize(window, &window_width, &window_height);
+
+    float ndc_x = 2.0f * window_x / window_width - 1.0f;
+    float ndc_y = 1.0f - 2.0f * window_y / window_height;
+
+    glm::mat4 inverse_model_view_projection = glm::inverse(model_view_projection);
+    glm::vec4 near_point = inverse_model_view_projection * glm::vec4(ndc_x, ndc_y, -1.0f, 1.0f);
+    glm::vec4 far_point = inverse_model_view_projection * glm::vec4(ndc_x, ndc_y, 1.0f, 1.0f);
+
+    Ray ray;
+    ray.origin = glm::vec3(near_point) / near_point.w;
+    ray.direction = glm::normalize(glm::vec3(far_point) / far_point.w - ray.origin);
+
+    return ray;
+}
@@ -5,6 +5,8 @@
 
 #include <glm/glm.hpp>
 
+#include "BoundingVolumeHierarchy.h"
+
 class MouseHandler {
 
 public:
@@ -15,6 +17,8 @@ public:
     void handle_left_button_status(bool is_button_down);
     glm::vec2 handle_mouse_motion(float relative_x, float relative_y);
 
+    Ray create_picking_ray(float window_x, float window_y, const glm::mat4& model_view_projection) const;
+
 private:
 
     SDL_Window* window;
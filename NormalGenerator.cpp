@@ -0,0 +1,312 @@
+#include "NormalGenerator.h"
+
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+#include "Simd.h"
+#include "ThreadPool.h"
+
+NormalGenerator::NormalGenerator()
+:
+thread_count(1),
+weighting(NormalWeighting::ANGLE),
+crease_angle_degrees(180.0f) {
+    // do nothing for now
+}
+
+// --------------------------------------------------------------------------
+
+NormalGenerator::~NormalGenerator() {
+    // do nothing for now
+}
+
+// --------------------------------------------------------------------------
+
+void NormalGenerator::set_thread_count(int thread_count) {
+    this->thread_count = thread_count > 0 ? thread_count : ThreadPool::get_hardware_thread_count();
+}
+
+// --------------------------------------------------------------------------
+
+void NormalGenerator::set_weighting(NormalWeighting weighting) {
+    this->weighting = weighting;
+}
+
+// --------------------------------------------------------------------------
+
+void NormalGenerator::set_crease_angle(float crease_angle_degrees) {
+    // Faces meeting at more than the crease angle don't share normals; 180 degrees or more
+    // smooths across every edge.
+    this->crease_angle_degrees = crease_angle_degrees;
+}
+
+// --------------------------------------------------------------------------
+
+void NormalGenerator::generate(Model& model, NormalType type) {
+    std::vector<glm::vec3> face_normals;
+    std::vector<float> corner_weights;
+    compute_face_normals(model, face_normals, corner_weights);
+
+    if (type == NormalType::FLAT) {
+        generate_flat_normals(model, face_normals);
+    } else {
+        generate_smooth_normals(model, face_normals, corner_weights);
+    }
+}
+
+// --------------------------------------------------------------------------
+
+void NormalGenerator::compute_face_normals(const Model& model, std::vector<glm::vec3>& face_normals, std::vector<float>& corner_weights) {
+    // Works on four faces at a time, one face per SIMD lane. Degenerate faces get a zero
+    // normal and zero weights, so they never contribute to smooth normals.
+    const ModelArray<glm::vec3>& vertices = model.get_vertices();
+    const ModelArray<Face>& faces = model.get_faces();
+    int face_count = faces.size();
+
+    face_normals.resize(face_count);
+    corner_weights.resize(face_count * 3);
+
+    ThreadPool thread_pool(thread_count);
+    int task_count = (face_count + FACES_PER_TASK - 1) / FACES_PER_TASK;
+    thread_pool.parallel_for(task_count, [&](int task_index) {
+        int task_begin = task_index * FACES_PER_TASK;
+        int task_end = std::min(task_begin + FACES_PER_TASK, face_count);
+
+        Float4 tiny = float4_splat(std::numeric_limits<float>::min());
+        Float4 zero = float4_splat(0.0f);
+
+        for (int first_face = task_begin; first_face < task_end; first_face += 4) {
+            int lane_count = std::min(4, task_end - first_face);
+
+            float lane_positions[3][3][4];
+            for (int lane = 0; lane < 4; lane++) {
+                const Face& face = faces[first_face + std::min(lane, lane_count - 1)];
+                for (int corner = 0; corner < 3; corner++) {
+                    const glm::vec3& position = vertices[face.vertex_indices[corner]];
+                    for (int axis = 0; axis < 3; axis++) {
+                        lane_positions[corner][axis][lane] = position[axis];
+                    }
+                }
+            }
+
+            Float4 edges[3][3];
+            for (int corner = 0; corner < 3; corner++) {
+                for (int axis = 0; axis < 3; axis++) {
+                    edges[corner][axis] = float4_load(lane_positions[(corner + 1) % 3][axis]) - float4_load(lane_positions[corner][axis]);
+                }
+            }
+
+            // (p1 - p0) x (p2 - p0), written with the last edge (p0 - p2) as last x first.
+            Float4 cross[3];
+            cross[0] = edges[2][1] * edges[0][2] - edges[2][2] * edges[0][1];
+            cross[1] = edges[2][2] * edges[0][0] - edges[2][0] * edges[0][2];
+            cross[2] = edges[2][0] * edges[0][1] - edges[2][1] * edges[0][0];
+
+            Float4 length = float4_sqrt(float4_dot3(cross[0], cross[1], cross[2], cross[0], cross[1], cross[2]));
+            Mask4 is_valid = float4_greater(length, tiny);
+            Float4 inverse_length = float4_splat(1.0f) / float4_max(length, tiny);
+
+            float normal_components[3][4];
+            for (int axis = 0; axis < 3; axis++) {
+                float4_store(normal_components[axis], float4_select(is_valid, cross[axis] * inverse_length, zero));
+            }
+
+            float weights[3][4];
+            if (weighting == NormalWeighting::AREA) {
+                Float4 area = float4_select(is_valid, float4_splat(0.5f) * length, zero);
+                for (int corner = 0; corner < 3; corner++) {
+                    float4_store(weights[corner], area);
+                }
+            } else {
+                // The angle between the two edges leaving each corner.
+                for (int corner = 0; corner < 3; corner++) {
+                    const Float4* outgoing = edges[corner];
+                    const Float4* incoming = edges[(corner + 2) % 3];
+                    Float4 dot = zero - float4_dot3(outgoing[0], outgoing[1], outgoing[2], incoming[0], incoming[1], incoming[2]);
+                    Float4 lengths_squared = float4_dot3(outgoing[0], outgoing[1], outgoing[2], outgoing[0], outgoing[1], outgoing[2])
+                        * float4_dot3(incoming[0], incoming[1], incoming[2], incoming[0], incoming[1], incoming[2]);
+                    Float4 cosine = float4_clamp(dot / float4_sqrt(float4_max(lengths_squared, tiny)), float4_splat(-1.0f), float4_splat(1.0f));
+
+                    float cosines[4];
+                    float4_store(cosines, float4_select(is_valid, cosine, float4_splat(1.0f)));
+                    for (int lane = 0; lane < 4; lane++) {
+                        weights[corner][lane] = std::acos(cosines[lane]);
+                    }
+                }
+            }
+
+            for (int lane = 0; lane < lane_count; lane++) {
+                int face = first_face + lane;
+                face_normals[face] = glm::vec3(normal_components[0][lane], normal_components[1][lane], normal_components[2][lane]);
+                for (int corner = 0; corner < 3; corner++) {
+                    corner_weights[face * 3 + corner] = weights[corner][lane];
+                }
+            }
+        }
+    });
+}
+
+// --------------------------------------------------------------------------
+
+void NormalGenerator::normalize_normals(ModelArray<glm::vec3>& normals) {
+    // Zero-length normals only come from degenerate geometry and are left as they are.
+    int normal_count = normals.size();
+
+    ThreadPool thread_pool(thread_count);
+    int task_count = (normal_count + VERTICES_PER_TASK - 1) / VERTICES_PER_TASK;
+    thread_pool.parallel_for(task_count, [&](int task_index) {
+        int task_begin = task_index * VERTICES_PER_TASK;
+        int task_end = std::min(task_begin + VERTICES_PER_TASK, normal_count);
+
+        Float4 tiny = float4_splat(std::numeric_limits<float>::min());
+        Float4 zero = float4_splat(0.0f);
+
+        for (int first_normal = task_begin; first_normal < task_end; first_normal += 4) {
+            int lane_count = std::min(4, task_end - first_normal);
+
+            Float4 components[3];
+            for (int axis = 0; axis < 3; axis++) {
+                float values[4];
+                for (int lane = 0; lane < 4; lane++) {
+                    values[lane] = normals[first_normal + std::min(lane, lane_count - 1)][axis];
+                }
+                components[axis] = float4_load(values);
+            }
+
+            Float4 length = float4_sqrt(float4_dot3(components[0], components[1], components[2], components[0], components[1], components[2]));
+            Mask4 is_valid = float4_greater(length, tiny);
+            Float4 inverse_length = float4_splat(1.0f) / float4_max(length, tiny);
+
+            float normalized_components[3][4];
+            for (int axis = 0; axis < 3; axis++) {
+                float4_store(normalized_components[axis], float4_select(is_valid, components[axis] * inverse_length, zero));
+            }
+
+            for (int lane = 0; lane < lane_count; lane++) {
+                normals[first_normal + lane] = glm::vec3(normalized_components[0][lane], normalized_components[1][lane], normalized_components[2][lane]);
+            }
+        }
+    });
+}
+
+// --------------------------------------------------------------------------
+
+void NormalGenerator::generate_flat_normals(Model& model, const std::vector<glm::vec3>& face_normals) {
+    std::vector<int> corner_normal_indices(face_normals.size() * 3);
+    for (size_t corner = 0; corner < corner_normal_indices.size(); corner++) {
+        corner_normal_indices[corner] = corner / 3;
+    }
+
+    model.replace_normals(ModelArray<glm::vec3>(face_normals.begin(), face_normals.end()), corner_normal_indices);
+}
+
+// --------------------------------------------------------------------------
+
+void NormalGenerator::generate_smooth_normals(Model& model, const std::vector<glm::vec3>& face_normals, const std::vector<float>& corner_weights) {
+    const ModelArray<Face>& faces = model.get_faces();
+    int vertex_count = model.get_vertices().size();
+    int corner_count = faces.size() * 3;
+
+    // Each vertex gathers from the face corners that use it instead of every face scattering
+    // into its vertices, so threads never write to the same normal. Corners are listed in
+    // face order, which keeps the sums, and therefore the results, deterministic.
+    std::vector<int> first_incident_corners(vertex_count + 1, 0);
+    for (const Face& face : faces) {
+        for (int corner = 0; corner < 3; corner++) {
+            first_incident_corners[face.vertex_indices[corner] + 1]++;
+        }
+    }
+    for (int vertex = 0; vertex < vertex_count; vertex++) {
+        first_incident_corners[vertex + 1] += first_incident_corners[vertex];
+    }
+
+    std::vector<int> incident_corners(corner_count);
+    std::vector<int> next_incident_corners(first_incident_corners.begin(), first_incident_corners.end() - 1);
+    for (int corner = 0; corner < corner_count; corner++) {
+        incident_corners[next_incident_corners[faces[corner / 3].vertex_indices[corner % 3]]++] = corner;
+    }
+    next_incident_corners = std::vector<int>();
+
+    ThreadPool thread_pool(thread_count);
+    int task_count = (vertex_count + VERTICES_PER_TASK - 1) / VERTICES_PER_TASK;
+
+    std::vector<int> corner_normal_indices(corner_count);
+    if (crease_angle_degrees >= 180.0f) {
+        ModelArray<glm::vec3> vertex_normals(vertex_count);
+        thread_pool.parallel_for(task_count, [&](int task_index) {
+            int task_begin = task_index * VERTICES_PER_TASK;
+            int task_end = std::min(task_begin + VERTICES_PER_TASK, vertex_count);
+            for (int vertex = task_begin; vertex < task_end; vertex++) {
+                glm::vec3 normal = glm::vec3(0.0f, 0.0f, 0.0f);
+                for (int i = first_incident_corners[vertex]; i < first_incident_corners[vertex + 1]; i++) {
+                    int corner = incident_corners[i];
+                    normal += corner_weights[corner] * face_normals[corner / 3];
+                }
+                vertex_normals[vertex] = normal;
+            }
+        });
+
+        for (int corner = 0; corner < corner_count; corner++) {
+            corner_normal_indices[corner] = faces[corner / 3].vertex_indices[corner % 3];
+        }
+
+        normalize_normals(vertex_normals);
+        model.replace_normals(std::move(vertex_normals), corner_normal_indices);
+        return;
+    }
+
+    // With a crease angle, each corner only averages the faces around its vertex that are
+    // close enough to its own face. Corners of a vertex that end up with the same set of
+    // faces produce bit-identical sums and share one normal, found by a short scan.
+    float min_cosine = std::cos(glm::radians(crease_angle_degrees));
+
+    std::vector<glm::vec3> corner_normals(corner_count);
+    std::vector<int> representative_corners(corner_count);
+    thread_pool.parallel_for(task_count, [&](int task_index) {
+        int task_begin = task_index * VERTICES_PER_TASK;
+        int task_end = std::min(task_begin + VERTICES_PER_TASK, vertex_count);
+        for (int vertex = task_begin; vertex < task_end; vertex++) {
+            int incident_begin = first_incident_corners[vertex];
+            int incident_end = first_incident_corners[vertex + 1];
+            for (int i = incident_begin; i < incident_end; i++) {
+                int corner = incident_corners[i];
+                const glm::vec3& face_normal = face_normals[corner / 3];
+
+                glm::vec3 normal = glm::vec3(0.0f, 0.0f, 0.0f);
+                for (int j = incident_begin; j < incident_end; j++) {
+                    int other_corner = incident_corners[j];
+                    const glm::vec3& other_face_normal = face_normals[other_corner / 3];
+                    if (glm::dot(face_normal, other_face_normal) >= min_cosine) {
+                        normal += corner_weights[other_corner] * other_face_normal;
+                    }
+                }
+                corner_normals[corner] = normal;
+
+                representative_corners[corner] = corner;
+                for (int j = incident_begin; j < i; j++) {
+                    int other_corner = incident_corners[j];
+                    if (representative_corners[other_corner] == other_corner && corner_normals[other_corner] == normal) {
+                        representative_corners[corner] = other_corner;
+                        break;
+                    }
+                }
+            }
+        }
+    });
+
+    // Representatives always come earlier in face order, so one pass assigns every index.
+    ModelArray<glm::vec3> normals;
+    for (int corner = 0; corner < corner_count; corner++) {
+        int representative_corner = representative_corners[corner];
+        if (representative_corner == corner) {
+            corner_normal_indices[corner] = normals.size();
+            normals.push_back(corner_normals[corner]);
+        } else {
+            corner_normal_indices[corner] = corner_normal_indices[representative_corner];
+        }
+    }
+
+    normalize_normals(normals);
+    model.replace_normals(std::move(normals), corner_normal_indices);
+}
@@ -0,0 +1,48 @@
+#ifndef NORMAL_GENERATOR_H
+#define NORMAL_GENERATOR_H
+
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "Model.h"
+
+enum class NormalType {
+    FLAT,
+    SMOOTH
+};
+
+enum class NormalWeighting {
+    AREA,
+    ANGLE
+};
+
+class NormalGenerator {
+
+public:
+
+    NormalGenerator();
+    ~NormalGenerator();
+
+    void set_thread_count(int thread_count);
+    void set_weighting(NormalWeighting weighting);
+    void set_crease_angle(float crease_angle_degrees);
+
+    void generate(Model& model, NormalType type);
+
+private:
+
+    static const int FACES_PER_TASK = 1 << 14;
+    static const int VERTICES_PER_TASK = 1 << 14;
+
+    int thread_count;
+    NormalWeighting weighting;
+    float crease_angle_degrees;
+
+    void compute_face_normals(const Model& model, std::vector<glm::vec3>& face_normals, std::vector<float>& corner_weights);
+    void normalize_normals(ModelArray<glm::vec3>& normals);
+
+    void generate_flat_normals(Model& model, const std::vector<glm::vec3>& face_normals);
+    void generate_smooth_normals(Model& model, const std::vector<glm::vec3>& face_normals, const std::vector<float>& corner_weights);
+};
+
+#endif
@@ -1,12 +1,28 @@
 #include "ObjLoader.h"
 
-#include <fstream>
+#include <charconv>
+#include <cctype>
+#include <cstring>
+#include <cstdlib>
+#include <cerrno>
 #include <string>
 #include <sstream>
 #include <iostream>
+#include <algorithm>
 #include <glm/glm.hpp>
 
-ObjLoader::ObjLoader() {
+#include "MappedFile.h"
+#include "ThreadPool.h"
+#include "JobScheduler.h"
+#include "MaterialLibrary.h"
+#include "Profiler.h"
+
+ObjLoader::ObjLoader()
+:
+thread_count(1),
+job_scheduler(nullptr),
+memory_arena(nullptr),
+material_library(nullptr) {
     // do nothing for now
 }
 
@@ -18,129 +34,504 @@ ObjLoader::~ObjLoader() {
 
 // --------------------------------------------------------------------------
 
+void ObjLoader::set_thread_count(int thread_count) {
+    // A thread count of 0 or less means one thread per hardware thread.
+    this->thread_count = thread_count > 0 ? thread_count : ThreadPool::get_hardware_thread_count();
+}
+
+// --------------------------------------------------------------------------
+
+void ObjLoader::set_job_scheduler(JobScheduler* job_scheduler) {
+    // Parse chunks become sub-tasks of the calling job on this scheduler instead of
+    // running on a pool of their own, so large files spread across idle workers.
+    this->job_scheduler = job_scheduler;
+    if (job_scheduler != nullptr) {
+        thread_count = job_scheduler->get_thread_count();
+    }
+}
+
+// --------------------------------------------------------------------------
+
+void ObjLoader::set_memory_arena(MemoryArena* memory_arena) {
+    // Loaded models take their storage from this arena, which must outlive them.
+    this->memory_arena = memory_arena;
+}
+
+// --------------------------------------------------------------------------
+
+void ObjLoader::set_material_library(MaterialLibrary* material_library) {
+    // Material libraries are handed to material_library as soon as their mtllib line is
+    // parsed, so their textures start loading while the rest of the geometry is parsed.
+    this->material_library = material_library;
+}
+
+// --------------------------------------------------------------------------
+
 std::optional<Model> ObjLoader::load_from_file(const std::string& file_path) {
-    std::ifstream file(file_path);
-    if (!file) {
+    PROFILE_SCOPE("ObjLoader::load_from_file");
+
+    // Material library paths are relative to the OBJ file.
+    size_t last_slash_position = file_path.find_last_of('/');
+    file_directory = last_slash_position != std::string::npos ? file_path.substr(0, last_slash_position + 1) : "";
+
+    MappedFile file;
+    if (!file.open(file_path)) {
         return std::nullopt;
     }
 
+    const char* file_data = file.get_data();
+    if (thread_count > 1 && file.get_size() >= MIN_PARALLEL_FILE_SIZE) {
+        return load_in_parallel(file_data, file_data + file.get_size());
+    }
+
+    PROFILE_SCOPE("parse");
+    Model model(memory_arena);
+    model.reserve(count_elements(file_data, file_data + file.get_size()));
+    if (!parse_lines(file_data, file_data + file.get_size(), model, std::cerr)) {
+        return std::nullopt;
+    }
+
+    return model;
+}
+
+// --------------------------------------------------------------------------
+
+bool ObjLoader::load_in_batches(const char* begin, const char* end, int faces_per_batch, const std::function<bool(Model&)>& handle_batch) {
+    // Faces refer to vertex attributes by absolute index, so those keep accumulating in the
+    // model, but its faces are dropped after every batch. Returning false from handle_batch
+    // stops the load.
     Model model;
 
-    std::string line;
-    while (getline(file, line)) {
-        size_t comment_start_position = line.find('#');
-        if (comment_start_position != std::string::npos) {
-            line = line.substr(0, comment_start_position);
-        }
-
-        std::vector<std::string> tokens = split_string_by_whitespace(line);
-        if (tokens.size() == 0) {
-            continue;
-        } else if (tokens[0] == "v") {
-            if (tokens.size() != 4) {
-                std::cerr << "[ERROR] Vertex line contains unexpected number of tokens!" << std::endl;
-                std::cerr << "[ERROR] Line content: " << line << std::endl;
-                return std::nullopt;
-            }
+    const char* line_start = begin;
+    while (line_start < end) {
+        const char* line_end = static_cast<const char*>(std::memchr(line_start, '\n', end - line_start));
+        if (line_end == nullptr) {
+            line_end = end;
+        }
 
-            glm::vec3 vertex;
-            vertex.x = std::stof(tokens[1]);
-            vertex.y = std::stof(tokens[2]);
-            vertex.z = std::stof(tokens[3]);
-
-            model.add_vertex(vertex);
-        } else if (tokens[0] == "vn") {
-            if (tokens.size() != 4) {
-                std::cerr << "[ERROR] Normal line contains unexpected number of tokens!" << std::endl;
-                std::cerr << "[ERROR] Line content: " << line << std::endl;
-                return std::nullopt;
-            }
+        if (!parse_line(std::string_view(line_start, line_end - line_start), model, std::cerr)) {
+            return false;
+        }
 
-            glm::vec3 normal;
-            normal.x = std::stof(tokens[1]);
-            normal.y = std::stof(tokens[2]);
-            normal.z = std::stof(tokens[3]);
-
-            model.add_normal(normal);
-        } else if (tokens[0] == "vt") {
-            if (tokens.size() != 3) {
-                std::cerr << "[ERROR] Texture coordinate line contains unexpected number of tokens!" << std::endl;
-                std::cerr << "[ERROR] Line content: " << line << std::endl;
-                return std::nullopt;
+        if ((int)model.get_faces().size() >= faces_per_batch) {
+            if (!handle_batch(model)) {
+                return false;
             }
+            model.clear_faces();
+        }
 
-            glm::vec2 texture_coordinate;
-            texture_coordinate.x = std::stof(tokens[1]);
-            texture_coordinate.y = std::stof(tokens[2]);
-
-            model.add_texture_coordinate(texture_coordinate);
-        } else if (tokens[0] == "f") {
-            if (tokens.size() != 4) {
-                std::cerr << "[ERROR] Face line contains unexpected number of tokens!" << std::endl;
-                std::cerr << "[ERROR] Please note that only triangles are currently supported." << std::endl;
-                std::cerr << "[ERROR] Line content: " << line << std::endl;
-                return std::nullopt;
-            }
+        line_start = line_end + 1;
+    }
 
-            Face face = create_face_from_face_line_tokens(tokens);
-            model.add_face(face);
+    return handle_batch(model);
+}
+
+// --------------------------------------------------------------------------
+
+bool ObjLoader::load_lines(const char* begin, const char* end, Model& model) {
+    // Adds whole lines to a model that may already hold the lines before them, like the text
+    // appended to a file that's still being written. The model keeps everything it had.
+    PROFILE_SCOPE("ObjLoader::load_lines");
+    return parse_lines(begin, end, model, std::cerr);
+}
+
+// --------------------------------------------------------------------------
+
+std::optional<Model> ObjLoader::load_in_parallel(const char* begin, const char* end) {
+    struct Chunk {
+        const char* begin;
+        const char* end;
+        Model model;
+        std::ostringstream diagnostics;
+        bool succeeded;
+    };
+
+    // Use a few chunks per thread so that uneven line mixes still balance out,
+    // and move each boundary forward to the start of the next line.
+    size_t file_size = end - begin;
+    size_t chunk_count = std::min<size_t>(thread_count * CHUNKS_PER_THREAD, file_size / MIN_CHUNK_SIZE);
+    chunk_count = std::max<size_t>(chunk_count, 1);
+
+    std::vector<Chunk> chunks(chunk_count);
+    const char* chunk_begin = begin;
+    for (size_t i = 0; i < chunk_count; i++) {
+        const char* chunk_end = end;
+        if (i + 1 < chunk_count) {
+            chunk_end = std::max(chunk_begin, begin + file_size * (i + 1) / chunk_count);
+            const char* newline = static_cast<const char*>(std::memchr(chunk_end, '\n', end - chunk_end));
+            chunk_end = newline != nullptr ? newline + 1 : end;
+        }
+
+        chunks[i].begin = chunk_begin;
+        chunks[i].end = chunk_end;
+        chunk_begin = chunk_end;
+    }
+
+    std::vector<ModelStatistics> chunk_counts(chunk_count);
+    auto count_chunk = [&](int chunk_index) {
+        chunk_counts[chunk_index] = count_elements(chunks[chunk_index].begin, chunks[chunk_index].end);
+    };
+
+    auto parse_chunk = [&](int chunk_index) {
+        PROFILE_SCOPE("parse chunk");
+        Chunk& chunk = chunks[chunk_index];
+        chunk.succeeded = parse_lines(chunk.begin, chunk.end, chunk.model, chunk.diagnostics);
+    };
+
+    std::optional<ThreadPool> thread_pool;
+    if (job_scheduler == nullptr) {
+        thread_pool.emplace(thread_count);
+    }
+
+    auto run_for_each_chunk = [&](const std::function<void(int)>& function) {
+        if (job_scheduler != nullptr) {
+            job_scheduler->parallel_for(chunk_count, function);
         } else {
-            std::cerr << "[WARN] Ignoring unknown token: " << tokens[0] << std::endl;
+            thread_pool->parallel_for(chunk_count, function);
+        }
+    };
+
+    run_for_each_chunk(count_chunk);
+
+    // The first chunk is parsed straight into the model that's returned, sized for the whole
+    // file, so merging only copies the chunks after it. Only its thread uses the arena.
+    ModelStatistics total_counts = {};
+    for (const ModelStatistics& counts : chunk_counts) {
+        total_counts.vertex_count += counts.vertex_count;
+        total_counts.normal_count += counts.normal_count;
+        total_counts.texture_coordinate_count += counts.texture_coordinate_count;
+        total_counts.face_count += counts.face_count;
+    }
+
+    chunks[0].model = Model(memory_arena);
+    chunks[0].model.reserve(total_counts);
+    for (size_t i = 1; i < chunk_count; i++) {
+        chunks[i].model.reserve(chunk_counts[i]);
+    }
+
+    run_for_each_chunk(parse_chunk);
+
+    // Replay diagnostics in file order and stop at the first failing chunk, which
+    // reproduces exactly what the serial loader prints and returns.
+    for (Chunk& chunk : chunks) {
+        std::cerr << chunk.diagnostics.str();
+        if (!chunk.succeeded) {
+            return std::nullopt;
         }
     }
 
+    PROFILE_SCOPE("merge chunks");
+    Model model = std::move(chunks[0].model);
+    for (size_t i = 1; i < chunk_count; i++) {
+        model.append(std::move(chunks[i].model));
+    }
+
     return model;
 }
 
 // --------------------------------------------------------------------------
 
-std::vector<std::string> ObjLoader::split_string_by_whitespace(const std::string& str) {
-    std::istringstream stream(str);
-    std::vector<std::string> tokens;
+ModelStatistics ObjLoader::count_elements(const char* begin, const char* end) {
+    // A quick pass over the line keywords only, so the model can be sized once instead of
+    // growing by doubling. Only faces of three corners are accepted, so one face line is
+    // one face.
+    ModelStatistics counts = {0, 0, 0, 0, 0, 0, 1.0f, 0, 0, 0};
+
+    const char* line_start = begin;
+    while (line_start < end) {
+        const char* line_end = static_cast<const char*>(std::memchr(line_start, '\n', end - line_start));
+        if (line_end == nullptr) {
+            line_end = end;
+        }
+
+        const char* c = line_start;
+        while (c < line_end && (*c == ' ' || *c == '\t')) {
+            c++;
+        }
+
+        auto is_keyword_end = [line_end](const char* position) {
+            return position == line_end || std::isspace(static_cast<unsigned char>(*position)) || *position == '#';
+        };
+
+        if (c < line_end && *c == 'f' && is_keyword_end(c + 1)) {
+            counts.face_count++;
+        } else if (c < line_end && *c == 'v') {
+            if (is_keyword_end(c + 1)) {
+                counts.vertex_count++;
+            } else if (c[1] == 'n' && is_keyword_end(c + 2)) {
+                counts.normal_count++;
+            } else if (c[1] == 't' && is_keyword_end(c + 2)) {
+                counts.texture_coordinate_count++;
+            }
+        }
+
+        line_start = line_end + 1;
+    }
+
+    return counts;
+}
+
+// --------------------------------------------------------------------------
+
+bool ObjLoader::parse_lines(const char* begin, const char* end, Model& model, std::ostream& diagnostics) {
+    const char* line_start = begin;
+    while (line_start < end) {
+        const char* line_end = static_cast<const char*>(std::memchr(line_start, '\n', end - line_start));
+        if (line_end == nullptr) {
+            line_end = end;
+        }
+
+        if (!parse_line(std::string_view(line_start, line_end - line_start), model, diagnostics)) {
+            return false;
+        }
+
+        line_start = line_end + 1;
+    }
+
+    return true;
+}
+
+// --------------------------------------------------------------------------
+
+bool ObjLoader::parse_line(std::string_view line, Model& model, std::ostream& diagnostics) {
+    size_t comment_start_position = line.find('#');
+    if (comment_start_position != std::string_view::npos) {
+        line = line.substr(0, comment_start_position);
+    }
+
+    std::string_view tokens[MAX_LINE_TOKENS];
+    int token_count = split_string_by_whitespace(line, tokens, MAX_LINE_TOKENS);
+    if (token_count == 0) {
+        return true;
+    } else if (tokens[0] == "v") {
+        if (token_count != 4) {
+            diagnostics << "[ERROR] Vertex line contains unexpected number of tokens!" << std::endl;
+            diagnostics << "[ERROR] Line content: " << line << std::endl;
+            return false;
+        }
+
+        glm::vec3 vertex;
+        if (!parse_float(tokens[1], vertex.x) || !parse_float(tokens[2], vertex.y) || !parse_float(tokens[3], vertex.z)) {
+            diagnostics << "[ERROR] Vertex line contains an invalid number!" << std::endl;
+            diagnostics << "[ERROR] Line content: " << line << std::endl;
+            return false;
+        }
+
+        model.add_vertex(vertex);
+    } else if (tokens[0] == "vn") {
+        if (token_count != 4) {
+            diagnostics << "[ERROR] Normal line contains unexpected number of tokens!" << std::endl;
+            diagnostics << "[ERROR] Line content: " << line << std::endl;
+            return false;
+        }
+
+        glm::vec3 normal;
+        if (!parse_float(tokens[1], normal.x) || !parse_float(tokens[2], normal.y) || !parse_float(tokens[3], normal.z)) {
+            diagnostics << "[ERROR] Normal line contains an invalid number!" << std::endl;
+            diagnostics << "[ERROR] Line content: " << line << std::endl;
+            return false;
+        }
+
+        model.add_normal(normal);
+    } else if (tokens[0] == "vt") {
+        if (token_count != 3) {
+            diagnostics << "[ERROR] Texture coordinate line contains unexpected number of tokens!" << std::endl;
+            diagnostics << "[ERROR] Line content: " << line << std::endl;
+            return false;
+        }
+
+        glm::vec2 texture_coordinate;
+        if (!parse_float(tokens[1], texture_coordinate.x) || !parse_float(tokens[2], texture_coordinate.y)) {
+            diagnostics << "[ERROR] Texture coordinate line contains an invalid number!" << std::endl;
+            diagnostics << "[ERROR] Line content: " << line << std::endl;
+            return false;
+        }
+
+        model.add_texture_coordinate(texture_coordinate);
+    } else if (tokens[0] == "f") {
+        if (token_count != 4) {
+            diagnostics << "[ERROR] Face line contains unexpected number of tokens!" << std::endl;
+            diagnostics << "[ERROR] Please note that only triangles are currently supported." << std::endl;
+            diagnostics << "[ERROR] Line content: " << line << std::endl;
+            return false;
+        }
+
+        Face face;
+        if (!create_face_from_face_line_tokens(tokens, face)) {
+            diagnostics << "[ERROR] Face line contains an invalid index!" << std::endl;
+            diagnostics << "[ERROR] Line content: " << line << std::endl;
+            return false;
+        }
+
+        model.add_face(face);
+    } else if (tokens[0] == "usemtl") {
+        // Material names may contain spaces, so the name is the rest of the line.
+        std::string_view material_name = trim_whitespace(line.substr(tokens[0].data() + tokens[0].size() - line.data()));
+        if (material_name.empty()) {
+            diagnostics << "[WARN] Ignoring material line without a name: " << line << std::endl;
+            return true;
+        }
+
+        model.use_material(std::string(material_name));
+    } else if (tokens[0] == "mtllib") {
+        // Any number of libraries may be named, so they're read from the line rather than the capped tokens.
+        std::string_view library_names = line.substr(tokens[0].data() + tokens[0].size() - line.data());
+        std::string_view library_name;
+        if (split_string_by_whitespace(library_names, &library_name, 1) == 0) {
+            diagnostics << "[WARN] Ignoring material library line without a name: " << line << std::endl;
+            return true;
+        }
+
+        while (split_string_by_whitespace(library_names, &library_name, 1) > 0) {
+            std::string material_library_path = library_name[0] == '/' ? std::string(library_name) : file_directory + std::string(library_name);
+            model.add_material_library(material_library_path);
+            if (material_library != nullptr) {
+                material_library->load(material_library_path);
+            }
+
+            library_names = library_names.substr(library_name.data() + library_name.size() - library_names.data());
+        }
+    } else {
+        diagnostics << "[WARN] Ignoring unknown token: " << tokens[0] << std::endl;
+    }
+
+    return true;
+}
+
+// --------------------------------------------------------------------------
+
+int ObjLoader::split_string_by_whitespace(std::string_view str, std::string_view* tokens, int max_tokens) {
+    // Returns the total number of tokens on the line, but only the first max_tokens are stored.
+    int token_count = 0;
+
+    size_t position = 0;
+    while (position < str.size()) {
+        while (position < str.size() && std::isspace(static_cast<unsigned char>(str[position]))) {
+            position++;
+        }
+
+        if (position == str.size()) {
+            break;
+        }
+
+        size_t token_start_position = position;
+        while (position < str.size() && !std::isspace(static_cast<unsigned char>(str[position]))) {
+            position++;
+        }
+
+        if (token_count < max_tokens) {
+            tokens[token_count] = str.substr(token_start_position, position - token_start_position);
+        }
+        token_count++;
+    }
+
+    return token_count;
+}
+
+// --------------------------------------------------------------------------
+
+std::string_view ObjLoader::trim_whitespace(std::string_view str) {
+    while (!str.empty() && std::isspace(static_cast<unsigned char>(str.front()))) {
+        str.remove_prefix(1);
+    }
 
-    std::string token;
-    while (stream >> token) {
-        tokens.push_back(token);
+    while (!str.empty() && std::isspace(static_cast<unsigned char>(str.back()))) {
+        str.remove_suffix(1);
     }
 
-    return tokens;
+    return str;
 }
 
 // --------------------------------------------------------------------------
 
-std::vector<std::string> ObjLoader::split_string_by_character(const std::string& str, const char delimiter) {
-    std::istringstream stream(str);
-    std::vector<std::string> tokens;
+bool ObjLoader::parse_float(std::string_view token, float& value) {
+    // Like std::stof(), accept a leading '+' and stop at the first character that isn't part of the number.
+    if (token.size() >= 2 && token[0] == '+' && token[1] != '-' && token[1] != '+') {
+        token.remove_prefix(1);
+    }
 
-    std::string token;
-    while (std::getline(stream, token, delimiter)) {
-        tokens.push_back(token);
+#if defined(__cpp_lib_to_chars)
+    std::from_chars_result result = std::from_chars(token.data(), token.data() + token.size(), value);
+    return result.ec == std::errc();
+#else
+    // Standard libraries without floating point std::from_chars() fall back to strtof() on a stack copy.
+    char buffer[64];
+    std::string long_token;
+    const char* number_start;
+    if (token.size() < sizeof(buffer)) {
+        std::memcpy(buffer, token.data(), token.size());
+        buffer[token.size()] = '\0';
+        number_start = buffer;
+    } else {
+        long_token = std::string(token);
+        number_start = long_token.c_str();
     }
 
-    return tokens;
+    char* number_end;
+    errno = 0;
+    value = std::strtof(number_start, &number_end);
+    return number_end != number_start && errno != ERANGE;
+#endif
 }
 
 // --------------------------------------------------------------------------
 
-Face ObjLoader::create_face_from_face_line_tokens(const std::vector<std::string>& face_line_tokens) {
-    Face face;
+bool ObjLoader::parse_index(std::string_view token, int& value) {
+    if (token.size() >= 2 && token[0] == '+' && token[1] != '-' && token[1] != '+') {
+        token.remove_prefix(1);
+    }
+
+    std::from_chars_result result = std::from_chars(token.data(), token.data() + token.size(), value);
+    return result.ec == std::errc();
+}
+
+// --------------------------------------------------------------------------
 
+bool ObjLoader::create_face_from_face_line_tokens(const std::string_view* face_line_tokens, Face& face) {
     for (int i = 0; i < 3; i++) {
-        std::string face_line_token = face_line_tokens[1 + i];
-        std::vector<std::string> tokens = split_string_by_character(face_line_token, '/');
+        std::string_view face_line_token = face_line_tokens[1 + i];
 
-        face.vertex_indices[i] = std::stoi(tokens[0]) - 1;
+        std::string_view vertex_token = face_line_token;
+        std::string_view texture_coordinate_token;
+        std::string_view normal_token;
+
+        size_t first_slash_position = face_line_token.find('/');
+        if (first_slash_position != std::string_view::npos) {
+            vertex_token = face_line_token.substr(0, first_slash_position);
+
+            std::string_view remaining_token = face_line_token.substr(first_slash_position + 1);
+            size_t second_slash_position = remaining_token.find('/');
+            texture_coordinate_token = remaining_token.substr(0, second_slash_position);
+            if (second_slash_position != std::string_view::npos) {
+                normal_token = remaining_token.substr(second_slash_position + 1);
+            }
+        }
+
+        int vertex_index;
+        if (!parse_index(vertex_token, vertex_index)) {
+            return false;
+        }
+
+        face.vertex_indices[i] = vertex_index - 1;
         face.texture_coordinate_indices[i] = -1;
         face.normal_indices[i] = -1;
 
-        if (tokens.size() >= 2 && tokens[1] != "") {
-            face.texture_coordinate_indices[i] = std::stoi(tokens[1]) - 1;
+        int texture_coordinate_index;
+        if (texture_coordinate_token != "") {
+            if (!parse_index(texture_coordinate_token, texture_coordinate_index)) {
+                return false;
+            }
+            face.texture_coordinate_indices[i] = texture_coordinate_index - 1;
         }
 
-        if (tokens.size() >= 3 && tokens[2] != "") {
-            face.normal_indices[i] = std::stoi(tokens[2]) - 1;
+        int normal_index;
+        if (normal_token != "") {
+            if (!parse_index(normal_token, normal_index)) {
+                return false;
+            }
+            face.normal_indices[i] = normal_index - 1;
         }
     }
 
-    return face;
+    return true;
 }
@@ -2,12 +2,17 @@
 #define OBJ_LOADER_H
 
 #include <optional>
-#include <vector>
 #include <string>
+#include <string_view>
+#include <ostream>
+#include <functional>
 
 #include "Model.h"
 #include "Face.h"
 
+class JobScheduler;
+class MaterialLibrary;
+
 class ObjLoader {
 
 public:
@@ -15,14 +20,43 @@ public:
     ObjLoader();
     ~ObjLoader();
 
+    void set_thread_count(int thread_count);
+    void set_job_scheduler(JobScheduler* job_scheduler);
+    void set_memory_arena(MemoryArena* memory_arena);
+    void set_material_library(MaterialLibrary* material_library);
+
     std::optional<Model> load_from_file(const std::string& file_path);
+    bool load_in_batches(const char* begin, const char* end, int faces_per_batch, const std::function<bool(Model&)>& handle_batch);
+    bool load_lines(const char* begin, const char* end, Model& model);
 
 private:
 
-    std::vector<std::string> split_string_by_whitespace(const std::string& str);
-    std::vector<std::string> split_string_by_character(const std::string& str, const char delimiter);
+    static const int MAX_LINE_TOKENS = 5;
+
+    static const size_t MIN_PARALLEL_FILE_SIZE = 4 * 1024 * 1024;
+    static const size_t MIN_CHUNK_SIZE = 1024 * 1024;
+    static const int CHUNKS_PER_THREAD = 4;
+
+    int thread_count;
+    JobScheduler* job_scheduler;
+    MemoryArena* memory_arena;
+    MaterialLibrary* material_library;
+    std::string file_directory;
+
+    std::optional<Model> load_in_parallel(const char* begin, const char* end);
+
+    static ModelStatistics count_elements(const char* begin, const char* end);
+
+    bool parse_lines(const char* begin, const char* end, Model& model, std::ostream& diagnostics);
+    bool parse_line(std::string_view line, Model& model, std::ostream& diagnostics);
+
+    int split_string_by_whitespace(std::string_view str, std::string_view* tokens, int max_tokens);
+    std::string_view trim_whitespace(std::string_view str);
+
+    bool parse_float(std::string_view token, float& value);
+    bool parse_index(std::string_view token, int& value);
 
-    Face create_face_from_face_line_tokens(const std::vector<std::string>& face_line_tokens);
+    bool create_face_from_face_line_tokens(const std::string_view* face_line_tokens, Face& face);
 };
 
 #endif
@@ -0,0 +1,163 @@
+#include "Profiler.h"
+
+#ifdef ENABLE_PROFILING
+
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+
+Profiler& Profiler::get_instance() {
+    static Profiler profiler;
+    return profiler;
+}
+
+// --------------------------------------------------------------------------
+
+Profiler::Profiler()
+:
+start_time(std::chrono::steady_clock::now()),
+is_enabled(false),
+next_thread_id(GPU_THREAD_ID + 1) {
+    // do nothing for now
+}
+
+// --------------------------------------------------------------------------
+
+Profiler::~Profiler() {
+    // do nothing for now
+}
+
+// --------------------------------------------------------------------------
+
+void Profiler::start_tracing() {
+    is_enabled.store(true, std::memory_order_relaxed);
+}
+
+// --------------------------------------------------------------------------
+
+bool Profiler::is_tracing() const {
+    return is_enabled.load(std::memory_order_relaxed);
+}
+
+// --------------------------------------------------------------------------
+
+int64_t Profiler::get_time_us() const {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start_time).count();
+}
+
+// --------------------------------------------------------------------------
+
+int Profiler::get_current_thread_id() {
+    // Small, stable ids read better in the trace viewer than hashed std::thread ids.
+    thread_local int thread_id = next_thread_id.fetch_add(1, std::memory_order_relaxed);
+    return thread_id;
+}
+
+// --------------------------------------------------------------------------
+
+void Profiler::add_event(const char* name, const char* category, int thread_id, int64_t start_us, int64_t duration_us) {
+    std::lock_guard<std::mutex> lock(events_mutex);
+    events.push_back({name, category, thread_id, start_us, duration_us});
+}
+
+// --------------------------------------------------------------------------
+
+bool Profiler::write_chrome_trace(const std::string& file_path) {
+    // Complete ("X") events in the Trace Event Format, which both chrome://tracing and Perfetto open.
+    std::ofstream file(file_path);
+    if (!file) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(events_mutex);
+
+    file << "{\"traceEvents\":[" << std::endl;
+    file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << GPU_THREAD_ID << ",\"args\":{\"name\":\"GPU\"}}";
+    for (const TraceEvent& event : events) {
+        file << "," << std::endl;
+        file << "{\"name\":\"" << event.name << "\",\"cat\":\"" << event.category << "\",\"ph\":\"X\",\"pid\":1"
+             << ",\"tid\":" << event.thread_id << ",\"ts\":" << event.start_us << ",\"dur\":" << event.duration_us << "}";
+    }
+    file << std::endl << "],\"displayTimeUnit\":\"ms\"}" << std::endl;
+
+    return file.good();
+}
+
+// --------------------------------------------------------------------------
+
+ScopedTimer::ScopedTimer(const char* name, const char* category)
+:
+name(name),
+category(category),
+start_us(0),
+is_active(Profiler::get_instance().is_tracing()) {
+    if (is_active) {
+        start_us = Profiler::get_instance().get_time_us();
+    }
+}
+
+// --------------------------------------------------------------------------
+
+ScopedTimer::~ScopedTimer() {
+    if (!is_active) {
+        return;
+    }
+
+    Profiler& profiler = Profiler::get_instance();
+    profiler.add_event(name, category, profiler.get_current_thread_id(), start_us, profiler.get_time_us() - start_us);
+}
+
+// --------------------------------------------------------------------------
+
+FrameTimeSummary::FrameTimeSummary()
+:
+last_report_time_us(0),
+cpu_frame_count(0),
+cpu_total_ms(0.0),
+cpu_max_ms(0.0),
+gpu_frame_count(0),
+gpu_total_ms(0.0),
+gpu_max_ms(0.0) {
+    // do nothing for now
+}
+
+// --------------------------------------------------------------------------
+
+FrameTimeSummary::~FrameTimeSummary() {
+    // do nothing for now
+}
+
+// --------------------------------------------------------------------------
+
+void FrameTimeSummary::add_cpu_frame_time(double frame_time_ms) {
+    cpu_frame_count++;
+    cpu_total_ms += frame_time_ms;
+    cpu_max_ms = std::max(cpu_max_ms, frame_time_ms);
+}
+
+// --------------------------------------------------------------------------
+
+void FrameTimeSummary::add_gpu_frame_time(double frame_time_ms) {
+    gpu_frame_count++;
+    gpu_total_ms += frame_time_ms;
+    gpu_max_ms = std::max(gpu_max_ms, frame_time_ms);
+}
+
+// --------------------------------------------------------------------------
+
+void FrameTimeSummary::print_if_due(int64_t current_time_us) {
+    if (current_time_us - last_report_time_us < REPORT_INTERVAL_US || cpu_frame_count == 0) {
+        return;
+    }
+
+    std::cout << "Frame time: CPU " << (cpu_total_ms / cpu_frame_count) << " ms average, " << cpu_max_ms << " ms max";
+    if (gpu_frame_count > 0) {
+        std::cout << "; GPU " << (gpu_total_ms / gpu_frame_count) << " ms average, " << gpu_max_ms << " ms max";
+    }
+    std::cout << " (" << cpu_frame_count << " frames)" << std::endl;
+
+    *this = FrameTimeSummary();
+    last_report_time_us = current_time_us;
+}
+
+#endif
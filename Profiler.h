@@ -0,0 +1,105 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+// The profiler is only compiled in when ENABLE_PROFILING is defined (make PROFILE=1).
+// Otherwise PROFILE_SCOPE expands to nothing and none of the classes below exist.
+
+#ifdef ENABLE_PROFILING
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+struct TraceEvent {
+    const char* name;
+    const char* category;
+    int thread_id;
+    int64_t start_us;
+    int64_t duration_us;
+};
+
+class Profiler {
+
+public:
+
+    static const int GPU_THREAD_ID = 0;
+
+    static Profiler& get_instance();
+
+    void start_tracing();
+    bool is_tracing() const;
+
+    int64_t get_time_us() const;
+    int get_current_thread_id();
+
+    void add_event(const char* name, const char* category, int thread_id, int64_t start_us, int64_t duration_us);
+    bool write_chrome_trace(const std::string& file_path);
+
+private:
+
+    Profiler();
+    ~Profiler();
+
+    std::chrono::steady_clock::time_point start_time;
+    std::atomic<bool> is_enabled;
+    std::atomic<int> next_thread_id;
+
+    std::mutex events_mutex;
+    std::vector<TraceEvent> events;
+};
+
+class ScopedTimer {
+
+public:
+
+    // The name and category must be string literals; only the pointers are kept.
+    ScopedTimer(const char* name, const char* category);
+    ~ScopedTimer();
+
+private:
+
+    const char* name;
+    const char* category;
+    int64_t start_us;
+    bool is_active;
+};
+
+class FrameTimeSummary {
+
+public:
+
+    FrameTimeSummary();
+    ~FrameTimeSummary();
+
+    void add_cpu_frame_time(double frame_time_ms);
+    void add_gpu_frame_time(double frame_time_ms);
+
+    void print_if_due(int64_t current_time_us);
+
+private:
+
+    static const int64_t REPORT_INTERVAL_US = 1000000;
+
+    int64_t last_report_time_us;
+    int cpu_frame_count;
+    double cpu_total_ms;
+    double cpu_max_ms;
+    int gpu_frame_count;
+    double gpu_total_ms;
+    double gpu_max_ms;
+};
+
+#define PROFILE_CONCATENATE_INNER(a, b) a##b
+#define PROFILE_CONCATENATE(a, b) PROFILE_CONCATENATE_INNER(a, b)
+#define PROFILE_SCOPE(name) ScopedTimer PROFILE_CONCATENATE(scoped_timer_, __LINE__)(name, "cpu")
+
+#else
+
+#define PROFILE_SCOPE(name)
+
+#endif
+
+#endif
@@ -0,0 +1,332 @@
+#include "Scene.h"
+
+#include <map>
+#include <limits>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <algorithm>
+#include <filesystem>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "MappedFile.h"
+#include "ContentHash.h"
+#include "ThreadPool.h"
+#include "Profiler.h"
+
+static ModelExtents create_empty_extents() {
+    const float MAX_FLOAT_VALUE = std::numeric_limits<float>::max();
+
+    ModelExtents extents;
+    extents.min = glm::vec3(MAX_FLOAT_VALUE, MAX_FLOAT_VALUE, MAX_FLOAT_VALUE);
+    extents.max = glm::vec3(-MAX_FLOAT_VALUE, -MAX_FLOAT_VALUE, -MAX_FLOAT_VALUE);
+    return extents;
+}
+
+// --------------------------------------------------------------------------
+
+Scene::Scene()
+:
+thread_count(1),
+duplicate_file_count(0) {
+    extents = create_empty_extents();
+    vertex_extents = create_empty_extents();
+}
+
+// --------------------------------------------------------------------------
+
+Scene::~Scene() {
+    // do nothing for now
+}
+
+// --------------------------------------------------------------------------
+
+void Scene::set_thread_count(int thread_count) {
+    this->thread_count = thread_count > 0 ? thread_count : ThreadPool::get_hardware_thread_count();
+}
+
+// --------------------------------------------------------------------------
+
+std::optional<std::vector<ScenePlacement>> Scene::load_placements(const std::string& placement_file_path) {
+    // One placement per line: OBJ_FILE X Y Z [ROTATION_X ROTATION_Y ROTATION_Z [SCALE]], with the
+    // rotations in degrees. Relative paths are relative to the placement file.
+    std::ifstream file(placement_file_path);
+    if (!file) {
+        std::cerr << "[ERROR] Could not open placement file \"" << placement_file_path << "\"" << std::endl;
+        return std::nullopt;
+    }
+
+    std::filesystem::path base_directory = std::filesystem::path(placement_file_path).parent_path();
+
+    std::vector<ScenePlacement> placements;
+    std::string line;
+    int line_number = 0;
+    while (std::getline(file, line)) {
+        line_number++;
+
+        size_t comment_start = line.find('#');
+        if (comment_start != std::string::npos) {
+            line.erase(comment_start);
+        }
+
+        std::istringstream line_stream(line);
+        std::string file_path;
+        if (!(line_stream >> file_path)) {
+            continue;
+        }
+
+        float values[7] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f };
+        int value_count = 0;
+        while (value_count < 7 && line_stream >> values[value_count]) {
+            value_count++;
+        }
+
+        // A short count must have stopped at the end of the line, not at something that isn't a number.
+        std::string extra_token;
+        bool is_at_end = value_count == 7 ? !(line_stream >> extra_token) : line_stream.eof();
+        bool is_valid = (value_count == 3 || value_count == 6 || value_count == 7) && is_at_end;
+        if (!is_valid) {
+            std::cerr << "[ERROR] Invalid placement on line " << line_number << " of \"" << placement_file_path << "\"" << std::endl;
+            return std::nullopt;
+        }
+
+        std::filesystem::path path(file_path);
+        if (path.is_relative()) {
+            path = base_directory / path;
+        }
+
+        glm::mat4 transform = glm::translate(glm::mat4(1.0f), glm::vec3(values[0], values[1], values[2]));
+        transform = glm::rotate(transform, glm::radians(values[5]), glm::vec3(0.0f, 0.0f, 1.0f));
+        transform = glm::rotate(transform, glm::radians(values[4]), glm::vec3(0.0f, 1.0f, 0.0f));
+        transform = glm::rotate(transform, glm::radians(values[3]), glm::vec3(1.0f, 0.0f, 0.0f));
+        transform = glm::scale(transform, glm::vec3(values[6], values[6], values[6]));
+
+        placements.push_back({path.string(), transform});
+    }
+
+    return placements;
+}
+
+// --------------------------------------------------------------------------
+
+bool Scene::load(const std::vector<ScenePlacement>& placements, const std::function<std::optional<IndexedBufferData>(const std::string& file_path)>& load_mesh) {
+    // Paths naming the same file, and different files with the same contents, share one mesh.
+    // The remaining meshes are loaded in parallel, one per task, and packed into one vertex and
+    // one index buffer with each mesh's indices rebased onto its vertices.
+    PROFILE_SCOPE("Scene::load");
+
+    meshes.clear();
+    instance_transforms.clear();
+    indexed_buffer_data = IndexedBufferData();
+    duplicate_file_count = 0;
+
+    std::map<std::string, int> distinct_path_indices;
+    std::vector<std::string> distinct_paths;
+    std::vector<int> placement_distinct_indices;
+    for (const ScenePlacement& placement : placements) {
+        std::error_code error;
+        std::string canonical_path = std::filesystem::weakly_canonical(placement.file_path, error).string();
+        if (error) {
+            canonical_path = placement.file_path;
+        }
+
+        auto inserted = distinct_path_indices.insert({canonical_path, (int)distinct_paths.size()});
+        if (inserted.second) {
+            distinct_paths.push_back(placement.file_path);
+        }
+        placement_distinct_indices.push_back(inserted.first->second);
+    }
+
+    ThreadPool thread_pool(thread_count);
+
+    int distinct_count = distinct_paths.size();
+    std::vector<std::pair<uint64_t, uint64_t>> file_keys(distinct_count);
+    std::vector<char> is_file_readable(distinct_count, 0);
+    thread_pool.parallel_for(distinct_count, [&](int distinct_index) {
+        MappedFile file;
+        if (file.open(distinct_paths[distinct_index])) {
+            file_keys[distinct_index] = {file.get_size(), compute_content_hash(file.get_data(), file.get_size())};
+            is_file_readable[distinct_index] = 1;
+        }
+    });
+
+    std::map<std::pair<uint64_t, uint64_t>, int> mesh_indices;
+    std::vector<int> distinct_mesh_indices(distinct_count);
+    for (int distinct_index = 0; distinct_index < distinct_count; distinct_index++) {
+        if (!is_file_readable[distinct_index]) {
+            std::cerr << "[ERROR] Could not open file \"" << distinct_paths[distinct_index] << "\"" << std::endl;
+            return false;
+        }
+
+        auto inserted = mesh_indices.insert({file_keys[distinct_index], (int)meshes.size()});
+        if (inserted.second) {
+            SceneMesh mesh;
+            mesh.file_path = distinct_paths[distinct_index];
+            mesh.instance_count = 0;
+            meshes.push_back(mesh);
+        } else {
+            duplicate_file_count++;
+        }
+        distinct_mesh_indices[distinct_index] = inserted.first->second;
+    }
+
+    int mesh_count = meshes.size();
+    std::vector<std::optional<IndexedBufferData>> mesh_buffers(mesh_count);
+    thread_pool.parallel_for(mesh_count, [&](int mesh_index) {
+        mesh_buffers[mesh_index] = load_mesh(meshes[mesh_index].file_path);
+    });
+
+    for (int mesh_index = 0; mesh_index < mesh_count; mesh_index++) {
+        if (!mesh_buffers[mesh_index].has_value()) {
+            std::cerr << "[ERROR] Could not load file \"" << meshes[mesh_index].file_path << "\"" << std::endl;
+            return false;
+        }
+    }
+
+    // Group the instances by mesh so that each mesh's transforms are contiguous.
+    std::vector<int> placement_mesh_indices(placements.size());
+    for (size_t placement = 0; placement < placements.size(); placement++) {
+        placement_mesh_indices[placement] = distinct_mesh_indices[placement_distinct_indices[placement]];
+        meshes[placement_mesh_indices[placement]].instance_count++;
+    }
+
+    int first_instance = 0;
+    for (SceneMesh& mesh : meshes) {
+        mesh.first_instance = first_instance;
+        first_instance += mesh.instance_count;
+    }
+
+    instance_transforms.resize(placements.size());
+    std::vector<int> next_instances(mesh_count);
+    for (int mesh_index = 0; mesh_index < mesh_count; mesh_index++) {
+        next_instances[mesh_index] = meshes[mesh_index].first_instance;
+    }
+    for (size_t placement = 0; placement < placements.size(); placement++) {
+        instance_transforms[next_instances[placement_mesh_indices[placement]]++] = placements[placement].transform;
+    }
+
+    size_t total_vertex_count = 0;
+    size_t total_index_count = 0;
+    for (const std::optional<IndexedBufferData>& mesh_buffer : mesh_buffers) {
+        total_vertex_count += mesh_buffer->vertex_count;
+        total_index_count += mesh_buffer->indices.size();
+    }
+
+    indexed_buffer_data.vertex_data.reserve(total_vertex_count * Model::FLOATS_PER_BUFFER_VERTEX);
+    indexed_buffer_data.indices.reserve(total_index_count);
+    for (int mesh_index = 0; mesh_index < mesh_count; mesh_index++) {
+        IndexedBufferData& mesh_buffer = mesh_buffers[mesh_index].value();
+        SceneMesh& mesh = meshes[mesh_index];
+
+        uint32_t base_vertex = indexed_buffer_data.vertex_count;
+        mesh.first_index = indexed_buffer_data.indices.size();
+        mesh.index_count = mesh_buffer.indices.size();
+        mesh.vertex_count = mesh_buffer.vertex_count;
+
+        mesh.extents = create_empty_extents();
+        for (int vertex = 0; vertex < mesh_buffer.vertex_count; vertex++) {
+            const float* position = &mesh_buffer.vertex_data[vertex * Model::FLOATS_PER_BUFFER_VERTEX];
+            mesh.extents.min = glm::min(mesh.extents.min, glm::vec3(position[0], position[1], position[2]));
+            mesh.extents.max = glm::max(mesh.extents.max, glm::vec3(position[0], position[1], position[2]));
+        }
+
+        indexed_buffer_data.vertex_data.insert(indexed_buffer_data.vertex_data.end(), mesh_buffer.vertex_data.begin(), mesh_buffer.vertex_data.end());
+        for (uint32_t index : mesh_buffer.indices) {
+            indexed_buffer_data.indices.push_back(base_vertex + index);
+        }
+        indexed_buffer_data.vertex_count += mesh_buffer.vertex_count;
+
+        mesh_buffer = IndexedBufferData();
+    }
+
+    bool fits_16_bit_indices = indexed_buffer_data.vertex_count <= 65536;
+    indexed_buffer_data.index_size_in_bytes = fits_16_bit_indices ? sizeof(uint16_t) : sizeof(uint32_t);
+
+    compute_extents();
+    return true;
+}
+
+// --------------------------------------------------------------------------
+
+void Scene::arrange_in_row() {
+    // Lines the instances up along the x axis with a small gap, standing on y = 0 and centered in z.
+    const float GAP_FRACTION = 0.1f;
+
+    float max_width = 0.0f;
+    for (const SceneMesh& mesh : meshes) {
+        max_width = std::max(max_width, mesh.extents.max.x - mesh.extents.min.x);
+    }
+
+    float cursor_x = 0.0f;
+    for (const SceneMesh& mesh : meshes) {
+        glm::vec3 mesh_offset = glm::vec3(-mesh.extents.min.x, -mesh.extents.min.y, -0.5f * (mesh.extents.min.z + mesh.extents.max.z));
+        for (int instance = mesh.first_instance; instance < mesh.first_instance + mesh.instance_count; instance++) {
+            instance_transforms[instance] = glm::translate(glm::mat4(1.0f), glm::vec3(cursor_x, 0.0f, 0.0f) + mesh_offset);
+            cursor_x += (mesh.extents.max.x - mesh.extents.min.x) + GAP_FRACTION * max_width;
+        }
+    }
+
+    compute_extents();
+}
+
+// --------------------------------------------------------------------------
+
+const std::vector<SceneMesh>& Scene::get_meshes() const {
+    return meshes;
+}
+
+// --------------------------------------------------------------------------
+
+const std::vector<glm::mat4>& Scene::get_instance_transforms() const {
+    return instance_transforms;
+}
+
+// --------------------------------------------------------------------------
+
+IndexedBufferData& Scene::get_indexed_buffer_data() {
+    return indexed_buffer_data;
+}
+
+// --------------------------------------------------------------------------
+
+ModelExtents Scene::get_extents() const {
+    return extents;
+}
+
+// --------------------------------------------------------------------------
+
+ModelExtents Scene::get_vertex_extents() const {
+    return vertex_extents;
+}
+
+// --------------------------------------------------------------------------
+
+int Scene::get_duplicate_file_count() const {
+    return duplicate_file_count;
+}
+
+// --------------------------------------------------------------------------
+
+void Scene::compute_extents() {
+    // The scene's extents bound every instance's transformed box; the vertex extents bound the
+    // untransformed vertices, which is what the quantized vertex formats need.
+    extents = create_empty_extents();
+    vertex_extents = create_empty_extents();
+    for (const SceneMesh& mesh : meshes) {
+        vertex_extents.min = glm::min(vertex_extents.min, mesh.extents.min);
+        vertex_extents.max = glm::max(vertex_extents.max, mesh.extents.max);
+
+        for (int instance = mesh.first_instance; instance < mesh.first_instance + mesh.instance_count; instance++) {
+            for (int corner = 0; corner < 8; corner++) {
+                glm::vec3 corner_position = glm::vec3(
+                    (corner & 1) ? mesh.extents.max.x : mesh.extents.min.x,
+                    (corner & 2) ? mesh.extents.max.y : mesh.extents.min.y,
+                    (corner & 4) ? mesh.extents.max.z : mesh.extents.min.z
+                );
+                glm::vec3 transformed_position = glm::vec3(instance_transforms[instance] * glm::vec4(corner_position, 1.0f));
+                extents.min = glm::min(extents.min, transformed_position);
+                extents.max = glm::max(extents.max, transformed_position);
+            }
+        }
+    }
+}
@@ -0,0 +1,66 @@
+#ifndef SCENE_H
+#define SCENE_H
+
+#include <string>
+#include <vector>
+#include <optional>
+#include <functional>
+#include <glm/glm.hpp>
+
+#include "Model.h"
+
+struct ScenePlacement {
+    std::string file_path;
+    glm::mat4 transform;
+};
+
+// One unique mesh in the packed buffers, drawn once for all of its instances, which are
+// stored next to each other in the instance transforms.
+struct SceneMesh {
+    std::string file_path;
+    int first_index;
+    int index_count;
+    int vertex_count;
+    int first_instance;
+    int instance_count;
+    ModelExtents extents;
+};
+
+class Scene {
+
+public:
+
+    Scene();
+    ~Scene();
+
+    void set_thread_count(int thread_count);
+
+    static std::optional<std::vector<ScenePlacement>> load_placements(const std::string& placement_file_path);
+
+    bool load(const std::vector<ScenePlacement>& placements, const std::function<std::optional<IndexedBufferData>(const std::string& file_path)>& load_mesh);
+    void arrange_in_row();
+
+    const std::vector<SceneMesh>& get_meshes() const;
+    const std::vector<glm::mat4>& get_instance_transforms() const;
+    IndexedBufferData& get_indexed_buffer_data();
+
+    ModelExtents get_extents() const;
+    ModelExtents get_vertex_extents() const;
+    int get_duplicate_file_count() const;
+
+private:
+
+    void compute_extents();
+
+    int thread_count;
+
+    std::vector<SceneMesh> meshes;
+    std::vector<glm::mat4> instance_transforms;
+    IndexedBufferData indexed_buffer_data;
+
+    ModelExtents extents;
+    ModelExtents vertex_extents;
+    int duplicate_file_count;
+};
+
+#endif
@@ -0,0 +1,370 @@
+#include "ShaderManager.h"
+
+#include <chrono>
+#include <cstring>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <iostream>
+#include <filesystem>
+#include <unistd.h>
+
+#include "ContentHash.h"
+#include "Profiler.h"
+
+const char ShaderManager::CACHE_FILE_MAGIC[8] = {'O', 'B', 'J', 'V', 'P', 'R', 'O', 'G'};
+
+static bool read_file_into_string(const std::string& file_path, std::string& str) {
+    std::ifstream file(file_path);
+    if (!file) {
+        return false;
+    }
+
+    std::stringstream ss;
+    ss << file.rdbuf();
+    str = ss.str();
+
+    return true;
+}
+
+// --------------------------------------------------------------------------
+
+static double get_elapsed_ms(std::chrono::steady_clock::time_point start_time) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start_time).count();
+}
+
+// --------------------------------------------------------------------------
+
+ShaderManager::ShaderManager()
+:
+is_binary_cache_supported(false),
+cached_program_count(0),
+compile_ms(0.0),
+cache_load_ms(0.0) {
+    // do nothing for now
+}
+
+// --------------------------------------------------------------------------
+
+ShaderManager::~ShaderManager() {
+    // do nothing for now
+}
+
+// --------------------------------------------------------------------------
+
+bool ShaderManager::load_sources(const std::string& vertex_shader_file_path, const std::string& fragment_shader_file_path) {
+    // Doesn't need an OpenGL context, so missing files are reported before a window opens.
+    if (!read_file_into_string(vertex_shader_file_path, vertex_shader_source)) {
+        std::cerr << "[ERROR] Could not open vertex shader file \"" << vertex_shader_file_path << "\"" << std::endl;
+        return false;
+    }
+
+    if (!read_file_into_string(fragment_shader_file_path, fragment_shader_source)) {
+        std::cerr << "[ERROR] Could not open fragment shader file \"" << fragment_shader_file_path << "\"" << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+// --------------------------------------------------------------------------
+
+void ShaderManager::set_cache_directory(const std::string& cache_directory) {
+    // An empty directory turns the program binary cache off.
+    this->cache_directory = cache_directory;
+}
+
+// --------------------------------------------------------------------------
+
+void ShaderManager::initialize() {
+    // Needs a current OpenGL context. Program binaries only load into the driver that saved
+    // them, so its name and version are part of every cache key.
+    auto get_string = [](GLenum name) {
+        const char* value = reinterpret_cast<const char*>(glGetString(name));
+        return std::string(value != nullptr ? value : "unknown");
+    };
+    driver_name = get_string(GL_VENDOR) + "\n" + get_string(GL_RENDERER) + "\n" + get_string(GL_VERSION);
+
+    GLint binary_format_count = 0;
+    if (GLEW_VERSION_4_1 || GLEW_ARB_get_program_binary) {
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &binary_format_count);
+    }
+    is_binary_cache_supported = binary_format_count > 0 && !cache_directory.empty();
+}
+
+// --------------------------------------------------------------------------
+
+void ShaderManager::destroy() {
+    for (const Program& program : programs) {
+        glDeleteProgram(program.program);
+    }
+    programs.clear();
+}
+
+// --------------------------------------------------------------------------
+
+GLuint ShaderManager::get_program(const ShaderVariant& variant) {
+    // Builds the variant the first time it's asked for, from the cache if it can. Returns 0
+    // if the sources don't compile.
+    std::string defines = get_defines(variant);
+    for (const Program& program : programs) {
+        if (program.defines == defines) {
+            return program.program;
+        }
+    }
+
+    PROFILE_SCOPE("ShaderManager::get_program");
+
+    uint64_t program_key = get_program_key(defines);
+    GLuint program = 0;
+    if (is_binary_cache_supported) {
+        std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+        program = load_cached_program(program_key);
+        if (program != 0) {
+            cached_program_count++;
+            cache_load_ms += get_elapsed_ms(start_time);
+        }
+    }
+
+    if (program == 0) {
+        std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+        program = compile_program(defines);
+        compile_ms += get_elapsed_ms(start_time);
+        if (program == 0) {
+            return 0;
+        }
+
+        if (is_binary_cache_supported) {
+            store_cached_program(program, program_key);
+        }
+    }
+
+    programs.push_back({defines, program});
+    return program;
+}
+
+// --------------------------------------------------------------------------
+
+ShaderStatistics ShaderManager::get_statistics() const {
+    ShaderStatistics statistics;
+    statistics.program_count = programs.size();
+    statistics.cached_program_count = cached_program_count;
+    statistics.compile_ms = compile_ms;
+    statistics.cache_load_ms = cache_load_ms;
+    statistics.is_binary_cache_supported = is_binary_cache_supported;
+    return statistics;
+}
+
+// --------------------------------------------------------------------------
+
+std::string ShaderManager::get_defines(const ShaderVariant& variant) {
+    std::string defines;
+    if (variant.has_normals) {
+        defines += "#define HAS_NORMALS\n";
+    }
+    if (variant.has_texture_coordinates) {
+        defines += "#define HAS_TEXTURE_COORDINATES\n";
+    }
+    if (variant.has_quantized_positions) {
+        defines += "#define QUANTIZED_POSITIONS\n";
+    }
+    if (variant.has_octahedral_normals) {
+        defines += "#define OCTAHEDRAL_NORMALS\n";
+    }
+    if (variant.has_normal_matrix) {
+        defines += "#define NORMAL_MATRIX\n";
+    }
+    return defines;
+}
+
+// --------------------------------------------------------------------------
+
+std::string ShaderManager::add_defines(const std::string& source, const std::string& defines) {
+    // GLSL wants #version before anything else, so the defines go right after it, and #line
+    // keeps the line numbers in compile errors matching the file.
+    size_t version_start = source.find("#version");
+    if (version_start == std::string::npos) {
+        return defines + "#line 1\n" + source;
+    }
+
+    size_t version_end = source.find('\n', version_start);
+    if (version_end == std::string::npos) {
+        return source + "\n" + defines;
+    }
+
+    int version_line = std::count(source.begin(), source.begin() + version_end, '\n') + 1;
+    return source.substr(0, version_end + 1) + defines + "#line " + std::to_string(version_line + 1) + "\n" + source.substr(version_end + 1);
+}
+
+// --------------------------------------------------------------------------
+
+GLuint ShaderManager::compile_shader(GLenum shader_type, const std::string& source) {
+    GLuint shader = glCreateShader(shader_type);
+    const char* source_text = source.c_str();
+    glShaderSource(shader, 1, &source_text, nullptr);
+    glCompileShader(shader);
+
+    GLint success;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+    if (!success) {
+        char infoLog[512];
+        glGetShaderInfoLog(shader, 512, nullptr, infoLog);
+        std::cerr << (shader_type == GL_VERTEX_SHADER ? "vertex" : "fragment") << " shader compilation failed:\n" << infoLog << "\n";
+        glDeleteShader(shader);
+        return 0;
+    }
+
+    return shader;
+}
+
+// --------------------------------------------------------------------------
+
+GLuint ShaderManager::compile_program(const std::string& defines) {
+    GLuint vertex_shader = compile_shader(GL_VERTEX_SHADER, add_defines(vertex_shader_source, defines));
+    if (vertex_shader == 0) {
+        return 0;
+    }
+
+    GLuint fragment_shader = compile_shader(GL_FRAGMENT_SHADER, add_defines(fragment_shader_source, defines));
+    if (fragment_shader == 0) {
+        glDeleteShader(vertex_shader);
+        return 0;
+    }
+
+    GLuint program = glCreateProgram();
+    if (is_binary_cache_supported) {
+        glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+    glAttachShader(program, vertex_shader);
+    glAttachShader(program, fragment_shader);
+    glLinkProgram(program);
+
+    glDetachShader(program, vertex_shader);
+    glDetachShader(program, fragment_shader);
+    glDeleteShader(vertex_shader);
+    glDeleteShader(fragment_shader);
+
+    GLint success;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (!success) {
+        char infoLog[512];
+        glGetProgramInfoLog(program, 512, nullptr, infoLog);
+        std::cerr << "Program linking failed:\n" << infoLog << "\n";
+        glDeleteProgram(program);
+        return 0;
+    }
+
+    return program;
+}
+
+// --------------------------------------------------------------------------
+
+GLuint ShaderManager::load_cached_program(uint64_t program_key) {
+    // Returns 0 if there's no usable binary. Drivers reject binaries from other versions of
+    // themselves, which just means compiling again.
+    std::string cache_file_path = get_cache_file_path(program_key);
+    std::ifstream file(cache_file_path, std::ios::binary);
+    if (!file) {
+        return 0;
+    }
+
+    std::error_code error;
+    uintmax_t file_size = std::filesystem::file_size(cache_file_path, error);
+
+    CacheFileHeader header;
+    bool is_valid = !error && file.read(reinterpret_cast<char*>(&header), sizeof(CacheFileHeader))
+        && std::memcmp(header.magic, CACHE_FILE_MAGIC, sizeof(header.magic)) == 0
+        && header.version == CACHE_FORMAT_VERSION
+        && header.program_key == program_key
+        && header.binary_size > 0 && header.binary_size == file_size - sizeof(CacheFileHeader);
+    if (!is_valid) {
+        return 0;
+    }
+
+    std::vector<char> binary(header.binary_size);
+    if (!file.read(binary.data(), binary.size())) {
+        return 0;
+    }
+
+    GLuint program = glCreateProgram();
+    glProgramBinary(program, header.binary_format, binary.data(), binary.size());
+
+    GLint success;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (!success) {
+        glDeleteProgram(program);
+        return 0;
+    }
+
+    return program;
+}
+
+// --------------------------------------------------------------------------
+
+void ShaderManager::store_cached_program(GLuint program, uint64_t program_key) {
+    GLint binary_size = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &binary_size);
+    if (binary_size <= 0) {
+        return;
+    }
+
+    std::vector<char> binary(binary_size);
+    GLsizei written_size = 0;
+    GLenum binary_format = 0;
+    glGetProgramBinary(program, binary_size, &written_size, &binary_format, binary.data());
+    if (written_size <= 0) {
+        return;
+    }
+
+    std::error_code error;
+    std::filesystem::create_directories(cache_directory, error);
+    if (error) {
+        std::cerr << "[WARN] Could not create shader cache directory \"" << cache_directory << "\"" << std::endl;
+        return;
+    }
+
+    CacheFileHeader header;
+    std::memcpy(header.magic, CACHE_FILE_MAGIC, sizeof(header.magic));
+    header.version = CACHE_FORMAT_VERSION;
+    header.binary_format = binary_format;
+    header.program_key = program_key;
+    header.binary_size = written_size;
+
+    // Write to a temporary file and rename it into place, so concurrent viewers
+    // never load a half-written binary.
+    std::string cache_file_path = get_cache_file_path(program_key);
+    std::string temporary_file_path = cache_file_path + ".tmp" + std::to_string(getpid());
+    {
+        std::ofstream file(temporary_file_path, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char*>(&header), sizeof(CacheFileHeader));
+        file.write(binary.data(), written_size);
+
+        if (!file) {
+            std::cerr << "[WARN] Could not write shader cache \"" << temporary_file_path << "\"" << std::endl;
+            file.close();
+            std::remove(temporary_file_path.c_str());
+            return;
+        }
+    }
+
+    if (std::rename(temporary_file_path.c_str(), cache_file_path.c_str()) != 0) {
+        std::cerr << "[WARN] Could not write shader cache \"" << cache_file_path << "\"" << std::endl;
+        std::remove(temporary_file_path.c_str());
+    }
+}
+
+// --------------------------------------------------------------------------
+
+uint64_t ShaderManager::get_program_key(const std::string& defines) const {
+    std::string key_text = driver_name + '\0' + defines + '\0' + vertex_shader_source + '\0' + fragment_shader_source;
+    return compute_content_hash(key_text.data(), key_text.size());
+}
+
+// --------------------------------------------------------------------------
+
+std::string ShaderManager::get_cache_file_path(uint64_t program_key) const {
+    std::ostringstream cache_file_path;
+    cache_file_path << cache_directory << "/program-" << std::hex << std::setw(16) << std::setfill('0') << program_key << ".bin";
+    return cache_file_path.str();
+}
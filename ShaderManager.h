@@ -0,0 +1,92 @@
+#ifndef SHADER_MANAGER_H
+#define SHADER_MANAGER_H
+
+#include <GL/glew.h>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+// The features a shader program is specialized for. Each one becomes a #define in both
+// stages, so a variant only does the work its vertex layout and uniforms need.
+struct ShaderVariant {
+    bool has_normals;
+    bool has_texture_coordinates;
+    bool has_quantized_positions;
+    bool has_octahedral_normals;
+    bool has_normal_matrix;
+};
+
+struct ShaderStatistics {
+    int program_count;
+    int cached_program_count;
+    double compile_ms;
+    double cache_load_ms;
+    bool is_binary_cache_supported;
+};
+
+// Builds shader program variants from one pair of source files. Linked programs are kept
+// as driver binaries in a cache directory, keyed by a hash of the driver and the sources,
+// so later runs load them instead of compiling. Any change to either one just misses the
+// cache and compiles again.
+class ShaderManager {
+
+public:
+
+    ShaderManager();
+    ~ShaderManager();
+
+    ShaderManager(const ShaderManager&) = delete;
+    ShaderManager& operator=(const ShaderManager&) = delete;
+
+    bool load_sources(const std::string& vertex_shader_file_path, const std::string& fragment_shader_file_path);
+    void set_cache_directory(const std::string& cache_directory);
+
+    void initialize();
+    void destroy();
+
+    GLuint get_program(const ShaderVariant& variant);
+    ShaderStatistics get_statistics() const;
+
+    static std::string get_defines(const ShaderVariant& variant);
+
+private:
+
+    static const char CACHE_FILE_MAGIC[8];
+    static const uint32_t CACHE_FORMAT_VERSION = 1;
+
+    struct CacheFileHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t binary_format;
+        uint64_t program_key;
+        uint64_t binary_size;
+    };
+
+    struct Program {
+        std::string defines;
+        GLuint program;
+    };
+
+    static std::string add_defines(const std::string& source, const std::string& defines);
+    static GLuint compile_shader(GLenum shader_type, const std::string& source);
+
+    GLuint compile_program(const std::string& defines);
+    GLuint load_cached_program(uint64_t program_key);
+    void store_cached_program(GLuint program, uint64_t program_key);
+
+    uint64_t get_program_key(const std::string& defines) const;
+    std::string get_cache_file_path(uint64_t program_key) const;
+
+    std::string vertex_shader_source;
+    std::string fragment_shader_source;
+    std::string cache_directory;
+    std::string driver_name;
+    bool is_binary_cache_supported;
+
+    std::vector<Program> programs;
+    int cached_program_count;
+    double compile_ms;
+    double cache_load_ms;
+};
+
+#endif
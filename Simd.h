@@ -0,0 +1,153 @@
+#ifndef SIMD_H
+#define SIMD_H
+
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+
+// Minimal 4-wide float/int vector types used by the CPU-side geometry kernels.
+// Backed by SSE2 on x86-64, NEON on AArch64 and plain arrays everywhere else.
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define SIMD_SSE2 1
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define SIMD_NEON 1
+#endif
+
+#if defined(SIMD_SSE2)
+
+struct Float4 { __m128 value; };
+struct Int4 { __m128i value; };
+struct Mask4 { __m128 value; };
+
+inline Float4 float4_load(const float* values) { return {_mm_loadu_ps(values)}; }
+inline void float4_store(float* values, Float4 a) { _mm_storeu_ps(values, a.value); }
+inline Float4 float4_set(float x, float y, float z, float w) { return {_mm_setr_ps(x, y, z, w)}; }
+inline Float4 float4_splat(float value) { return {_mm_set1_ps(value)}; }
+
+inline Float4 operator+(Float4 a, Float4 b) { return {_mm_add_ps(a.value, b.value)}; }
+inline Float4 operator-(Float4 a, Float4 b) { return {_mm_sub_ps(a.value, b.value)}; }
+inline Float4 operator*(Float4 a, Float4 b) { return {_mm_mul_ps(a.value, b.value)}; }
+inline Float4 operator/(Float4 a, Float4 b) { return {_mm_div_ps(a.value, b.value)}; }
+
+inline Float4 float4_min(Float4 a, Float4 b) { return {_mm_min_ps(a.value, b.value)}; }
+inline Float4 float4_max(Float4 a, Float4 b) { return {_mm_max_ps(a.value, b.value)}; }
+inline Float4 float4_abs(Float4 a) { return {_mm_andnot_ps(_mm_set1_ps(-0.0f), a.value)}; }
+inline Float4 float4_sqrt(Float4 a) { return {_mm_sqrt_ps(a.value)}; }
+
+inline Mask4 float4_less(Float4 a, Float4 b) { return {_mm_cmplt_ps(a.value, b.value)}; }
+inline Mask4 float4_greater(Float4 a, Float4 b) { return {_mm_cmpgt_ps(a.value, b.value)}; }
+inline Mask4 float4_greater_equal(Float4 a, Float4 b) { return {_mm_cmpge_ps(a.value, b.value)}; }
+inline Mask4 operator&(Mask4 a, Mask4 b) { return {_mm_and_ps(a.value, b.value)}; }
+inline Mask4 operator|(Mask4 a, Mask4 b) { return {_mm_or_ps(a.value, b.value)}; }
+inline int mask4_bits(Mask4 mask) { return _mm_movemask_ps(mask.value); }
+inline Float4 float4_select(Mask4 mask, Float4 if_true, Float4 if_false) {
+    return {_mm_or_ps(_mm_and_ps(mask.value, if_true.value), _mm_andnot_ps(mask.value, if_false.value))};
+}
+
+inline Int4 float4_round_to_int(Float4 a) { return {_mm_cvtps_epi32(a.value)}; }
+inline Float4 int4_to_float(Int4 a) { return {_mm_cvtepi32_ps(a.value)}; }
+inline void int4_store(int32_t* values, Int4 a) { _mm_storeu_si128(reinterpret_cast<__m128i*>(values), a.value); }
+
+#elif defined(SIMD_NEON)
+
+struct Float4 { float32x4_t value; };
+struct Int4 { int32x4_t value; };
+struct Mask4 { uint32x4_t value; };
+
+inline Float4 float4_load(const float* values) { return {vld1q_f32(values)}; }
+inline void float4_store(float* values, Float4 a) { vst1q_f32(values, a.value); }
+inline Float4 float4_set(float x, float y, float z, float w) { float values[4] = {x, y, z, w}; return {vld1q_f32(values)}; }
+inline Float4 float4_splat(float value) { return {vdupq_n_f32(value)}; }
+
+inline Float4 operator+(Float4 a, Float4 b) { return {vaddq_f32(a.value, b.value)}; }
+inline Float4 operator-(Float4 a, Float4 b) { return {vsubq_f32(a.value, b.value)}; }
+inline Float4 operator*(Float4 a, Float4 b) { return {vmulq_f32(a.value, b.value)}; }
+inline Float4 operator/(Float4 a, Float4 b) { return {vdivq_f32(a.value, b.value)}; }
+
+inline Float4 float4_min(Float4 a, Float4 b) { return {vminq_f32(a.value, b.value)}; }
+inline Float4 float4_max(Float4 a, Float4 b) { return {vmaxq_f32(a.value, b.value)}; }
+inline Float4 float4_abs(Float4 a) { return {vabsq_f32(a.value)}; }
+inline Float4 float4_sqrt(Float4 a) { return {vsqrtq_f32(a.value)}; }
+
+inline Mask4 float4_less(Float4 a, Float4 b) { return {vcltq_f32(a.value, b.value)}; }
+inline Mask4 float4_greater(Float4 a, Float4 b) { return {vcgtq_f32(a.value, b.value)}; }
+inline Mask4 float4_greater_equal(Float4 a, Float4 b) { return {vcgeq_f32(a.value, b.value)}; }
+inline Mask4 operator&(Mask4 a, Mask4 b) { return {vandq_u32(a.value, b.value)}; }
+inline Mask4 operator|(Mask4 a, Mask4 b) { return {vorrq_u32(a.value, b.value)}; }
+inline int mask4_bits(Mask4 mask) {
+    uint32_t lanes[4];
+    vst1q_u32(lanes, mask.value);
+    return (lanes[0] & 1) | (lanes[1] & 2) | (lanes[2] & 4) | (lanes[3] & 8);
+}
+inline Float4 float4_select(Mask4 mask, Float4 if_true, Float4 if_false) { return {vbslq_f32(mask.value, if_true.value, if_false.value)}; }
+
+inline Int4 float4_round_to_int(Float4 a) { return {vcvtnq_s32_f32(a.value)}; }
+inline Float4 int4_to_float(Int4 a) { return {vcvtq_f32_s32(a.value)}; }
+inline void int4_store(int32_t* values, Int4 a) { vst1q_s32(values, a.value); }
+
+#else
+
+struct Float4 { float value[4]; };
+struct Int4 { int32_t value[4]; };
+struct Mask4 { bool value[4]; };
+
+#define SIMD_FOR_EACH_LANE(expression) for (int lane = 0; lane < 4; lane++) { expression; }
+
+inline Float4 float4_load(const float* values) { Float4 a; SIMD_FOR_EACH_LANE(a.value[lane] = values[lane]); return a; }
+inline void float4_store(float* values, Float4 a) { SIMD_FOR_EACH_LANE(values[lane] = a.value[lane]); }
+inline Float4 float4_set(float x, float y, float z, float w) { return {{x, y, z, w}}; }
+inline Float4 float4_splat(float value) { return {{value, value, value, value}}; }
+
+inline Float4 operator+(Float4 a, Float4 b) { SIMD_FOR_EACH_LANE(a.value[lane] += b.value[lane]); return a; }
+inline Float4 operator-(Float4 a, Float4 b) { SIMD_FOR_EACH_LANE(a.value[lane] -= b.value[lane]); return a; }
+inline Float4 operator*(Float4 a, Float4 b) { SIMD_FOR_EACH_LANE(a.value[lane] *= b.value[lane]); return a; }
+inline Float4 operator/(Float4 a, Float4 b) { SIMD_FOR_EACH_LANE(a.value[lane] /= b.value[lane]); return a; }
+
+inline Float4 float4_min(Float4 a, Float4 b) { SIMD_FOR_EACH_LANE(a.value[lane] = std::min(a.value[lane], b.value[lane])); return a; }
+inline Float4 float4_max(Float4 a, Float4 b) { SIMD_FOR_EACH_LANE(a.value[lane] = std::max(a.value[lane], b.value[lane])); return a; }
+inline Float4 float4_abs(Float4 a) { SIMD_FOR_EACH_LANE(a.value[lane] = std::fabs(a.value[lane])); return a; }
+inline Float4 float4_sqrt(Float4 a) { SIMD_FOR_EACH_LANE(a.value[lane] = std::sqrt(a.value[lane])); return a; }
+
+inline Mask4 float4_less(Float4 a, Float4 b) { Mask4 mask; SIMD_FOR_EACH_LANE(mask.value[lane] = a.value[lane] < b.value[lane]); return mask; }
+inline Mask4 float4_greater(Float4 a, Float4 b) { Mask4 mask; SIMD_FOR_EACH_LANE(mask.value[lane] = a.value[lane] > b.value[lane]); return mask; }
+inline Mask4 float4_greater_equal(Float4 a, Float4 b) { Mask4 mask; SIMD_FOR_EACH_LANE(mask.value[lane] = a.value[lane] >= b.value[lane]); return mask; }
+inline Mask4 operator&(Mask4 a, Mask4 b) { SIMD_FOR_EACH_LANE(a.value[lane] = a.value[lane] && b.value[lane]); return a; }
+inline Mask4 operator|(Mask4 a, Mask4 b) { SIMD_FOR_EACH_LANE(a.value[lane] = a.value[lane] || b.value[lane]); return a; }
+inline int mask4_bits(Mask4 mask) { int bits = 0; SIMD_FOR_EACH_LANE(bits |= mask.value[lane] << lane); return bits; }
+inline Float4 float4_select(Mask4 mask, Float4 if_true, Float4 if_false) {
+    SIMD_FOR_EACH_LANE(if_false.value[lane] = mask.value[lane] ? if_true.value[lane] : if_false.value[lane]);
+    return if_false;
+}
+
+inline Int4 float4_round_to_int(Float4 a) { Int4 b; SIMD_FOR_EACH_LANE(b.value[lane] = (int32_t)std::nearbyint(a.value[lane])); return b; }
+inline Float4 int4_to_float(Int4 a) { Float4 b; SIMD_FOR_EACH_LANE(b.value[lane] = (float)a.value[lane]); return b; }
+inline void int4_store(int32_t* values, Int4 a) { SIMD_FOR_EACH_LANE(values[lane] = a.value[lane]); }
+
+#undef SIMD_FOR_EACH_LANE
+
+#endif
+
+inline Float4 float4_clamp(Float4 a, Float4 low, Float4 high) {
+    return float4_min(float4_max(a, low), high);
+}
+
+inline Float4 float4_dot3(Float4 ax, Float4 ay, Float4 az, Float4 bx, Float4 by, Float4 bz) {
+    return ax * bx + ay * by + az * bz;
+}
+
+inline float float4_horizontal_min(Float4 a) {
+    float values[4];
+    float4_store(values, a);
+    return std::min(std::min(values[0], values[1]), std::min(values[2], values[3]));
+}
+
+inline float float4_horizontal_max(Float4 a) {
+    float values[4];
+    float4_store(values, a);
+    return std::max(std::max(values[0], values[1]), std::max(values[2], values[3]));
+}
+
+#endif
@@ -0,0 +1,521 @@
+#include "SoftwareRasterizer.h"
+
+#include <cmath>
+#include <chrono>
+#include <algorithm>
+
+#include "Simd.h"
+#include "Model.h"
+#include "ThreadPool.h"
+#include "JobScheduler.h"
+#include "Profiler.h"
+
+static double get_elapsed_ms(std::chrono::steady_clock::time_point start_time) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start_time).count();
+}
+
+// --------------------------------------------------------------------------
+
+SoftwareRasterizer::SoftwareRasterizer(int thread_count)
+:
+thread_count(thread_count > 0 ? thread_count : ThreadPool::get_hardware_thread_count()),
+job_scheduler(std::make_unique<JobScheduler>(this->thread_count)),
+width(0),
+height(0),
+depth_stride(0),
+tile_column_count(0),
+tile_row_count(0),
+vertex_data(nullptr),
+vertex_count(0),
+indices(nullptr),
+index_count(0),
+shading({glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.2f, 0.2f, 0.2f), glm::vec3(0.0f, 1.0f, 0.0f), 32.0f}),
+light_direction(0.0f, 0.0f, 1.0f),
+statistics({0, 0, 0.0, 0.0, 0.0, 0.0}) {
+    image.width = 0;
+    image.height = 0;
+}
+
+// --------------------------------------------------------------------------
+
+SoftwareRasterizer::~SoftwareRasterizer() {
+    // do nothing for now
+}
+
+// --------------------------------------------------------------------------
+
+void SoftwareRasterizer::resize(int width, int height) {
+    // Depth rows are padded to whole groups of four pixels, so every group can be loaded at once.
+    this->width = std::max(width, 0);
+    this->height = std::max(height, 0);
+    depth_stride = (this->width + 3) & ~3;
+    tile_column_count = (this->width + TILE_SIZE - 1) / TILE_SIZE;
+    tile_row_count = (this->height + TILE_SIZE - 1) / TILE_SIZE;
+
+    depth_buffer.assign((size_t)depth_stride * this->height, 1.0f);
+    visible_triangles.assign((size_t)this->width * this->height, nullptr);
+    visible_weights.assign((size_t)this->width * this->height, glm::vec2(0.0f, 0.0f));
+    image.width = this->width;
+    image.height = this->height;
+    image.pixels.assign((size_t)this->width * this->height * 4, 0);
+}
+
+// --------------------------------------------------------------------------
+
+void SoftwareRasterizer::set_shading(const RasterizerShading& shading) {
+    this->shading = shading;
+}
+
+// --------------------------------------------------------------------------
+
+void SoftwareRasterizer::set_mesh(const float* vertex_data, int vertex_count, const uint32_t* indices, int index_count) {
+    // The mesh isn't copied, so it has to outlive every render() that draws it.
+    this->vertex_data = vertex_data;
+    this->vertex_count = vertex_count;
+    this->indices = indices;
+    this->index_count = index_count;
+}
+
+// --------------------------------------------------------------------------
+
+void SoftwareRasterizer::render(const glm::mat4& model_matrix, const glm::mat4& view_matrix, const glm::mat4& projection_matrix, glm::vec3 camera_world_position) {
+    PROFILE_SCOPE("SoftwareRasterizer::render");
+
+    std::chrono::steady_clock::time_point frame_start_time = std::chrono::steady_clock::now();
+
+    statistics = {index_count / 3, 0, 0.0, 0.0, 0.0, 0.0};
+    light_direction = glm::normalize(-shading.sun_direction);
+
+    glm::mat4 model_view_projection = projection_matrix * view_matrix * model_matrix;
+
+    std::chrono::steady_clock::time_point phase_start_time = std::chrono::steady_clock::now();
+    transformed_vertices.resize(vertex_count);
+    run_tasks((vertex_count + VERTICES_PER_TASK - 1) / VERTICES_PER_TASK, [&](int task_index) {
+        transform_vertices(task_index, model_matrix, model_view_projection);
+    });
+    statistics.transform_ms = get_elapsed_ms(phase_start_time);
+
+    phase_start_time = std::chrono::steady_clock::now();
+    int triangle_task_count = (index_count / 3 + TRIANGLES_PER_TASK - 1) / TRIANGLES_PER_TASK;
+    task_triangles.resize(triangle_task_count);
+    task_tile_bins.resize(triangle_task_count);
+    run_tasks(triangle_task_count, [&](int task_index) {
+        set_up_triangles(task_index);
+    });
+    for (const std::vector<ScreenTriangle>& triangles : task_triangles) {
+        statistics.rasterized_triangle_count += triangles.size();
+    }
+    statistics.binning_ms = get_elapsed_ms(phase_start_time);
+
+    phase_start_time = std::chrono::steady_clock::now();
+    run_tasks(tile_column_count * tile_row_count, [&](int tile_index) {
+        rasterize_tile(tile_index, camera_world_position);
+    });
+    statistics.rasterization_ms = get_elapsed_ms(phase_start_time);
+
+    statistics.frame_ms = get_elapsed_ms(frame_start_time);
+}
+
+// --------------------------------------------------------------------------
+
+const Image& SoftwareRasterizer::get_image() const {
+    return image;
+}
+
+// --------------------------------------------------------------------------
+
+int SoftwareRasterizer::get_thread_count() const {
+    return thread_count;
+}
+
+// --------------------------------------------------------------------------
+
+const RasterizerStatistics& SoftwareRasterizer::get_statistics() const {
+    return statistics;
+}
+
+// --------------------------------------------------------------------------
+
+void SoftwareRasterizer::run_tasks(int task_count, const std::function<void(int)>& task) {
+    // One job per task, dealt out across the scheduler's queues. Tiles differ a lot in cost,
+    // so idle workers steal whatever is left rather than each getting a fixed share.
+    if (task_count == 1) {
+        task(0);
+        return;
+    }
+
+    for (int task_index = 0; task_index < task_count; task_index++) {
+        job_scheduler->submit([&task, task_index]() {
+            task(task_index);
+        });
+    }
+    job_scheduler->wait_for_all();
+}
+
+// --------------------------------------------------------------------------
+
+void SoftwareRasterizer::transform_vertices(int task_index, const glm::mat4& model_matrix, const glm::mat4& model_view_projection) {
+    // Each matrix column is one SIMD register, so a vertex takes three multiply-adds per matrix.
+    const int STRIDE = Model::FLOATS_PER_BUFFER_VERTEX;
+
+    glm::mat3 normal_matrix = glm::transpose(glm::inverse(glm::mat3(model_matrix)));
+
+    Float4 clip_columns[4];
+    Float4 world_columns[4];
+    Float4 normal_columns[3];
+    for (int column = 0; column < 4; column++) {
+        clip_columns[column] = float4_load(&model_view_projection[column][0]);
+        world_columns[column] = float4_load(&model_matrix[column][0]);
+    }
+    for (int column = 0; column < 3; column++) {
+        normal_columns[column] = float4_set(normal_matrix[column][0], normal_matrix[column][1], normal_matrix[column][2], 0.0f);
+    }
+
+    int first_vertex = task_index * VERTICES_PER_TASK;
+    int last_vertex = std::min(first_vertex + VERTICES_PER_TASK, vertex_count);
+    for (int i = first_vertex; i < last_vertex; i++) {
+        const float* vertex = &vertex_data[(size_t)i * STRIDE];
+        Float4 x = float4_splat(vertex[0]);
+        Float4 y = float4_splat(vertex[1]);
+        Float4 z = float4_splat(vertex[2]);
+
+        TransformedVertex& transformed_vertex = transformed_vertices[i];
+        float4_store(&transformed_vertex.clip_position[0], clip_columns[0] * x + clip_columns[1] * y + clip_columns[2] * z + clip_columns[3]);
+
+        float values[4];
+        float4_store(values, world_columns[0] * x + world_columns[1] * y + world_columns[2] * z + world_columns[3]);
+        transformed_vertex.world_position = glm::vec3(values[0], values[1], values[2]);
+
+        float4_store(values, normal_columns[0] * float4_splat(vertex[3]) + normal_columns[1] * float4_splat(vertex[4]) + normal_columns[2] * float4_splat(vertex[5]));
+        transformed_vertex.world_normal = glm::vec3(values[0], values[1], values[2]);
+    }
+}
+
+// --------------------------------------------------------------------------
+
+void SoftwareRasterizer::set_up_triangles(int task_index) {
+    // Triangles entirely outside one side of the view are dropped, and the rest are clipped
+    // against the near plane only. Anything else off screen is cut off by the tile bounds.
+    std::vector<ScreenTriangle>& triangles = task_triangles[task_index];
+    std::vector<std::vector<uint32_t>>& tile_bins = task_tile_bins[task_index];
+    triangles.clear();
+    tile_bins.resize(tile_column_count * tile_row_count);
+    for (std::vector<uint32_t>& tile_bin : tile_bins) {
+        tile_bin.clear();
+    }
+
+    int first_triangle = task_index * TRIANGLES_PER_TASK;
+    int last_triangle = std::min(first_triangle + TRIANGLES_PER_TASK, index_count / 3);
+    for (int triangle = first_triangle; triangle < last_triangle; triangle++) {
+        const TransformedVertex* corners[3] = {
+            &transformed_vertices[indices[triangle * 3]],
+            &transformed_vertices[indices[triangle * 3 + 1]],
+            &transformed_vertices[indices[triangle * 3 + 2]]
+        };
+
+        // One bit per corner and view plane: left, right, bottom, top, near, far.
+        int outside_all = 0x3F;
+        int outside_any = 0;
+        for (const TransformedVertex* corner : corners) {
+            const glm::vec4& position = corner->clip_position;
+            int outside = (position.x < -position.w ? 0x01 : 0) | (position.x > position.w ? 0x02 : 0)
+                | (position.y < -position.w ? 0x04 : 0) | (position.y > position.w ? 0x08 : 0)
+                | (position.z <= -position.w ? 0x10 : 0) | (position.z > position.w ? 0x20 : 0);
+            outside_all &= outside;
+            outside_any |= outside;
+        }
+
+        if (outside_all != 0) {
+            continue;
+        }
+
+        if ((outside_any & 0x10) == 0) {
+            add_screen_triangle(task_index, *corners[0], *corners[1], *corners[2]);
+            continue;
+        }
+
+        // Clipping a triangle against one plane leaves a triangle or a quad, drawn as a fan.
+        TransformedVertex polygon[4];
+        int polygon_size = 0;
+        for (int corner = 0; corner < 3; corner++) {
+            const TransformedVertex& current = *corners[corner];
+            const TransformedVertex& next = *corners[(corner + 1) % 3];
+            float current_distance = current.clip_position.z + current.clip_position.w;
+            float next_distance = next.clip_position.z + next.clip_position.w;
+
+            if (current_distance > 0.0f) {
+                polygon[polygon_size++] = current;
+            }
+
+            if ((current_distance > 0.0f) != (next_distance > 0.0f)) {
+                float t = current_distance / (current_distance - next_distance);
+                TransformedVertex& intersection = polygon[polygon_size++];
+                intersection.clip_position = glm::mix(current.clip_position, next.clip_position, t);
+                intersection.world_position = glm::mix(current.world_position, next.world_position, t);
+                intersection.world_normal = glm::mix(current.world_normal, next.world_normal, t);
+            }
+        }
+
+        for (int i = 1; i + 1 < polygon_size; i++) {
+            add_screen_triangle(task_index, polygon[0], polygon[i], polygon[i + 1]);
+        }
+    }
+}
+
+// --------------------------------------------------------------------------
+
+void SoftwareRasterizer::add_screen_triangle(int task_index, const TransformedVertex& a, const TransformedVertex& b, const TransformedVertex& c) {
+    // Both sides are drawn, as in the OpenGL renderer, so back-facing triangles are just rewound.
+    ScreenTriangle triangle;
+    triangle.vertices[0] = project(a);
+    triangle.vertices[1] = project(b);
+    triangle.vertices[2] = project(c);
+
+    const ScreenVertex& v0 = triangle.vertices[0];
+    const ScreenVertex& v1 = triangle.vertices[1];
+    const ScreenVertex& v2 = triangle.vertices[2];
+    triangle.area = (v1.x - v0.x) * (v2.y - v0.y) - (v2.x - v0.x) * (v1.y - v0.y);
+    if (!(triangle.area != 0.0f) || !std::isfinite(triangle.area)) {
+        return;
+    }
+    if (triangle.area < 0.0f) {
+        std::swap(triangle.vertices[1], triangle.vertices[2]);
+        triangle.area = -triangle.area;
+    }
+
+    // Pixels whose centers the triangle's bounds cover, clamped to the screen.
+    float min_x = std::min({v0.x, v1.x, v2.x});
+    float max_x = std::max({v0.x, v1.x, v2.x});
+    float min_y = std::min({v0.y, v1.y, v2.y});
+    float max_y = std::max({v0.y, v1.y, v2.y});
+    triangle.min_x = (int)std::ceil(std::clamp(min_x - 0.5f, 0.0f, (float)width));
+    triangle.max_x = (int)std::floor(std::clamp(max_x - 0.5f, -1.0f, (float)width - 1.0f));
+    triangle.min_y = (int)std::ceil(std::clamp(min_y - 0.5f, 0.0f, (float)height));
+    triangle.max_y = (int)std::floor(std::clamp(max_y - 0.5f, -1.0f, (float)height - 1.0f));
+    if (triangle.min_x > triangle.max_x || triangle.min_y > triangle.max_y) {
+        return;
+    }
+
+    std::vector<ScreenTriangle>& triangles = task_triangles[task_index];
+    std::vector<std::vector<uint32_t>>& tile_bins = task_tile_bins[task_index];
+    uint32_t triangle_index = triangles.size();
+    triangles.push_back(triangle);
+
+    for (int tile_y = triangle.min_y / TILE_SIZE; tile_y <= triangle.max_y / TILE_SIZE; tile_y++) {
+        for (int tile_x = triangle.min_x / TILE_SIZE; tile_x <= triangle.max_x / TILE_SIZE; tile_x++) {
+            tile_bins[tile_y * tile_column_count + tile_x].push_back(triangle_index);
+        }
+    }
+}
+
+// --------------------------------------------------------------------------
+
+SoftwareRasterizer::ScreenVertex SoftwareRasterizer::project(const TransformedVertex& vertex) const {
+    // Screen rows go from the top down, like the image, and depth maps to 0..1 as in OpenGL.
+    float inverse_w = 1.0f / vertex.clip_position.w;
+
+    ScreenVertex screen_vertex;
+    screen_vertex.x = (vertex.clip_position.x * inverse_w * 0.5f + 0.5f) * width;
+    screen_vertex.y = (0.5f - vertex.clip_position.y * inverse_w * 0.5f) * height;
+    screen_vertex.z = vertex.clip_position.z * inverse_w * 0.5f + 0.5f;
+    screen_vertex.inverse_w = inverse_w;
+    screen_vertex.world_position_over_w = vertex.world_position * inverse_w;
+    screen_vertex.world_normal_over_w = vertex.world_normal * inverse_w;
+    return screen_vertex;
+}
+
+// --------------------------------------------------------------------------
+
+void SoftwareRasterizer::rasterize_tile(int tile_index, glm::vec3 camera_world_position) {
+    // Each tile clears its own part of the buffers, then draws the triangles binned to it in
+    // submission order, so ties in depth resolve the same way on every run. Only the nearest
+    // triangle at each pixel is remembered, and pixels are shaded once at the end, so hidden
+    // surfaces cost a depth test rather than the lighting.
+    int tile_min_x = (tile_index % tile_column_count) * TILE_SIZE;
+    int tile_min_y = (tile_index / tile_column_count) * TILE_SIZE;
+    int tile_max_x = std::min(tile_min_x + TILE_SIZE, width) - 1;
+    int tile_max_y = std::min(tile_min_y + TILE_SIZE, height) - 1;
+    int tile_width = tile_max_x - tile_min_x + 1;
+
+    for (int y = tile_min_y; y <= tile_max_y; y++) {
+        std::fill_n(&depth_buffer[(size_t)y * depth_stride + tile_min_x], tile_width, 1.0f);
+        std::fill_n(&visible_triangles[(size_t)y * width + tile_min_x], tile_width, nullptr);
+    }
+
+    for (size_t task_index = 0; task_index < task_tile_bins.size(); task_index++) {
+        const std::vector<ScreenTriangle>& triangles = task_triangles[task_index];
+        for (uint32_t triangle_index : task_tile_bins[task_index][tile_index]) {
+            rasterize_triangle(triangles[triangle_index], tile_min_x, tile_min_y, tile_max_x, tile_max_y);
+        }
+    }
+
+    for (int y = tile_min_y; y <= tile_max_y; y++) {
+        size_t pixel_index = (size_t)y * width + tile_min_x;
+        for (int x = tile_min_x; x <= tile_max_x; x++, pixel_index++) {
+            unsigned char* pixel = &image.pixels[pixel_index * 4];
+            const ScreenTriangle* triangle = visible_triangles[pixel_index];
+            if (triangle == nullptr) {
+                pixel[0] = 0;
+                pixel[1] = 0;
+                pixel[2] = 0;
+                pixel[3] = 255;
+                continue;
+            }
+
+            glm::vec2 weights = visible_weights[pixel_index];
+            shade_pixel(*triangle, 1.0f - weights.x - weights.y, weights.x, weights.y, camera_world_position, pixel);
+        }
+    }
+}
+
+// --------------------------------------------------------------------------
+
+void SoftwareRasterizer::rasterize_triangle(const ScreenTriangle& triangle, int tile_min_x, int tile_min_y, int tile_max_x, int tile_max_y) {
+    // Edge functions and depth are tested four pixels at a time. Each edge function is the
+    // weight of the opposite corner, scaled by the triangle's area.
+    const ScreenVertex& v0 = triangle.vertices[0];
+    const ScreenVertex& v1 = triangle.vertices[1];
+    const ScreenVertex& v2 = triangle.vertices[2];
+
+    int min_x = std::max(triangle.min_x, tile_min_x);
+    int max_x = std::min(triangle.max_x, tile_max_x);
+    int min_y = std::max(triangle.min_y, tile_min_y);
+    int max_y = std::min(triangle.max_y, tile_max_y);
+    if (min_x > max_x || min_y > max_y) {
+        return;
+    }
+
+    // Edge from a to b: (b.x - a.x) * (y - a.y) - (b.y - a.y) * (x - a.x).
+    auto get_edge_step_x = [](const ScreenVertex& a, const ScreenVertex& b) { return -(b.y - a.y); };
+    auto get_edge_step_y = [](const ScreenVertex& a, const ScreenVertex& b) { return b.x - a.x; };
+    auto get_edge_value = [](const ScreenVertex& a, const ScreenVertex& b, float x, float y) { return (b.x - a.x) * (y - a.y) - (b.y - a.y) * (x - a.x); };
+
+    float step_x[3] = {get_edge_step_x(v1, v2), get_edge_step_x(v2, v0), get_edge_step_x(v0, v1)};
+    float step_y[3] = {get_edge_step_y(v1, v2), get_edge_step_y(v2, v0), get_edge_step_y(v0, v1)};
+
+    // Groups of four start on multiples of four, matching the depth buffer's padding.
+    int first_group_x = min_x & ~3;
+    float first_x = first_group_x + 0.5f;
+    float first_y = min_y + 0.5f;
+    float row_values[3] = {
+        get_edge_value(v1, v2, first_x, first_y),
+        get_edge_value(v2, v0, first_x, first_y),
+        get_edge_value(v0, v1, first_x, first_y)
+    };
+
+    Float4 lane_offsets = float4_set(0.0f, 1.0f, 2.0f, 3.0f);
+    Float4 group_steps[3];
+    Float4 lane_steps[3];
+    for (int edge = 0; edge < 3; edge++) {
+        group_steps[edge] = float4_splat(4.0f * step_x[edge]);
+        lane_steps[edge] = lane_offsets * float4_splat(step_x[edge]);
+    }
+
+    float inverse_area = 1.0f / triangle.area;
+    Float4 depth_weights[3] = {float4_splat(v0.z * inverse_area), float4_splat(v1.z * inverse_area), float4_splat(v2.z * inverse_area)};
+    Float4 zero = float4_splat(0.0f);
+    Float4 column_min = float4_splat(min_x - 0.5f);
+    Float4 column_max = float4_splat(max_x + 0.5f);
+
+    for (int y = min_y; y <= max_y; y++) {
+        // Each edge bounds the row on one side, so long thin triangles only test the pixels
+        // near their span rather than their whole bounds. The bounds are widened by a pixel
+        // against rounding, since the edge tests below decide coverage exactly.
+        float span_min_x = min_x;
+        float span_max_x = max_x;
+        for (int edge = 0; edge < 3; edge++) {
+            if (step_x[edge] == 0.0f) {
+                span_max_x = row_values[edge] < 0.0f ? -1.0f : span_max_x;
+                continue;
+            }
+
+            float crossing_x = first_group_x - row_values[edge] / step_x[edge];
+            if (step_x[edge] > 0.0f) {
+                span_min_x = std::max(span_min_x, crossing_x - 1.0f);
+            } else {
+                span_max_x = std::min(span_max_x, crossing_x + 1.0f);
+            }
+        }
+
+        float row_edge_values[3] = {row_values[0], row_values[1], row_values[2]};
+        for (int edge = 0; edge < 3; edge++) {
+            row_values[edge] += step_y[edge];
+        }
+
+        if (!(span_min_x <= span_max_x)) {
+            continue;
+        }
+
+        int span_first_x = (int)std::ceil(span_min_x) & ~3;
+        int span_last_x = (int)std::floor(span_max_x);
+
+        Float4 edges[3];
+        for (int edge = 0; edge < 3; edge++) {
+            edges[edge] = float4_splat(row_edge_values[edge] + step_x[edge] * (span_first_x - first_group_x)) + lane_steps[edge];
+        }
+
+        float* depth_row = &depth_buffer[(size_t)y * depth_stride];
+        size_t row_start = (size_t)y * width;
+        Float4 column = float4_splat((float)span_first_x) + lane_offsets;
+
+        for (int x = span_first_x; x <= span_last_x; x += 4) {
+            Mask4 is_inside = float4_greater_equal(edges[0], zero) & float4_greater_equal(edges[1], zero) & float4_greater_equal(edges[2], zero)
+                & float4_greater(column, column_min) & float4_less(column, column_max);
+
+            if (mask4_bits(is_inside) != 0) {
+                Float4 depth = edges[0] * depth_weights[0] + edges[1] * depth_weights[1] + edges[2] * depth_weights[2];
+                Float4 stored_depth = float4_load(depth_row + x);
+                Mask4 is_visible = is_inside & float4_less(depth, stored_depth);
+
+                int visible_bits = mask4_bits(is_visible);
+                if (visible_bits != 0) {
+                    float4_store(depth_row + x, float4_select(is_visible, depth, stored_depth));
+
+                    float lane_edges[2][4];
+                    float4_store(lane_edges[0], edges[1]);
+                    float4_store(lane_edges[1], edges[2]);
+
+                    for (int lane = 0; lane < 4; lane++) {
+                        if ((visible_bits & (1 << lane)) != 0) {
+                            visible_triangles[row_start + x + lane] = &triangle;
+                            visible_weights[row_start + x + lane] = glm::vec2(lane_edges[0][lane] * inverse_area, lane_edges[1][lane] * inverse_area);
+                        }
+                    }
+                }
+            }
+
+            for (int edge = 0; edge < 3; edge++) {
+                edges[edge] = edges[edge] + group_steps[edge];
+            }
+            column = column + float4_splat(4.0f);
+        }
+    }
+}
+
+// --------------------------------------------------------------------------
+
+void SoftwareRasterizer::shade_pixel(const ScreenTriangle& triangle, float weight_0, float weight_1, float weight_2, glm::vec3 camera_world_position, unsigned char* pixel) {
+    // Blinn-Phong, exactly as default.frag computes it.
+    const ScreenVertex& v0 = triangle.vertices[0];
+    const ScreenVertex& v1 = triangle.vertices[1];
+    const ScreenVertex& v2 = triangle.vertices[2];
+
+    float inverse_w = weight_0 * v0.inverse_w + weight_1 * v1.inverse_w + weight_2 * v2.inverse_w;
+    glm::vec3 world_position = (weight_0 * v0.world_position_over_w + weight_1 * v1.world_position_over_w + weight_2 * v2.world_position_over_w) / inverse_w;
+    glm::vec3 normal = weight_0 * v0.world_normal_over_w + weight_1 * v1.world_normal_over_w + weight_2 * v2.world_normal_over_w;
+
+    float normal_length = glm::length(normal);
+    glm::vec3 n = normal_length > 0.0f ? normal / normal_length : glm::vec3(0.0f, 0.0f, 0.0f);
+    glm::vec3 v = glm::normalize(camera_world_position - world_position);
+    glm::vec3 h = glm::normalize(light_direction + v);
+
+    glm::vec3 ambient = shading.ambient_light * shading.base_color;
+    glm::vec3 diffuse = std::max(glm::dot(n, light_direction), 0.0f) * shading.base_color;
+    float specular_amount = std::pow(std::max(glm::dot(n, h), 0.0f), shading.shininess);
+
+    glm::vec3 color = glm::clamp(ambient + diffuse + glm::vec3(specular_amount), 0.0f, 1.0f);
+    pixel[0] = (unsigned char)(color.x * 255.0f + 0.5f);
+    pixel[1] = (unsigned char)(color.y * 255.0f + 0.5f);
+    pixel[2] = (unsigned char)(color.z * 255.0f + 0.5f);
+    pixel[3] = 255;
+}
@@ -0,0 +1,127 @@
+#ifndef SOFTWARE_RASTERIZER_H
+#define SOFTWARE_RASTERIZER_H
+
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <functional>
+#include <glm/glm.hpp>
+
+#include "ImageDecoder.h"
+
+class JobScheduler;
+
+// The lighting inputs of default.frag.
+struct RasterizerShading {
+    glm::vec3 sun_direction;
+    glm::vec3 ambient_light;
+    glm::vec3 base_color;
+    float shininess;
+};
+
+struct RasterizerStatistics {
+    int triangle_count;
+    int rasterized_triangle_count;
+    double transform_ms;
+    double binning_ms;
+    double rasterization_ms;
+    double frame_ms;
+};
+
+// Draws a mesh in the viewer's float vertex layout on the CPU, for machines without a GPU.
+// Vertices are transformed in parallel, triangles are clipped against the near plane and
+// sorted into screen tiles, and then every tile is rasterized, depth tested and shaded on
+// its own. The image doesn't depend on the thread count.
+class SoftwareRasterizer {
+
+public:
+
+    SoftwareRasterizer(int thread_count = 0);
+    ~SoftwareRasterizer();
+
+    SoftwareRasterizer(const SoftwareRasterizer&) = delete;
+    SoftwareRasterizer& operator=(const SoftwareRasterizer&) = delete;
+
+    void resize(int width, int height);
+    void set_shading(const RasterizerShading& shading);
+    void set_mesh(const float* vertex_data, int vertex_count, const uint32_t* indices, int index_count);
+
+    void render(const glm::mat4& model_matrix, const glm::mat4& view_matrix, const glm::mat4& projection_matrix, glm::vec3 camera_world_position);
+
+    const Image& get_image() const;
+    int get_thread_count() const;
+    const RasterizerStatistics& get_statistics() const;
+
+private:
+
+    static const int TILE_SIZE = 64;
+    static const int VERTICES_PER_TASK = 1 << 14;
+    static const int TRIANGLES_PER_TASK = 1 << 14;
+
+    struct TransformedVertex {
+        glm::vec4 clip_position;
+        glm::vec3 world_position;
+        glm::vec3 world_normal;
+    };
+
+    // Attributes are stored divided by w, so they interpolate linearly across the screen.
+    struct ScreenVertex {
+        float x;
+        float y;
+        float z;
+        float inverse_w;
+        glm::vec3 world_position_over_w;
+        glm::vec3 world_normal_over_w;
+    };
+
+    // Vertices wind so that the signed area is positive, with tile bounds in pixels.
+    struct ScreenTriangle {
+        ScreenVertex vertices[3];
+        float area;
+        int min_x;
+        int min_y;
+        int max_x;
+        int max_y;
+    };
+
+    void run_tasks(int task_count, const std::function<void(int)>& task);
+
+    void transform_vertices(int task_index, const glm::mat4& model_matrix, const glm::mat4& model_view_projection);
+    void set_up_triangles(int task_index);
+    void add_screen_triangle(int task_index, const TransformedVertex& a, const TransformedVertex& b, const TransformedVertex& c);
+    ScreenVertex project(const TransformedVertex& vertex) const;
+
+    void rasterize_tile(int tile_index, glm::vec3 camera_world_position);
+    void rasterize_triangle(const ScreenTriangle& triangle, int tile_min_x, int tile_min_y, int tile_max_x, int tile_max_y);
+    void shade_pixel(const ScreenTriangle& triangle, float weight_0, float weight_1, float weight_2, glm::vec3 camera_world_position, unsigned char* pixel);
+
+    int thread_count;
+    std::unique_ptr<JobScheduler> job_scheduler;
+
+    int width;
+    int height;
+    int depth_stride;
+    int tile_column_count;
+    int tile_row_count;
+
+    const float* vertex_data;
+    int vertex_count;
+    const uint32_t* indices;
+    int index_count;
+
+    RasterizerShading shading;
+    glm::vec3 light_direction;
+    RasterizerStatistics statistics;
+
+    std::vector<TransformedVertex> transformed_vertices;
+    std::vector<std::vector<ScreenTriangle>> task_triangles;
+    std::vector<std::vector<std::vector<uint32_t>>> task_tile_bins;
+    std::vector<float> depth_buffer;
+
+    // The nearest triangle at each pixel and the weights of its second and third corners.
+    std::vector<const ScreenTriangle*> visible_triangles;
+    std::vector<glm::vec2> visible_weights;
+    Image image;
+};
+
+#endif
@@ -0,0 +1,423 @@
+#include "StreamingModelLoader.h"
+
+#include <cstring>
+#include <cctype>
+#include <limits>
+#include <iostream>
+#include <algorithm>
+#include <vector>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "ObjLoader.h"
+#include "Profiler.h"
+#include "MemoryTracker.h"
+
+StreamingModelLoader::StreamingModelLoader()
+:
+batch_size_in_bytes(16 * 1024 * 1024),
+vertex_destination(nullptr),
+file_descriptor(-1),
+total_vertex_count(0),
+queued_vertex_count(0),
+extents_vertex_count(0),
+is_loading(false),
+is_stopping(false),
+succeeded(false),
+statistics() {
+    const float MAX_FLOAT_VALUE = std::numeric_limits<float>::max();
+    extents.min = glm::vec3(MAX_FLOAT_VALUE, MAX_FLOAT_VALUE, MAX_FLOAT_VALUE);
+    extents.max = glm::vec3(-MAX_FLOAT_VALUE, -MAX_FLOAT_VALUE, -MAX_FLOAT_VALUE);
+}
+
+// --------------------------------------------------------------------------
+
+StreamingModelLoader::~StreamingModelLoader() {
+    stop();
+
+    for (const StreamedBatch& batch : batches) {
+        if (batch.vertex_data != nullptr) {
+            MemoryTracker::get_instance().remove_allocation(MemorySubsystem::LOADER, batch.size_in_bytes);
+        }
+    }
+}
+
+// --------------------------------------------------------------------------
+
+void StreamingModelLoader::set_batch_size(size_t batch_size_in_bytes) {
+    this->batch_size_in_bytes = batch_size_in_bytes;
+}
+
+// --------------------------------------------------------------------------
+
+void StreamingModelLoader::set_vertex_destination(unsigned char* vertex_destination) {
+    // Gives the loader somewhere to write every vertex of the file, such as a persistently
+    // mapped GPU buffer of get_total_vertex_count() vertices. Batches written there are
+    // queued without data, and only tell the caller how many vertices are ready. Followed
+    // files have no total, so their batches always carry their data.
+    this->vertex_destination = vertex_destination;
+}
+
+// --------------------------------------------------------------------------
+
+bool StreamingModelLoader::start(const std::string& file_path) {
+    if (!file.open(file_path)) {
+        return false;
+    }
+
+    // Counting faces up front is a cheap scan of line starts, and lets the caller
+    // size the GPU buffer once before the first batch arrives.
+    total_vertex_count = 3 * count_faces(file.get_data(), file.get_data() + file.get_size());
+
+    is_loading = true;
+    loader_thread = std::thread(&StreamingModelLoader::load_batches, this);
+
+    return true;
+}
+
+// --------------------------------------------------------------------------
+
+bool StreamingModelLoader::follow(const std::string& file_path) {
+    // Like start(), but the file may still be being written. Everything already in it is
+    // streamed first, and then every line appended to it, until stop() is called or the file
+    // is truncated or deleted.
+    file_descriptor = ::open(file_path.c_str(), O_RDONLY);
+    if (file_descriptor < 0) {
+        return false;
+    }
+
+    struct stat file_status;
+    if (fstat(file_descriptor, &file_status) != 0 || !S_ISREG(file_status.st_mode) || !file_watcher.open(file_path)) {
+        ::close(file_descriptor);
+        file_descriptor = -1;
+        return false;
+    }
+
+    this->file_path = file_path;
+    is_loading = true;
+    loader_thread = std::thread(&StreamingModelLoader::follow_appended_lines, this);
+
+    return true;
+}
+
+// --------------------------------------------------------------------------
+
+void StreamingModelLoader::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        is_stopping = true;
+    }
+    batch_consumed.notify_all();
+
+    if (loader_thread.joinable()) {
+        loader_thread.join();
+    }
+}
+
+// --------------------------------------------------------------------------
+
+int StreamingModelLoader::get_total_vertex_count() {
+    return total_vertex_count;
+}
+
+// --------------------------------------------------------------------------
+
+std::optional<StreamedBatch> StreamingModelLoader::poll_batch() {
+    std::optional<StreamedBatch> batch;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (batches.empty()) {
+            return std::nullopt;
+        }
+
+        batch = std::move(batches.front());
+        batches.pop_front();
+    }
+    batch_consumed.notify_one();
+
+    // The renderer uploads and frees a batch as soon as it takes one, so only queued ones count.
+    if (batch->vertex_data != nullptr) {
+        MemoryTracker::get_instance().remove_allocation(MemorySubsystem::LOADER, batch->size_in_bytes);
+    }
+
+    return batch;
+}
+
+// --------------------------------------------------------------------------
+
+bool StreamingModelLoader::is_finished() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return !is_loading && batches.empty();
+}
+
+// --------------------------------------------------------------------------
+
+bool StreamingModelLoader::has_failed() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return !is_loading && !succeeded;
+}
+
+// --------------------------------------------------------------------------
+
+ModelStatistics StreamingModelLoader::get_statistics() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return statistics;
+}
+
+// --------------------------------------------------------------------------
+
+int StreamingModelLoader::count_faces(const char* begin, const char* end) {
+    int face_count = 0;
+
+    const char* line_start = begin;
+    while (line_start < end) {
+        const char* line_end = static_cast<const char*>(std::memchr(line_start, '\n', end - line_start));
+        if (line_end == nullptr) {
+            line_end = end;
+        }
+
+        const char* c = line_start;
+        while (c < line_end && std::isspace(static_cast<unsigned char>(*c))) {
+            c++;
+        }
+
+        if (c < line_end && *c == 'f' && (c + 1 == line_end || *(c + 1) == '#' || std::isspace(static_cast<unsigned char>(*(c + 1))))) {
+            face_count++;
+        }
+
+        line_start = line_end + 1;
+    }
+
+    return face_count;
+}
+
+// --------------------------------------------------------------------------
+
+bool StreamingModelLoader::has_valid_indices(const Model& model, size_t earlier_face_count) {
+    // A face could name a vertex the file doesn't have, or one that a file that's still being
+    // written hasn't written yet. earlier_face_count is how many faces were cleared before these, for error messages.
+    int vertex_count = model.get_vertices().size();
+    int normal_count = model.get_normals().size();
+
+    const ModelArray<Face>& faces = model.get_faces();
+    for (size_t face_index = 0; face_index < faces.size(); face_index++) {
+        for (int i = 0; i < 3; i++) {
+            int vertex_index = faces[face_index].vertex_indices[i];
+            int normal_index = faces[face_index].normal_indices[i];
+            if (vertex_index < 0 || vertex_index >= vertex_count || normal_index < -1 || normal_index >= normal_count) {
+                std::cerr << "[ERROR] Face " << (earlier_face_count + face_index + 1) << " refers to a vertex or normal that isn't in the file" << std::endl;
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+// --------------------------------------------------------------------------
+
+void StreamingModelLoader::load_batches() {
+    // Faces are dropped after every batch, but any face may refer to any earlier vertex, normal
+    // or texture coordinate, so those are all kept until the file is done. Memory use grows
+    // with the file's attributes, and only the faces and GPU-ready batches stay bounded.
+    int faces_per_batch = (int)std::max<size_t>(batch_size_in_bytes / (3 * Model::FLOATS_PER_BUFFER_VERTEX * sizeof(float)), 1);
+
+    ModelStatistics final_statistics = {};
+    ObjLoader obj_loader;
+    bool load_succeeded = obj_loader.load_in_batches(file.get_data(), file.get_data() + file.get_size(), faces_per_batch, [&](Model& model) {
+        final_statistics.vertex_count = model.get_vertices().size();
+        final_statistics.normal_count = model.get_normals().size();
+        final_statistics.texture_coordinate_count = model.get_texture_coordinates().size();
+        size_t earlier_face_count = final_statistics.face_count;
+        final_statistics.face_count += model.get_faces().size();
+        return queue_batch(model, earlier_face_count);
+    });
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        is_loading = false;
+        succeeded = load_succeeded;
+        statistics = final_statistics;
+    }
+
+    file.close();
+}
+
+// --------------------------------------------------------------------------
+
+void StreamingModelLoader::follow_appended_lines() {
+    // Each pass reads only what was appended since the last one and parses it up to its last
+    // newline. The unfinished line after that waits for the writer to finish it, so no byte
+    // is read or parsed twice and an append costs the same however large the file has grown.
+    // Faces are cleared once they're queued, as load_in_batches() does, so only the vertices
+    // and normals that later faces may refer to are kept.
+    Model model;
+    ObjLoader obj_loader;
+    std::vector<char, TrackedAllocator<char, MemorySubsystem::LOADER>> read_buffer(FOLLOW_READ_SIZE);
+    std::string unparsed_text;
+    off_t file_offset = 0;
+    size_t face_count = 0;
+    bool load_succeeded = true;
+
+    while (!is_stop_requested()) {
+        ssize_t read_size = pread(file_descriptor, read_buffer.data(), read_buffer.size(), file_offset);
+        if (read_size < 0) {
+            std::cerr << "[ERROR] Could not read \"" << file_path << "\"" << std::endl;
+            load_succeeded = false;
+            break;
+        }
+
+        if (read_size == 0) {
+            // Caught up with the writer. A file that's shorter than what was read has been
+            // rewritten rather than appended to, and a deleted one won't grow any more.
+            struct stat file_status;
+            bool has_status = fstat(file_descriptor, &file_status) == 0;
+            if (has_status && file_status.st_size < file_offset) {
+                std::cerr << "[WARN] \"" << file_path << "\" was truncated, so it's no longer followed" << std::endl;
+                break;
+            }
+            if (has_status && file_status.st_nlink == 0) {
+                std::cerr << "[WARN] \"" << file_path << "\" was deleted, so it's no longer followed" << std::endl;
+                break;
+            }
+
+            file_watcher.wait_for_change(FOLLOW_POLL_INTERVAL_MS);
+            continue;
+        }
+
+        PROFILE_SCOPE("follow appended lines");
+
+        std::chrono::steady_clock::time_point read_time = std::chrono::steady_clock::now();
+        file_offset += read_size;
+        unparsed_text.append(read_buffer.data(), read_size);
+
+        size_t last_newline = unparsed_text.rfind('\n');
+        if (last_newline == std::string::npos) {
+            continue;
+        }
+
+        if (!obj_loader.load_lines(unparsed_text.data(), unparsed_text.data() + last_newline + 1, model)) {
+            load_succeeded = false;
+            break;
+        }
+        unparsed_text.erase(0, last_newline + 1);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            statistics.vertex_count = model.get_vertices().size();
+            statistics.normal_count = model.get_normals().size();
+            statistics.texture_coordinate_count = model.get_texture_coordinates().size();
+            statistics.face_count = face_count + model.get_faces().size();
+        }
+
+        if (!model.get_faces().empty() && !queue_appended_faces(model, face_count, read_time)) {
+            load_succeeded = false;
+            break;
+        }
+        face_count += model.get_faces().size();
+        model.clear_faces();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        is_loading = false;
+        succeeded = load_succeeded;
+    }
+
+    file_watcher.close();
+    ::close(file_descriptor);
+    file_descriptor = -1;
+}
+
+// --------------------------------------------------------------------------
+
+bool StreamingModelLoader::queue_batch(Model& model, size_t earlier_face_count) {
+    if (!has_valid_indices(model, earlier_face_count)) {
+        return false;
+    }
+
+    update_extents(model);
+
+    StreamedBatch batch;
+    batch.vertex_count = model.get_faces().size() * 3;
+    batch.size_in_bytes = batch.vertex_count * Model::FLOATS_PER_BUFFER_VERTEX * sizeof(float);
+    batch.extents = extents;
+    batch.read_time = std::chrono::steady_clock::now();
+
+    if (queued_vertex_count + batch.vertex_count > total_vertex_count) {
+        std::cerr << "[ERROR] Streamed more faces than the file was counted to contain!" << std::endl;
+        return false;
+    }
+
+    unsigned char* destination = vertex_destination.load();
+    if (destination != nullptr) {
+        size_t batch_offset = (size_t)queued_vertex_count * Model::FLOATS_PER_BUFFER_VERTEX * sizeof(float);
+        model.write_buffer_data(reinterpret_cast<float*>(destination + batch_offset));
+    } else {
+        batch.vertex_data = std::move(model.get_buffer_data().data);
+    }
+
+    queued_vertex_count += batch.vertex_count;
+
+    return push_batch(std::move(batch));
+}
+
+// --------------------------------------------------------------------------
+
+bool StreamingModelLoader::queue_appended_faces(const Model& model, size_t earlier_face_count, std::chrono::steady_clock::time_point read_time) {
+    if (!has_valid_indices(model, earlier_face_count)) {
+        return false;
+    }
+
+    update_extents(model);
+
+    StreamedBatch batch;
+    batch.vertex_count = model.get_faces().size() * 3;
+    batch.size_in_bytes = batch.vertex_count * Model::FLOATS_PER_BUFFER_VERTEX * sizeof(float);
+    batch.extents = extents;
+    batch.read_time = read_time;
+
+    batch.vertex_data.reset(new float[batch.vertex_count * Model::FLOATS_PER_BUFFER_VERTEX]);
+    model.write_buffer_data(batch.vertex_data.get());
+
+    return push_batch(std::move(batch));
+}
+
+// --------------------------------------------------------------------------
+
+bool StreamingModelLoader::push_batch(StreamedBatch batch) {
+    // Waiting for the renderer to drain the queue is what bounds memory use to a few batches.
+    std::unique_lock<std::mutex> lock(mutex);
+    batch_consumed.wait(lock, [this]() {
+        return is_stopping || batches.size() < MAX_QUEUED_BATCHES;
+    });
+
+    if (is_stopping) {
+        return false;
+    }
+
+    if (batch.vertex_data != nullptr) {
+        MemoryTracker::get_instance().add_allocation(MemorySubsystem::LOADER, batch.size_in_bytes);
+    }
+    batches.push_back(std::move(batch));
+    return true;
+}
+
+// --------------------------------------------------------------------------
+
+void StreamingModelLoader::update_extents(const Model& model) {
+    // Only the vertices added since the last batch are looked at.
+    const ModelArray<glm::vec3>& vertices = model.get_vertices();
+    for (; extents_vertex_count < vertices.size(); extents_vertex_count++) {
+        extents.min = glm::min(extents.min, vertices[extents_vertex_count]);
+        extents.max = glm::max(extents.max, vertices[extents_vertex_count]);
+    }
+}
+
+// --------------------------------------------------------------------------
+
+bool StreamingModelLoader::is_stop_requested() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return is_stopping;
+}
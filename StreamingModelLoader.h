@@ -0,0 +1,95 @@
+#ifndef STREAMING_MODEL_LOADER_H
+#define STREAMING_MODEL_LOADER_H
+
+#include <string>
+#include <deque>
+#include <memory>
+#include <atomic>
+#include <optional>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "Model.h"
+#include "MappedFile.h"
+#include "FileWatcher.h"
+
+struct StreamedBatch {
+    // Null when the batch was already written to the vertex destination.
+    std::unique_ptr<float[]> vertex_data;
+    int size_in_bytes;
+    int vertex_count;
+
+    // Extents of every vertex parsed so far, not only the ones used by this batch.
+    ModelExtents extents;
+
+    // When the text the batch was parsed from had been read.
+    std::chrono::steady_clock::time_point read_time;
+};
+
+class StreamingModelLoader {
+
+public:
+
+    StreamingModelLoader();
+    ~StreamingModelLoader();
+
+    StreamingModelLoader(const StreamingModelLoader&) = delete;
+    StreamingModelLoader& operator=(const StreamingModelLoader&) = delete;
+
+    void set_batch_size(size_t batch_size_in_bytes);
+    void set_vertex_destination(unsigned char* vertex_destination);
+
+    bool start(const std::string& file_path);
+    bool follow(const std::string& file_path);
+    void stop();
+
+    int get_total_vertex_count();
+    std::optional<StreamedBatch> poll_batch();
+
+    bool is_finished();
+    bool has_failed();
+    ModelStatistics get_statistics();
+
+private:
+
+    static const int MAX_QUEUED_BATCHES = 2;
+    static const size_t FOLLOW_READ_SIZE = 4 * 1024 * 1024;
+    static const int FOLLOW_POLL_INTERVAL_MS = 100;
+
+    static int count_faces(const char* begin, const char* end);
+    static bool has_valid_indices(const Model& model, size_t earlier_face_count);
+
+    void load_batches();
+    void follow_appended_lines();
+    bool queue_batch(Model& model, size_t earlier_face_count);
+    bool queue_appended_faces(const Model& model, size_t earlier_face_count, std::chrono::steady_clock::time_point read_time);
+    bool push_batch(StreamedBatch batch);
+    void update_extents(const Model& model);
+    bool is_stop_requested();
+
+    size_t batch_size_in_bytes;
+    std::atomic<unsigned char*> vertex_destination;
+
+    MappedFile file;
+    std::string file_path;
+    int file_descriptor;
+    FileWatcher file_watcher;
+    int total_vertex_count;
+    int queued_vertex_count;
+
+    ModelExtents extents;
+    size_t extents_vertex_count;
+
+    std::thread loader_thread;
+    std::mutex mutex;
+    std::condition_variable batch_consumed;
+    std::deque<StreamedBatch> batches;
+    bool is_loading;
+    bool is_stopping;
+    bool succeeded;
+    ModelStatistics statistics;
+};
+
+#endif
@@ -0,0 +1,218 @@
+#include "TextureCache.h"
+
+#include <chrono>
+#include <iostream>
+#include <filesystem>
+
+#include "MappedFile.h"
+#include "ContentHash.h"
+#include "ThreadPool.h"
+#include "JobScheduler.h"
+#include "Profiler.h"
+
+TextureCache::TextureCache(int thread_count)
+:
+thread_count(thread_count > 0 ? thread_count : ThreadPool::get_hardware_thread_count()),
+mipmap_filter(MipmapFilter::KAISER),
+request_count(0),
+duplicate_content_count(0),
+decode_ms(0.0) {
+    // do nothing for now
+}
+
+// --------------------------------------------------------------------------
+
+TextureCache::~TextureCache() {
+    // Jobs write into this cache, so they have to finish before it goes away.
+    wait_for_all();
+}
+
+// --------------------------------------------------------------------------
+
+void TextureCache::set_mipmap_filter(MipmapFilter mipmap_filter) {
+    this->mipmap_filter = mipmap_filter;
+}
+
+// --------------------------------------------------------------------------
+
+int TextureCache::request(const std::string& file_path) {
+    // Returns a handle for the texture, which is decoded in the background. Safe to call from
+    // any thread, and every path naming the same file gets the same handle.
+    std::error_code error;
+    std::string canonical_path = std::filesystem::weakly_canonical(file_path, error).string();
+    if (error) {
+        canonical_path = file_path;
+    }
+
+    int file_index;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        request_count++;
+
+        auto inserted = file_indices.insert({canonical_path, (int)files.size()});
+        if (!inserted.second) {
+            return inserted.first->second;
+        }
+
+        file_index = files.size();
+        files.push_back({file_path, -1});
+
+        // The scheduler only starts once there's something to decode. It gets one more thread
+        // than asked for, since the threads loading geometry are busy until wait_for_all().
+        if (job_scheduler == nullptr) {
+            job_scheduler = std::make_unique<JobScheduler>(thread_count + 1);
+        }
+    }
+
+    job_scheduler->submit([this, file_index] {
+        load_file(file_index);
+    });
+
+    return file_index;
+}
+
+// --------------------------------------------------------------------------
+
+void TextureCache::wait_for_all() {
+    if (job_scheduler != nullptr) {
+        job_scheduler->wait_for_all();
+    }
+}
+
+// --------------------------------------------------------------------------
+
+int TextureCache::get_texture_index(int handle) const {
+    // The texture a handle decoded to, shared by every file with the same contents, or -1 if
+    // it couldn't be decoded. Only meaningful after wait_for_all().
+    std::lock_guard<std::mutex> lock(mutex);
+    if (handle < 0 || handle >= (int)files.size()) {
+        return -1;
+    }
+
+    int texture_index = files[handle].texture_index;
+    return texture_index >= 0 && textures[texture_index].is_decoded ? texture_index : -1;
+}
+
+// --------------------------------------------------------------------------
+
+int TextureCache::get_texture_count() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return textures.size();
+}
+
+// --------------------------------------------------------------------------
+
+const DecodedTexture& TextureCache::get_texture(int texture_index) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return textures[texture_index];
+}
+
+// --------------------------------------------------------------------------
+
+void TextureCache::release_images() {
+    // Frees the pixels once they're on the GPU, keeping the sizes for reports.
+    std::lock_guard<std::mutex> lock(mutex);
+    for (DecodedTexture& texture : textures) {
+        std::vector<Image>().swap(texture.levels);
+    }
+}
+
+// --------------------------------------------------------------------------
+
+TextureCacheStatistics TextureCache::get_statistics() const {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    TextureCacheStatistics statistics;
+    statistics.request_count = request_count;
+    statistics.file_count = files.size();
+    statistics.duplicate_content_count = duplicate_content_count;
+    statistics.failed_count = 0;
+    statistics.texture_count = 0;
+    statistics.size_in_bytes = 0;
+    statistics.decode_ms = decode_ms;
+
+    for (const TextureFile& file : files) {
+        if (file.texture_index < 0 || !textures[file.texture_index].is_decoded) {
+            statistics.failed_count++;
+        }
+    }
+
+    for (const DecodedTexture& texture : textures) {
+        if (texture.is_decoded) {
+            statistics.texture_count++;
+            statistics.size_in_bytes += texture.size_in_bytes;
+        }
+    }
+
+    return statistics;
+}
+
+// --------------------------------------------------------------------------
+
+void TextureCache::load_file(int file_index) {
+    // Files are keyed by their size and content hash, so copies of one image under different
+    // names are only decoded once. The first file with some contents decodes them, outside
+    // the lock, and later ones just point at its texture.
+    PROFILE_SCOPE("TextureCache::load_file");
+
+    std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+
+    std::string file_path;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        file_path = files[file_index].file_path;
+    }
+
+    MappedFile file;
+    if (!file.open(file_path)) {
+        std::cerr << "[WARN] Could not open texture \"" << file_path << "\"" << std::endl;
+        return;
+    }
+
+    const unsigned char* data = reinterpret_cast<const unsigned char*>(file.get_data());
+    std::pair<uint64_t, uint64_t> content_key = {file.get_size(), compute_content_hash(data, file.get_size())};
+
+    DecodedTexture* texture;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto inserted = content_texture_indices.insert({content_key, (int)textures.size()});
+        files[file_index].texture_index = inserted.first->second;
+        if (!inserted.second) {
+            duplicate_content_count++;
+            return;
+        }
+
+        textures.push_back({file_path, {}, 0, 0, 0, 0, false});
+        texture = &textures.back();
+    }
+
+    ImageDecoder image_decoder;
+    std::optional<Image> image = image_decoder.decode(data, file.get_size(), file_path);
+
+    std::vector<Image> levels;
+    size_t size_in_bytes = 0;
+    if (image.has_value()) {
+        levels.push_back(std::move(image.value()));
+
+        MipmapGenerator mipmap_generator;
+        mipmap_generator.set_filter(mipmap_filter);
+        mipmap_generator.generate(levels);
+
+        for (const Image& level : levels) {
+            size_in_bytes += level.pixels.size();
+        }
+    }
+
+    double elapsed_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start_time).count();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!levels.empty()) {
+        texture->width = levels[0].width;
+        texture->height = levels[0].height;
+        texture->level_count = levels.size();
+        texture->size_in_bytes = size_in_bytes;
+        texture->levels = std::move(levels);
+        texture->is_decoded = true;
+    }
+    decode_ms += elapsed_ms;
+}
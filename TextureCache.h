@@ -0,0 +1,88 @@
+#ifndef TEXTURE_CACHE_H
+#define TEXTURE_CACHE_H
+
+#include <map>
+#include <deque>
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <cstdint>
+
+#include "ImageDecoder.h"
+#include "MipmapGenerator.h"
+
+class JobScheduler;
+
+// A decoded image with its whole mip chain, from full size down to 1x1. The sizes outlive
+// the pixels, which are released once they've been uploaded.
+struct DecodedTexture {
+    std::string file_path;
+    std::vector<Image> levels;
+    int width;
+    int height;
+    int level_count;
+    size_t size_in_bytes;
+    bool is_decoded;
+};
+
+struct TextureCacheStatistics {
+    int request_count;
+    int file_count;
+    int duplicate_content_count;
+    int failed_count;
+    int texture_count;
+    size_t size_in_bytes;
+    double decode_ms;
+};
+
+class TextureCache {
+
+public:
+
+    TextureCache(int thread_count = 0);
+    ~TextureCache();
+
+    TextureCache(const TextureCache&) = delete;
+    TextureCache& operator=(const TextureCache&) = delete;
+
+    void set_mipmap_filter(MipmapFilter mipmap_filter);
+
+    int request(const std::string& file_path);
+    void wait_for_all();
+
+    int get_texture_index(int handle) const;
+    int get_texture_count() const;
+    const DecodedTexture& get_texture(int texture_index) const;
+    void release_images();
+
+    TextureCacheStatistics get_statistics() const;
+
+private:
+
+    struct TextureFile {
+        std::string file_path;
+        int texture_index;
+    };
+
+    void load_file(int file_index);
+
+    int thread_count;
+    MipmapFilter mipmap_filter;
+    std::unique_ptr<JobScheduler> job_scheduler;
+
+    // Both deques keep their elements in place as they grow, so a job can fill in its
+    // texture while other jobs add theirs.
+    mutable std::mutex mutex;
+    std::map<std::string, int> file_indices;
+    std::deque<TextureFile> files;
+    std::map<std::pair<uint64_t, uint64_t>, int> content_texture_indices;
+    std::deque<DecodedTexture> textures;
+
+    int request_count;
+    int duplicate_content_count;
+    double decode_ms;
+};
+
+#endif
@@ -0,0 +1,100 @@
+#include "TexturePool.h"
+
+#include <algorithm>
+
+#include "TextureCache.h"
+#include "Profiler.h"
+
+TexturePool::TexturePool()
+:
+size_in_bytes(0) {
+    // do nothing for now
+}
+
+// --------------------------------------------------------------------------
+
+TexturePool::~TexturePool() {
+    // do nothing for now
+}
+
+// --------------------------------------------------------------------------
+
+void TexturePool::upload(TextureCache& texture_cache) {
+    // Needs a current OpenGL context, and every texture decoded. Each level goes up as it was
+    // generated, so the driver never builds its own mipmaps, and the decoded pixels are
+    // released afterwards.
+    PROFILE_SCOPE("TexturePool::upload");
+
+    float max_anisotropy = 1.0f;
+    if (GLEW_ARB_texture_filter_anisotropic || GLEW_EXT_texture_filter_anisotropic) {
+        glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY, &max_anisotropy);
+        max_anisotropy = std::min(max_anisotropy, MAX_ANISOTROPY);
+    }
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+    int texture_count = texture_cache.get_texture_count();
+    textures.assign(texture_count, 0);
+    for (int texture_index = 0; texture_index < texture_count; texture_index++) {
+        const DecodedTexture& decoded_texture = texture_cache.get_texture(texture_index);
+        if (!decoded_texture.is_decoded) {
+            continue;
+        }
+
+        glGenTextures(1, &textures[texture_index]);
+        glBindTexture(GL_TEXTURE_2D, textures[texture_index]);
+
+        for (int level = 0; level < decoded_texture.level_count; level++) {
+            const Image& image = decoded_texture.levels[level];
+            glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA8, image.width, image.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image.pixels.data());
+        }
+
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, decoded_texture.level_count - 1);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        if (max_anisotropy > 1.0f) {
+            glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY, max_anisotropy);
+        }
+
+        size_in_bytes += decoded_texture.size_in_bytes;
+    }
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    texture_cache.release_images();
+}
+
+// --------------------------------------------------------------------------
+
+void TexturePool::destroy() {
+    for (GLuint texture : textures) {
+        if (texture != 0) {
+            glDeleteTextures(1, &texture);
+        }
+    }
+
+    textures.clear();
+    size_in_bytes = 0;
+}
+
+// --------------------------------------------------------------------------
+
+GLuint TexturePool::get_texture(int texture_index) const {
+    // 0 for textures that couldn't be decoded.
+    return texture_index >= 0 && texture_index < (int)textures.size() ? textures[texture_index] : 0;
+}
+
+// --------------------------------------------------------------------------
+
+int TexturePool::get_texture_count() const {
+    return std::count_if(textures.begin(), textures.end(), [](GLuint texture) { return texture != 0; });
+}
+
+// --------------------------------------------------------------------------
+
+size_t TexturePool::get_size_in_bytes() const {
+    return size_in_bytes;
+}
@@ -0,0 +1,33 @@
+#ifndef TEXTURE_POOL_H
+#define TEXTURE_POOL_H
+
+#include <GL/glew.h>
+#include <vector>
+#include <cstddef>
+
+class TextureCache;
+
+// The GPU side of a TextureCache, with one texture object per decoded texture.
+class TexturePool {
+
+public:
+
+    TexturePool();
+    ~TexturePool();
+
+    void upload(TextureCache& texture_cache);
+    void destroy();
+
+    GLuint get_texture(int texture_index) const;
+    int get_texture_count() const;
+    size_t get_size_in_bytes() const;
+
+private:
+
+    static constexpr float MAX_ANISOTROPY = 8.0f;
+
+    std::vector<GLuint> textures;
+    size_t size_in_bytes;
+};
+
+#endif
@@ -0,0 +1,105 @@
+#include "ThreadPool.h"
+
+#include <atomic>
+#include <algorithm>
+
+ThreadPool::ThreadPool(int thread_count)
+:
+is_stopping(false) {
+    if (thread_count <= 0) {
+        thread_count = get_hardware_thread_count();
+    }
+
+    // The thread calling parallel_for() always takes part, so it counts as one of the threads.
+    for (int i = 0; i < thread_count - 1; i++) {
+        workers.emplace_back(&ThreadPool::run_worker, this);
+    }
+}
+
+// --------------------------------------------------------------------------
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(jobs_mutex);
+        is_stopping = true;
+    }
+    jobs_available.notify_all();
+
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+}
+
+// --------------------------------------------------------------------------
+
+int ThreadPool::get_thread_count() const {
+    return workers.size() + 1;
+}
+
+// --------------------------------------------------------------------------
+
+void ThreadPool::parallel_for(int task_count, const std::function<void(int)>& task) {
+    if (task_count <= 0) {
+        return;
+    }
+
+    std::atomic<int> next_task_index(0);
+    auto run_tasks = [&]() {
+        int task_index;
+        while ((task_index = next_task_index.fetch_add(1)) < task_count) {
+            task(task_index);
+        }
+    };
+
+    // Helpers reference this stack frame, so we wait for every one of them to
+    // finish, not just for every task to finish.
+    int helper_count = std::min<int>(workers.size(), task_count - 1);
+    int finished_helper_count = 0;
+    std::mutex helpers_mutex;
+    std::condition_variable helper_finished;
+
+    {
+        std::lock_guard<std::mutex> lock(jobs_mutex);
+        for (int i = 0; i < helper_count; i++) {
+            jobs.push([&]() {
+                run_tasks();
+
+                std::lock_guard<std::mutex> helpers_lock(helpers_mutex);
+                finished_helper_count++;
+                helper_finished.notify_one();
+            });
+        }
+    }
+    jobs_available.notify_all();
+
+    run_tasks();
+
+    std::unique_lock<std::mutex> helpers_lock(helpers_mutex);
+    helper_finished.wait(helpers_lock, [&]() { return finished_helper_count == helper_count; });
+}
+
+// --------------------------------------------------------------------------
+
+int ThreadPool::get_hardware_thread_count() {
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+// --------------------------------------------------------------------------
+
+void ThreadPool::run_worker() {
+    while (true) {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock(jobs_mutex);
+            jobs_available.wait(lock, [this]() { return is_stopping || !jobs.empty(); });
+            if (is_stopping && jobs.empty()) {
+                return;
+            }
+
+            job = std::move(jobs.front());
+            jobs.pop();
+        }
+
+        job();
+    }
+}
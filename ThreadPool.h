@@ -0,0 +1,39 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <vector>
+#include <queue>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+class ThreadPool {
+
+public:
+
+    ThreadPool(int thread_count);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    int get_thread_count() const;
+
+    void parallel_for(int task_count, const std::function<void(int)>& task);
+
+    static int get_hardware_thread_count();
+
+private:
+
+    void run_worker();
+
+    std::vector<std::thread> workers;
+
+    std::mutex jobs_mutex;
+    std::condition_variable jobs_available;
+    std::queue<std::function<void()>> jobs;
+    bool is_stopping;
+};
+
+#endif
@@ -0,0 +1,299 @@
+#include "VertexEncoder.h"
+
+#include <cstring>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+#include "Simd.h"
+#include "ThreadPool.h"
+#include "Profiler.h"
+
+// Loads one component of four consecutive interleaved vertices into the lanes of a Float4.
+// Lanes past the last vertex repeat the last vertex, so they never affect error maximums.
+static Float4 load_vertex_component(const float* vertex_data, int first_vertex, int vertex_count, int component) {
+    const int STRIDE = Model::FLOATS_PER_BUFFER_VERTEX;
+
+    float values[4];
+    for (int lane = 0; lane < 4; lane++) {
+        int vertex = std::min(first_vertex + lane, vertex_count - 1);
+        values[lane] = vertex_data[vertex * STRIDE + component];
+    }
+
+    return float4_load(values);
+}
+
+// Distance between the unit vectors along an original and a decoded normal. Unlike the
+// cosine, it keeps full float precision for the tiny angles quantization produces.
+static Float4 compute_chord_length(const Float4* components, Float4 length, const Float4* decoded_components) {
+    Float4 tiny = float4_splat(std::numeric_limits<float>::min());
+    Float4 inverse_length = float4_splat(1.0f) / float4_max(length, tiny);
+    Float4 inverse_decoded_length = float4_splat(1.0f) / float4_max(float4_sqrt(float4_dot3(
+        decoded_components[0], decoded_components[1], decoded_components[2],
+        decoded_components[0], decoded_components[1], decoded_components[2])), tiny);
+
+    Float4 squared_chord_length = float4_splat(0.0f);
+    for (int axis = 0; axis < 3; axis++) {
+        Float4 difference = components[axis] * inverse_length - decoded_components[axis] * inverse_decoded_length;
+        squared_chord_length = squared_chord_length + difference * difference;
+    }
+
+    return float4_sqrt(squared_chord_length);
+}
+
+static float chord_length_to_degrees(float chord_length) {
+    return glm::degrees(2.0f * std::asin(std::min(1.0f, 0.5f * chord_length)));
+}
+
+// --------------------------------------------------------------------------
+
+VertexEncoder::VertexEncoder()
+:
+thread_count(1) {
+    // do nothing for now
+}
+
+// --------------------------------------------------------------------------
+
+VertexEncoder::~VertexEncoder() {
+    // do nothing for now
+}
+
+// --------------------------------------------------------------------------
+
+void VertexEncoder::set_thread_count(int thread_count) {
+    // A thread count of 0 or less means one thread per hardware thread.
+    this->thread_count = thread_count > 0 ? thread_count : ThreadPool::get_hardware_thread_count();
+}
+
+// --------------------------------------------------------------------------
+
+EncodedVertexBuffer VertexEncoder::encode(const IndexedBufferData& indexed_buffer_data, VertexFormat format, const ModelExtents& extents) {
+    EncodedVertexBuffer encoded_vertex_buffer = get_layout(format, indexed_buffer_data.vertex_count, extents);
+    encoded_vertex_buffer.data.resize((size_t)encoded_vertex_buffer.vertex_count * encoded_vertex_buffer.bytes_per_vertex);
+    encode_into(indexed_buffer_data.vertex_data.data(), encoded_vertex_buffer, encoded_vertex_buffer.data.data());
+    return encoded_vertex_buffer;
+}
+
+// --------------------------------------------------------------------------
+
+EncodedVertexBuffer VertexEncoder::get_layout(VertexFormat format, int vertex_count, const ModelExtents& extents) {
+    // Everything about the encoded buffer except its data, which is enough to size a GPU
+    // buffer before encode_into() writes into it.
+    EncodedVertexBuffer encoded_vertex_buffer;
+    encoded_vertex_buffer.format = format;
+    encoded_vertex_buffer.vertex_count = vertex_count;
+    encoded_vertex_buffer.position_offset = glm::vec3(0.0f, 0.0f, 0.0f);
+    encoded_vertex_buffer.position_scale = glm::vec3(1.0f, 1.0f, 1.0f);
+    encoded_vertex_buffer.max_position_error = 0.0f;
+    encoded_vertex_buffer.max_normal_error_degrees = 0.0f;
+
+    if (format == VertexFormat::FLOAT32) {
+        encoded_vertex_buffer.bytes_per_vertex = Model::FLOATS_PER_BUFFER_VERTEX * sizeof(float);
+        encoded_vertex_buffer.normal_offset = 3 * sizeof(float);
+        return encoded_vertex_buffer;
+    }
+
+    // Positions become 16-bit unsigned normalized values across the model extents,
+    // normals either two 16-bit signed octahedral coordinates or a 10-10-10-2 word.
+    encoded_vertex_buffer.bytes_per_vertex = QUANTIZED_BYTES_PER_VERTEX;
+    encoded_vertex_buffer.normal_offset = QUANTIZED_NORMAL_OFFSET;
+    encoded_vertex_buffer.position_offset = extents.min;
+    encoded_vertex_buffer.position_scale = glm::max(extents.max - extents.min, glm::vec3(std::numeric_limits<float>::min()));
+    return encoded_vertex_buffer;
+}
+
+// --------------------------------------------------------------------------
+
+void VertexEncoder::encode_into(const float* vertex_data, EncodedVertexBuffer& layout, unsigned char* destination) {
+    PROFILE_SCOPE("VertexEncoder::encode");
+
+    // Threads encode disjoint ranges of vertices and every byte of each vertex is written
+    // exactly once without being read back, so the destination can be mapped GPU memory.
+    // vertex_data holds layout.vertex_count vertices and is only read, so it can be mapped too.
+    int vertex_count = layout.vertex_count;
+    int task_count = (vertex_count + VERTICES_PER_TASK - 1) / VERTICES_PER_TASK;
+
+    std::vector<float> max_position_errors(task_count, 0.0f);
+    std::vector<float> max_normal_errors_degrees(task_count, 0.0f);
+
+    ThreadPool thread_pool(std::min(thread_count, std::max(task_count, 1)));
+    thread_pool.parallel_for(task_count, [&](int task_index) {
+        int first_vertex = task_index * VERTICES_PER_TASK;
+        int range_vertex_count = std::min(VERTICES_PER_TASK, vertex_count - first_vertex);
+        const float* range_vertex_data = vertex_data + (size_t)first_vertex * Model::FLOATS_PER_BUFFER_VERTEX;
+        unsigned char* range_destination = destination + (size_t)first_vertex * layout.bytes_per_vertex;
+
+        if (layout.format == VertexFormat::FLOAT32) {
+            std::memcpy(range_destination, range_vertex_data, (size_t)range_vertex_count * layout.bytes_per_vertex);
+            return;
+        }
+
+        max_position_errors[task_index] = encode_positions(range_vertex_data, range_vertex_count, layout.position_offset, layout.position_scale, range_destination);
+        if (layout.format == VertexFormat::QUANTIZED_OCTAHEDRAL) {
+            max_normal_errors_degrees[task_index] = encode_octahedral_normals(range_vertex_data, range_vertex_count, range_destination);
+        } else {
+            max_normal_errors_degrees[task_index] = encode_packed_normals(range_vertex_data, range_vertex_count, range_destination);
+        }
+    });
+
+    for (int task_index = 0; task_index < task_count; task_index++) {
+        layout.max_position_error = std::max(layout.max_position_error, max_position_errors[task_index]);
+        layout.max_normal_error_degrees = std::max(layout.max_normal_error_degrees, max_normal_errors_degrees[task_index]);
+    }
+}
+
+// --------------------------------------------------------------------------
+
+float VertexEncoder::encode_positions(const float* vertex_data, int vertex_count, glm::vec3 position_offset, glm::vec3 position_scale, unsigned char* encoded_data) {
+    // Returns the largest distance between an original and a decoded position.
+    const float MAX_QUANTIZED_VALUE = 65535.0f;
+
+    Float4 zero = float4_splat(0.0f);
+    Float4 max_quantized_value = float4_splat(MAX_QUANTIZED_VALUE);
+    Float4 max_squared_error = zero;
+
+    for (int first_vertex = 0; first_vertex < vertex_count; first_vertex += 4) {
+        Float4 squared_error = zero;
+        int32_t quantized_values[3][4];
+
+        for (int axis = 0; axis < 3; axis++) {
+            Float4 offset = float4_splat(position_offset[axis]);
+            Float4 quantization_step = float4_splat(position_scale[axis] / MAX_QUANTIZED_VALUE);
+
+            Float4 position = load_vertex_component(vertex_data, first_vertex, vertex_count, axis);
+            Float4 normalized_position = (position - offset) * float4_splat(MAX_QUANTIZED_VALUE / position_scale[axis]);
+            Int4 quantized_position = float4_round_to_int(float4_clamp(normalized_position, zero, max_quantized_value));
+            int4_store(quantized_values[axis], quantized_position);
+
+            Float4 error = offset + int4_to_float(quantized_position) * quantization_step - position;
+            squared_error = squared_error + error * error;
+        }
+        max_squared_error = float4_max(max_squared_error, squared_error);
+
+        int block_vertex_count = std::min(4, vertex_count - first_vertex);
+        for (int lane = 0; lane < block_vertex_count; lane++) {
+            uint16_t encoded_position[4] = {
+                (uint16_t)quantized_values[0][lane],
+                (uint16_t)quantized_values[1][lane],
+                (uint16_t)quantized_values[2][lane],
+                0
+            };
+            std::memcpy(encoded_data + (first_vertex + lane) * QUANTIZED_BYTES_PER_VERTEX, encoded_position, sizeof(encoded_position));
+        }
+    }
+
+    return std::sqrt(float4_horizontal_max(max_squared_error));
+}
+
+// --------------------------------------------------------------------------
+
+float VertexEncoder::encode_octahedral_normals(const float* vertex_data, int vertex_count, unsigned char* encoded_data) {
+    // Projects the normal onto the octahedron |x| + |y| + |z| = 1 and folds the lower
+    // hemisphere over the diagonals, leaving two coordinates in [-1, 1].
+    // Returns the largest angle in degrees between an original and a decoded normal.
+    const float MAX_QUANTIZED_VALUE = 32767.0f;
+
+    Float4 zero = float4_splat(0.0f);
+    Float4 one = float4_splat(1.0f);
+    Float4 minus_one = float4_splat(-1.0f);
+    Float4 tiny = float4_splat(std::numeric_limits<float>::min());
+    Float4 max_chord_length = zero;
+
+    for (int first_vertex = 0; first_vertex < vertex_count; first_vertex += 4) {
+        Float4 x = load_vertex_component(vertex_data, first_vertex, vertex_count, 3);
+        Float4 y = load_vertex_component(vertex_data, first_vertex, vertex_count, 4);
+        Float4 z = load_vertex_component(vertex_data, first_vertex, vertex_count, 5);
+
+        Float4 length = float4_sqrt(float4_dot3(x, y, z, x, y, z));
+        Mask4 has_normal = float4_greater(length, zero);
+
+        Float4 octahedron_scale = one / float4_max(float4_abs(x) + float4_abs(y) + float4_abs(z), tiny);
+        Float4 projected_x = x * octahedron_scale;
+        Float4 projected_y = y * octahedron_scale;
+
+        Float4 sign_x = float4_select(float4_greater_equal(projected_x, zero), one, minus_one);
+        Float4 sign_y = float4_select(float4_greater_equal(projected_y, zero), one, minus_one);
+        Mask4 is_lower_hemisphere = float4_less(z, zero);
+        Float4 octahedral_x = float4_select(is_lower_hemisphere, (one - float4_abs(projected_y)) * sign_x, projected_x);
+        Float4 octahedral_y = float4_select(is_lower_hemisphere, (one - float4_abs(projected_x)) * sign_y, projected_y);
+
+        Int4 quantized_x = float4_round_to_int(float4_clamp(octahedral_x, minus_one, one) * float4_splat(MAX_QUANTIZED_VALUE));
+        Int4 quantized_y = float4_round_to_int(float4_clamp(octahedral_y, minus_one, one) * float4_splat(MAX_QUANTIZED_VALUE));
+
+        // Decode exactly like default.vert does.
+        Float4 decoded_x = int4_to_float(quantized_x) * float4_splat(1.0f / MAX_QUANTIZED_VALUE);
+        Float4 decoded_y = int4_to_float(quantized_y) * float4_splat(1.0f / MAX_QUANTIZED_VALUE);
+        Float4 decoded_z = one - float4_abs(decoded_x) - float4_abs(decoded_y);
+        Float4 fold = float4_max(zero - decoded_z, zero);
+        decoded_x = decoded_x + float4_select(float4_greater_equal(decoded_x, zero), zero - fold, fold);
+        decoded_y = decoded_y + float4_select(float4_greater_equal(decoded_y, zero), zero - fold, fold);
+
+        Float4 decoded_components[3] = {decoded_x, decoded_y, decoded_z};
+        Float4 components[3] = {x, y, z};
+        max_chord_length = float4_max(max_chord_length, float4_select(has_normal, compute_chord_length(components, length, decoded_components), zero));
+
+        int32_t quantized_values[2][4];
+        int4_store(quantized_values[0], quantized_x);
+        int4_store(quantized_values[1], quantized_y);
+
+        int block_vertex_count = std::min(4, vertex_count - first_vertex);
+        for (int lane = 0; lane < block_vertex_count; lane++) {
+            int16_t encoded_normal[2] = {(int16_t)quantized_values[0][lane], (int16_t)quantized_values[1][lane]};
+            std::memcpy(encoded_data + (first_vertex + lane) * QUANTIZED_BYTES_PER_VERTEX + QUANTIZED_NORMAL_OFFSET, encoded_normal, sizeof(encoded_normal));
+        }
+    }
+
+    return chord_length_to_degrees(float4_horizontal_max(max_chord_length));
+}
+
+// --------------------------------------------------------------------------
+
+float VertexEncoder::encode_packed_normals(const float* vertex_data, int vertex_count, unsigned char* encoded_data) {
+    // Packs the normalized normal into GL_INT_2_10_10_10_REV layout: 10-bit signed x, y
+    // and z in the low bits, an unused 2-bit w on top.
+    // Returns the largest angle in degrees between an original and a decoded normal.
+    const float MAX_QUANTIZED_VALUE = 511.0f;
+
+    Float4 zero = float4_splat(0.0f);
+    Float4 one = float4_splat(1.0f);
+    Float4 minus_one = float4_splat(-1.0f);
+    Float4 tiny = float4_splat(std::numeric_limits<float>::min());
+    Float4 max_chord_length = zero;
+
+    for (int first_vertex = 0; first_vertex < vertex_count; first_vertex += 4) {
+        Float4 components[3];
+        for (int axis = 0; axis < 3; axis++) {
+            components[axis] = load_vertex_component(vertex_data, first_vertex, vertex_count, 3 + axis);
+        }
+
+        Float4 length = float4_sqrt(float4_dot3(components[0], components[1], components[2], components[0], components[1], components[2]));
+        Mask4 has_normal = float4_greater(length, zero);
+        Float4 inverse_length = one / float4_max(length, tiny);
+
+        Int4 quantized_components[3];
+        Float4 decoded_components[3];
+        for (int axis = 0; axis < 3; axis++) {
+            Float4 normalized_component = float4_clamp(components[axis] * inverse_length, minus_one, one);
+            quantized_components[axis] = float4_round_to_int(normalized_component * float4_splat(MAX_QUANTIZED_VALUE));
+            decoded_components[axis] = int4_to_float(quantized_components[axis]) * float4_splat(1.0f / MAX_QUANTIZED_VALUE);
+        }
+
+        max_chord_length = float4_max(max_chord_length, float4_select(has_normal, compute_chord_length(components, length, decoded_components), zero));
+
+        int32_t quantized_values[3][4];
+        for (int axis = 0; axis < 3; axis++) {
+            int4_store(quantized_values[axis], quantized_components[axis]);
+        }
+
+        int block_vertex_count = std::min(4, vertex_count - first_vertex);
+        for (int lane = 0; lane < block_vertex_count; lane++) {
+            uint32_t packed_normal = (quantized_values[0][lane] & 0x3FF)
+                | ((quantized_values[1][lane] & 0x3FF) << 10)
+                | ((quantized_values[2][lane] & 0x3FF) << 20);
+            std::memcpy(encoded_data + (first_vertex + lane) * QUANTIZED_BYTES_PER_VERTEX + QUANTIZED_NORMAL_OFFSET, &packed_normal, sizeof(packed_normal));
+        }
+    }
+
+    return chord_length_to_degrees(float4_horizontal_max(max_chord_length));
+}
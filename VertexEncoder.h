@@ -0,0 +1,57 @@
+#ifndef VERTEX_ENCODER_H
+#define VERTEX_ENCODER_H
+
+#include <vector>
+#include <cstdint>
+#include <glm/glm.hpp>
+
+#include "Model.h"
+
+enum class VertexFormat {
+    FLOAT32,
+    QUANTIZED_OCTAHEDRAL,
+    QUANTIZED_PACKED
+};
+
+struct EncodedVertexBuffer {
+    std::vector<unsigned char> data;
+    VertexFormat format;
+    int vertex_count;
+    int bytes_per_vertex;
+    int normal_offset;
+
+    glm::vec3 position_offset;
+    glm::vec3 position_scale;
+
+    float max_position_error;
+    float max_normal_error_degrees;
+};
+
+class VertexEncoder {
+
+public:
+
+    VertexEncoder();
+    ~VertexEncoder();
+
+    void set_thread_count(int thread_count);
+
+    EncodedVertexBuffer encode(const IndexedBufferData& indexed_buffer_data, VertexFormat format, const ModelExtents& extents);
+
+    EncodedVertexBuffer get_layout(VertexFormat format, int vertex_count, const ModelExtents& extents);
+    void encode_into(const float* vertex_data, EncodedVertexBuffer& layout, unsigned char* destination);
+
+private:
+
+    static const int QUANTIZED_BYTES_PER_VERTEX = 12;
+    static const int QUANTIZED_NORMAL_OFFSET = 8;
+    static constexpr int VERTICES_PER_TASK = 1 << 16;
+
+    int thread_count;
+
+    float encode_positions(const float* vertex_data, int vertex_count, glm::vec3 position_offset, glm::vec3 position_scale, unsigned char* encoded_data);
+    float encode_octahedral_normals(const float* vertex_data, int vertex_count, unsigned char* encoded_data);
+    float encode_packed_normals(const float* vertex_data, int vertex_count, unsigned char* encoded_data);
+};
+
+#endif
@@ -0,0 +1,368 @@
+#include <iostream>
+#include <string>
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <cmath>
+#include <vector>
+
+// Writes a synthetic OBJ file for the loader benchmarks: a bumpy square grid of vertices
+// followed by its triangles, with the requested face format and comment density. The same
+// arguments always produce the same file.
+
+enum class FaceFormat {
+    POSITION,
+    POSITION_TEXTURE,
+    POSITION_NORMAL,
+    POSITION_TEXTURE_NORMAL
+};
+
+struct GeneratorOptions {
+    std::string file_path;
+    uint64_t vertex_count;
+    uint64_t face_count;
+    uint64_t target_size_in_bytes;
+    FaceFormat face_format;
+    double comment_density;
+};
+
+class BufferedWriter {
+
+public:
+
+    BufferedWriter(FILE* file)
+    :
+    file(file),
+    bytes_written(0),
+    is_failed(false) {
+        buffer.reserve(BUFFER_SIZE);
+    }
+
+    ~BufferedWriter() {
+        flush();
+    }
+
+    void write(const char* data, size_t size) {
+        if (buffer.size() + size > BUFFER_SIZE) {
+            flush();
+        }
+        buffer.insert(buffer.end(), data, data + size);
+        bytes_written += size;
+    }
+
+    void flush() {
+        if (!buffer.empty() && fwrite(buffer.data(), 1, buffer.size(), file) != buffer.size()) {
+            is_failed = true;
+        }
+        buffer.clear();
+    }
+
+    uint64_t get_bytes_written() const {
+        return bytes_written;
+    }
+
+    bool has_failed() const {
+        return is_failed;
+    }
+
+private:
+
+    static const size_t BUFFER_SIZE = 4 * 1024 * 1024;
+
+    FILE* file;
+    std::vector<char> buffer;
+    uint64_t bytes_written;
+    bool is_failed;
+};
+
+// --------------------------------------------------------------------------
+
+class CommentWriter {
+
+public:
+
+    // Adds a comment line after a data line often enough to make up the given fraction of all lines.
+    CommentWriter(double comment_density)
+    :
+    comments_per_line(comment_density < 1.0 ? comment_density / (1.0 - comment_density) : 0.0),
+    pending_comments(0.0),
+    comment_count(0) {
+        // do nothing for now
+    }
+
+    void after_line(BufferedWriter& writer) {
+        pending_comments += comments_per_line;
+        while (pending_comments >= 1.0) {
+            char line[64];
+            int length = snprintf(line, sizeof(line), "# synthetic comment %llu\n", (unsigned long long)comment_count++);
+            writer.write(line, length);
+            pending_comments -= 1.0;
+        }
+    }
+
+private:
+
+    double comments_per_line;
+    double pending_comments;
+    uint64_t comment_count;
+};
+
+// --------------------------------------------------------------------------
+
+float get_height(uint64_t row, uint64_t column) {
+    // Cheap hashed bumps, so positions don't all format to the same few digits.
+    uint64_t hash = (row * 0x9E3779B97F4A7C15ULL) ^ (column * 0xC2B2AE3D27D4EB4FULL);
+    hash ^= hash >> 29;
+    hash *= 0xBF58476D1CE4E5B9ULL;
+    hash ^= hash >> 32;
+    return (hash & 0xFFFF) / 65535.0f * 0.05f;
+}
+
+// --------------------------------------------------------------------------
+
+int format_face_corner(char* out, FaceFormat face_format, uint64_t index) {
+    unsigned long long obj_index = index + 1;
+    switch (face_format) {
+        case FaceFormat::POSITION:
+            return sprintf(out, " %llu", obj_index);
+        case FaceFormat::POSITION_TEXTURE:
+            return sprintf(out, " %llu/%llu", obj_index, obj_index);
+        case FaceFormat::POSITION_NORMAL:
+            return sprintf(out, " %llu//%llu", obj_index, obj_index);
+        default:
+            return sprintf(out, " %llu/%llu/%llu", obj_index, obj_index, obj_index);
+    }
+}
+
+// --------------------------------------------------------------------------
+
+uint64_t estimate_bytes_per_vertex(const GeneratorOptions& options, uint64_t vertex_count) {
+    // One v line, plus vt and vn lines when the faces refer to them, and two triangles' worth of f lines.
+    int index_digit_count = std::to_string(vertex_count).size();
+    uint64_t vertex_line_size = 30;
+    uint64_t corner_size = 1 + index_digit_count;
+    if (options.face_format == FaceFormat::POSITION_TEXTURE) {
+        vertex_line_size += 20;
+        corner_size += 1 + index_digit_count;
+    } else if (options.face_format == FaceFormat::POSITION_NORMAL) {
+        vertex_line_size += 30;
+        corner_size += 2 + index_digit_count;
+    } else if (options.face_format == FaceFormat::POSITION_TEXTURE_NORMAL) {
+        vertex_line_size += 50;
+        corner_size += 2 + 2 * index_digit_count;
+    }
+    uint64_t face_line_size = 2 + 3 * corner_size;
+
+    uint64_t line_count = options.face_format == FaceFormat::POSITION ? 3 : options.face_format == FaceFormat::POSITION_TEXTURE_NORMAL ? 5 : 4;
+    double comment_factor = options.comment_density < 1.0 ? 1.0 / (1.0 - options.comment_density) : 1.0;
+    double comment_size = 28.0 * (comment_factor - 1.0) * line_count;
+
+    return vertex_line_size + 2 * face_line_size + (uint64_t)comment_size;
+}
+
+// --------------------------------------------------------------------------
+
+bool generate(const GeneratorOptions& options) {
+    FILE* file = fopen(options.file_path.c_str(), "wb");
+    if (!file) {
+        std::cerr << "[ERROR] Could not open file \"" << options.file_path << "\"" << std::endl;
+        return false;
+    }
+
+    BufferedWriter writer(file);
+    CommentWriter comment_writer(options.comment_density);
+
+    uint64_t vertex_count = std::max<uint64_t>(options.vertex_count, 4);
+    uint64_t grid_width = std::max<uint64_t>((uint64_t)std::sqrt((double)vertex_count), 2);
+    uint64_t grid_height = std::max<uint64_t>(vertex_count / grid_width, 2);
+    vertex_count = grid_width * grid_height;
+    uint64_t quad_count = (grid_width - 1) * (grid_height - 1);
+
+    char header[256];
+    int header_length = snprintf(header, sizeof(header), "# Synthetic OBJ: %llu vertices, %llu faces\n",
+                                 (unsigned long long)vertex_count, (unsigned long long)options.face_count);
+    writer.write(header, header_length);
+
+    bool has_texture_coordinates = options.face_format == FaceFormat::POSITION_TEXTURE || options.face_format == FaceFormat::POSITION_TEXTURE_NORMAL;
+    bool has_normals = options.face_format == FaceFormat::POSITION_NORMAL || options.face_format == FaceFormat::POSITION_TEXTURE_NORMAL;
+
+    char line[256];
+    for (uint64_t row = 0; row < grid_height; row++) {
+        for (uint64_t column = 0; column < grid_width; column++) {
+            float x = (float)column / (grid_width - 1) - 0.5f;
+            float z = (float)row / (grid_height - 1) - 0.5f;
+            int length = snprintf(line, sizeof(line), "v %.6f %.6f %.6f\n", x, get_height(row, column), z);
+            writer.write(line, length);
+            comment_writer.after_line(writer);
+        }
+    }
+
+    if (has_texture_coordinates) {
+        for (uint64_t row = 0; row < grid_height; row++) {
+            for (uint64_t column = 0; column < grid_width; column++) {
+                int length = snprintf(line, sizeof(line), "vt %.6f %.6f\n", (float)column / (grid_width - 1), (float)row / (grid_height - 1));
+                writer.write(line, length);
+                comment_writer.after_line(writer);
+            }
+        }
+    }
+
+    if (has_normals) {
+        for (uint64_t vertex = 0; vertex < vertex_count; vertex++) {
+            writer.write("vn 0.000000 1.000000 0.000000\n", 30);
+            comment_writer.after_line(writer);
+        }
+    }
+
+    // Faces walk the grid's quads two triangles at a time, starting over if more are requested.
+    for (uint64_t face = 0; face < options.face_count; face++) {
+        uint64_t quad = (face / 2) % quad_count;
+        uint64_t row = quad / (grid_width - 1);
+        uint64_t column = quad % (grid_width - 1);
+        uint64_t top_left = row * grid_width + column;
+        uint64_t corners[2][3] = {
+            { top_left, top_left + grid_width, top_left + 1 },
+            { top_left + 1, top_left + grid_width, top_left + grid_width + 1 }
+        };
+
+        int length = 0;
+        line[length++] = 'f';
+        for (int corner = 0; corner < 3; corner++) {
+            length += format_face_corner(line + length, options.face_format, corners[face % 2][corner]);
+        }
+        line[length++] = '\n';
+        writer.write(line, length);
+        comment_writer.after_line(writer);
+    }
+
+    writer.flush();
+    bool is_write_failed = writer.has_failed();
+    if (fclose(file) != 0 || is_write_failed) {
+        std::cerr << "[ERROR] Could not write file \"" << options.file_path << "\"" << std::endl;
+        return false;
+    }
+
+    std::cout << "Wrote " << vertex_count << " vertices and " << options.face_count << " faces ("
+              << writer.get_bytes_written() << " bytes) to " << options.file_path << std::endl;
+    return true;
+}
+
+// --------------------------------------------------------------------------
+
+bool parse_size(const std::string& argument, uint64_t& size) {
+    // Accepts a plain byte count or one with a K, M or G suffix.
+    char* number_end;
+    double value = strtod(argument.c_str(), &number_end);
+    std::string suffix = number_end;
+    double multiplier = 1.0;
+    if (suffix == "K" || suffix == "k") {
+        multiplier = 1024.0;
+    } else if (suffix == "M" || suffix == "m") {
+        multiplier = 1024.0 * 1024.0;
+    } else if (suffix == "G" || suffix == "g") {
+        multiplier = 1024.0 * 1024.0 * 1024.0;
+    } else if (!suffix.empty()) {
+        return false;
+    }
+
+    if (!(value > 0.0)) {
+        return false;
+    }
+
+    size = (uint64_t)(value * multiplier);
+    return true;
+}
+
+// --------------------------------------------------------------------------
+
+void print_usage(const std::string& program_name) {
+    std::cerr << "Usage: " << program_name << " [OPTIONS] OUTPUT_FILE" << std::endl;
+    std::cerr << std::endl;
+    std::cerr << "Options:" << std::endl;
+    std::cerr << "  --vertices N     Number of vertices, rounded down to a square grid (default: 1000000)" << std::endl;
+    std::cerr << "  --faces N        Number of triangles (default: twice the vertex count)" << std::endl;
+    std::cerr << "  --size SIZE      Pick the vertex and face counts for a file of about SIZE bytes; accepts K, M and G suffixes" << std::endl;
+    std::cerr << "  --format FORMAT  Face corner format: v, v/vt, v//vn or v/vt/vn (default: v//vn)" << std::endl;
+    std::cerr << "  --comments FRACTION  Fraction of lines that are comments (default: 0)" << std::endl;
+}
+
+// --------------------------------------------------------------------------
+
+int main(int argc, char** argv) {
+    GeneratorOptions options;
+    options.vertex_count = 1000000;
+    options.face_count = 0;
+    options.target_size_in_bytes = 0;
+    options.face_format = FaceFormat::POSITION_NORMAL;
+    options.comment_density = 0.0;
+
+    for (int i = 1; i < argc; i++) {
+        std::string argument = argv[i];
+        char* number_end;
+        if (argument == "--vertices" && i + 1 < argc) {
+            options.vertex_count = strtoull(argv[++i], &number_end, 10);
+            if (*number_end != '\0' || options.vertex_count < 4) {
+                std::cerr << "[ERROR] Invalid vertex count \"" << argv[i] << "\"" << std::endl;
+                return EXIT_FAILURE;
+            }
+        } else if (argument == "--faces" && i + 1 < argc) {
+            options.face_count = strtoull(argv[++i], &number_end, 10);
+            if (*number_end != '\0' || options.face_count < 1) {
+                std::cerr << "[ERROR] Invalid face count \"" << argv[i] << "\"" << std::endl;
+                return EXIT_FAILURE;
+            }
+        } else if (argument == "--size" && i + 1 < argc) {
+            if (!parse_size(argv[++i], options.target_size_in_bytes)) {
+                std::cerr << "[ERROR] Invalid size \"" << argv[i] << "\"" << std::endl;
+                return EXIT_FAILURE;
+            }
+        } else if (argument == "--format" && i + 1 < argc) {
+            std::string face_format = argv[++i];
+            if (face_format == "v") {
+                options.face_format = FaceFormat::POSITION;
+            } else if (face_format == "v/vt") {
+                options.face_format = FaceFormat::POSITION_TEXTURE;
+            } else if (face_format == "v//vn") {
+                options.face_format = FaceFormat::POSITION_NORMAL;
+            } else if (face_format == "v/vt/vn") {
+                options.face_format = FaceFormat::POSITION_TEXTURE_NORMAL;
+            } else {
+                std::cerr << "[ERROR] Unknown face format \"" << face_format << "\"" << std::endl;
+                return EXIT_FAILURE;
+            }
+        } else if (argument == "--comments" && i + 1 < argc) {
+            options.comment_density = strtod(argv[++i], &number_end);
+            if (*number_end != '\0' || !(options.comment_density >= 0.0 && options.comment_density < 1.0)) {
+                std::cerr << "[ERROR] Invalid comment fraction \"" << argv[i] << "\"" << std::endl;
+                return EXIT_FAILURE;
+            }
+        } else if (argument.size() > 0 && argument[0] == '-') {
+            std::cerr << "[ERROR] Unknown option \"" << argument << "\"" << std::endl;
+            print_usage(argv[0]);
+            return EXIT_FAILURE;
+        } else if (options.file_path.empty()) {
+            options.file_path = argument;
+        } else {
+            print_usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (options.file_path.empty()) {
+        print_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    if (options.target_size_in_bytes > 0) {
+        // Two passes so the index digit count used by the estimate matches the final vertex count.
+        options.vertex_count = std::max<uint64_t>(options.target_size_in_bytes / estimate_bytes_per_vertex(options, 1000), 4);
+        options.vertex_count = std::max<uint64_t>(options.target_size_in_bytes / estimate_bytes_per_vertex(options, options.vertex_count), 4);
+        options.face_count = 0;
+    }
+
+    if (options.face_count == 0) {
+        options.face_count = 2 * options.vertex_count;
+    }
+
+    return generate(options) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,270 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <atomic>
+#include <new>
+#include <cstdlib>
+#include <algorithm>
+#include <functional>
+#include <filesystem>
+#include <sys/resource.h>
+#ifdef __APPLE__
+#include <malloc/malloc.h>
+#else
+#include <malloc.h>
+#endif
+
+#include "ObjLoader.h"
+#include "Model.h"
+#include "MemoryArena.h"
+
+// Times the loader's hot paths on one OBJ file. Allocations are counted by replacing the global
+// operator new, so they include everything the standard containers do underneath. Live heap
+// bytes are tracked through the allocator's own block sizes to find each run's peak.
+
+static std::atomic<uint64_t> allocation_count(0);
+static std::atomic<uint64_t> allocated_bytes(0);
+static std::atomic<int64_t> live_heap_bytes(0);
+static std::atomic<int64_t> peak_live_heap_bytes(0);
+
+static size_t get_allocation_size(void* pointer) {
+#ifdef __APPLE__
+    return malloc_size(pointer);
+#else
+    return malloc_usable_size(pointer);
+#endif
+}
+
+void* operator new(size_t size) {
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+    void* pointer = malloc(size > 0 ? size : 1);
+    if (!pointer) {
+        throw std::bad_alloc();
+    }
+
+    int64_t allocation_size = get_allocation_size(pointer);
+    int64_t live_bytes = live_heap_bytes.fetch_add(allocation_size, std::memory_order_relaxed) + allocation_size;
+    int64_t peak_bytes = peak_live_heap_bytes.load(std::memory_order_relaxed);
+    while (live_bytes > peak_bytes && !peak_live_heap_bytes.compare_exchange_weak(peak_bytes, live_bytes, std::memory_order_relaxed)) {
+        // A failed exchange reloads peak_bytes, so just try again.
+    }
+    return pointer;
+}
+
+static void free_counted(void* pointer) {
+    if (pointer != nullptr) {
+        live_heap_bytes.fetch_sub(get_allocation_size(pointer), std::memory_order_relaxed);
+    }
+    free(pointer);
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void* pointer) noexcept {
+    free_counted(pointer);
+}
+
+void operator delete[](void* pointer) noexcept {
+    free_counted(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept {
+    free_counted(pointer);
+}
+
+void operator delete[](void* pointer, size_t) noexcept {
+    free_counted(pointer);
+}
+
+// --------------------------------------------------------------------------
+
+struct BenchmarkResult {
+    std::string name;
+    std::vector<double> times_ms;
+    uint64_t allocation_count;
+    uint64_t allocated_bytes;
+    int64_t peak_heap_bytes;
+};
+
+// --------------------------------------------------------------------------
+
+uint64_t get_peak_resident_set_size() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return usage.ru_maxrss;
+#else
+    return (uint64_t)usage.ru_maxrss * 1024;
+#endif
+}
+
+// --------------------------------------------------------------------------
+
+BenchmarkResult run_benchmark(const std::string& name, int iteration_count, const std::function<void()>& run_iteration, const std::function<void()>& prepare_iteration = nullptr) {
+    // Allocations are reported for the first run, which starts cold. Later runs can reuse memory
+    // an earlier one kept, like an arena's block, and would hide it. The peak heap is how far
+    // live heap memory rose above where it was when the run started, so prepare_iteration frees
+    // the previous run's results untimed and uncounted.
+    BenchmarkResult result;
+    result.name = name;
+
+    for (int iteration = 0; iteration < iteration_count; iteration++) {
+        if (prepare_iteration) {
+            prepare_iteration();
+        }
+
+        uint64_t allocation_count_before = allocation_count.load();
+        uint64_t allocated_bytes_before = allocated_bytes.load();
+        int64_t live_heap_bytes_before = live_heap_bytes.load();
+        peak_live_heap_bytes.store(live_heap_bytes_before);
+
+        std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+        run_iteration();
+        std::chrono::duration<double, std::milli> elapsed_time = std::chrono::steady_clock::now() - start_time;
+
+        result.times_ms.push_back(elapsed_time.count());
+        if (iteration == 0) {
+            result.allocation_count = allocation_count.load() - allocation_count_before;
+            result.allocated_bytes = allocated_bytes.load() - allocated_bytes_before;
+            result.peak_heap_bytes = peak_live_heap_bytes.load() - live_heap_bytes_before;
+        }
+    }
+
+    std::sort(result.times_ms.begin(), result.times_ms.end());
+    return result;
+}
+
+// --------------------------------------------------------------------------
+
+void print_result(const BenchmarkResult& result, uint64_t file_size_in_bytes, uint64_t face_count) {
+    double best_ms = result.times_ms.front();
+    double median_ms = result.times_ms[result.times_ms.size() / 2];
+
+    std::cout << std::left << std::setw(22) << result.name << std::right << std::fixed << std::setprecision(2)
+              << "  best " << std::setw(10) << best_ms << " ms"
+              << "  median " << std::setw(10) << median_ms << " ms";
+    if (file_size_in_bytes > 0) {
+        std::cout << "  " << std::setw(9) << (file_size_in_bytes / (1024.0 * 1024.0)) / (best_ms / 1000.0) << " MB/s";
+    }
+    std::cout << "  " << std::setw(8) << (face_count / 1.0e6) / (best_ms / 1000.0) << " M faces/s"
+              << "  " << result.allocation_count << " allocations (" << std::setprecision(1) << (result.allocated_bytes / (1024.0 * 1024.0)) << " MB)"
+              << "  peak heap " << (result.peak_heap_bytes / (1024.0 * 1024.0)) << " MB"
+              << std::endl;
+}
+
+// --------------------------------------------------------------------------
+
+void print_usage(const std::string& program_name) {
+    std::cerr << "Usage: " << program_name << " [OPTIONS] OBJ_FILE" << std::endl;
+    std::cerr << std::endl;
+    std::cerr << "Options:" << std::endl;
+    std::cerr << "  --threads N      Number of threads used to load the OBJ file (default: all cores)" << std::endl;
+    std::cerr << "  --iterations N   Number of timed runs of each benchmark (default: 5)" << std::endl;
+}
+
+// --------------------------------------------------------------------------
+
+int main(int argc, char** argv) {
+    std::string file_path;
+    int thread_count = 0;
+    int iteration_count = 5;
+
+    for (int i = 1; i < argc; i++) {
+        std::string argument = argv[i];
+        char* number_end;
+        if (argument == "--threads" && i + 1 < argc) {
+            thread_count = strtol(argv[++i], &number_end, 10);
+            if (*number_end != '\0' || thread_count < 1) {
+                std::cerr << "[ERROR] Invalid thread count \"" << argv[i] << "\"" << std::endl;
+                return EXIT_FAILURE;
+            }
+        } else if (argument == "--iterations" && i + 1 < argc) {
+            iteration_count = strtol(argv[++i], &number_end, 10);
+            if (*number_end != '\0' || iteration_count < 1) {
+                std::cerr << "[ERROR] Invalid iteration count \"" << argv[i] << "\"" << std::endl;
+                return EXIT_FAILURE;
+            }
+        } else if (argument.size() > 0 && argument[0] == '-') {
+            std::cerr << "[ERROR] Unknown option \"" << argument << "\"" << std::endl;
+            print_usage(argv[0]);
+            return EXIT_FAILURE;
+        } else if (file_path.empty()) {
+            file_path = argument;
+        } else {
+            print_usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (file_path.empty()) {
+        print_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    std::error_code error;
+    uint64_t file_size_in_bytes = std::filesystem::file_size(file_path, error);
+    if (error) {
+        std::cerr << "[ERROR] Could not open file \"" << file_path << "\"" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    ObjLoader obj_loader;
+    obj_loader.set_thread_count(thread_count);
+
+    std::optional<Model> model;
+    BenchmarkResult load_result = run_benchmark("load_from_file", iteration_count, [&]() {
+        model = obj_loader.load_from_file(file_path);
+    }, [&]() {
+        model.reset();
+    });
+    if (!model.has_value()) {
+        std::cerr << "[ERROR] Could not load file \"" << file_path << "\"" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    uint64_t face_count = model->get_faces().size();
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << file_path << ": " << (file_size_in_bytes / (1024.0 * 1024.0)) << " MB, " << model->get_vertices().size() << " vertices, "
+              << face_count << " faces, " << iteration_count << " iterations" << std::endl;
+    std::cout << std::endl;
+    print_result(load_result, file_size_in_bytes, face_count);
+
+    // The same load with the model's arrays placed in one arena block. The arena is set up
+    // once, like a loader reused across files would, so later runs reuse its block and only
+    // the first run's allocations include it.
+    MemoryArena memory_arena;
+    ObjLoader arena_obj_loader;
+    arena_obj_loader.set_thread_count(thread_count);
+    arena_obj_loader.set_memory_arena(&memory_arena);
+
+    std::optional<Model> arena_model;
+    BenchmarkResult arena_load_result = run_benchmark("load_from_file (arena)", iteration_count, [&]() {
+        arena_model = arena_obj_loader.load_from_file(file_path);
+    }, [&]() {
+        arena_model.reset();
+        memory_arena.reset();
+    });
+    print_result(arena_load_result, file_size_in_bytes, face_count);
+    arena_model.reset();
+
+    BenchmarkResult buffer_data_result = run_benchmark("get_buffer_data", iteration_count, [&]() {
+        BufferData buffer_data = model->get_buffer_data();
+    });
+    print_result(buffer_data_result, 0, face_count);
+
+    ModelExtents extents;
+    BenchmarkResult extents_result = run_benchmark("get_extents", iteration_count, [&]() {
+        extents = model->get_extents();
+    });
+    print_result(extents_result, 0, face_count);
+
+    std::cout << std::endl;
+    std::cout << "Peak RSS: " << (get_peak_resident_set_size() / (1024.0 * 1024.0)) << " MB" << std::endl;
+
+    return EXIT_SUCCESS;
+}
@@ -1,29 +1,50 @@
 #version 330 core
 
+#ifdef HAS_NORMALS
 in vec3 normal;
+#endif
 in vec3 frag_world_position;
+#ifdef HAS_TEXTURE_COORDINATES
+in vec2 texture_coordinate;
+#endif
 
 uniform vec3 camera_world_position;
 uniform vec3 sun_direction;
 uniform vec3 ambient_light;
 uniform vec3 base_color;
 uniform float shininess;
+uniform vec3 specular_color;
+#ifdef HAS_TEXTURE_COORDINATES
+uniform bool has_diffuse_texture;
+uniform sampler2D diffuse_texture;
+#endif
 
 out vec4 frag_color;
 
 void main() {
+#ifdef HAS_NORMALS
     vec3 N = normalize(normal);
+#else
+    // Without normals, each triangle is lit flat, facing the way its screen-space slopes say.
+    vec3 N = normalize(cross(dFdx(frag_world_position), dFdy(frag_world_position)));
+#endif
     vec3 L = normalize(-sun_direction);
     vec3 V = normalize(camera_world_position - frag_world_position);
     vec3 H = normalize(L + V);
 
-    vec3 ambient = ambient_light * base_color;
+#ifdef HAS_TEXTURE_COORDINATES
+    vec3 surface_color = has_diffuse_texture ? base_color * texture(diffuse_texture, texture_coordinate).rgb : base_color;
+#else
+    vec3 surface_color = base_color;
+#endif
 
-    vec3 diffuse = max(dot(N, L), 0.0) * base_color;
+    vec3 ambient = ambient_light * surface_color;
+
+    vec3 diffuse = max(dot(N, L), 0.0) * surface_color;
 
     float specular_angle = max(dot(N, H), 0.0);
     float specular_amount = pow(specular_angle, shininess);
-    vec3 specular = specular_amount * vec3(1.0) * vec3(1.0);
+    vec3 specular = specular_amount * specular_color * vec3(1.0);
 
     vec3 final_color = clamp(ambient + diffuse + specular, 0.0, 1.0);
 
@@ -1,20 +1,81 @@
 #version 330 core
 
+// ShaderManager builds variants of this shader and default.frag by defining some of
+// HAS_NORMALS, HAS_TEXTURE_COORDINATES, QUANTIZED_POSITIONS, OCTAHEDRAL_NORMALS and
+// NORMAL_MATRIX before the first line after #version.
+
 layout (location = 0) in vec3 in_position;
+#ifdef HAS_NORMALS
 layout (location = 1) in vec3 in_normal;
+#endif
+layout (location = 2) in mat4 instance_transform;
+#ifdef HAS_TEXTURE_COORDINATES
+layout (location = 6) in vec2 in_texture_coordinate;
+#endif
 
 uniform mat4 model;
 uniform mat4 view;
 uniform mat4 projection;
 
+#ifdef NORMAL_MATRIX
+// transpose(inverse(model)), worked out once per draw instead of once per vertex.
+uniform mat3 normal_matrix;
+#endif
+
+#ifdef QUANTIZED_POSITIONS
+uniform vec3 position_offset;
+uniform vec3 position_scale;
+#endif
+
+#ifdef HAS_NORMALS
 out vec3 normal;
+#endif
 out vec3 frag_world_position;
+#ifdef HAS_TEXTURE_COORDINATES
+out vec2 texture_coordinate;
+#endif
+
+#ifdef OCTAHEDRAL_NORMALS
+vec3 decode_octahedral_normal(vec2 encoded_normal) {
+    vec3 decoded_normal = vec3(encoded_normal, 1.0 - abs(encoded_normal.x) - abs(encoded_normal.y));
+    float fold = max(-decoded_normal.z, 0.0);
+    decoded_normal.x += decoded_normal.x >= 0.0 ? -fold : fold;
+    decoded_normal.y += decoded_normal.y >= 0.0 ? -fold : fold;
+    return decoded_normal;
+}
+#endif
 
 void main() {
-    gl_Position = projection * view * model * vec4(in_position, 1.0);
+#ifdef QUANTIZED_POSITIONS
+    vec3 position = position_offset + position_scale * in_position;
+#else
+    vec3 position = in_position;
+#endif
+
+    mat4 instance_model = model * instance_transform;
+    gl_Position = projection * view * instance_model * vec4(position, 1.0);
+
+#ifdef HAS_NORMALS
+#ifdef OCTAHEDRAL_NORMALS
+    vec3 object_normal = decode_octahedral_normal(in_normal.xy);
+#else
+    vec3 object_normal = in_normal;
+#endif
+
+#ifdef NORMAL_MATRIX
+    // Instances are only ever moved, rotated and evenly scaled, so their own matrix turns
+    // normals the right way, and default.frag normalizes away the scale.
+    normal = normal_matrix * (mat3(instance_transform) * object_normal);
+#else
+    mat3 normal_matrix = mat3(transpose(inverse(instance_model)));
+    normal = normal_matrix * object_normal;
+#endif
+#endif
 
-    mat3 normal_matrix = mat3(transpose(inverse(model)));
-    normal = normal_matrix * in_normal;
+    frag_world_position = (instance_model * vec4(position, 1.0)).xyz;
 
-    frag_world_position = (model * vec4(in_position, 1.0)).xyz;
+#ifdef HAS_TEXTURE_COORDINATES
+    // OBJ texture coordinates start at the bottom left, and images are uploaded top row first.
+    texture_coordinate = vec2(in_texture_coordinate.x, 1.0 - in_texture_coordinate.y);
+#endif
 }
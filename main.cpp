@@ -5,7 +5,9 @@
 #include <stdlib.h>
 #include <string>
 #include <fstream>
-#include <sstream>
+#include <cstring>
+#include <algorithm>
+#include <chrono>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
@@ -14,149 +16,1530 @@
 #include <glm/gtx/string_cast.hpp>
 
 #include "ObjLoader.h"
+#include "ModelCache.h"
+#include "MeshOptimizer.h"
+#include "NormalGenerator.h"
+#include "ClusterCuller.h"
+#include "MeshSimplifier.h"
+#include "VertexEncoder.h"
+#include "BufferUploader.h"
+#include "ShaderManager.h"
+#include "GrowableBuffer.h"
+#include "MaterialLibrary.h"
+#include "TextureCache.h"
+#include "TexturePool.h"
+#include "StreamingModelLoader.h"
+#include "BoundingVolumeHierarchy.h"
+#include "Benchmark.h"
+#include "Profiler.h"
+#include "GpuTimer.h"
+#include "Scene.h"
+#include "BatchConverter.h"
 #include "MouseHandler.h"
+#include "SoftwareRasterizer.h"
+#include "ImageWriter.h"
+#include "ImageSequenceWriter.h"
+#include "FrameReadback.h"
+#include "MemoryTracker.h"
 
-bool read_file_into_string(const char* file_path, std::string& str) {
-    std::ifstream file(file_path);
-    if (!file) {
+// The view and lighting, shared by the OpenGL and CPU renderers.
+const int INITIAL_WINDOW_WIDTH = 500;
+const int INITIAL_WINDOW_HEIGHT = 500;
+
+const int BENCHMARK_WARMUP_FRAME_COUNT = 10;
+
+const float FOV_Y = glm::radians(45.0f);
+const float NEAR_CLIP_PLANE_DISTANCE = 0.1f;
+const float FAR_CLIP_PLANE_DISTANCE = 100.0f;
+const float DISTANCE_PER_MOUSE_WHEEL = 0.1f;
+
+const glm::vec3 SUN_DIRECTION = glm::normalize(glm::vec3(1.0f, -1.0f, -1.0f));
+const glm::vec3 AMBIENT_LIGHT = glm::vec3(0.2f, 0.2f, 0.2f);
+const glm::vec3 BASE_COLOR = glm::vec3(0.0f, 1.0f, 0.0f);
+const float DEFAULT_SHININESS = 32.0f;
+
+// --------------------------------------------------------------------------
+
+BufferDataView get_buffer_data_view(const IndexedBufferData& indexed_buffer_data) {
+    BufferDataView buffer_data_view;
+    buffer_data_view.vertex_data = indexed_buffer_data.vertex_data.data();
+    buffer_data_view.indices = indexed_buffer_data.indices.data();
+    buffer_data_view.texture_coordinate_data = indexed_buffer_data.texture_coordinate_data.data();
+    buffer_data_view.submeshes = indexed_buffer_data.submeshes.data();
+    buffer_data_view.vertex_count = indexed_buffer_data.vertex_count;
+    buffer_data_view.index_count = indexed_buffer_data.indices.size();
+    buffer_data_view.texture_coordinate_float_count = indexed_buffer_data.texture_coordinate_data.size();
+    buffer_data_view.submesh_count = indexed_buffer_data.submeshes.size();
+    buffer_data_view.index_size_in_bytes = indexed_buffer_data.index_size_in_bytes;
+    return buffer_data_view;
+}
+
+// --------------------------------------------------------------------------
+
+GLenum upload_index_buffer(BufferUploader& buffer_uploader, GLuint& ebo, const BufferDataView& buffer_data_view) {
+    // Narrows to 16 bits while writing when every index fits, so no narrowed copy is kept around.
+    const uint32_t* indices = buffer_data_view.indices;
+    size_t index_count = buffer_data_view.index_count;
+    if (buffer_data_view.index_size_in_bytes == sizeof(uint16_t)) {
+        buffer_uploader.upload(GL_ELEMENT_ARRAY_BUFFER, ebo, index_count * sizeof(uint16_t), [&](unsigned char* destination) {
+            std::copy(indices, indices + index_count, reinterpret_cast<uint16_t*>(destination));
+        });
+        return GL_UNSIGNED_SHORT;
+    }
+
+    buffer_uploader.upload(GL_ELEMENT_ARRAY_BUFFER, ebo, index_count * sizeof(uint32_t), [&](unsigned char* destination) {
+        std::memcpy(destination, indices, index_count * sizeof(uint32_t));
+    });
+    return GL_UNSIGNED_INT;
+}
+
+// --------------------------------------------------------------------------
+
+void set_up_instance_attributes(int first_instance) {
+    // Reads from the bound instance buffer. A mat4 attribute takes four locations, one per column,
+    // and advances once per instance. Pointing it at first_instance stands in for a base instance,
+    // which OpenGL 3.3 doesn't have.
+    const GLuint INSTANCE_TRANSFORM_LOCATION = 2;
+
+    GLsizei stride = sizeof(glm::mat4);
+    for (int column = 0; column < 4; column++) {
+        GLuint location = INSTANCE_TRANSFORM_LOCATION + column;
+        intptr_t offset = (intptr_t)first_instance * stride + column * sizeof(glm::vec4);
+        glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, stride, (void*)offset);
+        glVertexAttribDivisor(location, 1);
+        glEnableVertexAttribArray(location);
+    }
+}
+
+// --------------------------------------------------------------------------
+
+void set_up_vertex_attributes(const EncodedVertexBuffer& encoded_vertex_buffer) {
+    GLsizei stride = encoded_vertex_buffer.bytes_per_vertex;
+    void* normal_offset = (void*)(intptr_t)encoded_vertex_buffer.normal_offset;
+
+    // Quantized attributes are normalized by the fixed-function fetch and decoded in default.vert.
+    if (encoded_vertex_buffer.format == VertexFormat::FLOAT32) {
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)0);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, normal_offset);
+    } else if (encoded_vertex_buffer.format == VertexFormat::QUANTIZED_OCTAHEDRAL) {
+        glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, stride, (void*)0);
+        glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, stride, normal_offset);
+    } else {
+        glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, stride, (void*)0);
+        glVertexAttribPointer(1, 4, GL_INT_2_10_10_10_REV, GL_TRUE, stride, normal_offset);
+    }
+
+    glEnableVertexAttribArray(0);
+    glEnableVertexAttribArray(1);
+}
+
+// --------------------------------------------------------------------------
+
+float calculate_initial_camera_distance_to_object(glm::vec3& dimensions, float fovx, float fovy) {
+    float longest_obj_xz_distance_to_origin = glm::sqrt(0.5 * (dimensions.x * dimensions.x + dimensions.z * dimensions.z));
+
+    float best_vertical_distance = dimensions.y / (2.0f * glm::tan(fovy / 2.0f)) + longest_obj_xz_distance_to_origin;
+    float best_horizontal_distance = glm::max(dimensions.x, dimensions.z) / (2.0f * glm::tan(fovx / 2.0f)) + longest_obj_xz_distance_to_origin;
+
+    return glm::max(best_vertical_distance, best_horizontal_distance);
+}
+
+// --------------------------------------------------------------------------
+
+struct WindowResizeChanges {
+    float rotation_degrees_per_pixel;
+    float aspect_ratio;
+};
+
+WindowResizeChanges get_window_resize_changes(int new_window_width, int new_window_height) {
+    WindowResizeChanges window_resize_changes;
+    window_resize_changes.rotation_degrees_per_pixel = 360.0f / glm::max(new_window_width, new_window_height);
+    window_resize_changes.aspect_ratio = (float)new_window_width / new_window_height;
+
+    return window_resize_changes;
+}
+
+// --------------------------------------------------------------------------
+
+WindowResizeChanges handle_window_resize(int new_window_width, int new_window_height) {
+    glViewport(0, 0, new_window_width, new_window_height);
+    return get_window_resize_changes(new_window_width, new_window_height);
+}
+
+// --------------------------------------------------------------------------
+
+std::string get_window_title(const std::string& file_path) {
+    std::string window_title;
+    size_t last_slash_in_file_path_index = file_path.find_last_of('/');
+    if (last_slash_in_file_path_index == std::string::npos) {
+        window_title = file_path;
+    } else {
+        window_title = file_path.substr(last_slash_in_file_path_index + 1);
+    }
+    window_title += " - OBJ Viewer";
+
+    return window_title;
+}
+
+// --------------------------------------------------------------------------
+
+struct SubmeshMaterial {
+    glm::vec3 diffuse_color;
+    glm::vec3 specular_color;
+    float shininess;
+    GLuint texture;
+};
+
+// --------------------------------------------------------------------------
+
+struct CommandLineOptions {
+    std::vector<std::string> file_paths;
+    std::string placement_file_path;
+    bool is_scene;
+    int thread_count;
+    bool use_cache;
+    std::string cache_directory;
+    std::string shader_cache_directory;
+    bool cache_buffer_data;
+    bool optimize_mesh;
+    bool optimize_overdraw;
+    VertexFormat vertex_format;
+    bool stream;
+    bool follow;
+    size_t batch_size_in_bytes;
+    bool map_buffers;
+    MipmapFilter mipmap_filter;
+    bool generate_normals;
+    NormalType normal_type;
+    NormalWeighting normal_weighting;
+    float crease_angle_degrees;
+    bool cull_clusters;
+    int level_of_detail_count;
+    bool pick;
+    int benchmark_frame_count;
+    std::string benchmark_output_path;
+    std::string trace_file_path;
+    bool print_memory_statistics;
+    std::string memory_statistics_output_path;
+    bool print_frame_statistics;
+    bool render_on_demand;
+    std::string convert_output_directory;
+    ConversionFormat conversion_format;
+    bool use_software_renderer;
+    std::string render_image_path;
+    int image_width;
+    int image_height;
+    int turntable_frame_count;
+    std::string turntable_output_pattern;
+    float turntable_elevation_degrees;
+};
+
+void print_usage(const std::string& program_name) {
+    std::cerr << "Usage: " << program_name << " [OPTIONS] OBJ_FILE [OBJ_FILE...]" << std::endl;
+    std::cerr << "       " << program_name << " [OPTIONS] --placements FILE" << std::endl;
+    std::cerr << "       " << program_name << " [OPTIONS] --convert OUTPUT_DIR INPUT [INPUT...]" << std::endl;
+    std::cerr << std::endl;
+    std::cerr << "Options:" << std::endl;
+    std::cerr << "  --threads N      Number of threads used to load the OBJ file (default: all cores)" << std::endl;
+    std::cerr << "  --placements FILE  Load a scene with one \"OBJ_FILE X Y Z [ROTATION_X ROTATION_Y ROTATION_Z [SCALE]]\" per line" << std::endl;
+    std::cerr << "  --cache          Reuse a binary cache of the model stored next to the OBJ file" << std::endl;
+    std::cerr << "  --cache-dir DIR  Reuse a binary cache of the model stored in DIR" << std::endl;
+    std::cerr << "  --cache-buffer   Also cache the vertex and index buffers sent to the GPU" << std::endl;
+    std::cerr << "  --shader-cache DIR  Keep linked shader programs in DIR so later runs skip compiling them (default: shader-cache)" << std::endl;
+    std::cerr << "  --no-shader-cache  Always compile shader programs from source" << std::endl;
+    std::cerr << "  --optimize       Reorder triangles and vertices for the GPU vertex cache" << std::endl;
+    std::cerr << "  --optimize-overdraw  Like --optimize, and also reorder triangles to reduce overdraw" << std::endl;
+    std::cerr << "  --vertex-format FORMAT  Vertex layout sent to the GPU: float, oct16 or packed (default: float)" << std::endl;
+    std::cerr << "  --stream         Draw the model while it loads in the background, without indexing or caching" << std::endl;
+    std::cerr << "  --batch-size MB  Size of each streamed batch of triangles (default: 16)" << std::endl;
+    std::cerr << "  --follow         Like --stream, and keep drawing the faces appended to the file while it's being written" << std::endl;
+    std::cerr << "  --upload METHOD  Write buffers straight into mapped GPU memory or copy them through the driver: map or copy (default: map)" << std::endl;
+    std::cerr << "  --mip-filter FILTER  Filter used to shrink texture mipmaps: box or kaiser (default: kaiser)" << std::endl;
+    std::cerr << "  --normals TYPE   Replace the model's normals with flat or smooth ones (default: smooth, only if any are missing)" << std::endl;
+    std::cerr << "  --normal-weighting WEIGHTING  Weight face normals by corner angle or area when smoothing (default: angle)" << std::endl;
+    std::cerr << "  --crease-angle DEGREES  Don't smooth across edges sharper than this angle (default: 180)" << std::endl;
+    std::cerr << "  --cull           Skip clusters of triangles that are off screen or facing away (closed meshes only)" << std::endl;
+    std::cerr << "  --lod LEVELS     Build up to LEVELS simplified levels of detail, chosen by on-screen error (default: 1)" << std::endl;
+    std::cerr << "  --pick           Right-click the model to print the face and vertex under the cursor" << std::endl;
+    std::cerr << "  --bench FRAMES   Render FRAMES frames of a fixed camera path offscreen without vsync and print timings as JSON" << std::endl;
+    std::cerr << "  --bench-output FILE  Write the --bench JSON to FILE instead of standard output" << std::endl;
+    std::cerr << "  --on-demand      Only redraw when the view or the model changes, sleeping in between" << std::endl;
+    std::cerr << "  --renderer RENDERER  Draw with OpenGL or with the multithreaded CPU rasterizer: gl or cpu (default: gl," << std::endl;
+    std::cerr << "                   falling back to cpu if there's no OpenGL 3.3 context)" << std::endl;
+    std::cerr << "  --render-image FILE  Draw one frame with the CPU rasterizer, without opening a window, and save it as a .png or .ppm file" << std::endl;
+    std::cerr << "  --image-size WIDTHxHEIGHT  Size of the images saved by --render-image and --turntable (default: 500x500)" << std::endl;
+    std::cerr << "  --turntable FRAMES  Save FRAMES images of one turn around the model without opening a window" << std::endl;
+    std::cerr << "  --turntable-output PATTERN  File names for --turntable, with a run of # replaced by the frame number and" << std::endl;
+    std::cerr << "                   the extension choosing .png or .ppm (default: turntable_####.png)" << std::endl;
+    std::cerr << "  --turntable-elevation DEGREES  How far the model is tilted towards the camera during the turn (default: 20)" << std::endl;
+    std::cerr << "  --trace FILE     Write a Chrome/Perfetto trace of load phases and frames to FILE (needs make PROFILE=1)" << std::endl;
+    std::cerr << "  --frame-stats    Print CPU and GPU frame times every second (needs make PROFILE=1)" << std::endl;
+    std::cerr << "  --stats          Print the current and peak memory of the loader, the model, the buffer data and the" << std::endl;
+    std::cerr << "                   GPU buffers as JSON on exit" << std::endl;
+    std::cerr << "  --stats-output FILE  Like --stats, but write the JSON to FILE instead of standard output" << std::endl;
+    std::cerr << "  --convert OUTPUT_DIR  Convert each INPUT without opening a window. An INPUT is an OBJ file, a directory" << std::endl;
+    std::cerr << "                   searched for OBJ files, or @FILE listing one of those per line" << std::endl;
+    std::cerr << "  --convert-format FORMAT  Write a mesh file per INPUT or the viewer's model cache: mesh or cache (default: mesh)" << std::endl;
+}
+
+bool parse_command_line(int argc, char** argv, CommandLineOptions& options) {
+    options.thread_count = 0;
+    options.use_cache = false;
+    options.shader_cache_directory = "shader-cache";
+    options.cache_buffer_data = false;
+    options.optimize_mesh = false;
+    options.optimize_overdraw = false;
+    options.vertex_format = VertexFormat::FLOAT32;
+    options.stream = false;
+    options.follow = false;
+    options.batch_size_in_bytes = 16 * 1024 * 1024;
+    options.map_buffers = true;
+    options.mipmap_filter = MipmapFilter::KAISER;
+    options.generate_normals = false;
+    options.normal_type = NormalType::SMOOTH;
+    options.normal_weighting = NormalWeighting::ANGLE;
+    options.crease_angle_degrees = 180.0f;
+    options.cull_clusters = false;
+    options.level_of_detail_count = 1;
+    options.pick = false;
+    options.benchmark_frame_count = 0;
+    options.print_memory_statistics = false;
+    options.print_frame_statistics = false;
+    options.render_on_demand = false;
+    options.conversion_format = ConversionFormat::MESH;
+    options.use_software_renderer = false;
+    options.image_width = INITIAL_WINDOW_WIDTH;
+    options.image_height = INITIAL_WINDOW_HEIGHT;
+    options.turntable_frame_count = 0;
+    options.turntable_output_pattern = "turntable_####.png";
+    options.turntable_elevation_degrees = 20.0f;
+
+    for (int i = 1; i < argc; i++) {
+        std::string argument = argv[i];
+        if (argument == "--threads" && i + 1 < argc) {
+            char* number_end;
+            long thread_count = strtol(argv[++i], &number_end, 10);
+            if (*number_end != '\0' || thread_count < 1) {
+                std::cerr << "[ERROR] Invalid thread count \"" << argv[i] << "\"" << std::endl;
+                return false;
+            }
+            options.thread_count = thread_count;
+        } else if (argument == "--cache") {
+            options.use_cache = true;
+        } else if (argument == "--cache-dir" && i + 1 < argc) {
+            options.use_cache = true;
+            options.cache_directory = argv[++i];
+        } else if (argument == "--shader-cache" && i + 1 < argc) {
+            options.shader_cache_directory = argv[++i];
+        } else if (argument == "--no-shader-cache") {
+            options.shader_cache_directory = "";
+        } else if (argument == "--cache-buffer") {
+            options.use_cache = true;
+            options.cache_buffer_data = true;
+        } else if (argument == "--optimize") {
+            options.optimize_mesh = true;
+        } else if (argument == "--optimize-overdraw") {
+            options.optimize_mesh = true;
+            options.optimize_overdraw = true;
+        } else if (argument == "--vertex-format" && i + 1 < argc) {
+            std::string vertex_format = argv[++i];
+            if (vertex_format == "float") {
+                options.vertex_format = VertexFormat::FLOAT32;
+            } else if (vertex_format == "oct16") {
+                options.vertex_format = VertexFormat::QUANTIZED_OCTAHEDRAL;
+            } else if (vertex_format == "packed") {
+                options.vertex_format = VertexFormat::QUANTIZED_PACKED;
+            } else {
+                std::cerr << "[ERROR] Unknown vertex format \"" << vertex_format << "\"" << std::endl;
+                return false;
+            }
+        } else if (argument == "--stream") {
+            options.stream = true;
+        } else if (argument == "--follow") {
+            // Following is streaming that doesn't end at the end of the file.
+            options.stream = true;
+            options.follow = true;
+        } else if (argument == "--batch-size" && i + 1 < argc) {
+            char* number_end;
+            long batch_size = strtol(argv[++i], &number_end, 10);
+            if (*number_end != '\0' || batch_size < 1 || batch_size > 1024) {
+                std::cerr << "[ERROR] Invalid batch size \"" << argv[i] << "\"" << std::endl;
+                return false;
+            }
+            options.batch_size_in_bytes = (size_t)batch_size * 1024 * 1024;
+        } else if (argument == "--upload" && i + 1 < argc) {
+            std::string upload_method = argv[++i];
+            if (upload_method == "map") {
+                options.map_buffers = true;
+            } else if (upload_method == "copy") {
+                options.map_buffers = false;
+            } else {
+                std::cerr << "[ERROR] Unknown upload method \"" << upload_method << "\"" << std::endl;
+                return false;
+            }
+        } else if (argument == "--mip-filter" && i + 1 < argc) {
+            std::string mipmap_filter = argv[++i];
+            if (mipmap_filter == "box") {
+                options.mipmap_filter = MipmapFilter::BOX;
+            } else if (mipmap_filter == "kaiser") {
+                options.mipmap_filter = MipmapFilter::KAISER;
+            } else {
+                std::cerr << "[ERROR] Unknown mipmap filter \"" << mipmap_filter << "\"" << std::endl;
+                return false;
+            }
+        } else if (argument == "--normals" && i + 1 < argc) {
+            std::string normal_type = argv[++i];
+            if (normal_type == "flat") {
+                options.normal_type = NormalType::FLAT;
+            } else if (normal_type == "smooth") {
+                options.normal_type = NormalType::SMOOTH;
+            } else {
+                std::cerr << "[ERROR] Unknown normal type \"" << normal_type << "\"" << std::endl;
+                return false;
+            }
+            options.generate_normals = true;
+        } else if (argument == "--normal-weighting" && i + 1 < argc) {
+            std::string normal_weighting = argv[++i];
+            if (normal_weighting == "angle") {
+                options.normal_weighting = NormalWeighting::ANGLE;
+            } else if (normal_weighting == "area") {
+                options.normal_weighting = NormalWeighting::AREA;
+            } else {
+                std::cerr << "[ERROR] Unknown normal weighting \"" << normal_weighting << "\"" << std::endl;
+                return false;
+            }
+        } else if (argument == "--crease-angle" && i + 1 < argc) {
+            char* number_end;
+            float crease_angle_degrees = strtof(argv[++i], &number_end);
+            if (*number_end != '\0' || !(crease_angle_degrees >= 0.0f)) {
+                std::cerr << "[ERROR] Invalid crease angle \"" << argv[i] << "\"" << std::endl;
+                return false;
+            }
+            options.crease_angle_degrees = crease_angle_degrees;
+        } else if (argument == "--cull") {
+            options.cull_clusters = true;
+        } else if (argument == "--lod" && i + 1 < argc) {
+            char* number_end;
+            long level_of_detail_count = strtol(argv[++i], &number_end, 10);
+            if (*number_end != '\0' || level_of_detail_count < 1 || level_of_detail_count > 16) {
+                std::cerr << "[ERROR] Invalid level of detail count \"" << argv[i] << "\"" << std::endl;
+                return false;
+            }
+            options.level_of_detail_count = level_of_detail_count;
+        } else if (argument == "--pick") {
+            options.pick = true;
+        } else if (argument == "--bench" && i + 1 < argc) {
+            char* number_end;
+            long benchmark_frame_count = strtol(argv[++i], &number_end, 10);
+            if (*number_end != '\0' || benchmark_frame_count < 1) {
+                std::cerr << "[ERROR] Invalid benchmark frame count \"" << argv[i] << "\"" << std::endl;
+                return false;
+            }
+            options.benchmark_frame_count = benchmark_frame_count;
+        } else if (argument == "--bench-output" && i + 1 < argc) {
+            options.benchmark_output_path = argv[++i];
+        } else if (argument == "--trace" && i + 1 < argc) {
+            options.trace_file_path = argv[++i];
+        } else if (argument == "--frame-stats") {
+            options.print_frame_statistics = true;
+        } else if (argument == "--stats") {
+            options.print_memory_statistics = true;
+        } else if (argument == "--stats-output" && i + 1 < argc) {
+            options.print_memory_statistics = true;
+            options.memory_statistics_output_path = argv[++i];
+        } else if (argument == "--on-demand") {
+            options.render_on_demand = true;
+        } else if (argument == "--renderer" && i + 1 < argc) {
+            std::string renderer = argv[++i];
+            if (renderer == "gl") {
+                options.use_software_renderer = false;
+            } else if (renderer == "cpu") {
+                options.use_software_renderer = true;
+            } else {
+                std::cerr << "[ERROR] Unknown renderer \"" << renderer << "\"" << std::endl;
+                return false;
+            }
+        } else if (argument == "--render-image" && i + 1 < argc) {
+            options.render_image_path = argv[++i];
+            options.use_software_renderer = true;
+            if (!ImageWriter::is_supported_format(options.render_image_path)) {
+                std::cerr << "[ERROR] Unsupported image format for \"" << options.render_image_path << "\", use .png or .ppm" << std::endl;
+                return false;
+            }
+        } else if (argument == "--image-size" && i + 1 < argc) {
+            char* number_end;
+            long image_width = strtol(argv[++i], &number_end, 10);
+            long image_height = *number_end == 'x' ? strtol(number_end + 1, &number_end, 10) : 0;
+            if (*number_end != '\0' || image_width < 1 || image_width > 16384 || image_height < 1 || image_height > 16384) {
+                std::cerr << "[ERROR] Invalid image size \"" << argv[i] << "\"" << std::endl;
+                return false;
+            }
+            options.image_width = image_width;
+            options.image_height = image_height;
+        } else if (argument == "--turntable" && i + 1 < argc) {
+            char* number_end;
+            long turntable_frame_count = strtol(argv[++i], &number_end, 10);
+            if (*number_end != '\0' || turntable_frame_count < 1) {
+                std::cerr << "[ERROR] Invalid turntable frame count \"" << argv[i] << "\"" << std::endl;
+                return false;
+            }
+            options.turntable_frame_count = turntable_frame_count;
+        } else if (argument == "--turntable-output" && i + 1 < argc) {
+            options.turntable_output_pattern = argv[++i];
+        } else if (argument == "--turntable-elevation" && i + 1 < argc) {
+            char* number_end;
+            float turntable_elevation_degrees = strtof(argv[++i], &number_end);
+            if (*number_end != '\0' || !(turntable_elevation_degrees >= -90.0f && turntable_elevation_degrees <= 90.0f)) {
+                std::cerr << "[ERROR] Invalid turntable elevation \"" << argv[i] << "\"" << std::endl;
+                return false;
+            }
+            options.turntable_elevation_degrees = turntable_elevation_degrees;
+        } else if (argument == "--placements" && i + 1 < argc) {
+            options.placement_file_path = argv[++i];
+        } else if (argument == "--convert" && i + 1 < argc) {
+            options.convert_output_directory = argv[++i];
+        } else if (argument == "--convert-format" && i + 1 < argc) {
+            std::string conversion_format = argv[++i];
+            if (conversion_format == "mesh") {
+                options.conversion_format = ConversionFormat::MESH;
+            } else if (conversion_format == "cache") {
+                options.conversion_format = ConversionFormat::CACHE;
+            } else {
+                std::cerr << "[ERROR] Unknown conversion format \"" << conversion_format << "\"" << std::endl;
+                return false;
+            }
+        } else if (argument.size() > 0 && argument[0] == '-') {
+            std::cerr << "[ERROR] Unknown option \"" << argument << "\"" << std::endl;
+            return false;
+        } else {
+            options.file_paths.push_back(argument);
+        }
+    }
+
+#ifndef ENABLE_PROFILING
+    if (!options.trace_file_path.empty() || options.print_frame_statistics) {
+        std::cerr << "[ERROR] --trace and --frame-stats need a build with profiling enabled (make PROFILE=1)" << std::endl;
+        return false;
+    }
+#endif
+
+    // Quantized positions are relative to the model's extents, which a stream only knows once
+    // the whole file has been read.
+    if (options.stream && options.vertex_format != VertexFormat::FLOAT32) {
+        std::cerr << "[ERROR] --stream and --follow only support --vertex-format float" << std::endl;
+        return false;
+    }
+
+    if (options.benchmark_frame_count > 0 && options.stream) {
+        std::cerr << "[ERROR] --bench can't be combined with --stream" << std::endl;
+        return false;
+    }
+
+    if (options.benchmark_frame_count > 0 && options.render_on_demand) {
+        std::cerr << "[ERROR] --bench can't be combined with --on-demand" << std::endl;
+        return false;
+    }
+
+    if (options.turntable_frame_count > 0 && (options.benchmark_frame_count > 0 || options.stream || options.render_on_demand || options.pick)) {
+        std::cerr << "[ERROR] --turntable can't be combined with --bench, --stream, --on-demand or --pick" << std::endl;
+        return false;
+    }
+
+    if (!options.convert_output_directory.empty()) {
+        bool has_viewer_options = options.stream || options.use_cache || options.cull_clusters || options.level_of_detail_count > 1 || options.pick
+            || options.benchmark_frame_count > 0 || options.render_on_demand || options.print_frame_statistics || !options.placement_file_path.empty()
+            || options.use_software_renderer || options.turntable_frame_count > 0;
+        if (has_viewer_options) {
+            std::cerr << "[ERROR] --convert only takes the --threads, --normals, --normal-weighting, --crease-angle, --optimize, --optimize-overdraw," << std::endl;
+            std::cerr << "        --vertex-format, --convert-format and --trace options" << std::endl;
+            return false;
+        }
+
+        options.is_scene = false;
+        return !options.file_paths.empty();
+    }
+
+    if (!options.placement_file_path.empty() && !options.file_paths.empty()) {
+        std::cerr << "[ERROR] Give either OBJ files or --placements, not both" << std::endl;
+        return false;
+    }
+
+    // Several files, or a placement list, make a scene of instanced meshes.
+    options.is_scene = options.file_paths.size() > 1 || !options.placement_file_path.empty();
+    if (options.is_scene && (options.stream || options.use_cache || options.cull_clusters || options.level_of_detail_count > 1 || options.pick)) {
+        std::cerr << "[ERROR] --stream, --cache, --cull, --lod and --pick only work with a single OBJ file" << std::endl;
         return false;
     }
 
-    std::stringstream ss;
-    ss << file.rdbuf();
-    str = ss.str();
+    if (options.use_software_renderer && (options.is_scene || options.stream || options.cull_clusters || options.level_of_detail_count > 1 || options.pick)) {
+        std::cerr << "[ERROR] The cpu renderer only draws a single OBJ file, without --stream, --cull, --lod or --pick" << std::endl;
+        return false;
+    }
+
+    return !options.file_paths.empty() || !options.placement_file_path.empty();
+}
+
+// --------------------------------------------------------------------------
+
+#ifdef ENABLE_PROFILING
+void write_trace_file(const CommandLineOptions& options) {
+    if (options.trace_file_path.empty()) {
+        return;
+    }
+
+    if (Profiler::get_instance().write_chrome_trace(options.trace_file_path)) {
+        std::cout << "Wrote trace to " << options.trace_file_path << std::endl;
+    } else {
+        std::cerr << "[ERROR] Could not write trace file \"" << options.trace_file_path << "\"" << std::endl;
+    }
+}
+
+// --------------------------------------------------------------------------
+#endif
+
+int convert_files(const CommandLineOptions& options) {
+    PROFILE_SCOPE("convert_files");
+
+    std::optional<std::vector<ConversionInput>> inputs = BatchConverter::find_inputs(options.file_paths);
+    if (!inputs.has_value()) {
+        return EXIT_FAILURE;
+    }
+
+    if (inputs->empty()) {
+        std::cerr << "[ERROR] No OBJ files to convert" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    ConversionSettings settings;
+    settings.output_directory = options.convert_output_directory;
+    settings.format = options.conversion_format;
+    settings.thread_count = options.thread_count;
+    settings.generate_normals = options.generate_normals;
+    settings.normal_type = options.normal_type;
+    settings.normal_weighting = options.normal_weighting;
+    settings.crease_angle_degrees = options.crease_angle_degrees;
+    settings.optimize_mesh = options.optimize_mesh;
+    settings.optimize_overdraw = options.optimize_overdraw;
+    settings.vertex_format = options.vertex_format;
+
+    BatchConverter batch_converter(settings);
+    bool is_converted = batch_converter.convert(inputs.value());
+    batch_converter.print_summary();
+
+    return is_converted ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// --------------------------------------------------------------------------
+
+void optimize_mesh(IndexedBufferData& indexed_buffer_data, const CommandLineOptions& options) {
+    PROFILE_SCOPE("optimize_mesh");
+
+    MeshOptimizer mesh_optimizer;
+    mesh_optimizer.set_thread_count(options.thread_count);
+
+    VertexCacheStatistics statistics_before = mesh_optimizer.analyze_vertex_cache(indexed_buffer_data);
+
+    mesh_optimizer.optimize_vertex_cache(indexed_buffer_data);
+    if (options.optimize_overdraw) {
+        mesh_optimizer.optimize_overdraw(indexed_buffer_data);
+    }
+    mesh_optimizer.optimize_vertex_fetch(indexed_buffer_data);
+
+    VertexCacheStatistics statistics_after = mesh_optimizer.analyze_vertex_cache(indexed_buffer_data);
+
+    std::cout << "Vertex cache ACMR: " << statistics_before.acmr << " => " << statistics_after.acmr << std::endl;
+    std::cout << "Vertex cache ATVR: " << statistics_before.atvr << " => " << statistics_after.atvr << std::endl;
+}
+
+// --------------------------------------------------------------------------
+
+EncodedVertexBuffer get_vertex_buffer_layout(const IndexedBufferData& indexed_buffer_data, const CommandLineOptions& options, const ModelExtents& vertex_extents) {
+    // The vertices are only encoded once there's a GPU buffer to encode them into.
+    VertexEncoder vertex_encoder;
+    EncodedVertexBuffer encoded_vertex_buffer = vertex_encoder.get_layout(options.vertex_format, indexed_buffer_data.vertex_count, vertex_extents);
+
+    const char* vertex_format_names[] = { "float", "oct16", "packed" };
+    std::cout << std::endl;
+    std::cout << "Vertex format: " << vertex_format_names[(int)encoded_vertex_buffer.format] << " (" << encoded_vertex_buffer.bytes_per_vertex << " bytes per vertex)" << std::endl;
+    std::cout << "Vertex buffer size: " << (size_t)encoded_vertex_buffer.vertex_count * encoded_vertex_buffer.bytes_per_vertex << " bytes" << std::endl;
+
+    return encoded_vertex_buffer;
+}
+
+// --------------------------------------------------------------------------
+
+std::optional<IndexedBufferData> load_scene_mesh(const std::string& file_path, const CommandLineOptions& options) {
+    // Runs on the scene's worker threads, one file per thread, so each step runs serially and quietly.
+    ObjLoader obj_loader;
+    obj_loader.set_thread_count(1);
+    std::optional<Model> model = obj_loader.load_from_file(file_path);
+    if (!model.has_value()) {
+        return std::nullopt;
+    }
+
+    if (options.generate_normals || model->has_missing_normals()) {
+        NormalGenerator normal_generator;
+        normal_generator.set_thread_count(1);
+        normal_generator.set_weighting(options.normal_weighting);
+        normal_generator.set_crease_angle(options.crease_angle_degrees);
+        normal_generator.generate(model.value(), options.normal_type);
+    }
+
+    IndexedBufferData indexed_buffer_data = model->get_indexed_buffer_data();
+
+    if (options.optimize_mesh) {
+        MeshOptimizer mesh_optimizer;
+        mesh_optimizer.set_thread_count(1);
+        mesh_optimizer.optimize_vertex_cache(indexed_buffer_data);
+        if (options.optimize_overdraw) {
+            mesh_optimizer.optimize_overdraw(indexed_buffer_data);
+        }
+        mesh_optimizer.optimize_vertex_fetch(indexed_buffer_data);
+    }
+
+    return indexed_buffer_data;
+}
+
+// --------------------------------------------------------------------------
+
+void generate_normals(Model& model, const CommandLineOptions& options) {
+    PROFILE_SCOPE("generate_normals");
+
+    NormalGenerator normal_generator;
+    normal_generator.set_thread_count(options.thread_count);
+    normal_generator.set_weighting(options.normal_weighting);
+    normal_generator.set_crease_angle(options.crease_angle_degrees);
+
+    std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+    normal_generator.generate(model, options.normal_type);
+    std::chrono::duration<double, std::milli> elapsed_time = std::chrono::steady_clock::now() - start_time;
+
+    const char* normal_type_name = options.normal_type == NormalType::FLAT ? "flat" : "smooth";
+    std::cout << "Generated " << model.get_normals().size() << " " << normal_type_name << " normals in " << elapsed_time.count() << " ms" << std::endl;
+}
+
+// --------------------------------------------------------------------------
+
+std::vector<LevelOfDetail> build_levels_of_detail(IndexedBufferData& indexed_buffer_data, const CommandLineOptions& options, float model_size) {
+    PROFILE_SCOPE("build_levels_of_detail");
+
+    MeshSimplifier mesh_simplifier;
+    mesh_simplifier.set_thread_count(options.thread_count);
+
+    std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+    std::vector<LevelOfDetail> levels_of_detail = mesh_simplifier.build_levels_of_detail(indexed_buffer_data, options.level_of_detail_count);
+    std::chrono::duration<double, std::milli> elapsed_time = std::chrono::steady_clock::now() - start_time;
+
+    std::cout << "Built " << levels_of_detail.size() << " levels of detail in " << elapsed_time.count() << " ms" << std::endl;
+    for (size_t level = 0; level < levels_of_detail.size(); level++) {
+        const LevelOfDetail& level_of_detail = levels_of_detail[level];
+        std::cout << "  LOD " << level << ": " << (level_of_detail.index_count / 3) << " triangles, error " << level_of_detail.error
+                  << " (" << (100.0f * level_of_detail.error / model_size) << "% of model size)" << std::endl;
+    }
+
+    return levels_of_detail;
+}
+
+// --------------------------------------------------------------------------
+
+std::vector<ClusterCuller> build_clusters(const IndexedBufferData& indexed_buffer_data, const std::vector<LevelOfDetail>& levels_of_detail) {
+    PROFILE_SCOPE("build_clusters");
+
+    std::vector<ClusterCuller> cluster_cullers(levels_of_detail.size());
+    for (size_t level = 0; level < levels_of_detail.size(); level++) {
+        const LevelOfDetail& level_of_detail = levels_of_detail[level];
+        cluster_cullers[level].build_clusters(indexed_buffer_data, level_of_detail.first_index, level_of_detail.index_count);
+
+        int cluster_count = cluster_cullers[level].get_clusters().size();
+        float average_cluster_triangle_count = cluster_count > 0 ? (float)level_of_detail.index_count / 3 / cluster_count : 0.0f;
+        std::cout << "Clusters";
+        if (levels_of_detail.size() > 1) {
+            std::cout << " (LOD " << level << ")";
+        }
+        std::cout << ": " << cluster_count << " (" << average_cluster_triangle_count << " triangles on average)" << std::endl;
+    }
+
+    return cluster_cullers;
+}
+
+// --------------------------------------------------------------------------
+
+int select_level_of_detail(const std::vector<LevelOfDetail>& levels_of_detail, float camera_distance, float model_radius, int viewport_height, float fov_y) {
+    // Picks the coarsest level whose error stays under a pixel at the point of the model's
+    // bounding sphere nearest to the camera.
+    const float MAX_PIXEL_ERROR = 1.0f;
+
+    float nearest_distance = camera_distance - model_radius;
+    if (nearest_distance <= 0.0f) {
+        return 0;
+    }
+
+    float pixels_per_unit = viewport_height / (2.0f * nearest_distance * glm::tan(fov_y / 2.0f));
+
+    int level = 0;
+    while (level + 1 < (int)levels_of_detail.size() && levels_of_detail[level + 1].error * pixels_per_unit <= MAX_PIXEL_ERROR) {
+        level++;
+    }
+
+    return level;
+}
+
+// --------------------------------------------------------------------------
+
+void build_bounding_volume_hierarchy(BoundingVolumeHierarchy& bounding_volume_hierarchy, const Model& model, const CommandLineOptions& options) {
+    PROFILE_SCOPE("build_bounding_volume_hierarchy");
+
+    bounding_volume_hierarchy.set_thread_count(options.thread_count);
+
+    std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+    bounding_volume_hierarchy.build(model);
+    std::chrono::duration<double, std::milli> elapsed_time = std::chrono::steady_clock::now() - start_time;
+
+    std::cout << "Built BVH with " << bounding_volume_hierarchy.get_nodes().size() << " nodes and depth " << bounding_volume_hierarchy.get_depth()
+              << " in " << elapsed_time.count() << " ms" << std::endl;
+}
+
+// --------------------------------------------------------------------------
+
+void pick_face(const BoundingVolumeHierarchy& bounding_volume_hierarchy, const Ray& ray, const glm::mat4& model_matrix) {
+    std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+    std::optional<RayHit> hit = bounding_volume_hierarchy.intersect(ray);
+    std::chrono::duration<double, std::micro> elapsed_time = std::chrono::steady_clock::now() - start_time;
+
+    if (!hit.has_value()) {
+        std::cout << "Picked nothing in " << elapsed_time.count() << " us" << std::endl;
+        return;
+    }
+
+    // Faces and vertices are numbered from 1, as in the OBJ file.
+    glm::vec3 world_position = glm::vec3(model_matrix * glm::vec4(hit->position, 1.0f));
+    std::cout << "Picked face " << (hit->face_index + 1) << ", vertex " << (hit->vertex_index + 1)
+              << " at " << glm::to_string(world_position) << " in " << elapsed_time.count() << " us" << std::endl;
+}
+
+// --------------------------------------------------------------------------
+
+void print_texture_report(const TextureCache& texture_cache, const TexturePool& texture_pool, double wait_ms) {
+    const double BYTES_PER_MB = 1024.0 * 1024.0;
+
+    TextureCacheStatistics statistics = texture_cache.get_statistics();
+    std::cout << "Textures: " << statistics.request_count << " requested, " << statistics.file_count << " files, "
+              << statistics.duplicate_content_count << " duplicates by content, " << statistics.failed_count << " failed" << std::endl;
+    std::cout << "Texture decoding: " << statistics.decode_ms << " ms on background threads, " << wait_ms << " ms waited for after loading" << std::endl;
+
+    for (int texture_index = 0; texture_index < texture_cache.get_texture_count(); texture_index++) {
+        const DecodedTexture& texture = texture_cache.get_texture(texture_index);
+        if (texture.is_decoded) {
+            std::cout << "  " << texture.file_path << ": " << texture.width << "x" << texture.height << ", "
+                      << texture.level_count << " levels, " << (texture.size_in_bytes / BYTES_PER_MB) << " MB" << std::endl;
+        }
+    }
+
+    std::cout << "Texture memory: " << (texture_pool.get_size_in_bytes() / BYTES_PER_MB) << " MB in " << texture_pool.get_texture_count() << " textures (mipmaps included)" << std::endl;
+}
+
+// --------------------------------------------------------------------------
+
+std::vector<SubmeshMaterial> resolve_submesh_materials(const std::vector<Submesh>& submeshes, const std::vector<std::string>& material_names, const MaterialLibrary& material_library,
+                                                      const TextureCache& texture_cache, const TexturePool& texture_pool, const SubmeshMaterial& default_material) {
+    // Faces before any usemtl, and materials no library defines, keep the default look.
+    std::vector<SubmeshMaterial> submesh_materials;
+    std::vector<bool> is_missing_reported(material_names.size(), false);
+    for (const Submesh& submesh : submeshes) {
+        const Material* material = submesh.material_index >= 0 ? material_library.find(material_names[submesh.material_index]) : nullptr;
+        if (material == nullptr) {
+            if (submesh.material_index >= 0 && !is_missing_reported[submesh.material_index]) {
+                std::cerr << "[WARN] Material \"" << material_names[submesh.material_index] << "\" isn't defined in any material library" << std::endl;
+                is_missing_reported[submesh.material_index] = true;
+            }
+            submesh_materials.push_back(default_material);
+            continue;
+        }
+
+        GLuint texture = texture_pool.get_texture(texture_cache.get_texture_index(material->diffuse_texture));
+        submesh_materials.push_back({material->diffuse_color, material->specular_color, material->shininess, texture});
+    }
+
+    return submesh_materials;
+}
+
+// --------------------------------------------------------------------------
+
+#ifdef ENABLE_PROFILING
+void record_gpu_timings(GpuTimer& gpu_timer, FrameTimeSummary& frame_time_summary) {
+    // GPU intervals go on their own track, starting where the CPU issued them.
+    Profiler& profiler = Profiler::get_instance();
+    for (const GpuTiming& gpu_timing : gpu_timer.collect_results()) {
+        if (profiler.is_tracing()) {
+            profiler.add_event(gpu_timing.name, "gpu", Profiler::GPU_THREAD_ID, gpu_timing.cpu_start_us, (int64_t)(gpu_timing.elapsed_ms * 1000.0));
+        }
+        frame_time_summary.add_gpu_frame_time(gpu_timing.elapsed_ms);
+    }
+}
+
+// --------------------------------------------------------------------------
+#endif
+
+void write_benchmark_results(const Benchmark& benchmark, const CommandLineOptions& options, const std::string& file_path) {
+    if (options.benchmark_output_path.empty()) {
+        benchmark.write_json(std::cout, file_path, INITIAL_WINDOW_WIDTH, INITIAL_WINDOW_HEIGHT);
+        return;
+    }
+
+    std::ofstream benchmark_output(options.benchmark_output_path);
+    if (!benchmark_output) {
+        std::cerr << "[ERROR] Could not open benchmark output file \"" << options.benchmark_output_path << "\"" << std::endl;
+    } else {
+        benchmark.write_json(benchmark_output, file_path, INITIAL_WINDOW_WIDTH, INITIAL_WINDOW_HEIGHT);
+    }
+}
+
+// --------------------------------------------------------------------------
+
+void write_memory_statistics(const CommandLineOptions& options, const std::string& file_path, const std::optional<GpuMemoryStatistics>& gpu_statistics) {
+    if (!options.print_memory_statistics) {
+        return;
+    }
+
+    const MemoryTracker& memory_tracker = MemoryTracker::get_instance();
+    if (options.memory_statistics_output_path.empty()) {
+        memory_tracker.write_json(std::cout, file_path, gpu_statistics);
+        return;
+    }
+
+    std::ofstream memory_statistics_output(options.memory_statistics_output_path);
+    if (!memory_statistics_output) {
+        std::cerr << "[ERROR] Could not open memory statistics output file \"" << options.memory_statistics_output_path << "\"" << std::endl;
+    } else {
+        memory_tracker.write_json(memory_statistics_output, file_path, gpu_statistics);
+    }
+}
+
+// --------------------------------------------------------------------------
+
+long long get_buffer_size(GLuint buffer) {
+    if (buffer == 0) {
+        return 0;
+    }
+
+    GLint64 size_in_bytes = 0;
+    glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+    glGetBufferParameteri64v(GL_COPY_READ_BUFFER, GL_BUFFER_SIZE, &size_in_bytes);
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    return size_in_bytes;
+}
+
+// --------------------------------------------------------------------------
+
+void print_turntable_summary(const ImageSequenceWriter& image_sequence_writer, const CommandLineOptions& options) {
+    ImageSequenceStatistics statistics = image_sequence_writer.get_statistics();
+    double elapsed_seconds = statistics.elapsed_ms / 1000.0;
+
+    std::cout << std::endl;
+    std::cout << "Wrote " << statistics.written_count << " of " << options.turntable_frame_count << " frames to " << options.turntable_output_pattern;
+    if (statistics.failed_count > 0) {
+        std::cout << " (" << statistics.failed_count << " failed)";
+    }
+    std::cout << " in " << elapsed_seconds << " s";
+    if (elapsed_seconds > 0.0) {
+        std::cout << " (" << (statistics.written_count / elapsed_seconds) << " frames/s)";
+    }
+    std::cout << std::endl;
+
+    std::cout << "Encoding: " << (statistics.encode_ms / 1000.0) << " s on " << image_sequence_writer.get_thread_count() << " threads";
+    if (statistics.elapsed_ms > 0.0) {
+        std::cout << " (" << (statistics.encode_ms / statistics.elapsed_ms) << "x the wall time)";
+    }
+    std::cout << ", " << (statistics.size_in_bytes / (1024.0 * 1024.0)) << " MB written" << std::endl;
+}
+
+// --------------------------------------------------------------------------
+
+int run_software_renderer(const CommandLineOptions& options, const BufferDataView& buffer_data_view, const LevelOfDetail& level_of_detail,
+                          const ModelExtents& extents, glm::vec3 dimensions, Benchmark& benchmark, ImageSequenceWriter& image_sequence_writer,
+                          const std::string& file_path) {
+    // Draws the model with the CPU rasterizer, for machines without OpenGL 3.3. --bench,
+    // --render-image and --turntable run headless; otherwise each frame is copied into a plain
+    // window. Materials aren't drawn, so the whole model gets the default color, always at
+    // full detail.
+    bool is_benchmark = options.benchmark_frame_count > 0;
+    bool is_turntable = options.turntable_frame_count > 0;
+    bool is_headless = is_benchmark || is_turntable || !options.render_image_path.empty();
+    long long triangle_count = level_of_detail.index_count / 3;
+
+    SoftwareRasterizer rasterizer(options.thread_count);
+    rasterizer.set_shading({SUN_DIRECTION, AMBIENT_LIGHT, BASE_COLOR, DEFAULT_SHININESS});
+    rasterizer.set_mesh(buffer_data_view.vertex_data, buffer_data_view.vertex_count, buffer_data_view.indices + level_of_detail.first_index, level_of_detail.index_count);
+    rasterizer.resize(INITIAL_WINDOW_WIDTH, INITIAL_WINDOW_HEIGHT);
+
+    std::cout << std::endl;
+    std::cout << "Renderer: CPU rasterizer with " << rasterizer.get_thread_count() << " threads" << std::endl;
+
+    glm::mat4 centered_model_translation = glm::translate(glm::mat4(1.0), -0.5f * (extents.min + extents.max));
+    float rotation_degrees_x = 0.0f;
+    float rotation_degrees_y = 0.0f;
+
+    WindowResizeChanges window_resize_changes = get_window_resize_changes(INITIAL_WINDOW_WIDTH, INITIAL_WINDOW_HEIGHT);
+    float rotation_degrees_per_pixel = window_resize_changes.rotation_degrees_per_pixel;
+    float aspect_ratio = window_resize_changes.aspect_ratio;
+
+    const float FOV_X = 2.0f * glm::atan(glm::tan(FOV_Y / 2.0f) * aspect_ratio);
+    float initial_camera_z = calculate_initial_camera_distance_to_object(dimensions, FOV_X, FOV_Y) + NEAR_CLIP_PLANE_DISTANCE;
+    glm::vec3 camera_position = glm::vec3(0.0f, 0.0f, initial_camera_z);
+
+    auto render_frame = [&]() {
+        glm::mat4 rotation_x = glm::rotate(glm::mat4(1.0f), glm::radians(rotation_degrees_x), glm::vec3(1.0f, 0.0f, 0.0f));
+        glm::mat4 rotation_y = glm::rotate(glm::mat4(1.0f), glm::radians(rotation_degrees_y), glm::vec3(0.0f, 1.0f, 0.0f));
+        glm::mat4 model_matrix = rotation_x * rotation_y * centered_model_translation;
+        glm::mat4 view_matrix = glm::lookAt(camera_position, camera_position + glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+        glm::mat4 projection_matrix = glm::perspective(FOV_Y, aspect_ratio, NEAR_CLIP_PLANE_DISTANCE, FAR_CLIP_PLANE_DISTANCE);
+        rasterizer.render(model_matrix, view_matrix, projection_matrix, camera_position);
+    };
+
+    if (is_benchmark) {
+        // The same camera path as the OpenGL benchmark, so the two can be compared frame for frame.
+        RasterizerStatistics totals = {0, 0, 0.0, 0.0, 0.0, 0.0};
+        for (int frame_index = -BENCHMARK_WARMUP_FRAME_COUNT; frame_index < options.benchmark_frame_count; frame_index++) {
+            CameraPose camera_pose = Benchmark::get_camera_pose(std::max(frame_index, 0), options.benchmark_frame_count);
+            rotation_degrees_x = camera_pose.rotation_degrees_x;
+            rotation_degrees_y = camera_pose.rotation_degrees_y;
+            camera_position.z = initial_camera_z * camera_pose.camera_distance_scale;
+
+            std::chrono::steady_clock::time_point frame_start_time = std::chrono::steady_clock::now();
+            PROFILE_SCOPE("frame");
+            render_frame();
+            std::chrono::duration<double, std::milli> frame_time = std::chrono::steady_clock::now() - frame_start_time;
+
+            if (frame_index >= 0) {
+                benchmark.add_frame_time(frame_time.count());
+
+                const RasterizerStatistics& statistics = rasterizer.get_statistics();
+                totals.rasterized_triangle_count += statistics.rasterized_triangle_count;
+                totals.transform_ms += statistics.transform_ms;
+                totals.binning_ms += statistics.binning_ms;
+                totals.rasterization_ms += statistics.rasterization_ms;
+            }
+        }
+
+        int frame_count = options.benchmark_frame_count;
+        std::cout << "Per frame: transform " << (totals.transform_ms / frame_count) << " ms, binning " << (totals.binning_ms / frame_count)
+                  << " ms, rasterization " << (totals.rasterization_ms / frame_count) << " ms, "
+                  << (totals.rasterized_triangle_count / frame_count) << " of " << triangle_count << " triangles on screen" << std::endl;
+
+        benchmark.set_renderer("CPU rasterizer (" + std::to_string(rasterizer.get_thread_count()) + " threads)", triangle_count);
+        write_benchmark_results(benchmark, options, file_path);
+    }
+
+    if (!options.render_image_path.empty() || is_turntable) {
+        // Saved images have a size of their own, and the camera is fitted to it.
+        rasterizer.resize(options.image_width, options.image_height);
+        aspect_ratio = (float)options.image_width / options.image_height;
+        float image_fov_x = 2.0f * glm::atan(glm::tan(FOV_Y / 2.0f) * aspect_ratio);
+        initial_camera_z = calculate_initial_camera_distance_to_object(dimensions, image_fov_x, FOV_Y) + NEAR_CLIP_PLANE_DISTANCE;
+    }
+
+    if (!options.render_image_path.empty()) {
+        // Always the starting view, even after a benchmark has moved the camera.
+        rotation_degrees_x = 0.0f;
+        rotation_degrees_y = 0.0f;
+        camera_position.z = initial_camera_z;
+        render_frame();
+
+        ImageWriter image_writer;
+        if (!image_writer.write(rasterizer.get_image(), options.render_image_path)) {
+            return EXIT_FAILURE;
+        }
+        std::cout << "Wrote " << options.render_image_path << " in " << rasterizer.get_statistics().frame_ms << " ms" << std::endl;
+    }
+
+    if (is_turntable) {
+        // Each frame is copied out as soon as it's drawn, so encoding overlaps the next frame.
+        camera_position.z = initial_camera_z;
+        for (int frame_index = 0; frame_index < options.turntable_frame_count; frame_index++) {
+            rotation_degrees_x = options.turntable_elevation_degrees;
+            rotation_degrees_y = 360.0f * frame_index / options.turntable_frame_count;
+
+            PROFILE_SCOPE("frame");
+            render_frame();
+            image_sequence_writer.write(frame_index, rasterizer.get_image());
+        }
+
+        bool is_written = image_sequence_writer.finish();
+        print_turntable_summary(image_sequence_writer, options);
+        if (!is_written) {
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (is_headless) {
+        return EXIT_SUCCESS;
+    }
+
+    if (!SDL_Init(SDL_INIT_VIDEO)) {
+        std::cerr << "SDL_Init Error: " << SDL_GetError() << "\n";
+        return EXIT_FAILURE;
+    }
+
+    SDL_Window* window = SDL_CreateWindow(get_window_title(file_path).c_str(), INITIAL_WINDOW_WIDTH, INITIAL_WINDOW_HEIGHT, SDL_WINDOW_RESIZABLE);
+    if (!window) {
+        std::cerr << "SDL_CreateWindow Error: " << SDL_GetError() << "\n";
+        SDL_Quit();
+        return EXIT_FAILURE;
+    }
 
-    return true;
-}
+    MouseHandler mouse_handler(window);
 
-// --------------------------------------------------------------------------
+    // Frames cost far more than on a GPU, so one is only drawn when something has changed.
+    const Uint64 FRAME_REPORT_INTERVAL_MS = 1000;
+    int reported_frame_count = 0;
+    double reported_frame_ms = 0.0;
+    long long reported_triangle_count = 0;
+    Uint64 last_frame_report_time = SDL_GetTicks();
 
-bool check_shader_compilation(GLuint shader, const std::string& shader_type) {
-    GLint success;
-    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
-    if (!success) {
-        char infoLog[512];
-        glGetShaderInfoLog(shader, 512, nullptr, infoLog);
-        std::cerr << shader_type << "shader compilation failed:\n" << infoLog << "\n";
-        return false;
-    }
-    return true;
-}
+    bool is_frame_dirty = true;
+    bool running = true;
+    SDL_Event event;
+    while (running) {
+        glm::vec2 mouse_drag_motion = glm::vec2(0.0f, 0.0f);
+        float mouse_wheel_motion = 0.0f;
 
-// --------------------------------------------------------------------------
+        bool has_event = is_frame_dirty ? SDL_PollEvent(&event) : SDL_WaitEvent(&event);
+        for (; has_event; has_event = SDL_PollEvent(&event)) {
+            if (event.type == SDL_EVENT_QUIT) {
+                running = false;
+            } else if (event.type == SDL_EVENT_KEY_DOWN) {
+                if (event.key.scancode == SDL_SCANCODE_ESCAPE) {
+                    running = false;
+                }
+            } else if (event.type == SDL_EVENT_MOUSE_BUTTON_DOWN && event.button.button == SDL_BUTTON_LEFT) {
+                mouse_handler.handle_left_button_status(true);
+            } else if (event.type == SDL_EVENT_MOUSE_BUTTON_UP && event.button.button == SDL_BUTTON_LEFT) {
+                mouse_handler.handle_left_button_status(false);
+            } else if (event.type == SDL_EVENT_MOUSE_MOTION) {
+                mouse_drag_motion += mouse_handler.handle_mouse_motion(event.motion.xrel, event.motion.yrel);
+            } else if (event.type == SDL_EVENT_MOUSE_WHEEL) {
+                mouse_wheel_motion += event.wheel.y;
+            } else if (event.type == SDL_EVENT_WINDOW_EXPOSED) {
+                is_frame_dirty = true;
+            } else if (event.type == SDL_EVENT_WINDOW_RESIZED) {
+                WindowResizeChanges window_resize_changes = get_window_resize_changes(event.window.data1, event.window.data2);
+                rotation_degrees_per_pixel = window_resize_changes.rotation_degrees_per_pixel;
+                aspect_ratio = window_resize_changes.aspect_ratio;
+                is_frame_dirty = true;
+            }
+        }
 
-bool check_program_linkage(GLuint program) {
-    GLint success;
-    glGetProgramiv(program, GL_LINK_STATUS, &success);
-    if (!success) {
-        char infoLog[512];
-        glGetProgramInfoLog(program, 512, nullptr, infoLog);
-        std::cerr << "Program linking failed:\n" << infoLog << "\n";
-        return false;
-    }
-    return true;
-}
+        if (mouse_wheel_motion != 0.0f) {
+            camera_position.z += mouse_wheel_motion * DISTANCE_PER_MOUSE_WHEEL;
+            is_frame_dirty = true;
+        }
 
-// --------------------------------------------------------------------------
+        if (mouse_drag_motion.x != 0.0f || mouse_drag_motion.y != 0.0f) {
+            rotation_degrees_x += mouse_drag_motion.y * rotation_degrees_per_pixel;
+            rotation_degrees_y += mouse_drag_motion.x * rotation_degrees_per_pixel;
+            is_frame_dirty = true;
+        }
 
-float calculate_initial_camera_distance_to_object(glm::vec3& dimensions, float fovx, float fovy) {
-    float longest_obj_xz_distance_to_origin = glm::sqrt(0.5 * (dimensions.x * dimensions.x + dimensions.z * dimensions.z));
+        if (!running || !is_frame_dirty) {
+            continue;
+        }
+        is_frame_dirty = false;
+
+        // The window surface may be larger than the window on high density displays, so the
+        // frame is drawn at the surface's size.
+        SDL_Surface* window_surface = SDL_GetWindowSurface(window);
+        if (!window_surface) {
+            std::cerr << "SDL_GetWindowSurface Error: " << SDL_GetError() << "\n";
+            break;
+        }
 
-    float best_vertical_distance = dimensions.y / (2.0f * glm::tan(fovy / 2.0f)) + longest_obj_xz_distance_to_origin;
-    float best_horizontal_distance = glm::max(dimensions.x, dimensions.z) / (2.0f * glm::tan(fovx / 2.0f)) + longest_obj_xz_distance_to_origin;
+        const Image& image = rasterizer.get_image();
+        if (image.width != window_surface->w || image.height != window_surface->h) {
+            rasterizer.resize(window_surface->w, window_surface->h);
+        }
 
-    return glm::max(best_vertical_distance, best_horizontal_distance);
-}
+        PROFILE_SCOPE("frame");
+        render_frame();
 
-// --------------------------------------------------------------------------
+        SDL_Surface* frame_surface = SDL_CreateSurfaceFrom(image.width, image.height, SDL_PIXELFORMAT_RGBA32, (void*)image.pixels.data(), image.width * 4);
+        if (frame_surface) {
+            SDL_BlitSurface(frame_surface, nullptr, window_surface, nullptr);
+            SDL_DestroySurface(frame_surface);
+        }
+        SDL_UpdateWindowSurface(window);
 
-struct WindowResizeChanges {
-    float rotation_degrees_per_pixel;
-    float aspect_ratio;
-};
+        reported_frame_count++;
+        reported_frame_ms += rasterizer.get_statistics().frame_ms;
+        reported_triangle_count += triangle_count;
 
-WindowResizeChanges handle_window_resize(int new_window_width, int new_window_height) {
-    glViewport(0, 0, new_window_width, new_window_height);
+        Uint64 current_time = SDL_GetTicks();
+        if (current_time - last_frame_report_time >= FRAME_REPORT_INTERVAL_MS) {
+            std::cout << "CPU frame: " << (reported_frame_ms / reported_frame_count) << " ms ("
+                      << (reported_triangle_count / (reported_frame_ms * 1000.0)) << " million triangles per second)" << std::endl;
 
-    WindowResizeChanges window_resize_changes;
-    window_resize_changes.rotation_degrees_per_pixel = 360.0f / glm::max(new_window_width, new_window_height);
-    window_resize_changes.aspect_ratio = (float)new_window_width / new_window_height;
+            reported_frame_count = 0;
+            reported_frame_ms = 0.0;
+            reported_triangle_count = 0;
+            last_frame_report_time = current_time;
+        }
+    }
 
-    return window_resize_changes;
+    SDL_DestroyWindow(window);
+    SDL_Quit();
+
+    return EXIT_SUCCESS;
 }
 
 // --------------------------------------------------------------------------
 
 int main(int argc, char** argv) {
-    const int INITIAL_WINDOW_WIDTH = 500;
-    const int INITIAL_WINDOW_HEIGHT = 500;
-
     const char* vertex_shader_file_path = "default.vert";
     const char* fragment_shader_file_path = "default.frag";
 
     std::string program_name = argv[0];
-    if (argc != 2) {
-        std::cerr << "Usage: " << program_name << " OBJ_FILE" << std::endl;
+    CommandLineOptions options;
+    if (!parse_command_line(argc, argv, options)) {
+        print_usage(program_name);
         return EXIT_FAILURE;
     }
 
-    std::string file_path = argv[1];
+#ifdef ENABLE_PROFILING
+    if (!options.trace_file_path.empty()) {
+        Profiler::get_instance().start_tracing();
+    }
+#endif
+
+    if (!options.convert_output_directory.empty()) {
+        int exit_code = convert_files(options);
+        write_memory_statistics(options, options.convert_output_directory, std::nullopt);
+#ifdef ENABLE_PROFILING
+        write_trace_file(options);
+#endif
+        return exit_code;
+    }
 
-    ObjLoader obj_loader;
-    std::optional<Model> loaded_model = obj_loader.load_from_file(file_path);
-    if (!loaded_model.has_value()) {
-        std::cerr << "[ERROR] Could not open file \"" << file_path << "\"" << std::endl;
+    std::string file_path = options.is_scene && options.file_paths.empty() ? options.placement_file_path : options.file_paths[0];
+    bool is_benchmark = options.benchmark_frame_count > 0;
+    bool is_turntable = options.turntable_frame_count > 0;
+
+    // Checked before loading, so a bad output pattern doesn't waste the load.
+    ImageSequenceWriter image_sequence_writer(options.thread_count);
+    if (is_turntable && !image_sequence_writer.open(options.turntable_output_pattern)) {
         return EXIT_FAILURE;
     }
-    Model model = loaded_model.value();
 
-    ModelStatistics statistics = model.get_statistics();
-    std::cout << std::endl;
-    std::cout << "Vertices: " << statistics.vertex_count << std::endl;
-    std::cout << "Normals: " << statistics.normal_count << std::endl;
-    std::cout << "Texture coordinates: " << statistics.texture_coordinate_count << std::endl;
-    std::cout << "Faces: " << statistics.face_count << std::endl;
-    std::cout << std::endl;
+    // Load phases are always timed, but only reported by --bench.
+    Benchmark benchmark;
+
+    // Buffers that are uploaded as they are, rather than rewritten first, are read straight
+    // from the mapped model cache. Otherwise the view points into indexed_buffer_data.
+    ModelCache model_cache;
+    IndexedBufferData indexed_buffer_data;
+    BufferDataView buffer_data_view = {};
+    bool is_buffer_data_mapped = false;
+    EncodedVertexBuffer encoded_vertex_buffer;
+    ModelExtents extents;
+    glm::vec3 dimensions;
+
+    StreamingModelLoader streaming_model_loader;
+    std::vector<LevelOfDetail> levels_of_detail;
+    std::vector<ClusterCuller> cluster_cullers;
+    BoundingVolumeHierarchy bounding_volume_hierarchy;
+    std::vector<SceneMesh> scene_meshes;
+    std::vector<glm::mat4> instance_transforms = { glm::mat4(1.0f) };
+    long long triangles_per_frame = 0;
+
+    // Material libraries are read, and their textures start decoding, as soon as the loader
+    // reaches their mtllib lines. The textures are only waited for once the window is open.
+    TextureCache texture_cache(options.thread_count);
+    texture_cache.set_mipmap_filter(options.mipmap_filter);
+    MaterialLibrary material_library;
+    material_library.set_texture_cache(&texture_cache);
+    std::vector<std::string> material_names;
+    std::vector<Submesh> submeshes;
+    if (options.stream) {
+        streaming_model_loader.set_batch_size(options.batch_size_in_bytes);
+        bool is_started = options.follow ? streaming_model_loader.follow(file_path) : streaming_model_loader.start(file_path);
+        if (!is_started) {
+            std::cerr << "[ERROR] Could not open file \"" << file_path << "\"" << std::endl;
+            return EXIT_FAILURE;
+        }
 
-    ModelExtents extents = model.get_extents();
-    std::cout << "Extents: " << glm::to_string(extents.min) << " => " << glm::to_string(extents.max) << std::endl;
+        if (options.pick) {
+            std::cerr << "[WARN] Picking isn't available while streaming" << std::endl;
+        }
 
-    glm::vec3 dimensions = extents.max - extents.min;
-    std::cout << "Dimensions: " << glm::to_string(dimensions) << std::endl;
+        if (options.follow) {
+            std::cout << "Following \"" << file_path << "\" for appended faces" << std::endl;
+        } else {
+            std::cout << "Streaming " << (streaming_model_loader.get_total_vertex_count() / 3) << " faces in batches of " << (options.batch_size_in_bytes / (1024 * 1024)) << " MB" << std::endl;
+        }
 
-    if (!SDL_Init(SDL_INIT_VIDEO)) {
-        std::cerr << "SDL_Init Error: " << SDL_GetError() << "\n";
-        return EXIT_FAILURE;
+        // Streamed batches are drawn as plain triangles, so the buffer keeps the float layout.
+        encoded_vertex_buffer.format = VertexFormat::FLOAT32;
+        encoded_vertex_buffer.vertex_count = streaming_model_loader.get_total_vertex_count();
+        triangles_per_frame = encoded_vertex_buffer.vertex_count / 3;
+        encoded_vertex_buffer.bytes_per_vertex = Model::FLOATS_PER_BUFFER_VERTEX * sizeof(float);
+        encoded_vertex_buffer.normal_offset = 3 * sizeof(float);
+        encoded_vertex_buffer.position_offset = glm::vec3(0.0f, 0.0f, 0.0f);
+        encoded_vertex_buffer.position_scale = glm::vec3(1.0f, 1.0f, 1.0f);
+
+        extents.min = glm::vec3(0.0f, 0.0f, 0.0f);
+        extents.max = glm::vec3(0.0f, 0.0f, 0.0f);
+        dimensions = glm::vec3(0.0f, 0.0f, 0.0f);
+    } else if (options.is_scene) {
+        PROFILE_SCOPE("load scene");
+
+        std::vector<ScenePlacement> placements;
+        if (!options.placement_file_path.empty()) {
+            std::optional<std::vector<ScenePlacement>> loaded_placements = Scene::load_placements(options.placement_file_path);
+            if (!loaded_placements.has_value()) {
+                return EXIT_FAILURE;
+            }
+            placements = loaded_placements.value();
+        } else {
+            for (const std::string& obj_file_path : options.file_paths) {
+                placements.push_back({obj_file_path, glm::mat4(1.0f)});
+            }
+        }
+
+        if (placements.empty()) {
+            std::cerr << "[ERROR] No placements in \"" << options.placement_file_path << "\"" << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        Scene scene;
+        scene.set_thread_count(options.thread_count);
+        bool is_scene_loaded = scene.load(placements, [&](const std::string& mesh_file_path) {
+            return load_scene_mesh(mesh_file_path, options);
+        });
+        if (!is_scene_loaded) {
+            return EXIT_FAILURE;
+        }
+
+        // Files given on the command line have no placements, so they're laid out side by side.
+        if (options.placement_file_path.empty()) {
+            scene.arrange_in_row();
+        }
+        benchmark.end_phase("load_scene");
+
+        scene_meshes = scene.get_meshes();
+        instance_transforms = scene.get_instance_transforms();
+        indexed_buffer_data = std::move(scene.get_indexed_buffer_data());
+
+        long long triangle_count = 0;
+        for (const SceneMesh& scene_mesh : scene_meshes) {
+            triangle_count += (long long)scene_mesh.index_count / 3 * scene_mesh.instance_count;
+        }
+
+        std::cout << std::endl;
+        std::cout << "Placements: " << instance_transforms.size() << std::endl;
+        std::cout << "Unique meshes: " << scene_meshes.size() << " (" << scene.get_duplicate_file_count() << " duplicate files)" << std::endl;
+        std::cout << "Triangles drawn: " << triangle_count << std::endl;
+        triangles_per_frame = triangle_count;
+        std::cout << "Packed vertices: " << indexed_buffer_data.vertex_count << " (" << (8 * indexed_buffer_data.index_size_in_bytes) << "-bit indices)" << std::endl;
+        std::cout << std::endl;
+
+        extents = scene.get_extents();
+        std::cout << "Extents: " << glm::to_string(extents.min) << " => " << glm::to_string(extents.max) << std::endl;
+
+        dimensions = extents.max - extents.min;
+        std::cout << "Dimensions: " << glm::to_string(dimensions) << std::endl;
+
+        levels_of_detail.push_back({0, (int)indexed_buffer_data.indices.size(), 0.0f});
+
+        encoded_vertex_buffer = get_vertex_buffer_layout(indexed_buffer_data, options, scene.get_vertex_extents());
+    } else {
+        PROFILE_SCOPE("load model");
+
+        model_cache.set_cache_directory(options.cache_directory);
+        model_cache.set_processing_settings({options.generate_normals, options.normal_type, options.normal_weighting, options.crease_angle_degrees,
+                                             options.optimize_mesh, options.optimize_overdraw});
+
+        std::optional<Model> loaded_model;
+        bool is_model_from_cache = false;
+        if (options.use_cache) {
+            loaded_model = model_cache.load(file_path);
+            is_model_from_cache = loaded_model.has_value();
+            if (is_model_from_cache) {
+                std::cout << "Loaded model from cache" << std::endl;
+            }
+        }
+
+        if (!loaded_model.has_value()) {
+            ObjLoader obj_loader;
+            obj_loader.set_thread_count(options.thread_count);
+            obj_loader.set_material_library(&material_library);
+            loaded_model = obj_loader.load_from_file(file_path);
+            if (!loaded_model.has_value()) {
+                std::cerr << "[ERROR] Could not open file \"" << file_path << "\"" << std::endl;
+                return EXIT_FAILURE;
+            }
+
+        }
+        Model model = std::move(loaded_model.value());
+
+        // Only a model from the cache still needs its libraries read; the rest were read while parsing.
+        for (const std::string& material_library_path : model.get_material_library_paths()) {
+            material_library.load(material_library_path);
+        }
+        material_names = model.get_material_names();
+        benchmark.end_phase(is_model_from_cache ? "load_cache" : "parse");
+
+        if (model_cache.has_indexed_buffer_data()) {
+            // Only levels of detail and clusters rewrite the buffers, so without them nothing
+            // is copied out of the cache file before the upload.
+            if (options.cull_clusters || options.level_of_detail_count > 1) {
+                indexed_buffer_data = model_cache.get_indexed_buffer_data();
+            } else {
+                buffer_data_view = model_cache.get_buffer_data_view();
+                is_buffer_data_mapped = true;
+                indexed_buffer_data.vertex_count = buffer_data_view.vertex_count;
+                indexed_buffer_data.index_size_in_bytes = buffer_data_view.index_size_in_bytes;
+                indexed_buffer_data.submeshes.assign(buffer_data_view.submeshes, buffer_data_view.submeshes + buffer_data_view.submesh_count);
+            }
+            benchmark.end_phase("load_cached_buffers");
+
+            // The cache is only used when it was made with the same settings, so its buffers
+            // already had them applied.
+            if (options.optimize_mesh) {
+                std::cout << "Vertex cache: optimized when the cache was built" << std::endl;
+            }
+        } else {
+            if (options.generate_normals || model.has_missing_normals()) {
+                generate_normals(model, options);
+                benchmark.end_phase("normals");
+            }
+
+            indexed_buffer_data = model.get_indexed_buffer_data();
+            benchmark.end_phase("index");
+
+            if (options.optimize_mesh) {
+                optimize_mesh(indexed_buffer_data, options);
+                benchmark.end_phase("optimize");
+            }
+
+            bool is_cache_outdated = !is_model_from_cache || options.cache_buffer_data;
+            if (options.use_cache && is_cache_outdated && !model_cache.store(file_path, model, options.cache_buffer_data ? &indexed_buffer_data : nullptr)) {
+                std::cerr << "[WARN] Could not cache model for \"" << file_path << "\"" << std::endl;
+            }
+            benchmark.restart_phase_timer();
+        }
+
+        ModelStatistics statistics = model.get_statistics(indexed_buffer_data);
+        std::cout << std::endl;
+        std::cout << "Vertices: " << statistics.vertex_count << std::endl;
+        std::cout << "Normals: " << statistics.normal_count << std::endl;
+        std::cout << "Texture coordinates: " << statistics.texture_coordinate_count << std::endl;
+        std::cout << "Faces: " << statistics.face_count << std::endl;
+        std::cout << std::endl;
+        std::cout << "Indexed vertices: " << statistics.indexed_vertex_count << " (" << (8 * statistics.index_size_in_bytes) << "-bit indices)" << std::endl;
+        std::cout << "Deduplication ratio: " << statistics.deduplication_ratio << std::endl;
+        std::cout << "Memory saved by indexing: " << statistics.indexing_bytes_saved << " bytes" << std::endl;
+        std::cout << "Memory used: " << (statistics.model_size_in_bytes / (1024.0 * 1024.0)) << " MB by the model, "
+                  << (statistics.buffer_data_size_in_bytes / (1024.0 * 1024.0)) << " MB by the buffer data" << std::endl;
+        std::cout << std::endl;
+
+        extents = model.get_extents();
+        std::cout << "Extents: " << glm::to_string(extents.min) << " => " << glm::to_string(extents.max) << std::endl;
+
+        dimensions = extents.max - extents.min;
+        std::cout << "Dimensions: " << glm::to_string(dimensions) << std::endl;
+
+        size_t index_count = is_buffer_data_mapped ? buffer_data_view.index_count : indexed_buffer_data.indices.size();
+        submeshes = indexed_buffer_data.submeshes;
+        triangles_per_frame = index_count / 3;
+        if (!submeshes.empty()) {
+            std::cout << "Materials: " << material_names.size() << " used in " << submeshes.size() << " submeshes, " << material_library.get_material_count() << " defined" << std::endl;
+
+            // Levels of detail and clusters would mix triangles from different submeshes.
+            if (options.cull_clusters || options.level_of_detail_count > 1) {
+                std::cerr << "[WARN] --cull and --lod don't support models with materials, so they're turned off" << std::endl;
+                options.cull_clusters = false;
+                options.level_of_detail_count = 1;
+            }
+        }
+
+        if (options.pick) {
+            std::cout << std::endl;
+            benchmark.restart_phase_timer();
+            build_bounding_volume_hierarchy(bounding_volume_hierarchy, model, options);
+            benchmark.end_phase("bvh");
+        }
+
+        // Clustering needs local triangle order, which the vertex cache optimization already gives.
+        if (options.cull_clusters && !options.optimize_mesh) {
+            MeshOptimizer mesh_optimizer;
+            mesh_optimizer.set_thread_count(options.thread_count);
+            benchmark.restart_phase_timer();
+            mesh_optimizer.sort_triangles_spatially(indexed_buffer_data);
+            benchmark.end_phase("spatial_sort");
+        }
+
+        if (options.level_of_detail_count > 1) {
+            std::cout << std::endl;
+            benchmark.restart_phase_timer();
+            levels_of_detail = build_levels_of_detail(indexed_buffer_data, options, glm::length(dimensions));
+            benchmark.end_phase("lod");
+        } else {
+            levels_of_detail.push_back({0, (int)index_count, 0.0f});
+        }
+
+        if (options.cull_clusters) {
+            std::cout << std::endl;
+            benchmark.restart_phase_timer();
+            cluster_cullers = build_clusters(indexed_buffer_data, levels_of_detail);
+            benchmark.end_phase("clusters");
+        }
+
+        encoded_vertex_buffer = get_vertex_buffer_layout(indexed_buffer_data, options, extents);
+    }
+
+    if (!is_buffer_data_mapped) {
+        buffer_data_view = get_buffer_data_view(indexed_buffer_data);
+    }
+
+    // Without an OpenGL 3.3 context, a single model can still be drawn on the CPU.
+    bool can_use_software_renderer = !options.stream && !options.is_scene;
+    auto run_software_renderer_and_trace = [&]() {
+        int exit_code = run_software_renderer(options, buffer_data_view, levels_of_detail[0], extents, dimensions, benchmark, image_sequence_writer, file_path);
+        write_memory_statistics(options, file_path, std::nullopt);
+#ifdef ENABLE_PROFILING
+        write_trace_file(options);
+#endif
+        return exit_code;
+    };
+
+    benchmark.restart_phase_timer();
+
+    if (options.use_software_renderer) {
+        return run_software_renderer_and_trace();
+    }
+
+    if (is_benchmark || is_turntable) {
+        // SDL's offscreen driver renders through EGL without a display server, so the benchmark
+        // and turntables also run on machines without a GPU (e.g. Mesa's llvmpipe).
+        // SDL_VIDEO_DRIVER overrides it.
+        SDL_SetHint(SDL_HINT_VIDEO_DRIVER, "offscreen");
     }
 
-    std::string vertex_shader_source_string;
-    if (!read_file_into_string(vertex_shader_file_path, vertex_shader_source_string)) {
-        std::cerr << "[ERROR] Could not open vertex shader file \"" << vertex_shader_file_path << "\"" << std::endl;
+    if (!SDL_Init(SDL_INIT_VIDEO)) {
+        std::cerr << "SDL_Init Error: " << SDL_GetError() << "\n";
         return EXIT_FAILURE;
     }
-    const char* vertex_shader_source = vertex_shader_source_string.c_str();
 
-    std::string fragment_shader_source_string;
-    if (!read_file_into_string(fragment_shader_file_path, fragment_shader_source_string)) {
-        std::cerr << "[ERROR] Could not open fragment shader file \"" << fragment_shader_file_path << "\"" << std::endl;
+    ShaderManager shader_manager;
+    shader_manager.set_cache_directory(options.shader_cache_directory);
+    if (!shader_manager.load_sources(vertex_shader_file_path, fragment_shader_file_path)) {
         return EXIT_FAILURE;
     }
-    const char* fragment_shader_source = fragment_shader_source_string.c_str();
 
     SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
     SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3);
     SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
 
-    std::string window_title;
-    size_t last_slash_in_file_path_index = file_path.find_last_of('/');
-    if (last_slash_in_file_path_index == std::string::npos) {
-        window_title = file_path;
-    } else {
-        window_title = file_path.substr(last_slash_in_file_path_index + 1);
-    }
-    window_title += " - OBJ Viewer";
-
-    SDL_Window* window = SDL_CreateWindow(window_title.c_str(), INITIAL_WINDOW_WIDTH, INITIAL_WINDOW_HEIGHT, SDL_WINDOW_OPENGL | SDL_WINDOW_RESIZABLE);
+    SDL_WindowFlags window_flags = is_benchmark || is_turntable ? SDL_WINDOW_OPENGL | SDL_WINDOW_HIDDEN : SDL_WINDOW_OPENGL | SDL_WINDOW_RESIZABLE;
+    SDL_Window* window = SDL_CreateWindow(get_window_title(file_path).c_str(), INITIAL_WINDOW_WIDTH, INITIAL_WINDOW_HEIGHT, window_flags);
     if (!window) {
         std::cerr << "SDL_CreateWindow Error: " << SDL_GetError() << "\n";
         SDL_Quit();
@@ -168,60 +1551,165 @@ int main(int argc, char** argv) {
         std::cerr << "SDL_GL_CreateContext Error: " << SDL_GetError() << "\n";
         SDL_DestroyWindow(window);
         SDL_Quit();
-        return EXIT_FAILURE;
+        if (!can_use_software_renderer) {
+            return EXIT_FAILURE;
+        }
+
+        std::cerr << "[WARN] Falling back to the cpu renderer" << std::endl;
+        return run_software_renderer_and_trace();
     }
 
-    SDL_GL_SetSwapInterval(1);
+    // The benchmark measures how fast frames can be drawn, and turntables save them as fast
+    // as they can, so neither waits for vsync.
+    SDL_GL_SetSwapInterval(is_benchmark || is_turntable ? 0 : 1);
 
     glewExperimental = GL_TRUE;
     GLenum glewStatus = glewInit();
     if (glewStatus != GLEW_OK) {
         std::cerr << "GLEW init error: " << glewGetErrorString(glewStatus) << "\n";
-        return EXIT_FAILURE;
-    }
+        SDL_GL_DestroyContext(gl_context);
+        SDL_DestroyWindow(window);
+        SDL_Quit();
+        if (!can_use_software_renderer) {
+            return EXIT_FAILURE;
+        }
 
-    GLuint vertex_shader = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertex_shader, 1, &vertex_shader_source, nullptr);
-    glCompileShader(vertex_shader);
-    if (!check_shader_compilation(vertex_shader, "vertex")) {
-        return EXIT_FAILURE;
+        std::cerr << "[WARN] Falling back to the cpu renderer" << std::endl;
+        return run_software_renderer_and_trace();
     }
+    benchmark.end_phase("context");
 
-    GLuint fragment_shader = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragment_shader, 1, &fragment_shader_source, nullptr);
-    glCompileShader(fragment_shader);
-    if (!check_shader_compilation(fragment_shader, "fragment")) {
-        return EXIT_FAILURE;
-    }
+    const char* renderer_name = reinterpret_cast<const char*>(glGetString(GL_RENDERER));
+    benchmark.set_renderer(renderer_name != nullptr ? renderer_name : "unknown", triangles_per_frame);
 
-    GLuint shader_program = glCreateProgram();
-    glAttachShader(shader_program, vertex_shader);
-    glAttachShader(shader_program, fragment_shader);
-    glLinkProgram(shader_program);
-    if (!check_program_linkage(shader_program)) {
+#ifdef ENABLE_PROFILING
+    GpuTimer gpu_timer;
+    if (!options.trace_file_path.empty() || options.print_frame_statistics) {
+        gpu_timer.initialize();
+    }
+    FrameTimeSummary frame_time_summary;
+#endif
+
+    // The shader is specialized for the vertex layout, so it skips decoding the model doesn't
+    // need. Every layout has normals, and the normal matrix is worked out once per frame.
+    ShaderVariant shader_variant;
+    shader_variant.has_normals = true;
+    shader_variant.has_texture_coordinates = buffer_data_view.texture_coordinate_float_count > 0;
+    shader_variant.has_quantized_positions = encoded_vertex_buffer.format != VertexFormat::FLOAT32;
+    shader_variant.has_octahedral_normals = encoded_vertex_buffer.format == VertexFormat::QUANTIZED_OCTAHEDRAL;
+    shader_variant.has_normal_matrix = true;
+
+    shader_manager.initialize();
+    GLuint shader_program = shader_manager.get_program(shader_variant);
+    if (shader_program == 0) {
         return EXIT_FAILURE;
     }
+    benchmark.end_phase("shaders");
 
-    glDeleteShader(vertex_shader);
-    glDeleteShader(fragment_shader);
+    ShaderStatistics shader_statistics = shader_manager.get_statistics();
+    std::cout << std::endl;
+    std::cout << "Shader programs: " << (shader_statistics.program_count - shader_statistics.cached_program_count) << " compiled and linked in " << shader_statistics.compile_ms << " ms, "
+              << shader_statistics.cached_program_count << " loaded from the binary cache in " << shader_statistics.cache_load_ms << " ms";
+    if (!shader_statistics.is_binary_cache_supported) {
+        std::cout << " (binary cache unavailable)";
+    }
+    std::cout << std::endl;
 
-    GLuint vbo, vao;
+    GLuint vbo, ebo, vao, instance_vbo;
+    GLuint texture_coordinate_vbo = 0;
     glGenVertexArrays(1, &vao);
     glGenBuffers(1, &vbo);
-
-    int buffer_data_size_in_bytes, vertex_count;
-    float* buffer_data = model.get_buffer_data(buffer_data_size_in_bytes, vertex_count);
+    glGenBuffers(1, &ebo);
+    glGenBuffers(1, &instance_vbo);
 
     glBindVertexArray(vao);
     glBindBuffer(GL_ARRAY_BUFFER, vbo);
-    glBufferData(GL_ARRAY_BUFFER, buffer_data_size_in_bytes, buffer_data, GL_STATIC_DRAW);
-    delete[] buffer_data;
 
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(0 * sizeof(float)));
-    glEnableVertexAttribArray(0);
+    BufferUploader buffer_uploader;
+    buffer_uploader.initialize(options.map_buffers);
+    std::cout << "Buffer upload: " << buffer_uploader.get_method_name() << std::endl;
+
+    GLenum index_type = GL_UNSIGNED_INT;
+    int streamed_vertex_count = 0;
+    unsigned char* streamed_vertex_destination = nullptr;
+    GrowableBuffer growable_vertex_buffer;
+    size_t vertex_buffer_size = (size_t)encoded_vertex_buffer.vertex_count * encoded_vertex_buffer.bytes_per_vertex;
+    if (options.follow) {
+        // A followed file has no final size, so its vertices go into a chain of buffers that
+        // starts at one batch and doubles, and vbo stays empty.
+        growable_vertex_buffer.initialize(options.batch_size_in_bytes);
+    } else if (options.stream) {
+        PROFILE_SCOPE("allocate vertex buffer");
+
+        // Sized once for the whole model. With a persistent mapping the loader thread writes
+        // batches straight into it, otherwise they're copied in as they arrive.
+        streamed_vertex_destination = buffer_uploader.map_persistent(GL_ARRAY_BUFFER, vbo, vertex_buffer_size);
+        if (streamed_vertex_destination != nullptr) {
+            streaming_model_loader.set_vertex_destination(streamed_vertex_destination);
+        } else {
+            glBufferData(GL_ARRAY_BUFFER, vertex_buffer_size, nullptr, GL_STATIC_DRAW);
+        }
+    } else {
+        PROFILE_SCOPE("upload buffers");
+
+        VertexEncoder vertex_encoder;
+        vertex_encoder.set_thread_count(options.thread_count);
+        buffer_uploader.upload(GL_ARRAY_BUFFER, vbo, vertex_buffer_size, [&](unsigned char* destination) {
+            vertex_encoder.encode_into(buffer_data_view.vertex_data, encoded_vertex_buffer, destination);
+        });
+
+        index_type = upload_index_buffer(buffer_uploader, ebo, buffer_data_view);
+
+        // Texture coordinates have their own buffer, so models without materials don't pay for them.
+        size_t texture_coordinate_size_in_bytes = buffer_data_view.texture_coordinate_float_count * sizeof(float);
+        if (texture_coordinate_size_in_bytes > 0) {
+            glGenBuffers(1, &texture_coordinate_vbo);
+            buffer_uploader.upload(GL_ARRAY_BUFFER, texture_coordinate_vbo, texture_coordinate_size_in_bytes, [&](unsigned char* destination) {
+                std::memcpy(destination, buffer_data_view.texture_coordinate_data, texture_coordinate_size_in_bytes);
+            });
+        }
 
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
+        std::cout << "Max position error: " << encoded_vertex_buffer.max_position_error << std::endl;
+        std::cout << "Max normal error: " << encoded_vertex_buffer.max_normal_error_degrees << " degrees" << std::endl;
+    }
+
+    indexed_buffer_data = IndexedBufferData();
+    buffer_data_view = {};
+    model_cache.close();
+
+    // A failed mapping may have replaced the buffers, so bind them again before pointing the attributes at them.
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+    set_up_vertex_attributes(encoded_vertex_buffer);
+
+    if (texture_coordinate_vbo != 0) {
+        glBindBuffer(GL_ARRAY_BUFFER, texture_coordinate_vbo);
+        glVertexAttribPointer(6, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
+        glEnableVertexAttribArray(6);
+    }
+
+    // A single model is drawn as one identity instance so every path shares the shader.
+    glBindBuffer(GL_ARRAY_BUFFER, instance_vbo);
+    glBufferData(GL_ARRAY_BUFFER, instance_transforms.size() * sizeof(glm::mat4), instance_transforms.data(), GL_STATIC_DRAW);
+    set_up_instance_attributes(0);
+    buffer_uploader.wait_for_uploads();
+    benchmark.end_phase("upload");
+
+    TexturePool texture_pool;
+    std::vector<SubmeshMaterial> submesh_materials;
+    if (!submeshes.empty()) {
+        std::chrono::steady_clock::time_point wait_start_time = std::chrono::steady_clock::now();
+        texture_cache.wait_for_all();
+        std::chrono::duration<double, std::milli> wait_time = std::chrono::steady_clock::now() - wait_start_time;
+
+        texture_pool.upload(texture_cache);
+        std::cout << std::endl;
+        print_texture_report(texture_cache, texture_pool, wait_time.count());
+
+        SubmeshMaterial default_material = {BASE_COLOR, glm::vec3(1.0f, 1.0f, 1.0f), DEFAULT_SHININESS, 0};
+        submesh_materials = resolve_submesh_materials(submeshes, material_names, material_library, texture_cache, texture_pool, default_material);
+        benchmark.end_phase("textures");
+    }
 
     GLint model_location = glGetUniformLocation(shader_program, "model");
     GLint view_location = glGetUniformLocation(shader_program, "view");
@@ -231,38 +1719,112 @@ int main(int argc, char** argv) {
     GLint ambient_light_location = glGetUniformLocation(shader_program, "ambient_light");
     GLint base_color_location = glGetUniformLocation(shader_program, "base_color");
     GLint shininess_location = glGetUniformLocation(shader_program, "shininess");
-
-    glm::vec3 sun_direction = glm::normalize(glm::vec3(1.0f, -1.0f, -1.0f));
-    glm::vec3 base_color = glm::vec3(0.0f, 1.0f, 0.0f);
+    GLint specular_color_location = glGetUniformLocation(shader_program, "specular_color");
+    GLint has_diffuse_texture_location = glGetUniformLocation(shader_program, "has_diffuse_texture");
+    GLint diffuse_texture_location = glGetUniformLocation(shader_program, "diffuse_texture");
+    GLint position_offset_location = glGetUniformLocation(shader_program, "position_offset");
+    GLint position_scale_location = glGetUniformLocation(shader_program, "position_scale");
+    GLint normal_matrix_location = glGetUniformLocation(shader_program, "normal_matrix");
 
     glm::mat4 centered_model_translation = glm::translate(glm::mat4(1.0), -0.5f * (extents.min + extents.max));
     float rotation_degrees_x = 0.0f;
     float rotation_degrees_y = 0.0f;
 
-    WindowResizeChanges window_resize_changes = handle_window_resize(INITIAL_WINDOW_WIDTH, INITIAL_WINDOW_HEIGHT);
+    // Turntables draw into an offscreen framebuffer at the image size, whatever the window is.
+    FrameReadback frame_readback;
+    int viewport_width = INITIAL_WINDOW_WIDTH;
+    int viewport_height = INITIAL_WINDOW_HEIGHT;
+    if (is_turntable) {
+        if (!frame_readback.initialize(options.image_width, options.image_height)) {
+            return EXIT_FAILURE;
+        }
+        frame_readback.bind_framebuffer();
+        viewport_width = options.image_width;
+        viewport_height = options.image_height;
+    }
+
+    WindowResizeChanges window_resize_changes = handle_window_resize(viewport_width, viewport_height);
     float rotation_degrees_per_pixel = window_resize_changes.rotation_degrees_per_pixel;
     float aspect_ratio = window_resize_changes.aspect_ratio;
+    int window_height = viewport_height;
 
-    const float FOV_Y = glm::radians(45.0f);
     const float FOV_X = 2.0f * glm::atan(glm::tan(FOV_Y / 2.0f) * aspect_ratio);
-    const float NEAR_CLIP_PLANE_DISTANCE = 0.1f;
-    const float FAR_CLIP_PLANE_DISTANCE = 100.0f;
 
     float initial_camera_z = calculate_initial_camera_distance_to_object(dimensions, FOV_X, FOV_Y) + NEAR_CLIP_PLANE_DISTANCE;
     glm::vec3 camera_position = glm::vec3(0.0f, 0.0f, initial_camera_z);
 
     glEnable(GL_DEPTH_TEST);
 
-    const float DISTANCE_PER_MOUSE_WHEEL = 0.1f;
+    // The cone test drops clusters whose faces all point away from the camera, which is only
+    // invisible if back faces aren't drawn anyway. Faces are wound counter-clockwise, as in OBJ.
+    if (options.cull_clusters) {
+        glEnable(GL_CULL_FACE);
+        glCullFace(GL_BACK);
+        glFrontFace(GL_CCW);
+    }
+
+    // The lighting and vertex decoding uniforms never change, so they're set once. The matrices
+    // and camera position are only sent again when their inputs change.
+    glUseProgram(shader_program);
+    glUniform3fv(sun_direction_location, 1, glm::value_ptr(SUN_DIRECTION));
+    glUniform3fv(ambient_light_location, 1, glm::value_ptr(AMBIENT_LIGHT));
+    glUniform3fv(base_color_location, 1, glm::value_ptr(BASE_COLOR));
+    glUniform1f(shininess_location, DEFAULT_SHININESS);
+    glUniform3f(specular_color_location, 1.0f, 1.0f, 1.0f);
+    glUniform1i(has_diffuse_texture_location, GL_FALSE);
+    glUniform1i(diffuse_texture_location, 0);
+    glUniform3fv(position_offset_location, 1, glm::value_ptr(encoded_vertex_buffer.position_offset));
+    glUniform3fv(position_scale_location, 1, glm::value_ptr(encoded_vertex_buffer.position_scale));
+
+    const int STREAMING_POLL_INTERVAL_MS = 10;
+    const Uint64 FOLLOW_REPORT_INTERVAL_MS = 1000;
 
     MouseHandler mouse_handler(window);
 
+    bool is_streaming_reported = false;
+    std::optional<std::chrono::steady_clock::time_point> newest_append_read_time;
+    Uint64 last_follow_report_time = 0;
+    int current_level_of_detail = 0;
+
+    const Uint64 CULLING_REPORT_INTERVAL_MS = 1000;
+
+    VisibleRanges visible_ranges;
+    std::vector<const void*> visible_range_offsets;
+    CullingStatistics culling_totals = {0, 0, 0, 0};
+    int culled_frame_count = 0;
+    Uint64 last_culling_report_time = SDL_GetTicks();
+
+    std::optional<glm::vec2> pick_position;
+
+    // Warm-up frames draw the first pose of the camera path and aren't timed.
+    int benchmark_frame_index = -BENCHMARK_WARMUP_FRAME_COUNT;
+    int turntable_frame_index = 0;
+
+    glm::mat4 model_matrix;
+    glm::mat4 view_matrix;
+    glm::mat4 projection_matrix;
+    bool is_model_matrix_dirty = true;
+    bool is_view_matrix_dirty = true;
+    bool is_projection_matrix_dirty = true;
+    bool is_frame_dirty = true;
+
     bool running = true;
     SDL_Event event;
     while (running) {
         glm::vec2 mouse_drag_motion = glm::vec2(0.0f, 0.0f);
         float mouse_wheel_motion = 0.0f;
-        while (SDL_PollEvent(&event)) {
+
+        // When rendering on demand and nothing needs drawing, sleep until the next event. While
+        // streaming, wake up regularly to pick up new batches.
+        bool has_event;
+        if (options.render_on_demand && !is_frame_dirty) {
+            bool is_streaming = options.stream && !is_streaming_reported;
+            has_event = is_streaming ? SDL_WaitEventTimeout(&event, STREAMING_POLL_INTERVAL_MS) : SDL_WaitEvent(&event);
+        } else {
+            has_event = SDL_PollEvent(&event);
+        }
+
+        for (; has_event; has_event = SDL_PollEvent(&event)) {
             if (event.type == SDL_EVENT_QUIT) {
                 running = false;
             } else if (event.type == SDL_EVENT_KEY_DOWN) {
@@ -273,64 +1835,319 @@ int main(int argc, char** argv) {
                 mouse_handler.handle_left_button_status(true);
             } else if (event.type == SDL_EVENT_MOUSE_BUTTON_UP && event.button.button == SDL_BUTTON_LEFT) {
                 mouse_handler.handle_left_button_status(false);
+            } else if (event.type == SDL_EVENT_MOUSE_BUTTON_DOWN && event.button.button == SDL_BUTTON_RIGHT && options.pick && !options.stream) {
+                pick_position = glm::vec2(event.button.x, event.button.y);
             } else if (event.type == SDL_EVENT_MOUSE_MOTION) {
-                mouse_drag_motion = mouse_handler.handle_mouse_motion(event.motion.xrel, event.motion.yrel);
+                mouse_drag_motion += mouse_handler.handle_mouse_motion(event.motion.xrel, event.motion.yrel);
             } else if (event.type == SDL_EVENT_MOUSE_WHEEL) {
-                mouse_wheel_motion = event.wheel.y;
-            } else if (event.type == SDL_EVENT_WINDOW_RESIZED) {
+                mouse_wheel_motion += event.wheel.y;
+            } else if (event.type == SDL_EVENT_WINDOW_EXPOSED) {
+                is_frame_dirty = true;
+            } else if (event.type == SDL_EVENT_WINDOW_RESIZED && !is_turntable) {
                 int new_window_width = event.window.data1;
                 int new_window_height = event.window.data2;
 
                 WindowResizeChanges window_resize_changes = handle_window_resize(new_window_width, new_window_height);
                 rotation_degrees_per_pixel = window_resize_changes.rotation_degrees_per_pixel;
                 aspect_ratio = window_resize_changes.aspect_ratio;
+                window_height = new_window_height;
+                is_projection_matrix_dirty = true;
+            }
+        }
+
+        if (options.stream) {
+            std::optional<StreamedBatch> batch;
+            while ((batch = streaming_model_loader.poll_batch()).has_value()) {
+                // Batches without data were already written into the mapped buffer by the loader.
+                GLintptr batch_offset = (GLintptr)streamed_vertex_count * encoded_vertex_buffer.bytes_per_vertex;
+                if (options.follow) {
+                    // Only the appended faces are uploaded.
+                    growable_vertex_buffer.append(batch->vertex_data.get(), batch->size_in_bytes);
+                    newest_append_read_time = batch->read_time;
+                } else if (batch->vertex_data != nullptr && streamed_vertex_destination != nullptr) {
+                    std::memcpy(streamed_vertex_destination + batch_offset, batch->vertex_data.get(), batch->size_in_bytes);
+                } else if (batch->vertex_data != nullptr) {
+                    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+                    glBufferSubData(GL_ARRAY_BUFFER, batch_offset, batch->size_in_bytes, batch->vertex_data.get());
+                }
+                streamed_vertex_count += batch->vertex_count;
+
+                // Keep the growing model centered and in view, preserving any zoom the user applied.
+                extents = batch->extents;
+                dimensions = extents.max - extents.min;
+                centered_model_translation = glm::translate(glm::mat4(1.0), -0.5f * (extents.min + extents.max));
+
+                float fitted_camera_z = calculate_initial_camera_distance_to_object(dimensions, FOV_X, FOV_Y) + NEAR_CLIP_PLANE_DISTANCE;
+                camera_position.z += fitted_camera_z - initial_camera_z;
+                initial_camera_z = fitted_camera_z;
+
+                is_model_matrix_dirty = true;
+                is_view_matrix_dirty = true;
+            }
+
+            if (!is_streaming_reported && streaming_model_loader.is_finished()) {
+                is_streaming_reported = true;
+
+                ModelStatistics statistics = streaming_model_loader.get_statistics();
+                std::cout << std::endl;
+                if (streaming_model_loader.has_failed()) {
+                    std::cerr << "[ERROR] Streaming stopped early; showing the faces loaded so far" << std::endl;
+                }
+                std::cout << "Vertices: " << statistics.vertex_count << std::endl;
+                std::cout << "Normals: " << statistics.normal_count << std::endl;
+                std::cout << "Texture coordinates: " << statistics.texture_coordinate_count << std::endl;
+                std::cout << "Faces: " << statistics.face_count << std::endl;
+                std::cout << "Extents: " << glm::to_string(extents.min) << " => " << glm::to_string(extents.max) << std::endl;
             }
         }
 
-        camera_position.z += mouse_wheel_motion * DISTANCE_PER_MOUSE_WHEEL;
+        if (mouse_wheel_motion != 0.0f) {
+            camera_position.z += mouse_wheel_motion * DISTANCE_PER_MOUSE_WHEEL;
+            is_view_matrix_dirty = true;
+        }
 
-        rotation_degrees_x += mouse_drag_motion.y * rotation_degrees_per_pixel;
-        rotation_degrees_y += mouse_drag_motion.x * rotation_degrees_per_pixel;
+        if (mouse_drag_motion.x != 0.0f || mouse_drag_motion.y != 0.0f) {
+            rotation_degrees_x += mouse_drag_motion.y * rotation_degrees_per_pixel;
+            rotation_degrees_y += mouse_drag_motion.x * rotation_degrees_per_pixel;
+            is_model_matrix_dirty = true;
+        }
 
-        glm::mat4 rotation_x = glm::rotate(glm::mat4(1.0f), glm::radians(rotation_degrees_x), glm::vec3(1.0f, 0.0f, 0.0f));
-        glm::mat4 rotation_y = glm::rotate(glm::mat4(1.0f), glm::radians(rotation_degrees_y), glm::vec3(0.0f, 1.0f, 0.0f));
-        glm::mat4 model_matrix = rotation_x * rotation_y * centered_model_translation;
+        if (is_benchmark) {
+            CameraPose camera_pose = Benchmark::get_camera_pose(std::max(benchmark_frame_index, 0), options.benchmark_frame_count);
+            rotation_degrees_x = camera_pose.rotation_degrees_x;
+            rotation_degrees_y = camera_pose.rotation_degrees_y;
+            camera_position.z = initial_camera_z * camera_pose.camera_distance_scale;
+            is_model_matrix_dirty = true;
+            is_view_matrix_dirty = true;
+        }
 
-        glm::mat4 view_matrix = glm::lookAt(
-            camera_position,
-            camera_position + glm::vec3(0.0f, 0.0f, -1.0f),
-            glm::vec3(0.0f, 1.0f, 0.0f)
-        );
+        if (is_turntable) {
+            // One full turn around the vertical axis, tilted towards the camera.
+            rotation_degrees_x = options.turntable_elevation_degrees;
+            rotation_degrees_y = 360.0f * turntable_frame_index / options.turntable_frame_count;
+            is_model_matrix_dirty = true;
+        }
+
+        if (is_model_matrix_dirty) {
+            glm::mat4 rotation_x = glm::rotate(glm::mat4(1.0f), glm::radians(rotation_degrees_x), glm::vec3(1.0f, 0.0f, 0.0f));
+            glm::mat4 rotation_y = glm::rotate(glm::mat4(1.0f), glm::radians(rotation_degrees_y), glm::vec3(0.0f, 1.0f, 0.0f));
+            model_matrix = rotation_x * rotation_y * centered_model_translation;
+            glUniformMatrix4fv(model_location, 1, GL_FALSE, glm::value_ptr(model_matrix));
+
+            glm::mat3 normal_matrix = glm::transpose(glm::inverse(glm::mat3(model_matrix)));
+            glUniformMatrix3fv(normal_matrix_location, 1, GL_FALSE, glm::value_ptr(normal_matrix));
+        }
+
+        if (is_view_matrix_dirty) {
+            view_matrix = glm::lookAt(
+                camera_position,
+                camera_position + glm::vec3(0.0f, 0.0f, -1.0f),
+                glm::vec3(0.0f, 1.0f, 0.0f)
+            );
+            glUniformMatrix4fv(view_location, 1, GL_FALSE, glm::value_ptr(view_matrix));
+            glUniform3fv(camera_world_position_location, 1, glm::value_ptr(camera_position));
+        }
+
+        if (is_projection_matrix_dirty) {
+            projection_matrix = glm::perspective(
+                FOV_Y,
+                aspect_ratio,
+                NEAR_CLIP_PLANE_DISTANCE,
+                FAR_CLIP_PLANE_DISTANCE
+            );
+            glUniformMatrix4fv(projection_location, 1, GL_FALSE, glm::value_ptr(projection_matrix));
+        }
 
-        glm::mat4 projection_matrix = glm::perspective(
-            FOV_Y,
-            aspect_ratio,
-            NEAR_CLIP_PLANE_DISTANCE,
-            FAR_CLIP_PLANE_DISTANCE
-        );
+        is_frame_dirty = is_frame_dirty || is_model_matrix_dirty || is_view_matrix_dirty || is_projection_matrix_dirty;
+        is_model_matrix_dirty = false;
+        is_view_matrix_dirty = false;
+        is_projection_matrix_dirty = false;
+
+        if (pick_position.has_value()) {
+            Ray ray = mouse_handler.create_picking_ray(pick_position->x, pick_position->y, projection_matrix * view_matrix * model_matrix);
+            pick_face(bounding_volume_hierarchy, ray, model_matrix);
+            pick_position.reset();
+        }
+
+        if (options.render_on_demand && !is_frame_dirty) {
+            continue;
+        }
+        is_frame_dirty = false;
+
+        std::chrono::steady_clock::time_point frame_start_time = std::chrono::steady_clock::now();
+        PROFILE_SCOPE("frame");
+
+#ifdef ENABLE_PROFILING
+        record_gpu_timings(gpu_timer, frame_time_summary);
+        gpu_timer.begin("draw");
+#endif
 
         glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-        glUseProgram(shader_program);
-        glUniformMatrix4fv(model_location, 1, GL_FALSE, glm::value_ptr(model_matrix));
-        glUniformMatrix4fv(view_location, 1, GL_FALSE, glm::value_ptr(view_matrix));
-        glUniformMatrix4fv(projection_location, 1, GL_FALSE, glm::value_ptr(projection_matrix));
-        glUniform3fv(camera_world_position_location, 1, glm::value_ptr(camera_position));
-        glUniform3fv(sun_direction_location, 1, glm::value_ptr(sun_direction));
-        glUniform3f(ambient_light_location, 0.2f, 0.2f, 0.2f);
-        glUniform3fv(base_color_location, 1, glm::value_ptr(base_color));
-        glUniform1f(shininess_location, 32.0f);
+        int level = 0;
+        if (!options.stream) {
+            level = select_level_of_detail(levels_of_detail, camera_position.z, 0.5f * glm::length(dimensions), window_height, FOV_Y);
+            if (level != current_level_of_detail && levels_of_detail.size() > 1) {
+                std::cout << "Switched to LOD " << level << " (" << (levels_of_detail[level].index_count / 3) << " triangles)" << std::endl;
+            }
+            current_level_of_detail = level;
+        }
+
+        int index_size_in_bytes = index_type == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
 
         glBindVertexArray(vao);
-        glDrawArrays(GL_TRIANGLES, 0, vertex_count);
+        if (options.follow) {
+            // Each buffer in the chain needs the attributes pointed at it before it's drawn.
+            for (int chunk = 0; chunk < growable_vertex_buffer.get_chunk_count(); chunk++) {
+                glBindBuffer(GL_ARRAY_BUFFER, growable_vertex_buffer.get_chunk_buffer(chunk));
+                set_up_vertex_attributes(encoded_vertex_buffer);
+                glDrawArrays(GL_TRIANGLES, 0, growable_vertex_buffer.get_chunk_size(chunk) / encoded_vertex_buffer.bytes_per_vertex);
+            }
+        } else if (options.stream) {
+            glDrawArrays(GL_TRIANGLES, 0, streamed_vertex_count);
+        } else if (options.cull_clusters) {
+            glm::vec3 object_camera_position = glm::vec3(glm::inverse(model_matrix) * glm::vec4(camera_position, 1.0f));
+            CullingStatistics culling_statistics = cluster_cullers[level].cull(projection_matrix * view_matrix * model_matrix, object_camera_position, visible_ranges);
+
+            visible_range_offsets.resize(visible_ranges.first_indices.size());
+            for (size_t i = 0; i < visible_range_offsets.size(); i++) {
+                visible_range_offsets[i] = (const void*)((intptr_t)visible_ranges.first_indices[i] * index_size_in_bytes);
+            }
+            glMultiDrawElements(GL_TRIANGLES, visible_ranges.index_counts.data(), index_type, visible_range_offsets.data(), visible_range_offsets.size());
+
+            culling_totals.culled_cluster_count += culling_statistics.culled_cluster_count;
+            culling_totals.visible_cluster_count += culling_statistics.visible_cluster_count;
+            culling_totals.culled_triangle_count += culling_statistics.culled_triangle_count;
+            culling_totals.visible_triangle_count += culling_statistics.visible_triangle_count;
+            culled_frame_count++;
+
+            Uint64 current_time = SDL_GetTicks();
+            if (current_time - last_culling_report_time >= CULLING_REPORT_INTERVAL_MS) {
+                long long cluster_count = culling_totals.culled_cluster_count + culling_totals.visible_cluster_count;
+                long long triangle_count = culling_totals.culled_triangle_count + culling_totals.visible_triangle_count;
+                std::cout << "Culled per frame: " << (culling_totals.culled_cluster_count / culled_frame_count) << " of " << (cluster_count / culled_frame_count) << " clusters, "
+                          << (culling_totals.culled_triangle_count / culled_frame_count) << " of " << (triangle_count / culled_frame_count) << " triangles"
+                          << " (" << visible_ranges.first_indices.size() << " draw ranges)" << std::endl;
+
+                culling_totals = {0, 0, 0, 0};
+                culled_frame_count = 0;
+                last_culling_report_time = current_time;
+            }
+        } else if (options.is_scene) {
+            // One draw per unique mesh covers all of its placements.
+            glBindBuffer(GL_ARRAY_BUFFER, instance_vbo);
+            for (const SceneMesh& scene_mesh : scene_meshes) {
+                set_up_instance_attributes(scene_mesh.first_instance);
+                glDrawElementsInstanced(GL_TRIANGLES, scene_mesh.index_count, index_type, (void*)((intptr_t)scene_mesh.first_index * index_size_in_bytes), scene_mesh.instance_count);
+            }
+        } else if (!submesh_materials.empty()) {
+            // One draw per submesh, with its material's uniforms and texture.
+            for (size_t i = 0; i < submeshes.size(); i++) {
+                const SubmeshMaterial& submesh_material = submesh_materials[i];
+                glUniform3fv(base_color_location, 1, glm::value_ptr(submesh_material.diffuse_color));
+                glUniform3fv(specular_color_location, 1, glm::value_ptr(submesh_material.specular_color));
+                glUniform1f(shininess_location, submesh_material.shininess);
+                glUniform1i(has_diffuse_texture_location, submesh_material.texture != 0);
+                glBindTexture(GL_TEXTURE_2D, submesh_material.texture);
+                glDrawElements(GL_TRIANGLES, submeshes[i].index_count, index_type, (void*)((intptr_t)submeshes[i].first_index * index_size_in_bytes));
+            }
+        } else {
+            const LevelOfDetail& level_of_detail = levels_of_detail[level];
+            glDrawElements(GL_TRIANGLES, level_of_detail.index_count, index_type, (void*)((intptr_t)level_of_detail.first_index * index_size_in_bytes));
+        }
+
+#ifdef ENABLE_PROFILING
+        gpu_timer.end();
+
+        std::chrono::duration<double, std::milli> cpu_frame_time = std::chrono::steady_clock::now() - frame_start_time;
+        frame_time_summary.add_cpu_frame_time(cpu_frame_time.count());
+        if (options.print_frame_statistics) {
+            frame_time_summary.print_if_due(Profiler::get_instance().get_time_us());
+        }
+#endif
+
+        if (is_turntable) {
+            // The pixels are copied out asynchronously and picked up a few frames later, so
+            // drawing doesn't wait for them.
+            frame_readback.read_frame(turntable_frame_index, image_sequence_writer);
+            turntable_frame_index++;
+            if (turntable_frame_index >= options.turntable_frame_count) {
+                running = false;
+            }
+        }
 
         SDL_GL_SwapWindow(window);
+
+        if (newest_append_read_time.has_value()) {
+            // How long the newest appended text took to reach the screen, which shouldn't grow with the file.
+            std::chrono::duration<double, std::milli> append_latency = std::chrono::steady_clock::now() - newest_append_read_time.value();
+            newest_append_read_time.reset();
+
+            Uint64 current_time = SDL_GetTicks();
+            if (current_time - last_follow_report_time >= FOLLOW_REPORT_INTERVAL_MS) {
+                std::cout << "Following: " << (streamed_vertex_count / 3) << " faces, newest drawn " << append_latency.count() << " ms after it was read"
+                          << " (" << (growable_vertex_buffer.get_capacity() / (1024 * 1024)) << " MB in " << growable_vertex_buffer.get_chunk_count() << " buffers)" << std::endl;
+                last_follow_report_time = current_time;
+            }
+        }
+
+        if (is_benchmark) {
+            // Without vsync the swap may return before the frame is drawn, so wait for it.
+            glFinish();
+            std::chrono::duration<double, std::milli> frame_time = std::chrono::steady_clock::now() - frame_start_time;
+            if (benchmark_frame_index >= 0) {
+                benchmark.add_frame_time(frame_time.count());
+            }
+
+            benchmark_frame_index++;
+            if (benchmark_frame_index >= options.benchmark_frame_count) {
+                running = false;
+            }
+        }
+    }
+
+    if (is_benchmark) {
+        write_benchmark_results(benchmark, options, file_path);
+    }
+
+    bool is_turntable_written = true;
+    if (is_turntable) {
+        frame_readback.finish(image_sequence_writer);
+        is_turntable_written = image_sequence_writer.finish();
+        print_turntable_summary(image_sequence_writer, options);
+        std::cout << "Readback stalls: " << frame_readback.get_stall_count() << std::endl;
+    }
+
+    // The loader may still be writing into the mapped vertex buffer, so it has to stop before the context goes away.
+    streaming_model_loader.stop();
+
+    if (options.print_memory_statistics) {
+        GpuMemoryStatistics gpu_statistics;
+        gpu_statistics.vertex_buffer_bytes = options.follow ? growable_vertex_buffer.get_capacity() : get_buffer_size(vbo);
+        gpu_statistics.index_buffer_bytes = get_buffer_size(ebo);
+        gpu_statistics.texture_coordinate_buffer_bytes = get_buffer_size(texture_coordinate_vbo);
+        gpu_statistics.instance_buffer_bytes = get_buffer_size(instance_vbo);
+        gpu_statistics.texture_bytes = texture_pool.get_size_in_bytes();
+        gpu_statistics.readback_bytes = frame_readback.get_size_in_bytes();
+        gpu_statistics.total_bytes = gpu_statistics.vertex_buffer_bytes + gpu_statistics.index_buffer_bytes + gpu_statistics.texture_coordinate_buffer_bytes
+            + gpu_statistics.instance_buffer_bytes + gpu_statistics.texture_bytes + gpu_statistics.readback_bytes;
+        write_memory_statistics(options, file_path, gpu_statistics);
     }
 
+    buffer_uploader.destroy();
+    texture_pool.destroy();
+    frame_readback.destroy();
+    shader_manager.destroy();
+
+#ifdef ENABLE_PROFILING
+    gpu_timer.destroy();
+    write_trace_file(options);
+#endif
+
     SDL_GL_DestroyContext(gl_context);
     SDL_DestroyWindow(window);
     SDL_Quit();
 
-    return EXIT_SUCCESS;
+    return is_turntable_written ? EXIT_SUCCESS : EXIT_FAILURE;
 }